@@ -1,7 +1,14 @@
+if(CHERRYSIM_64BIT)
+  set(SIM_ARCHITECTURE_FLAGS "")
+else()
+  set(SIM_ARCHITECTURE_FLAGS "-m32")
+endif()
+
 if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
   if(ENABLE_SANITIZERS)
     set(SANITIZER  "-fsanitize=address -fsanitize=undefined -fsanitize=integer-divide-by-zero -fsanitize=unreachable -fsanitize=vla-bound -fsanitize=null -fsanitize=return -fsanitize=enum -fsanitize=bool -fsanitize=vptr -fsanitize=pointer-overflow")
     target_compile_definitions(cherrySim_tester PRIVATE "SANITIZERS_ENABLED")
+    target_compile_definitions(cherrySim_bench PRIVATE "SANITIZERS_ENABLED")
   else(ENABLE_SANITIZERS)
     set(SANITIZER  "")
   endif(ENABLE_SANITIZERS)
@@ -12,8 +19,8 @@ if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
     set(COVERAGE_FLAGS  "")
   endif()
   
-  set(CMAKE_C_FLAGS           "-include ${PROJECT_SOURCE_DIR}/cherrysim/SystemTest.h -m32 -Wno-unknown-pragmas -fno-builtin -fno-strict-aliasing -fomit-frame-pointer -std=gnu99" CACHE INTERNAL "c compiler flags")
-  set(CMAKE_CXX_FLAGS         "-include ${PROJECT_SOURCE_DIR}/cherrysim/SystemTest.h -m32 -Wno-unknown-pragmas ${COVERAGE_FLAGS} -fno-builtin -fno-strict-aliasing -fomit-frame-pointer -fdata-sections -ffunction-sections -fsingle-precision-constant -std=c++17 -pthread ${SANITIZER} -fno-omit-frame-pointer " CACHE INTERNAL "cxx compiler flags")
+  set(CMAKE_C_FLAGS           "-include ${PROJECT_SOURCE_DIR}/cherrysim/SystemTest.h ${SIM_ARCHITECTURE_FLAGS} -Wno-unknown-pragmas -fno-builtin -fno-strict-aliasing -fomit-frame-pointer -std=gnu99" CACHE INTERNAL "c compiler flags")
+  set(CMAKE_CXX_FLAGS         "-include ${PROJECT_SOURCE_DIR}/cherrysim/SystemTest.h ${SIM_ARCHITECTURE_FLAGS} -Wno-unknown-pragmas ${COVERAGE_FLAGS} -fno-builtin -fno-strict-aliasing -fomit-frame-pointer -fdata-sections -ffunction-sections -fsingle-precision-constant -std=c++17 -pthread ${SANITIZER} -fno-omit-frame-pointer " CACHE INTERNAL "cxx compiler flags")
   set(CMAKE_EXE_LINKER_FLAGS  "-rdynamic ${COVERAGE_FLAGS} ${SANITIZER} -fno-omit-frame-pointer"  CACHE INTERNAL "exe link flags")
 
   set(CMAKE_C_FLAGS_DEBUG     "-Og -g3 -ggdb3"  CACHE INTERNAL "c debug compiler flags")
@@ -59,7 +66,9 @@ elseif(CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
     target_compile_options_multi_lang("${SIMULATOR_TARGETS}" CXX "-Wno-invalid-offsetof") # All modern compilers allow the usage of offsetof within non-standard-layout types.
   endif(NOT EMSCRIPTEN)
   target_compile_options_multi("${SIMULATOR_TARGETS}" "--include=${PROJECT_SOURCE_DIR}/cherrysim/SystemTest.h")
-  target_compile_options_multi("${SIMULATOR_TARGETS}" "-m32")
+  if(NOT CHERRYSIM_64BIT)
+    target_compile_options_multi("${SIMULATOR_TARGETS}" "-m32")
+  endif()
   set(CMAKE_C_FLAGS           "-fno-builtin -fno-strict-aliasing -fomit-frame-pointer -std=gnu99" CACHE INTERNAL "c compiler flags")
   set(CMAKE_CXX_FLAGS         "${COVERAGE_FLAGS} -fno-builtin -fno-strict-aliasing -fomit-frame-pointer -fdata-sections -ffunction-sections -std=c++17 -pthread -fno-omit-frame-pointer " CACHE INTERNAL "cxx compiler flags")
   set(CMAKE_EXE_LINKER_FLAGS  "-rdynamic ${COVERAGE_FLAGS} -fno-omit-frame-pointer"  CACHE INTERNAL "exe link flags")
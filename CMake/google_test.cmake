@@ -63,3 +63,4 @@ endif()
 
 # Link to cherrySim
 target_link_libraries(cherrySim_tester PRIVATE gtest gtest_main)
+target_link_libraries(cherrySim_bench PRIVATE gtest)
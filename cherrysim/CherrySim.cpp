@@ -36,6 +36,7 @@
 #include <FruityHal.h>
 #include <FruityMesh.h>
 #include "PathLossModel.h"
+#include "FlashFileFormat.h"
 
 #include <malloc.h>
 #include <algorithm>
@@ -47,10 +48,7 @@
 #include <functional>
 #include <json.hpp>
 #include <fstream>
-
-extern "C"{
-#include <dbscan.h>
-}
+#include <future>
 
 #include <GlobalState.h>
 #include <Node.h>
@@ -123,6 +121,7 @@ ConnTypeResolver connTypeResolvers[] = {
 // These functions can start / stop / reset the simulator
 //#########################################################################################
 
+//Header of flash files that were written before the FlashFileFormat was introduced
 struct FlashFileHeader
 {
     u32 version;
@@ -131,6 +130,9 @@ struct FlashFileHeader
     u32 amountOfNodes;
 };
 
+//Interval in which the app timer of the firmware fires (MAIN_TIMER_TICK converted to ms)
+static constexpr u32 simAppTimerIntervalMs = (u32)(100L * MAIN_TIMER_TICK * 10 / ticksPerSecond);
+
 bool CherrySim::ShouldSimIvTrigger(u32 ivMs)
 {
     return (currentNode->state.timeMs % ivMs) == 0;
@@ -150,73 +152,486 @@ void CherrySim::StoreFlashToFile()
 {
     if (simConfig.storeFlashToFile == "") return;
 
-    std::ofstream file(simConfig.storeFlashToFile, std::ios::binary);
-    
-    FlashFileHeader ffh;
-    CheckedMemset(&ffh, 0, sizeof(ffh));
+    //The periodic backups only need the flash, capturing the RAM of all nodes would slow down every one of them
+    WriteSnapshotToFile(CaptureSnapshot(false));
+}
 
-    ffh.version = FM_VERSION;
-    ffh.sizeOfHeader = sizeof(ffh);
-    ffh.flashSize = SIM_MAX_FLASH_SIZE;
-    ffh.amountOfNodes = GetTotalNodes();
+void CherrySim::StoreSnapshotToFile()
+{
+    if (simConfig.storeFlashToFile == "") return;
 
-    file.write((const char*)&ffh, sizeof(ffh));
+    WriteSnapshotToFile(CaptureSnapshot(true));
+}
 
-    for (u32 i = 0; i < GetTotalNodes(); i++)
+void CherrySim::WriteSnapshotToFile(SimSnapshot::Snapshot&& snapshot)
+{
+    //Only one write is in flight at a time, usually the previous one finished long ago
+    WaitForFlashFileWrite();
+
+    //Capturing the snapshot only copies memory, encoding and writing it is done in the background. The file
+    //is written next to the previous one and renamed afterwards so that a crash never leaves it half written.
+    flashFileWriter = std::async(std::launch::async, [path = simConfig.storeFlashToFile, snapshot = std::move(snapshot)]() {
+        const std::vector<u8> data = SimSnapshot::Serialize(snapshot);
+        const std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary);
+            file.write((const char*)data.data(), data.size());
+            file.close();
+            if (!file.good()) return false;
+        }
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            //On Windows, rename does not replace an existing file
+            std::remove(path.c_str());
+            if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) return false;
+        }
+        return true;
+    });
+}
+
+void CherrySim::WaitForFlashFileWrite()
+{
+    if (flashFileWriter.valid() && !flashFileWriter.get())
     {
-        file.write((const char*)this->nodes[i].flash, SIM_MAX_FLASH_SIZE);
+        printf("ERROR: The flash file '%s' could not be written!\n", simConfig.storeFlashToFile.c_str());
+        SIMEXCEPTIONFORCE(FileException);
     }
 }
 
+//Returns false if the file does not exist
+bool CherrySim::ReadFlashFile(const std::string& path, std::vector<char>& buffer)
+{
+    std::ifstream infile(path, std::ifstream::binary);
+    if (!infile.good()) return false;
+
+    infile.seekg(0, std::ios::end);
+    size_t length = infile.tellg();
+    infile.seekg(0, std::ios::beg);
+    buffer.resize(length);
+    infile.read(buffer.data(), length);
+
+    //If for some reason the file could not be read properly, we throw an exception
+    if (!infile.good()) {
+        SIMEXCEPTIONFORCE(IllegalStateException);
+    }
+    return true;
+}
+
+bool CherrySim::IsFlashFileHeaderValid(const FlashFileFormat::Header& header) const
+{
+    //=> We are not checking against the version as this is set to the FruityMesh version which is allowed to change
+    return header.magic         == FlashFileFormat::MAGIC
+        && header.sizeOfHeader  == sizeof(header)
+        && header.flashSize     == SIM_MAX_FLASH_SIZE
+        && header.pageSize      == FlashFileFormat::PAGE_SIZE
+        && header.amountOfNodes == GetTotalNodes();
+}
+
 void CherrySim::LoadFlashFromFile()
 {
     if (simConfig.storeFlashToFile == "") return;
 
-    std::ifstream infile(simConfig.storeFlashToFile, std::ifstream::binary);
-
     //If file does not exist we just return
-    if (!infile.good())
+    std::vector<char> buffer;
+    if (!ReadFlashFile(simConfig.storeFlashToFile, buffer))
     {
         printf("WARNING: Flash was not loaded from file as the file '%s' did not exist!", simConfig.storeFlashToFile.c_str());
         return;
     }
+    const size_t length = buffer.size();
 
-    infile.seekg(0, std::ios::end);
-    size_t length = infile.tellg();
-    infile.seekg(0, std::ios::beg);
-    char* buffer = new char[length];
-    infile.read(buffer, length);
+    FlashFileFormat::Header header;
+    CheckedMemset(&header, 0, sizeof(header));
+    if (length >= sizeof(header)) CheckedMemcpy(&header, buffer.data(), sizeof(header));
 
-    //If for some reason the file could not be read properly, we throw an exception
-    if (!infile.good()) {
-        SIMEXCEPTIONFORCE(IllegalStateException);
+    if (header.magic != FlashFileFormat::MAGIC)
+    {
+        LoadLegacyFlashFromFile(buffer);
+        return;
     }
 
+    if (!IsFlashFileHeaderValid(header))
+    {
+        //Probably the correct action if this happens is to just remove the flash safe file (see simConfig.storeFlashToFile)
+        //This is NOT automatically performed here as it would be rather rude to just remove it in case the user accidentally
+        //launched a different version of CherrySim or another config.
+        SIMEXCEPTION(CorruptOrOutdatedSavefile);
+        return;
+    }
+
+    //Each node is restored through an intermediate buffer so that its erased pages stay shared.
+    //The RAM of a snapshot that may follow the flash belongs to another CherrySim and is ignored.
+    const u8* data = (const u8*)buffer.data() + sizeof(header);
+    const u8* end = (const u8*)buffer.data() + length;
+    std::vector<u8> nodeFlash(SIM_MAX_FLASH_SIZE);
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        if (!FlashFileFormat::DeserializeNode(data, end, nodeFlash.data(), SIM_MAX_FLASH_SIZE))
+        {
+            SIMEXCEPTION(CorruptOrOutdatedSavefile);
+            return;
+        }
+        this->nodes[i].flash.Program(0, nodeFlash.data(), SIM_MAX_FLASH_SIZE);
+    }
+}
+
+//Files written before the FlashFileFormat was introduced contain the raw flash of all nodes
+void CherrySim::LoadLegacyFlashFromFile(const std::vector<char>& buffer)
+{
     FlashFileHeader ffh;
     CheckedMemset(&ffh, 0, sizeof(ffh));
-    ffh = *(FlashFileHeader*)(buffer);
+    if (buffer.size() >= sizeof(ffh)) ffh = *(const FlashFileHeader*)(buffer.data());
 
     if (
-        //=> We are not checking against the version as this is set to the FruityMesh version which is allowed to change
            ffh.sizeOfHeader  != sizeof(ffh)
         || ffh.flashSize     != SIM_MAX_FLASH_SIZE
         || ffh.amountOfNodes != GetTotalNodes()
-        || length            != sizeof(ffh) + SIM_MAX_FLASH_SIZE * GetTotalNodes()
+        || buffer.size()     != sizeof(ffh) + SIM_MAX_FLASH_SIZE * GetTotalNodes()
         )
     {
-        //Probably the correct action if this happens is to just remove the flash safe file (see simConfig.storeFlashToFile)
-        //This is NOT automatically performed here as it would be rather rude to just remove it in case the user accidentally
-        //launched a different version of CherrySim or another config.
         SIMEXCEPTION(CorruptOrOutdatedSavefile);
         return;
     }
 
     for (u32 i = 0; i < GetTotalNodes(); i++)
     {
-        CheckedMemcpy(this->nodes[i].flash, buffer + SIM_MAX_FLASH_SIZE * i + sizeof(ffh), SIM_MAX_FLASH_SIZE);
+        this->nodes[i].flash.Program(0, (const u8*)buffer.data() + SIM_MAX_FLASH_SIZE * i + sizeof(ffh), SIM_MAX_FLASH_SIZE);
+    }
+}
+
+//The members of a NodeEntry that are copied raw into a snapshot, in addition to its GlobalState and RAM blocks
+template<typename Entry, typename Function>
+static void ForEachRawNodeMember(Entry& node, Function&& function)
+{
+    function(node.x);
+    function(node.y);
+    function(node.z);
+    function(node.currentFloorNumber);
+    function(node.ficr);
+    function(node.uicr);
+    function(node.gpio);
+    function(node.radio);
+    function(node.state);
+    function(node.led1On);
+    function(node.led2On);
+    function(node.led3On);
+    function(node.nanoAmperePerMsTotal);
+    function(node.restartCounter);
+    function(node.simulatedFrames);
+    function(node.idleFrames);
+    function(node.watchdogTimeout);
+    function(node.lastWatchdogFeedTime);
+    function(node.rebootReason);
+    function(node.bmgWasInit);
+    function(node.twiWasInit);
+    function(node.Tlv49dA1b6WasInit);
+    function(node.spiWasInit);
+    function(node.lis2dh12WasInit);
+    function(node.bme280WasInit);
+    function(node.discoveryAlwaysBusy);
+    function(node.lis2dh12InertialInterruptEnabled);
+    function(node.lastMovementSimTimeMs);
+    function(node.fakeDfuVersion);
+    function(node.fakeDfuVersionArmed);
+    function(node.sentPackets);
+    function(node.routedPackets);
+    function(node.timeslotRadioSignalCallback);
+    function(node.timeslotCloseSessionRequested);
+    function(node.timeslotRequested);
+    function(node.timeslotActive);
+    function(node.retainedRamMemory);
+}
+
+//Keeps the bytes of a member that owns heap memory while the memory around it is overwritten with a raw copy
+template<typename T>
+class PreservedBytes
+{
+private:
+    T& member;
+    alignas(T) u8 bytes[sizeof(T)];
+
+public:
+    explicit PreservedBytes(T& member) : member(member)
+    {
+        memcpy(bytes, (const void*)&member, sizeof(T));
+    }
+    ~PreservedBytes()
+    {
+        memcpy((void*)&member, bytes, sizeof(T));
+    }
+};
+
+SimSnapshot::Snapshot CherrySim::CaptureSnapshot(bool includeState) const
+{
+    static_assert(std::is_trivially_copyable_v<SimulatorState>, "The SimulatorState is copied raw");
+
+    SimSnapshot::Snapshot snapshot(FM_VERSION, SIM_MAX_FLASH_SIZE);
+    if (!includeState)
+    {
+        for (u32 i = 0; i < GetTotalNodes(); i++) snapshot.flash.AddNode(nodes[i].flash.GetData());
+        return snapshot;
+    }
+    SimSnapshot::Writer writer(snapshot.state);
+
+    SimSnapshot::StateHeader header;
+    CheckedMemset(&header, 0, sizeof(header));
+    header.magic                = SimSnapshot::STATE_MAGIC;
+    header.sizeOfHeader         = sizeof(header);
+    header.amountOfNodes        = GetTotalNodes();
+    header.sizeOfSimulatorState = sizeof(SimulatorState);
+    header.sizeOfGlobalState    = sizeof(GlobalState);
+    header.sizeOfNodeEntry      = sizeof(NodeEntry);
+    header.nodesAddress         = (uint64_t)(uintptr_t)nodes;
+    writer.WriteValue(header);
+    writer.WriteValue(simState);
+
+    std::vector<u8> nodeState;
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        snapshot.flash.AddNode(nodes[i].flash.GetData());
+
+        nodeState.clear();
+        CaptureNodeState(nodes[i], nodeState);
+        writer.WriteValue((u32)nodeState.size());
+        writer.Write(nodeState.data(), nodeState.size());
+    }
+
+    return snapshot;
+}
+
+void CherrySim::CaptureNodeState(const NodeEntry& node, std::vector<u8>& out) const
+{
+    SimSnapshot::Writer writer(out);
+
+    SimSnapshot::NodeStateHeader header;
+    CheckedMemset(&header, 0, sizeof(header));
+    header.moduleMemoryBlockAddress = (uint64_t)(uintptr_t)node.moduleMemoryBlock.get();
+    header.halMemoryAddress         = (uint64_t)(uintptr_t)node.halMemory.get();
+    header.moduleMemoryBlockSize    = node.moduleMemoryBlockSize;
+    header.halMemorySize            = node.halMemorySize;
+    writer.WriteValue(header);
+    writer.Write(node.moduleMemoryBlock.get(), node.moduleMemoryBlockSize);
+    writer.Write(node.halMemory.get(), node.halMemorySize);
+
+    //The GlobalState is copied raw, its members that own heap memory are stored by their content
+    writer.Write(&node.gs, sizeof(GlobalState));
+    std::queue<TerminalCommandQueueEntry> terminalCommands = node.gs.terminal.terminalCommandQueue;
+    writer.WriteValue((u32)terminalCommands.size());
+    while (!terminalCommands.empty())
+    {
+        const TerminalCommandQueueEntry& entry = terminalCommands.front();
+        writer.WriteValue((u32)entry.terminalCommand.size());
+        writer.Write(entry.terminalCommand.data(), entry.terminalCommand.size());
+        writer.WriteValue(entry.skipCrcCheck);
+        terminalCommands.pop();
+    }
+    const std::vector<LoadStatistics::SenderStatistics>& senders = node.gs.node.loadStatistics.GetSenders();
+    writer.WriteValue((u32)senders.size());
+    writer.Write(senders.data(), senders.size() * sizeof(LoadStatistics::SenderStatistics));
+
+    ForEachRawNodeMember(node, [&writer](const auto& member) {
+        static_assert(std::is_trivially_copyable_v<std::remove_cv_t<std::remove_reference_t<decltype(member)>>>, "Members of the NodeEntry that own memory must be stored by their content");
+        writer.WriteValue(member);
+    });
+
+    writer.WriteValue(node.eventQueue.GetSize());
+    node.eventQueue.ForEach([&writer](const SimBleEventRecord& record) {
+        writer.WriteValue(record.payloadSize);
+        writer.WriteValue(record.globalId);
+        writer.WriteValue(record.additionalInfo);
+        writer.Write(record.GetEvent(), record.payloadSize);
+    });
+
+    std::queue<u32> interrupts = node.interruptQueue;
+    writer.WriteValue((u32)interrupts.size());
+    while (!interrupts.empty())
+    {
+        writer.WriteValue(interrupts.front());
+        interrupts.pop();
+    }
+    writer.WriteValue((u32)node.gpioInitializedPins.size());
+    for (const auto& pin : node.gpioInitializedPins)
+    {
+        writer.WriteValue(pin.first);
+        writer.WriteValue(pin.second);
+    }
+}
+
+void CherrySim::RestoreSnapshotFromFile()
+{
+    WaitForFlashFileWrite();
+
+    std::vector<char> buffer;
+    if (!ReadFlashFile(simConfig.storeFlashToFile, buffer))
+    {
+        SIMEXCEPTION(CorruptOrOutdatedSavefile);
+        return;
+    }
+    RestoreSnapshot(std::vector<u8>(buffer.begin(), buffer.end()));
+}
+
+//Restoring a snapshot that does not fit would overwrite the RAM of the nodes with garbage, so this is never ignored
+static void ThrowSnapshotMismatch(const char* reason)
+{
+    printf("ERROR: The snapshot can not be restored, %s!\n", reason);
+    SIMEXCEPTIONFORCE(CorruptOrOutdatedSavefile);
+}
+
+void CherrySim::RestoreSnapshot(const std::vector<u8>& serializedSnapshot)
+{
+    const u8* const begin = serializedSnapshot.data();
+    const u8* const end = begin + serializedSnapshot.size();
+
+    FlashFileFormat::Header header;
+    CheckedMemset(&header, 0, sizeof(header));
+    if (serializedSnapshot.size() >= sizeof(header)) CheckedMemcpy(&header, begin, sizeof(header));
+    if (!IsFlashFileHeaderValid(header)) ThrowSnapshotMismatch("the flash header does not match this simulation");
+
+    //Everything is validated before the first node is changed, which is why the flash is decoded twice
+    std::vector<u8> nodeFlash(SIM_MAX_FLASH_SIZE);
+    const u8* const flashData = begin + sizeof(header);
+    const u8* stateData = flashData;
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        if (!FlashFileFormat::DeserializeNode(stateData, end, nodeFlash.data(), SIM_MAX_FLASH_SIZE)) ThrowSnapshotMismatch("the flash is truncated");
+    }
+
+    SimSnapshot::Reader reader(stateData, end);
+    SimSnapshot::StateHeader stateHeader;
+    CheckedMemset(&stateHeader, 0, sizeof(stateHeader));
+    SimulatorState state;
+    if (reader.IsAtEnd()) ThrowSnapshotMismatch("it only contains the flash");
+    if (
+           !reader.ReadValue(stateHeader)
+        || stateHeader.magic                != SimSnapshot::STATE_MAGIC
+        || stateHeader.sizeOfHeader         != sizeof(stateHeader)
+        || stateHeader.amountOfNodes        != GetTotalNodes()
+        )
+    {
+        ThrowSnapshotMismatch("the state header is corrupt");
+    }
+    if (
+           stateHeader.sizeOfSimulatorState != sizeof(SimulatorState)
+        || stateHeader.sizeOfGlobalState    != sizeof(GlobalState)
+        || stateHeader.sizeOfNodeEntry      != sizeof(NodeEntry)
+        )
+    {
+        ThrowSnapshotMismatch("it was captured with a different memory layout");
+    }
+    if (stateHeader.nodesAddress != (uint64_t)(uintptr_t)nodes) ThrowSnapshotMismatch("it was captured by another CherrySim instance or process");
+    if (!reader.ReadValue(state)) ThrowSnapshotMismatch("the SimulatorState is truncated");
+
+    const u8* const nodeStates = reader.GetPosition();
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        u32 length = 0;
+        const u8* nodeState = reader.ReadValue(length) ? reader.Skip(length) : nullptr;
+        SimSnapshot::NodeStateHeader nodeHeader;
+        CheckedMemset(&nodeHeader, 0, sizeof(nodeHeader));
+        if (nodeState == nullptr || length < sizeof(nodeHeader)) ThrowSnapshotMismatch("a node state is truncated");
+        CheckedMemcpy(&nodeHeader, nodeState, sizeof(nodeHeader));
+        if (
+               nodeHeader.moduleMemoryBlockAddress != (uint64_t)(uintptr_t)nodes[i].moduleMemoryBlock.get()
+            || nodeHeader.halMemoryAddress         != (uint64_t)(uintptr_t)nodes[i].halMemory.get()
+            || nodeHeader.moduleMemoryBlockSize    != nodes[i].moduleMemoryBlockSize
+            || nodeHeader.halMemorySize            != nodes[i].halMemorySize
+            )
+        {
+            ThrowSnapshotMismatch("the memory blocks of a node were moved");
+        }
     }
 
-    delete[] buffer;
+    simState = state;
+    const u8* data = flashData;
+    reader = SimSnapshot::Reader(nodeStates, end);
+    for (u32 i = 0; i < GetTotalNodes(); i++)
+    {
+        FlashFileFormat::DeserializeNode(data, end, nodeFlash.data(), SIM_MAX_FLASH_SIZE);
+        nodes[i].flash.Program(0, nodeFlash.data(), SIM_MAX_FLASH_SIZE);
+
+        u32 length = 0;
+        reader.ReadValue(length);
+        const u8* nodeState = reader.Skip(length);
+        SimSnapshot::Reader nodeReader(nodeState, nodeState + length);
+        if (!RestoreNodeState(nodes[i], nodeReader)) ThrowSnapshotMismatch("a node state is corrupt");
+        UpdateSpatialGrid(i);
+    }
+}
+
+bool CherrySim::RestoreNodeState(NodeEntry& node, SimSnapshot::Reader& reader)
+{
+    //The header was already validated by RestoreSnapshot
+    reader.Skip(sizeof(SimSnapshot::NodeStateHeader));
+    bool success = reader.Read(node.moduleMemoryBlock.get(), node.moduleMemoryBlockSize)
+                && reader.Read(node.halMemory.get(), node.halMemorySize);
+
+    {
+        const PreservedBytes<std::queue<TerminalCommandQueueEntry>> terminalCommandQueue(node.gs.terminal.terminalCommandQueue);
+        const PreservedBytes<LoadStatistics> loadStatistics(node.gs.node.loadStatistics);
+        success = success && reader.Read((void*)&node.gs, sizeof(GlobalState));
+    }
+    u32 amountOfTerminalCommands = 0;
+    success = success && reader.ReadValue(amountOfTerminalCommands);
+    node.gs.terminal.terminalCommandQueue = {};
+    for (u32 i = 0; success && i < amountOfTerminalCommands; i++)
+    {
+        TerminalCommandQueueEntry entry;
+        u32 commandLength = 0;
+        const u8* command = reader.ReadValue(commandLength) ? reader.Skip(commandLength) : nullptr;
+        success = command != nullptr && reader.ReadValue(entry.skipCrcCheck);
+        if (success)
+        {
+            entry.terminalCommand.assign((const char*)command, commandLength);
+            node.gs.terminal.terminalCommandQueue.push(entry);
+        }
+    }
+    u32 amountOfSenders = 0;
+    success = success && reader.ReadValue(amountOfSenders);
+    std::vector<LoadStatistics::SenderStatistics> senders(success ? amountOfSenders : 0);
+    success = success && reader.Read(senders.data(), senders.size() * sizeof(LoadStatistics::SenderStatistics));
+    node.gs.node.loadStatistics.SetSenders(senders);
+
+    ForEachRawNodeMember(node, [&reader, &success](auto& member) {
+        success = success && reader.Read((void*)&member, sizeof(member));
+    });
+
+    u32 amountOfEvents = 0;
+    success = success && reader.ReadValue(amountOfEvents);
+    node.eventQueue.Clear();
+    for (u32 i = 0; success && i < amountOfEvents; i++)
+    {
+        simBleEvent event;
+        CheckedMemset(&event, 0, sizeof(event));
+        u32 payloadSize = 0;
+        success = reader.ReadValue(payloadSize)
+               && payloadSize <= sizeof(event.bleEvent) + sizeof(event.bleEventOverflowData)
+               && reader.ReadValue(event.globalId)
+               && reader.ReadValue(event.additionalInfo)
+               && reader.Read(&event.bleEvent, payloadSize);
+        if (success) node.eventQueue.Push(event);
+    }
+
+    u32 amountOfInterrupts = 0;
+    success = success && reader.ReadValue(amountOfInterrupts);
+    node.interruptQueue = {};
+    for (u32 i = 0; success && i < amountOfInterrupts; i++)
+    {
+        u32 pin = 0;
+        success = reader.ReadValue(pin);
+        if (success) node.interruptQueue.push(pin);
+    }
+    u32 amountOfPins = 0;
+    success = success && reader.ReadValue(amountOfPins);
+    node.gpioInitializedPins.clear();
+    for (u32 i = 0; success && i < amountOfPins; i++)
+    {
+        u32 pin = 0;
+        InterruptSettings settings;
+        success = reader.ReadValue(pin) && reader.ReadValue(settings);
+        if (success) node.gpioInitializedPins[pin] = settings;
+    }
+
+    return success && reader.IsAtEnd();
 }
 
 #define AddSimulatedFeatureSet(featureset) \
@@ -414,11 +829,10 @@ std::string CherrySim::RedirectFeatureset(const std::string & oldFeatureset)
 {
     if (IsRedirectedFeatureset(oldFeatureset))
     {
-        trace("Redirecting : %s ", oldFeatureset);
-        trace(" to github_dev_nrf52" EOL);
+        printf("Redirecting : %s ", oldFeatureset.c_str());
+        printf(" to github_dev_nrf52" EOL);
         return "github_dev_nrf52";
     }
-    trace("oldFeatureset: %s", oldFeatureset);
     return oldFeatureset;
 }
 #endif
@@ -506,7 +920,13 @@ CherrySim::CherrySim(const SimConfiguration &simConfig)
 
 CherrySim::~CherrySim()
 {
-    StoreFlashToFile();
+    //A failed write was already reported and must not escape the destructor
+    try
+    {
+        StoreFlashToFile();
+        WaitForFlashFileWrite();
+    }
+    catch (const FileException&) {}
 
     //Clean up up all nodes
     for (u32 i = 0; i < GetTotalNodes(); i++) {
@@ -563,6 +983,7 @@ void CherrySim::Init()
     //This will try to allocate a consecutive range of memory to hold the node data
     //If this call fails because of bad_alloc it means that the OS cannot reserve a consecurive range
     //long enough to hold the data. Remember that CherrySim is a 32bit process
+    //The flash of the nodes is not part of this range, it is mapped separately by each SimFlashMemory
     nodeEntryBuffer.resize(totalSize);
     CheckedMemset(nodeEntryBuffer.data(), 0, nodeEntryBuffer.size());
     nodes = (NodeEntry*)nodeEntryBuffer.data();
@@ -576,6 +997,8 @@ void CherrySim::Init()
         InitNode(i);
     }
 
+    advertisingGrid.Reset(GetTotalNodes());
+
     SetFeaturesets();
 
     GetAssetNodes();
@@ -843,79 +1266,219 @@ void CherrySim::ImportPositionsAndDataFromJson()
     }
 }
 
-void HelperPositionNodesRandomly(CherrySim &instance, std::vector<point_t> &points, u32 numberOfNodesToPlace)
+namespace
 {
-    //Calculate the epsilon using the rssi threshold and the transmission powers
-    double epsilon = pow(10, ((double)-STABLE_CONNECTION_RSSI_THRESHOLD + SIMULATOR_NODE_DEFAULT_CALIBRATED_TX + SIMULATOR_NODE_DEFAULT_DBM_TX) / 10 / instance.propagationConstant);
+    //Disjoint sets of node indices, used to find the nodes that are connected through nodes in range of each other
+    class NodeUnionFind
+    {
+    private:
+        std::vector<u32> parents;
+        std::vector<u32> sizes;
 
-    unsigned int minpts = 0; //a point must reach only one of another cluster to become part of its cluster
+    public:
+        explicit NodeUnionFind(u32 nodeCount) : parents(nodeCount), sizes(nodeCount, 1)
+        {
+            for (u32 i = 0; i < nodeCount; i++) parents[i] = i;
+        }
 
-    bool retry = true;
-    while (retry) {
-        //printf("try\n");
-        retry = false;
+        u32 Find(u32 nodeIndex)
+        {
+            while (parents[nodeIndex] != nodeIndex)
+            {
+                parents[nodeIndex] = parents[parents[nodeIndex]];
+                nodeIndex = parents[nodeIndex];
+            }
+            return nodeIndex;
+        }
 
-        //Create 2D points for all node positions
-        for (u32 i = 0; i < instance.GetTotalNodes(); i++) {
-            points[i].cluster_id = -1; //unclassified
-            points[i].x = (double)instance.nodes[i].x * (double)instance.simConfig.mapWidthInMeters;
-            points[i].y = (double)instance.nodes[i].y * (double)instance.simConfig.mapHeightInMeters;
-            points[i].z = (double)instance.nodes[i].z * (double)instance.simConfig.mapElevationInMeters;
+        void Union(u32 a, u32 b)
+        {
+            a = Find(a);
+            b = Find(b);
+            if (a == b) return;
+            if (sizes[a] < sizes[b]) std::swap(a, b);
+            parents[b] = a;
+            sizes[a] += sizes[b];
         }
+    };
 
-        //Use dbscan algorithm to check how many clusters these nodes can generate
-        dbscan(points.data(), numberOfNodesToPlace, epsilon, minpts, euclidean_dist);
+    //The part of the map in which nodes are placed, in normalized coordinates
+    struct PlacementArea
+    {
+        float minX = 0.0f;
+        float minY = 0.0f;
+        float width = 1.0f;
+        float height = 1.0f;
+    };
 
-        //printf("Epsilon for dbscan: %lf\n", epsilon);
-        //printf("Minimum points: %u\n", minpts);
-        //print_points(points, num_points);
+    constexpr double pi = 3.14159265358979323846;
 
-        for (u32 i = 0; i < numberOfNodesToPlace; i++) {
-            if (points[i].cluster_id != 0) {
-                retry = true;
-                instance.nodes[i].x = (float)instance.simState.rnd.NextU32() / (float)0xFFFFFFFF;
-                instance.nodes[i].y = (float)instance.simState.rnd.NextU32() / (float)0xFFFFFFFF;
-            }
+    float NextNormalized(MersenneTwister& rnd)
+    {
+        return (float)rnd.NextU32() / (float)0xFFFFFFFF;
+    }
+}
+
+//Makes sure that the first numberOfNodesToPlace nodes are connected to the first node through nodes that are in
+//stable connection range of each other. Nodes that are already connected keep their position. All others are placed
+//one after another: either where they are, if an already placed node is in range by now, or at a random position
+//in the area that is in range of a placed node. If random positions keep failing (e.g. on a sparse map), the node
+//is put next to a random placed node instead. A spatial grid with the range as cell size keeps this linear.
+static void HelperPositionNodesRandomly(CherrySim &instance, u32 numberOfNodesToPlace, const PlacementArea& area)
+{
+    constexpr u32 maxRandomPositionAttempts = 8;
+    constexpr u32 maxNeighbourPositionAttempts = 1000;
+
+    if (numberOfNodesToPlace == 0) return;
+
+    const double range = instance.GetStableConnectionRangeInMeters();
+    const double mapWidth = instance.simConfig.mapWidthInMeters;
+    const double mapHeight = instance.simConfig.mapHeightInMeters;
+    const double mapElevation = instance.simConfig.mapElevationInMeters;
+    const auto isInRange = [&](u32 a, u32 b) {
+        const double dx = ((double)instance.nodes[a].x - (double)instance.nodes[b].x) * mapWidth;
+        const double dy = ((double)instance.nodes[a].y - (double)instance.nodes[b].y) * mapHeight;
+        const double dz = ((double)instance.nodes[a].z - (double)instance.nodes[b].z) * mapElevation;
+        return dx * dx + dy * dy + dz * dz <= range * range;
+    };
+
+    //The cell size is a bit larger than the range so that rounding never hides a node in range
+    SpatialGrid grid((float)range + 1.0f);
+    std::vector<u32> candidates;
+    const auto getCandidates = [&](u32 nodeIndex) {
+        const NodeEntry& node = instance.nodes[nodeIndex];
+        grid.GetCandidates((float)(node.x * mapWidth), (float)(node.y * mapHeight), (float)(node.z * mapElevation), candidates);
+    };
+    const auto insertIntoGrid = [&](u32 nodeIndex) {
+        const NodeEntry& node = instance.nodes[nodeIndex];
+        grid.Update(nodeIndex, (float)(node.x * mapWidth), (float)(node.y * mapHeight), (float)(node.z * mapElevation));
+    };
+    const auto isInRangeOfGrid = [&](u32 nodeIndex) {
+        getCandidates(nodeIndex);
+        return std::any_of(candidates.begin(), candidates.end(), [&](u32 other) { return other != nodeIndex && isInRange(nodeIndex, other); });
+    };
+
+    //Find all nodes that are connected to the first node at their current position
+    NodeUnionFind components(numberOfNodesToPlace);
+    grid.Reset(numberOfNodesToPlace);
+    for (u32 i = 0; i < numberOfNodesToPlace; i++)
+    {
+        getCandidates(i);
+        for (u32 other : candidates)
+        {
+            if (isInRange(i, other)) components.Union(i, other);
+        }
+        insertIntoGrid(i);
+    }
+
+    //From now on, the grid only contains the placed nodes. The components are not updated anymore
+    //as moving a node might split the component that it was part of before.
+    grid.Reset(numberOfNodesToPlace);
+    std::vector<u32> placedNodes;
+    std::vector<bool> isPlaced(numberOfNodesToPlace, false);
+    for (u32 i = 0; i < numberOfNodesToPlace; i++)
+    {
+        if (components.Find(i) != components.Find(0)) continue;
+        placedNodes.push_back(i);
+        isPlaced[i] = true;
+        insertIntoGrid(i);
+    }
+
+    for (u32 i = 0; i < numberOfNodesToPlace; i++)
+    {
+        if (isPlaced[i]) continue;
+        NodeEntry& node = instance.nodes[i];
+
+        bool placed = isInRangeOfGrid(i);
+        for (u32 attempt = 0; !placed && attempt < maxRandomPositionAttempts; attempt++)
+        {
+            node.x = area.minX + NextNormalized(instance.simState.rnd) * area.width;
+            node.y = area.minY + NextNormalized(instance.simState.rnd) * area.height;
+            placed = isInRangeOfGrid(i);
+        }
+        for (u32 attempt = 0; !placed && attempt < maxNeighbourPositionAttempts; attempt++)
+        {
+            const NodeEntry& neighbour = instance.nodes[placedNodes[instance.simState.rnd.NextU32(0, (u32)placedNodes.size() - 1)]];
+            const double dz = ((double)node.z - (double)neighbour.z) * mapElevation;
+            //Slightly less than the range as the positions are stored as floats
+            const double reach = std::sqrt(std::max<double>(0, range * range - dz * dz)) * 0.99;
+            if (reach <= 0.0) continue;
+
+            const double angle = NextNormalized(instance.simState.rnd) * 2.0 * pi;
+            const double distance = std::sqrt(NextNormalized(instance.simState.rnd)) * reach;
+            const double x = neighbour.x + std::cos(angle) * distance / mapWidth;
+            const double y = neighbour.y + std::sin(angle) * distance / mapHeight;
+            //Clamping towards the neighbour keeps it in range, nodes only leave the map if the neighbour is outside already
+            node.x = (float)std::clamp<double>(x, std::min<double>(0, neighbour.x), std::max<double>(1, neighbour.x));
+            node.y = (float)std::clamp<double>(y, std::min<double>(0, neighbour.y), std::max<double>(1, neighbour.y));
+            placed = isInRangeOfGrid(i);
         }
+        if (!placed)
+        {
+            //No placed node is close enough in height to reach this node
+            SIMEXCEPTION(IllegalStateException);
+            continue;
+        }
+
+        placedNodes.push_back(i);
+        isPlaced[i] = true;
+        insertIntoGrid(i);
     }
 }
 
-//This will position all nodes randomly, by using dbscan to generate a configuration that can be clustered
-void CherrySim::PositionNodesRandomly()
+double CherrySim::GetStableConnectionRangeInMeters() const
 {
-    //Set some random x and y position for all nodes
-    // for (u32 nodeIndex = 0; nodeIndex < GetTotalNodes(); nodeIndex++) {
-    //     nodes[nodeIndex].x = (float)simState.rnd.NextU32() / (float)0xFFFFFFFF;
-    //     nodes[nodeIndex].y = (float)simState.rnd.NextU32() / (float)0xFFFFFFFF;
-    //     nodes[nodeIndex].z = 0;
-    // }
+    //Calculate the range using the rssi threshold and the transmission powers
+    return pow(10, ((double)-STABLE_CONNECTION_RSSI_THRESHOLD + SIMULATOR_NODE_DEFAULT_CALIBRATED_TX + SIMULATOR_NODE_DEFAULT_DBM_TX) / 10 / propagationConstant);
+}
 
-    //New:set the number of nodes to place for rectangular positioning
-    u32 totalNodes = GetTotalNodes();
-    float spacingX = 0.2;
-    float spacingY = 0.2;
+//This will position all nodes randomly so that the resulting configuration can be clustered
+void CherrySim::PositionNodesRandomly()
+{
+    const u32 totalNodes = GetTotalNodes();
+    const u32 numNoneAssetNodes = totalNodes - GetAssetNodes();
+    PlacementArea area;
 
-    for (u32 i = 0; i < totalNodes; i++) {
-        u32 row = i / 3;  // 計算行數
-        u32 col = i % 3;  // 計算列數
-        
-        nodes[i].x = (col + 1) * spacingX;  // X 坐標（列）
-        nodes[i].y = (row + 1) * spacingY;  // Y 坐標（行）
-        nodes[i].z = 0;
+    if (simConfig.targetMeanNeighbourDegree > 0)
+    {
+        //With a uniform density, a node has density * PI * range^2 neighbours on average (ignoring the border of the area).
+        //The area is a centered square of the required size, clipped to the map if the map is too small.
+        const double range = GetStableConnectionRangeInMeters();
+        const double areaInSquareMeters = std::max(1u, numNoneAssetNodes) * pi * range * range / simConfig.targetMeanNeighbourDegree;
+        const double widthInMeters = std::min(std::sqrt(areaInSquareMeters), (double)simConfig.mapWidthInMeters);
+        const double heightInMeters = std::min(areaInSquareMeters / widthInMeters, (double)simConfig.mapHeightInMeters);
+        area.width = (float)(widthInMeters / simConfig.mapWidthInMeters);
+        area.height = (float)(heightInMeters / simConfig.mapHeightInMeters);
+        area.minX = (1.0f - area.width) / 2;
+        area.minY = (1.0f - area.height) / 2;
+
+        for (u32 i = 0; i < totalNodes; i++) {
+            nodes[i].x = area.minX + NextNormalized(simState.rnd) * area.width;
+            nodes[i].y = area.minY + NextNormalized(simState.rnd) * area.height;
+            nodes[i].z = 0;
+        }
     }
+    else
+    {
+        //New:set the number of nodes to place for rectangular positioning
+        float spacingX = 0.2;
+        float spacingY = 0.2;
 
+        for (u32 i = 0; i < totalNodes; i++) {
+            u32 row = i / 3;  // 計算行數
+            u32 col = i % 3;  // 計算列數
 
-    u32 numNoneAssetNodes = GetTotalNodes() - GetAssetNodes();
-    //Next, we must check if the configuraton can cluster
-    std::vector<point_t> points = {};
-    points.resize(GetTotalNodes());
+            nodes[i].x = (col + 1) * spacingX;  // X 坐標（列）
+            nodes[i].y = (row + 1) * spacingY;  // Y 坐標（行）
+            nodes[i].z = 0;
+        }
+    }
 
-    //Two passes for DBScan are required, once for none assets, once for assets.
+    //Two passes are required, once for none assets, once for assets.
     //This is necessary to make sure that assets are not considered as valid mesh
-    //nodes to DBScan.
-    HelperPositionNodesRandomly(*this, points, numNoneAssetNodes);
-    HelperPositionNodesRandomly(*this, points, GetTotalNodes());
-    
+    //nodes when connecting the none assets.
+    HelperPositionNodesRandomly(*this, numNoneAssetNodes, area);
+    HelperPositionNodesRandomly(*this, totalNodes, area);
 }
 
 
@@ -1135,6 +1698,9 @@ void CherrySim::SimulateStepForAllNodes()
         // Update the cached floor index using the current z-coordinate of the node
         currentNode->currentFloorNumber = FindFloorNumber(currentNode->z);
 
+        // Positions might have been written directly (e.g. by a test), so the grid is refreshed once per step
+        UpdateSpatialGrid(i);
+
         sumOfAllSimulatedFrames += currentNode->simulatedFrames;
     }
     const int64_t avgSimulatedFrames = sumOfAllSimulatedFrames / GetTotalNodes();
@@ -1165,31 +1731,45 @@ void CherrySim::SimulateStepForAllNodes()
             }
         }
 
+        if (simulateNode && simConfig.eventDrivenScheduling && IsCurrentNodeIdle())
+        {
+            //Nothing is due on the node in this step, so only the parts that happen every step are simulated
+            simulateNode = false;
+            currentNode->simulatedFrames++;
+            currentNode->idleFrames++;
+            currentNode->state.timeMs += simConfig.simTickDurationMs;
+            SimulateBatteryUsage();
+        }
+
         if (simulateNode)
         {
             StackBaseSetter sbs;
 
             currentNode->simulatedFrames++;
-            SimulateMovement();
-            QueueInterrupts();
-            SimulateTimer();
-            SimulateTimeouts();
-            SimulateAdvertising();
-            SimulateConnections();
-            SimulateServiceDiscovery();
-            SimulateUartInterrupts();
-            SimulateTimeslot();
-            SimulateConnectionParameterUpdateRequestTimeout();
+            MeasurePhase(SimPhase::MOVEMENT, [this]() { SimulateMovement(); });
+            MeasurePhase(SimPhase::INTERRUPTS, [this]() { QueueInterrupts(); });
+            MeasurePhase(SimPhase::TIMER, [this]() { SimulateTimer(); });
+            MeasurePhase(SimPhase::TIMEOUTS, [this]() { SimulateTimeouts(); });
+            MeasurePhase(SimPhase::ADVERTISING, [this]() { SimulateAdvertising(); });
             try {
-                FruityHal::EventLooper();
-                SimulateFlashCommit();
-                SimulateBatteryUsage();
-                SimulateWatchDog();
+                //The firmware handles BLE events during connection events if they are simulated
+                MeasurePhase(SimPhase::CONNECTIONS, [this]() { SimulateConnections(); });
+                MeasurePhase(SimPhase::SERVICE_DISCOVERY, [this]() { SimulateServiceDiscovery(); });
+                MeasurePhase(SimPhase::UART_INTERRUPTS, [this]() { SimulateUartInterrupts(); });
+                MeasurePhase(SimPhase::TIMESLOT, [this]() { SimulateTimeslot(); });
+                MeasurePhase(SimPhase::CONNECTION_PARAMETER_UPDATE, [this]() { SimulateConnectionParameterUpdateRequestTimeout(); });
+                MeasurePhase(SimPhase::EVENT_LOOPER, []() { FruityHal::EventLooper(); });
+                MeasurePhase(SimPhase::FLASH_COMMIT, [this]() { SimulateFlashCommit(); });
+                MeasurePhase(SimPhase::BATTERY_USAGE, [this]() { SimulateBatteryUsage(); });
+                MeasurePhase(SimPhase::WATCHDOG, [this]() { SimulateWatchDog(); });
             }
             catch (const NodeSystemResetException& e) {
                 //Node broke out of its current simulation and rebootet
                 if (simEventListener) simEventListener->CherrySimEventHandler("NODE_RESET");
             }
+
+            //Errors of the DYNAMIC_ARRAYs are detected in destructors which must not throw
+            currentNode->scratchArena.CheckReleaseErrors();
         }
 
         globalBreakCounter++;
@@ -1563,6 +2143,14 @@ TerminalCommandHandlerReturnType CherrySim::TerminalCommandHandler(const std::ve
             PrintPacketStats(nodeId, "ROUTED");
             return TerminalCommandHandlerReturnType::SUCCESS;
         }
+        else if (commandArgs[1] == "scratchstat") {
+            //Print how much memory the DYNAMIC_ARRAYs of each node needed at most
+            for (u32 i = 0; i < GetTotalNodes(); i++) {
+                const ScratchArena& arena = nodes[i].scratchArena;
+                printf("Node %u (terminal %u): peak %u bytes, heap fallbacks %u" EOL, nodes[i].GetNodeId(), nodes[i].GetTerminalId(), arena.GetPeakUsage(), arena.GetHeapFallbacks());
+            }
+            return TerminalCommandHandlerReturnType::SUCCESS;
+        }
 
         else if (commandArgs[1] == "animation")
         {
@@ -1932,6 +2520,7 @@ void CherrySim::SetNode(u32 i)
         simGpioPtr        = nullptr;
         simFlashPtr       = nullptr;
         simUartPtr        = nullptr;
+        simScratchArenaPtr = nullptr;
         return;
     }
     if (i >= GetTotalNodes())
@@ -1948,17 +2537,18 @@ void CherrySim::SetNode(u32 i)
     simFicrPtr = &(nodes[i].ficr);
     simUicrPtr = &(nodes[i].uicr);
     simGpioPtr = &(nodes[i].gpio);
-    simFlashPtr = nodes[i].flash;
+    simFlashPtr = nodes[i].flash.GetData();
     simUartPtr = &(nodes[i].state.uartType);
     simRadioPtr = &(nodes[i].radio);
+    simScratchArenaPtr = &(nodes[i].scratchArena);
 
-    __application_start_address = (uint32_t)simFlashPtr + FruityHal::GetSoftDeviceSize();
+    __application_start_address = POINTER_TO_FLASH_ADDRESS(simFlashPtr) + FruityHal::GetSoftDeviceSize();
     __application_end_address = (uint32_t)__application_start_address + ChipsetToApplicationSize(GET_CHIPSET());
-    __application_ram_start_address = (uint32_t)currentNode; //FIXME not the correct value, just adummy.
+    __application_ram_start_address = (uint32_t)(uintptr_t)currentNode; //FIXME not the correct value, just adummy.
 
     //Point the linker sections for connectionTypeResolvers to the correct array
-    __start_conn_type_resolvers = (u32)connTypeResolvers;
-    __stop_conn_type_resolvers = ((u32)connTypeResolvers) + sizeof(connTypeResolvers);
+    __start_conn_type_resolvers = (uintptr_t)connTypeResolvers;
+    __stop_conn_type_resolvers = ((uintptr_t)connTypeResolvers) + sizeof(connTypeResolvers);
 
     __license_data_start_address = __application_start_address + LICENSE_APP_IV_OFFSET;
 
@@ -2022,6 +2612,30 @@ int CherrySim::ChipsetToBootloaderAddr(Chipset chipset)
     }
 }
 
+const SimFlashImage& CherrySim::GetFactoryFlashImage(BleStackType bleStackType, u32 bootloaderAddr)
+{
+    //The images are never released as the flash of the nodes maps them until the process exits
+    static std::map<std::pair<BleStackType, u32>, std::unique_ptr<SimFlashImage>> images;
+    std::unique_ptr<SimFlashImage>& image = images[std::make_pair(bleStackType, bootloaderAddr)];
+    if (image) return *image;
+
+    std::vector<u8> content(SIM_MAX_FLASH_SIZE, 0xFF);
+    if (bleStackType == BleStackType::NRF_SD_132_ANY) {
+        CheckedMemcpy(content.data(), s132_mbr_and_header_nrf52_v5_1_0, sizeof(s132_mbr_and_header_nrf52_v5_1_0));
+    }
+    else if (bleStackType == BleStackType::NRF_SD_140_ANY) {
+        CheckedMemcpy(content.data(), s140_mbr_and_header_nrf52840_v6_1_0, sizeof(s140_mbr_and_header_nrf52840_v6_1_0));
+    }
+
+    //Put some data where the bootloader is supposed to be (add a version number)
+    //TODO: Having a hardcoded 1024 is not a nice thing to do to give the offset of the bootloader version
+    const u32 bootloaderVersion = 123;
+    CheckedMemcpy(content.data() + bootloaderAddr + 1024, &bootloaderVersion, sizeof(bootloaderVersion));
+
+    image.reset(new SimFlashImage(content.data(), SIM_MAX_FLASH_SIZE));
+    return *image;
+}
+
 void CherrySim::CheckForMultiTensorflowUsage()
 {
 #ifndef GITHUB_RELEASE
@@ -2236,11 +2850,6 @@ void CherrySim::FlashNode(u32 i) {
 
     nodes[i].uicr.BOOTLOADERADDR = ChipsetToBootloaderAddr(GetChipset_CherrySim());
 
-    //##### Configure Flash
-    //Put some data where the bootloader is supposed to be (add a version number)
-    //TODO: Having a hardcoded 1024 is not a nice thing to do to give the offset of the bootloader version
-    *((u32*)&nodes[i].flash[currentNode->uicr.BOOTLOADERADDR + 1024]) = 123;
-
     //TODO: Currently, we only support one specific SoftDevice per chipset
     //This should be refactored to store the used BLE Stack as part of the featureset
     if (GetChipset_CherrySim() == Chipset::CHIP_NRF52) {
@@ -2250,12 +2859,9 @@ void CherrySim::FlashNode(u32 i) {
         nodes[i].bleStackType = BleStackType::NRF_SD_140_ANY;
     }
 
-    if (nodes[i].bleStackType == BleStackType::NRF_SD_132_ANY) {
-        CheckedMemcpy(simFlashPtr, s132_mbr_and_header_nrf52_v5_1_0, sizeof(s132_mbr_and_header_nrf52_v5_1_0));
-    }
-    else if (nodes[i].bleStackType == BleStackType::NRF_SD_140_ANY) {
-        CheckedMemcpy(simFlashPtr, s140_mbr_and_header_nrf52840_v6_1_0, sizeof(s140_mbr_and_header_nrf52840_v6_1_0));
-    }
+    //##### Configure Flash
+    //The MBR and bootloader are the same for all nodes, so their pages are shared instead of copied into each node
+    nodes[i].flash.Map(GetFactoryFlashImage(nodes[i].bleStackType, nodes[i].uicr.BOOTLOADERADDR));
 
     //TODO: Add app, softdevice, etc,... from .hex files into flash
     //Afterwards, we can use the normal size calculation for addresses without redefining it
@@ -2272,6 +2878,8 @@ void CherrySim::BootCurrentNode()
     }
     //############## Prepare the node memory
 
+    //The DYNAMIC_ARRAYs of the previous run are gone together with its stack
+    currentNode->scratchArena.Reset();
     currentNode->restartCounter++;
     currentNode->bmgWasInit        = false;
     currentNode->twiWasInit        = false;
@@ -2296,9 +2904,8 @@ void CherrySim::BootCurrentNode()
     //Reset our GPIO Peripheral
     CheckedMemset(simGpioPtr, 0x00, sizeof(NRF_GPIO_Type));
 
-    //Create a queue for events    if (simGlobalStatePtr != nullptr) {
-    currentNode->eventQueue.~deque();
-    new (&(currentNode->eventQueue)) std::deque<simBleEvent>();
+    //Drop all events that were queued before
+    currentNode->eventQueue.Clear();
 
     //Set the Ble stack parameters in the node so that we can use them later
     SetBleStack(currentNode);
@@ -2308,10 +2915,8 @@ void CherrySim::BootCurrentNode()
     new (&currentNode->state) SoftdeviceState();
 
     //Allocate halMemory
-    const u32 halMemorySize = FruityHal::GetHalMemorySize() / sizeof(u32) + 1;
-    u32* halMemory = new u32[halMemorySize];
-    CheckedMemset(halMemory, 0, halMemorySize * sizeof(u32));
-    GS->halMemory = halMemory;
+    AllocateNodeMemory(currentNode->halMemory, currentNode->halMemorySize, FruityHal::GetHalMemorySize());
+    GS->halMemory = currentNode->halMemory.get();
     FruityHal::InitHalMemory();
 
     //############## Boot the node using the FruityMesh boot routine
@@ -2319,8 +2924,8 @@ void CherrySim::BootCurrentNode()
 
     //Create memory for modules
     const u32 moduleMemoryBlockSize = INITIALIZE_MODULES(false);
-    currentNode->moduleMemoryBlock = (u8*)new u32[moduleMemoryBlockSize / sizeof(u32) + 1];
-    GS->moduleAllocator.SetMemory(currentNode->moduleMemoryBlock, moduleMemoryBlockSize);
+    AllocateNodeMemory(currentNode->moduleMemoryBlock, currentNode->moduleMemoryBlockSize, moduleMemoryBlockSize);
+    GS->moduleAllocator.SetMemory((u8*)currentNode->moduleMemoryBlock.get(), moduleMemoryBlockSize);
     //Boot the modules
     BootModules();
 
@@ -2333,11 +2938,7 @@ void CherrySim::BootCurrentNode()
 
 void CherrySim::ErasePage(u32 pageAddress)
 {
-    u32* p = (u32*)pageAddress;
-
-    for (u32 i = 0; i < FruityHal::GetCodePageSize() / sizeof(u32); i++) {
-        p[i] = 0xFFFFFFFF;
-    }
+    currentNode->flash.Erase(pageAddress - FLASH_REGION_START_ADDRESS, FruityHal::GetCodePageSize());
 }
 
 void CherrySim::WriteRecordToFlash(u16 recordId, u8* data, u16 dataLength) {
@@ -2362,14 +2963,14 @@ void CherrySim::WriteRecordToFlash(u16 recordId, u8* data, u16 dataLength) {
     //The crc is calculated over the record header and data, excluding the first two byte (crc and flags)
     record->crc = Utility::CalculateCrc8(((u8*)record) + sizeof(u16), record->recordLength - sizeof(u16));
 
-    u8* dest = (u8*)Utility::GetSettingsPageBaseAddress();
+    u32 destOffset = (u32)Utility::GetSettingsPageBaseAddress() - FLASH_REGION_START_ADDRESS;
 
     //Put the page header at the beginning of the settings page in flash
-    CheckedMemcpy(dest, &pageHeader, SIZEOF_RECORD_STORAGE_PAGE_HEADER);
-    dest += SIZEOF_RECORD_STORAGE_PAGE_HEADER;
+    currentNode->flash.Program(destOffset, (const u8*)&pageHeader, SIZEOF_RECORD_STORAGE_PAGE_HEADER);
+    destOffset += SIZEOF_RECORD_STORAGE_PAGE_HEADER;
 
     //Put the record and data on the settings page in flash
-    CheckedMemcpy(dest, record, recordLength);
+    currentNode->flash.Program(destOffset, (const u8*)record, recordLength);
 }
 
 void CherrySim::ResetCurrentNode(RebootReason rebootReason, bool throwException, bool powerLoss) {
@@ -2405,16 +3006,21 @@ void CherrySim::ResetCurrentNode(RebootReason rebootReason, bool throwException,
 }
 
 void CherrySim::ShutdownCurrentNode() {
-    //Clean up everything that is remaining
-    delete[] currentNode->moduleMemoryBlock;
+    //The module and hal memory are kept for the next boot, see NodeEntry::moduleMemoryBlock
 
     //Delete all simulation step handlers
     CleanSimulationStepHandlers(currentNode);
+}
 
-    //Cast is needed because the following passage from the C++ Standard:
-    //"This implies that an object cannot be deleted using a pointer of type void* because there are no objects of type void"
-    u32* halMemory = (u32*)GS->halMemory;
-    delete[] halMemory;
+void CherrySim::AllocateNodeMemory(std::unique_ptr<u32[]>& block, u32& blockSize, u32 requiredSize)
+{
+    //The block only moves if a different featureset needs a different size
+    if (block == nullptr || blockSize != requiredSize)
+    {
+        block.reset(new u32[requiredSize / sizeof(u32) + 1]);
+        blockSize = requiredSize;
+    }
+    CheckedMemset(block.get(), 0, (requiredSize / sizeof(u32) + 1) * sizeof(u32));
 }
 
 //############################### Bootloader Simulation ###################################
@@ -2425,7 +3031,7 @@ void CherrySim::ShutdownCurrentNode() {
 void CherrySim::SimulateFruityLoader()
 {
     const u32 settingsPageAddress = FruityHal::GetBootloaderSettingsAddress();
-    const auto settings = (const BootloaderSettings*)settingsPageAddress;
+    const auto settings = (const BootloaderSettings*)FLASH_ADDRESS_TO_POINTER(settingsPageAddress);
     
     //The bootloader will only be activated once a magic number is stored
     if (settings->updatePending == BOOTLOADER_MAGIC_NUMBER)
@@ -2448,9 +3054,9 @@ void CherrySim::SimulateFruityLoader()
             //Copy the application pages
             for (u32 i = 0; i < settings->imageNumPages; i++) {
                 const u32 srcAddr = FLASH_REGION_START_ADDRESS + settings->imageStartPage * FruityHal::GetCodePageSize();
-                const u32 dstAddr = FLASH_REGION_START_ADDRESS + dstStartPage * FruityHal::GetCodePageSize();
+                const u32 dstOffset = dstStartPage * FruityHal::GetCodePageSize();
 
-                CheckedMemcpy((u32*)dstAddr, (u32*)srcAddr, FruityHal::GetCodePageSize());
+                currentNode->flash.Program(dstOffset, FLASH_ADDRESS_TO_POINTER(srcAddr), FruityHal::GetCodePageSize());
             }
 
             //Erase the Bootloader Settings Page after the update was finished
@@ -2528,12 +3134,40 @@ void CherrySim::SimulateAdvertising() {
             const u32 startIndex = (indexStep == 1 ? 0 : simState.rnd.NextU32() % indexStep);
             const u32 nodeCount = GetTotalNodes() - GetAssetNodes();
 
-            //Distribute the event to all nodes in range
-            for (u32 i = startIndex; i < nodeCount; i += indexStep) {
-                if (i != currentNode->index) {
+            //Only nodes in the neighbouring grid cells can be in range. The candidates are sorted by index
+            //so that random numbers are drawn in the same order as when iterating over all nodes.
+            advertisingGrid.GetCandidates(currentNode->GetXinMeters(), currentNode->GetYinMeters(), currentNode->GetZinMeters(), advertisingCandidates);
+
+            //The noise free part of the reception is computed for a batch of candidates at once. Everything that
+            //draws random numbers is done afterwards for each candidate of the batch, still in the order of the index.
+            const ReceptionKernel::Parameters receptionParameters = GetReceptionKernelParameters(currentNode);
+            ReceptionKernel::Batch batch;
+            u32 batchNodeIndices[ReceptionKernel::BATCH_SIZE];
+            u32 candidateIndex = 0;
+
+            while (candidateIndex < advertisingCandidates.size()) {
+                batch.count = 0;
+                for (; candidateIndex < advertisingCandidates.size() && batch.count < ReceptionKernel::BATCH_SIZE; candidateIndex++) {
+                    const u32 i = advertisingCandidates[candidateIndex];
+                    if (i >= nodeCount) {
+                        candidateIndex = advertisingCandidates.size();
+                        break;
+                    }
+                    if (i < startIndex || (i - startIndex) % indexStep != 0) continue;
+                    if (i == currentNode->index) continue;
+                    batchNodeIndices[batch.count] = i;
+                    batch.count++;
+                }
+                if (batch.count == 0) break;
+
+                ComputeReceptionBatch(currentNode, receptionParameters, batchNodeIndices, batch);
+
+                //Distribute the event to all nodes in range
+                for (u32 lane = 0; lane < batch.count; lane++) {
+                    const u32 i = batchNodeIndices[lane];
                     //If the random value hits the probability, the event is sent
-                    const uint32_t probability = [this, indexStep, i] {
-                        const uint32_t rawProbability = CalculateReceptionProbabilityForAdvertisement(currentNode, &nodes[i]);
+                    const uint32_t probability = [this, indexStep, i, lane, &batch] {
+                        const uint32_t rawProbability = CalculateReceptionProbabilityForAdvertisement(&nodes[i], batch, lane);
                         if (simConfig.perfectReceptionProbabilityForAdvertising) {
                             return rawProbability;
                         }
@@ -2569,7 +3203,7 @@ void CherrySim::SimulateAdvertising() {
                             s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
                             s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)currentNode->state.advertisingType;
 
-                            nodes[i].eventQueue.push_back(s);
+                            nodes[i].eventQueue.Push(s);
                         }
                     }
                     //If the other node is connecting
@@ -2675,6 +3309,9 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     freeInConnection->isCentral = false;
     freeInConnection->lastReceivedPacketTimestampMs = simState.simTimeMs;
     freeInConnection->connectionSetupTimeMs = simState.simTimeMs;
+    freeInConnection->nextConnectionEventUs = (uint64_t)simState.simTimeMs * 1000;
+    freeInConnection->llDataLength = LL_DEFAULT_DATA_LENGTH;
+    freeInConnection->sentValueBytes = 0;
 
     //Generate an event for the current node
     simBleEvent s2;
@@ -2684,12 +3321,12 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     s2.bleEvent.header.evt_len = s2.globalId;
     s2.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
 
-    s2.bleEvent.evt.gap_evt.params.connected.conn_params.min_conn_interval = slave->state.connectionParamIntervalMs;
-    s2.bleEvent.evt.gap_evt.params.connected.conn_params.max_conn_interval = slave->state.connectionParamIntervalMs;
+    s2.bleEvent.evt.gap_evt.params.connected.conn_params.min_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(master->state.connectionParamIntervalMs);
+    s2.bleEvent.evt.gap_evt.params.connected.conn_params.max_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(master->state.connectionParamIntervalMs);
     s2.bleEvent.evt.gap_evt.params.connected.peer_addr = Convert(&master->address);
     s2.bleEvent.evt.gap_evt.params.connected.role = BLE_GAP_ROLE_PERIPH;
 
-    slave->eventQueue.push_back(s2);
+    slave->eventQueue.Push(s2);
 
     //###### Remote node
 
@@ -2729,6 +3366,9 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     freeOutConnection->isCentral = true;
     freeOutConnection->lastReceivedPacketTimestampMs = simState.simTimeMs;
     freeOutConnection->connectionSetupTimeMs = simState.simTimeMs;
+    freeOutConnection->nextConnectionEventUs = (uint64_t)simState.simTimeMs * 1000;
+    freeOutConnection->llDataLength = LL_DEFAULT_DATA_LENGTH;
+    freeOutConnection->sentValueBytes = 0;
 
     //Save connection references
     freeInConnection->partnerConnection = freeOutConnection;
@@ -2742,12 +3382,12 @@ void CherrySim::ConnectMasterToSlave(NodeEntry* master, NodeEntry* slave)
     s.bleEvent.header.evt_len = s.globalId;
     s.bleEvent.evt.gap_evt.conn_handle = simState.globalConnHandleCounter;
 
-    s.bleEvent.evt.gap_evt.params.connected.conn_params.min_conn_interval = slave->state.connectionParamIntervalMs;
-    s.bleEvent.evt.gap_evt.params.connected.conn_params.max_conn_interval = slave->state.connectionParamIntervalMs;
+    s.bleEvent.evt.gap_evt.params.connected.conn_params.min_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(master->state.connectionParamIntervalMs);
+    s.bleEvent.evt.gap_evt.params.connected.conn_params.max_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(master->state.connectionParamIntervalMs);
     s.bleEvent.evt.gap_evt.params.connected.peer_addr = Convert(&slave->address);
     s.bleEvent.evt.gap_evt.params.connected.role = BLE_GAP_ROLE_CENTRAL;
 
-    master->eventQueue.push_back(s);
+    master->eventQueue.Push(s);
 
     //Disable connecting for the other node because we just got the remote SoftDevice a connection
     master->state.connectingActive = false;
@@ -2799,7 +3439,7 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
     s1.bleEvent.header.evt_len = s1.globalId;
     s1.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
     s1.bleEvent.evt.gap_evt.params.disconnected.reason = hciReason;
-    connection->owningNode->eventQueue.push_back(s1);
+    connection->owningNode->eventQueue.Push(s1);
 
     //#### Remote node
     partnerConnection->connectionActive = false;
@@ -2811,7 +3451,7 @@ u32 CherrySim::DisconnectSimulatorConnection(SoftdeviceConnection* connection, u
     s2.bleEvent.header.evt_len = s2.globalId;
     s2.bleEvent.evt.gap_evt.conn_handle = partnerConnection->connectionHandle;
     s2.bleEvent.evt.gap_evt.params.disconnected.reason = hciReasonPartner;
-    partnerNode->eventQueue.push_back(s2);
+    partnerNode->eventQueue.Push(s2);
 
     return NRF_SUCCESS;
 }
@@ -2828,7 +3468,7 @@ void CherrySim::SimulateTimeouts() {
         s.bleEvent.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
         s.bleEvent.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_CONN;
 
-        currentNode->eventQueue.push_back(s);
+        currentNode->eventQueue.Push(s);
     }
 }
 
@@ -2890,6 +3530,14 @@ SoftDeviceBufferedPacket* getNextPacketToWrite(SoftdeviceConnection* connection)
     return packet;
 }
 
+//Returns the length of the ATT value of a buffered write or notification
+static u32 GetValueLength(const SoftDeviceBufferedPacket& packet)
+{
+    return packet.isHvx
+        ? (u32)(uintptr_t)packet.params.hvxParams.p_len //See sd_ble_gatts_hvx, the length is stored instead of the pointer
+        : packet.params.writeParams.len;
+}
+
 void CherrySim::SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u8 packetCount)
 {
     if (packetCount > 0) {
@@ -2901,15 +3549,16 @@ void CherrySim::SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u
         s2.bleEvent.evt.gattc_evt.conn_handle = connHandle;
         s2.bleEvent.evt.gattc_evt.params.write_cmd_tx_complete.count = packetCount;
 
-        node->eventQueue.push_back(s2);
+        node->eventQueue.Push(s2);
     }
 }
 
 void CherrySim::SimulateConnections() {
     /* Currently, the simulation will only take one connection event to transmit a reliable packet and both the packet event and the ACK will be generated
-    * at the same time. Also, all unreliable packets are always sent in one conneciton event.
-    * If many connections exist with short connection intervals, the behaviour is not realistic as the amount of packets that are being sent should decrease.
-    * There is also no probability of failure and the buffer is always emptied
+    * at the same time. There is also no probability of failure.
+    * With simConfig.simulateConnectionEvents, the amount of packets per connection event is computed by the ConnectionEventModel and all events
+    * that fall into the current simulation step are simulated. Otherwise, a random amount of packets is sent once per connection interval
+    * and depends only on the number of connections, which is not realistic for short connection intervals.
     */
 
     if (blockConnections) return;
@@ -2919,32 +3568,42 @@ void CherrySim::SimulateConnections() {
         SoftdeviceConnection* connection = &currentNode->state.connections[i];
         if (connection->connectionActive) {
 
-            //FIXME: This implementation will currently not calculate a correct throughput for packets
-            //if the interval is smaller than the simulation timestep, it will only simulate one connectionEvent
-            //To fix this, we should calculate the throughput according to our documented measurements
-            //depending on the number of connections, whether scanning / advertising are active, the eventLength and the interval
+            u32 dueConnectionEvents = 0;
+            if (simConfig.simulateConnectionEvents)
+            {
+                dueConnectionEvents = GetDueConnectionEvents(connection);
+            }
+            else
+            {
+                u16 connectionIntervalMs = connection->connectionInterval;
 
-            u16 connectionIntervalMs = connection->connectionInterval;
+                //FIXME: This is a workaround as the simulation timestep is probably not dividable by (int)7.5
+                if (connectionIntervalMs == (int)7.5f) connectionIntervalMs = 10;
 
-            //FIXME: This is a workaround as the simulation timestep is probably not dividable by (int)7.5
-            if (connectionIntervalMs == (int)7.5f) connectionIntervalMs = 10;
+                //Each connecitonInterval, we see if there are any packets to send
+                if (ShouldSimConnectionIvTrigger(connectionIntervalMs, connection)) dueConnectionEvents = 1;
+            }
 
-            //Each connecitonInterval, we see if there are any packets to send
-            if (ShouldSimConnectionIvTrigger(connectionIntervalMs, connection)) {
+            if (dueConnectionEvents > 0) {
 
-                //Depending on the number of connections, we send a random amount of packets from the unreliable buffers
-                u8 numConnections = GetNumSimConnections(currentNode);
-                u8 numPacketsToSend;
+                u8 numPacketsToSend = 0;
                 u32 unreliablePacketsSent = 0;
 
-                if (numConnections == 1) numPacketsToSend = (u8)PSRNGINT(0, SIM_NUM_UNRELIABLE_BUFFERS);
-                else if (numConnections == 2) numPacketsToSend = (u8)PSRNGINT(0, 5);
-                else numPacketsToSend = (u8)PSRNGINT(0, 3);
+                if (!simConfig.simulateConnectionEvents)
+                {
+                    //Depending on the number of connections, we send a random amount of packets from the unreliable buffers
+                    u8 numConnections = GetNumSimConnections(currentNode);
+
+                    if (numConnections == 1) numPacketsToSend = (u8)PSRNGINT(0, SIM_NUM_UNRELIABLE_BUFFERS);
+                    else if (numConnections == 2) numPacketsToSend = (u8)PSRNGINT(0, 5);
+                    else numPacketsToSend = (u8)PSRNGINT(0, 3);
+                }
 
                 const double rssiMult = CalculateReceptionProbabilityForConnection(connection->owningNode, connection->partner);
                 if (rssiMult == 0)
                 {
                     numPacketsToSend = 0;
+                    dueConnectionEvents = 0;
                 }
                 else
                 {
@@ -2972,67 +3631,23 @@ void CherrySim::SimulateConnections() {
                     DisconnectSimulatorConnection(&currentNode->state.connections[i], BLE_HCI_CONNECTION_TIMEOUT, BLE_HCI_CONNECTION_TIMEOUT);
                 }
 
-                for (int k = 0; k < numPacketsToSend; k++) {
-                    SoftDeviceBufferedPacket* packet = getNextPacketToWrite(connection);
-                    if (packet == nullptr) break;
-
-#ifdef FM_NATIVE_RENDERER_ENABLED
-                    if (bbeRenderer)
-                    {
-                        bbeRenderer->addPacket(packet->sender, packet->receiver);
-                    }
-#endif
+                if (simConfig.simulateConnectionEvents)
+                {
+                    for (u32 k = 0; k < dueConnectionEvents && connection->connectionActive; k++) SimulateConnectionEvent(connection);
+                }
+                else
+                {
+                    for (int k = 0; k < numPacketsToSend; k++) {
+                        SoftDeviceBufferedPacket* packet = getNextPacketToWrite(connection);
+                        if (packet == nullptr) break;
 
-                    //Notifications
-                    if (packet->isHvx) {
-                        GenerateNotification(packet);
-                        //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
-                        unreliablePacketsSent++;
-                    }
-                    //Unreliable Writes
-                    else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_CMD) {
-                        GenerateWrite(packet);
-                        //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
-                        unreliablePacketsSent++;
+                        //Do not send any more packets this connectionEvent after a reliable write as we need to wait for an ACK
+                        if (SimulateConnectionPacket(connection, packet, &unreliablePacketsSent)) break;
                     }
-                    //Reliable Writes
-                    else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_REQ) {
-
-                        //Send tx complete for all previous unreliable writes if there were any
-                        SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
-                        unreliablePacketsSent = 0;
-
-                        GenerateWrite(packet);
-                        //Remove packet from softdevice buffer
-                        packet->sender = nullptr;
-
-                        //Generate the event that the write was successful immediately
-                        //TODO: Could be postponed a bit to better match the real world
-                        simBleEvent s2;
-                        CheckedMemset(&s2, 0, sizeof(s2));
-                        s2.globalId = simState.globalEventIdCounter++;
-                        s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
-                        s2.bleEvent.header.evt_len = s2.globalId;
-                        s2.bleEvent.evt.gattc_evt.conn_handle = connection->connectionHandle;
-                        s2.bleEvent.evt.gattc_evt.gatt_status = (u16)FruityHal::BleGattEror::SUCCESS;
-                        //Save the global packet id so that we can track where a packet was generated after we receive it
-                        s2.additionalInfo = packet->globalPacketId;
-                        currentNode->eventQueue.push_back(s2);
 
-
-
-                        //Do not send any more packets this connectionEvent as we need to wait for an ACK
-                        break;
-                    }
-                    else {
-                        SIMEXCEPTION(IllegalArgumentException);
-                    }
+                    //Send remaining accumulated tx complete events for notifications and unreliable writes
+                    SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
                 }
-
-                //Send remaining accumulated tx complete events for notifications and unreliable writes
-                SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
             }
         }
     }
@@ -3053,7 +3668,7 @@ void CherrySim::SimulateConnections() {
                 s.bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
                 s.bleEvent.evt.gap_evt.params.rssi_changed.rssi = (i8)GetReceptionRssi(master, slave);
 
-                currentNode->eventQueue.push_back(s);
+                currentNode->eventQueue.Push(s);
             }
         }
     }
@@ -3072,6 +3687,142 @@ void CherrySim::SimulateConnections() {
     }
 }
 
+//Returns the amount of connection events that took place since the last call and schedules the next one
+u32 CherrySim::GetDueConnectionEvents(SoftdeviceConnection* connection)
+{
+    const uint64_t nowUs = (uint64_t)simState.simTimeMs * 1000;
+    const u32 connectionIntervalUs = GetConnectionEventParameters(*connection).connectionIntervalUs;
+
+    u32 dueEvents = 0;
+    while (connection->nextConnectionEventUs <= nowUs)
+    {
+        connection->nextConnectionEventUs += connectionIntervalUs;
+        dueEvents++;
+    }
+    return dueEvents;
+}
+
+ConnectionEventParameters CherrySim::GetConnectionEventParameters(const SoftdeviceConnection& connection)
+{
+    ConnectionEventParameters parameters;
+    //The interval is stored in truncated ms, e.g. 7 for 7.5 ms, but is always a multiple of 1.25 ms
+    parameters.connectionIntervalUs  = std::max<u32>(CherrySimUtils::ConnectionIntervalMsToUnits(connection.connectionInterval), 1) * CONFIG_UNIT_1_25_MS;
+    parameters.eventLengthUs         = currentNode->state.connectionEventLengthUs;
+    parameters.eventExtension        = currentNode->state.connectionEventExtension;
+    parameters.llDataLength          = connection.llDataLength;
+    parameters.encrypted             = connection.connectionEncrypted;
+    parameters.activeConnections     = GetNumSimConnections(currentNode);
+    parameters.scanning              = currentNode->state.scanningActive;
+    parameters.advertisingIntervalMs = currentNode->state.advertisingActive ? currentNode->state.advertisingIntervalMs : 0;
+    return parameters;
+}
+
+//Sends packets from the buffers of the connection until the radio time of the connection event is used up
+void CherrySim::SimulateConnectionEvent(SoftdeviceConnection* connection)
+{
+    const ConnectionEventParameters parameters = GetConnectionEventParameters(*connection);
+    const ConnectionEventCalibration& calibration = GetConnectionEventCalibration(currentNode->bleStackType);
+
+    u32 eventTimeLeftUs = ComputeConnectionEventTimeUs(parameters, calibration);
+    u32 pdusLeft = calibration.maxPdusPerEvent != 0 ? calibration.maxPdusPerEvent : UINT32_MAX;
+    u32 unreliablePacketsSent = 0;
+    bool firstPacket = true;
+    bool refilled = false;
+
+    while (true)
+    {
+        SoftDeviceBufferedPacket* packet = getNextPacketToWrite(connection);
+        if (packet == nullptr)
+        {
+            //The firmware refills the buffers as soon as it gets the tx complete events, which happens
+            //while the connection event is still running
+            if (refilled) break;
+            refilled = true;
+            SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
+            unreliablePacketsSent = 0;
+            FruityHal::PullBleEvents();
+            if (!connection->connectionActive) return;
+            continue;
+        }
+        refilled = false;
+
+        const u32 valueLength = GetValueLength(*packet);
+        const u32 airTimeUs = ComputeWriteAirTimeUs(valueLength, parameters.llDataLength, parameters.encrypted);
+        const u32 reservedTimeUs = ComputeWriteReservedTimeUs(valueLength, parameters.llDataLength, parameters.encrypted);
+        const u32 pdus = ComputeWritePduCount(valueLength, parameters.llDataLength);
+
+        //The master always transmits at the anchor point, so the first packet is sent in any case
+        if (!firstPacket && (reservedTimeUs > eventTimeLeftUs || pdus > pdusLeft)) break;
+        firstPacket = false;
+        eventTimeLeftUs -= std::min(eventTimeLeftUs, airTimeUs);
+        pdusLeft -= std::min(pdusLeft, pdus);
+
+        //Do not send any more packets this connectionEvent after a reliable write as we need to wait for an ACK
+        if (SimulateConnectionPacket(connection, packet, &unreliablePacketsSent)) break;
+    }
+
+    //Send remaining accumulated tx complete events for notifications and unreliable writes
+    SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, unreliablePacketsSent);
+}
+
+//Delivers a buffered packet to the partner, returns true if it was a reliable write after which the connection event ends
+bool CherrySim::SimulateConnectionPacket(SoftdeviceConnection* connection, SoftDeviceBufferedPacket* packet, u32* unreliablePacketsSent)
+{
+#ifdef FM_NATIVE_RENDERER_ENABLED
+    if (bbeRenderer)
+    {
+        bbeRenderer->addPacket(packet->sender, packet->receiver);
+    }
+#endif
+
+    connection->sentValueBytes += GetValueLength(*packet);
+
+    //Notifications
+    if (packet->isHvx) {
+        GenerateNotification(packet);
+        //Remove packet from softdevice buffer
+        packet->sender = nullptr;
+        (*unreliablePacketsSent)++;
+    }
+    //Unreliable Writes
+    else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_CMD) {
+        GenerateWrite(packet);
+        //Remove packet from softdevice buffer
+        packet->sender = nullptr;
+        (*unreliablePacketsSent)++;
+    }
+    //Reliable Writes
+    else if (packet->params.writeParams.write_op == BLE_GATT_OP_WRITE_REQ) {
+
+        //Send tx complete for all previous unreliable writes if there were any
+        SendUnreliableTxCompleteEvent(currentNode, connection->connectionHandle, *unreliablePacketsSent);
+        *unreliablePacketsSent = 0;
+
+        GenerateWrite(packet);
+        //Remove packet from softdevice buffer
+        packet->sender = nullptr;
+
+        //Generate the event that the write was successful immediately
+        //TODO: Could be postponed a bit to better match the real world
+        simBleEvent s2;
+        CheckedMemset(&s2, 0, sizeof(s2));
+        s2.globalId = simState.globalEventIdCounter++;
+        s2.bleEvent.header.evt_id = BLE_GATTC_EVT_WRITE_RSP;
+        s2.bleEvent.header.evt_len = s2.globalId;
+        s2.bleEvent.evt.gattc_evt.conn_handle = connection->connectionHandle;
+        s2.bleEvent.evt.gattc_evt.gatt_status = (u16)FruityHal::BleGattEror::SUCCESS;
+        //Save the global packet id so that we can track where a packet was generated after we receive it
+        s2.additionalInfo = packet->globalPacketId;
+        currentNode->eventQueue.Push(s2);
+
+        return true;
+    }
+    else {
+        SIMEXCEPTION(IllegalArgumentException);
+    }
+    return false;
+}
+
 //This function generates a WRITE event and a TX for two nodes that want to send data
 void CherrySim::GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket) {
 
@@ -3130,7 +3881,7 @@ void CherrySim::GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket) {
     s.bleEvent.evt.gatts_evt.params.write.offset = 0;
     s.bleEvent.evt.gatts_evt.params.write.op = p_write_params.write_op;
 
-    receiver->eventQueue.push_back(s);
+    receiver->eventQueue.Push(s);
 }
 
 void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
@@ -3149,7 +3900,7 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
         j["reliable"] = false;
         j["timeMs"] = simState.simTimeMs;
         char buffer[128];
-        Logger::ConvertBufferToHexString(hvx_params.p_data, (u32)hvx_params.p_len, buffer, 128);
+        Logger::ConvertBufferToHexString(hvx_params.p_data, (u32)(uintptr_t)hvx_params.p_len, buffer, 128);
         j["data"] = buffer;
         printf("%s" EOL, j.dump().c_str());
     }
@@ -3163,13 +3914,13 @@ void CherrySim::GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket) {
 
     //jstodo check this workaround again.
     // This is a workaround for hvxParams keeping only pointer to len.
-    CheckedMemcpy(&s.bleEvent.evt.gattc_evt.params.hvx.data, hvx_params.p_data, (u32)hvx_params.p_len);
+    CheckedMemcpy(&s.bleEvent.evt.gattc_evt.params.hvx.data, hvx_params.p_data, (u32)(uintptr_t)hvx_params.p_len);
     s.bleEvent.evt.gattc_evt.params.hvx.handle = hvx_params.handle;
     // This is a workaround for hvxParams keeping only pointer to len.
-    s.bleEvent.evt.gattc_evt.params.hvx.len = (u16)(u32)hvx_params.p_len;
+    s.bleEvent.evt.gattc_evt.params.hvx.len = (u16)(uintptr_t)hvx_params.p_len;
     s.bleEvent.evt.gattc_evt.params.hvx.type = hvx_params.type;
 
-    receiver->eventQueue.push_back(s);
+    receiver->eventQueue.Push(s);
 }
 
 void CherrySim::StartServiceDiscovery(u16 connHandle, const ble_uuid_t &p_uuid, int discoveryTimeMs)
@@ -3458,12 +4209,12 @@ void CherrySim::SimulateConnectionParameterUpdateRequestTimeout()
         bleEvent.evt.gap_evt.conn_handle = peripheralConnection.connectionHandle;
 
         auto & connParams = bleEvent.evt.gap_evt.params.conn_param_update.conn_params;
-        connParams.min_conn_interval = peripheralConnection.connectionInterval;
-        connParams.max_conn_interval = peripheralConnection.connectionInterval;
+        connParams.min_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(peripheralConnection.connectionInterval);
+        connParams.max_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(peripheralConnection.connectionInterval);
         connParams.slave_latency = Conf::GetInstance().meshPeripheralSlaveLatency;
         connParams.conn_sup_timeout = Conf::meshConnectionSupervisionTimeout;
 
-        peripheral.eventQueue.push_back(simEvent);
+        peripheral.eventQueue.Push(simEvent);
     }
 }
 
@@ -3477,11 +4228,76 @@ void CherrySim::SimulateTimer() {
     //Advance time of this node
     currentNode->state.timeMs += simConfig.simTickDurationMs;
 
-    if (ShouldSimIvTrigger(100L * MAIN_TIMER_TICK * 10 / ticksPerSecond)) {
+    if (ShouldSimIvTrigger(simAppTimerIntervalMs)) {
         app_timer_handler(nullptr);
     }
 }
 
+//Checks if simulating the current node in this step would do nothing besides advancing its time and battery
+//usage. Work that can be queued from outside of the node (by other nodes, the terminal or a test) is checked
+//directly instead of being scheduled, which is why this is evaluated during each step.
+bool CherrySim::IsCurrentNodeIdle()
+{
+    const NodeEntry& node = *currentNode;
+    const SoftdeviceState& state = node.state;
+
+    //The time the node will have in this step, see SimulateTimer
+    const u32 timeMs = state.timeMs + simConfig.simTickDurationMs;
+    const auto isDue = [timeMs](u32 ivMs) { return ivMs == 0 || timeMs % ivMs == 0; };
+
+    //Work that is already queued
+    if (!node.eventQueue.IsEmpty()
+        || !node.interruptQueue.empty()
+        || state.numWaitingFlashOperations > 0
+        || state.uartReadIndex != state.uartBufferLength
+        || state.discoveryDoneTime != 0
+        || node.timeslotRequested
+        || node.timeslotActive
+        || node.timeslotCloseSessionRequested
+        || node.animation.IsStarted()
+        || GS->passsedTimeSinceLastTimerHandlerDs > 0
+        || GS->terminal.HasPendingTerminalCommands())
+    {
+        return false;
+    }
+
+    //Things that have to be simulated in every step
+    if (simConfig.simulateWatchdog
+        || GS->numApplicationInterruptHandlers > 0
+        || GS->numMainContextHandlers > 0
+        || (GS->boardconf.getCustomPinset != nullptr && is_lis2dh12_moving_in_simulation()))
+    {
+        return false;
+    }
+
+    //Time based work
+    if (isDue(simAppTimerIntervalMs)) return false;
+    if (state.advertisingActive && isDue(state.advertisingIntervalMs)) return false;
+    if (state.connectingActive && state.connectingTimeoutTimestampMs <= (i32)simState.simTimeMs) return false;
+
+    for (int i = 0; i < state.configuredTotalConnectionCount; i++)
+    {
+        const SoftdeviceConnection& connection = state.connections[i];
+        if (!connection.connectionActive) continue;
+
+        if (connection.connParamUpdateRequestPending) return false;
+        if (simConfig.connectionTimeoutProbabilityPerSec != 0) return false;
+        if (isDue(5000)) return false;
+
+        //Same as in SimulateConnections
+        if (simConfig.simulateConnectionEvents)
+        {
+            if (!blockConnections && connection.nextConnectionEventUs <= (uint64_t)simState.simTimeMs * 1000) return false;
+            continue;
+        }
+        u16 connectionIntervalMs = connection.connectionInterval;
+        if (connectionIntervalMs == (int)7.5f) connectionIntervalMs = 10;
+        if (!blockConnections && timeMs >= connection.lastConnectionTimestampMs + connectionIntervalMs) return false;
+    }
+
+    return true;
+}
+
 void CherrySim::SimulateWatchDog()
 {
     if (simConfig.simulateWatchdog) {
@@ -3605,17 +4421,19 @@ void CherrySim::CheckMeshingConsistency()
             MeshConnection* conn = conns.handles[k].GetConnection();
 
             if (conn->HandshakeDone()) {
-                ChunkedPacketQueue* queue = conn->queue.GetQueueByPriority(DeliveryPriority::VITAL);
-                for (u32 m = 0; m < queue->GetAmountOfPackets(); m++) {
-                    u8 buffer[2048];
-                    u32 length = queue->RandomAccessPeek(buffer, sizeof(buffer), m);
-                    if (length >= SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_CLUSTER_INFO_UPDATE) {
+                const ChunkedPacketQueue* queue = conn->queue.GetQueueByPriority(DeliveryPriority::VITAL);
+                for (ChunkedPacketQueue::Cursor cursor = queue->GetCursor(); cursor.IsValid(); cursor.Next()) {
+                    const ChunkedPacketQueue::EntryView entry = cursor.Get();
+                    if (entry.size >= SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_CLUSTER_INFO_UPDATE) {
+                        //Only the beginning of the entry is needed to check if it is a cluster info update
+                        alignas(u32) u8 buffer[SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + SIZEOF_CONN_PACKET_CLUSTER_INFO_UPDATE];
+                        entry.CopyTo(buffer, sizeof(buffer));
                         ConnPacketClusterInfoUpdate* packet = (ConnPacketClusterInfoUpdate*)(buffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
                         if (packet->header.messageType == MessageType::CLUSTER_INFO_UPDATE)
                         {
                             //We must check if this packet was queued in the Softdevice already, if yes, we must not count it twice
                             //It will be removed after the Transmission Success was delivered from the SoftDevice
-                            if (queue->IsRandomAccessIndexLookedAhead(m) == false)
+                            if (cursor.IsLookedAhead() == false)
                             {
                                 conn->validityClusterUpdatesToSend += packet->payload.clusterSizeChange;
                             }
@@ -3653,7 +4471,7 @@ void CherrySim::CheckMeshingConsistency()
 
                 if (header->messageType == MessageType::CLUSTER_INFO_UPDATE)
                 {
-                    ConnPacketClusterInfoUpdate* packet = (ConnPacketClusterInfoUpdate*)header;
+                    const ConnPacketClusterInfoUpdate* packet = (const ConnPacketClusterInfoUpdate*)header;
 
                     BaseConnection* bc = node->gs.cm.GetRawConnectionFromHandle(sc->connectionHandle);
 
@@ -3677,17 +4495,17 @@ void CherrySim::CheckMeshingConsistency()
     {
         NodeEntry* node = &nodes[i];
 
-        for (u32 k = 0; k < node->eventQueue.size(); k++)
+        node->eventQueue.ForEach([node](const SimBleEventRecord& record)
         {
-            simBleEvent bleEvent = node->eventQueue[k];
-            if (bleEvent.bleEvent.header.evt_id == BLE_GATTS_EVT_WRITE) {
-                ble_gatts_evt_t* gattsEvt = (ble_gatts_evt_t*)&bleEvent.bleEvent.evt;
+            const ble_evt_t* bleEvent = record.GetEvent();
+            if (bleEvent->header.evt_id == BLE_GATTS_EVT_WRITE) {
+                const ble_gatts_evt_t* gattsEvt = &bleEvent->evt.gatts_evt;
 
-                ConnPacketHeader* header = (ConnPacketHeader*)gattsEvt->params.write.data;
+                const ConnPacketHeader* header = (const ConnPacketHeader*)gattsEvt->params.write.data;
 
                 if (header->messageType == MessageType::CLUSTER_INFO_UPDATE)
                 {
-                    ConnPacketClusterInfoUpdate* packet = (ConnPacketClusterInfoUpdate*)header;
+                    const ConnPacketClusterInfoUpdate* packet = (const ConnPacketClusterInfoUpdate*)header;
 
                     BaseConnection* bc = node->gs.cm.GetRawConnectionFromHandle(gattsEvt->conn_handle);
 
@@ -3705,7 +4523,7 @@ void CherrySim::CheckMeshingConsistency()
 
                 //TODO: Check characteristic if it's a mesh image and which packet, ...
             }
-        }
+        });
     }
 
     //Go through all nodes and its connections and recursively propagate the clusterUpdates
@@ -4043,13 +4861,19 @@ float CherrySim::GetDistanceBetween(const NodeEntry* nodeA, const NodeEntry* nod
 float CherrySim::GetReceptionRssi(const NodeEntry *sender, const NodeEntry *receiver)
 {
     // Early out if the nodes are too far from each other to optimize the performance for bigger scenarios
-    if (    abs(sender->x - receiver->x) * simConfig.mapWidthInMeters > 50
-        ||  abs(sender->y - receiver->y) * simConfig.mapHeightInMeters > 50
-        ||  abs(sender->z - receiver->z) * simConfig.mapElevationInMeters > 50)
+    if (    abs(sender->x - receiver->x) * simConfig.mapWidthInMeters > maxReceptionDistancePerAxisInMeters
+        ||  abs(sender->y - receiver->y) * simConfig.mapHeightInMeters > maxReceptionDistancePerAxisInMeters
+        ||  abs(sender->z - receiver->z) * simConfig.mapElevationInMeters > maxReceptionDistancePerAxisInMeters)
     {
         return -1000;
     }
 
+    // Compute the RSSI for transmissions between the two nodes
+    return ApplyRssiNoise(GetReceptionRssiNoNoise(sender, receiver));
+}
+
+float CherrySim::ApplyRssiNoise(const float rssiNoNoise)
+{
     // The RSSI must be clamped to below -11, because the AssetScanningModule is filtering out received
     // advertisements with RSSIs above -10 (on real hardware such measurements are invalid). In the simulator
     // however (due to the nature of the computation) the RSSIs for nodes that are extremely close (or even
@@ -4057,43 +4881,160 @@ float CherrySim::GetReceptionRssi(const NodeEntry *sender, const NodeEntry *rece
     // rejected.
     const auto clampRssi = [] (const float rssi) { return Utility::Clamp<float>(rssi, std::numeric_limits<float>::lowest(), -11.0f); };
 
-    // Compute the RSSI for transmissions between the two nodes
-    const float rssi = GetReceptionRssiNoNoise(sender, receiver);
-
     if (!simConfig.rssiNoise)
     {
-        return clampRssi(rssi);
+        return clampRssi(rssiNoNoise);
     }
 
     // Generate RSSI noise with the specified parameters
     const float noise = GenerateRssiNoise(simState.rnd, rssiNoiseStddev, rssiNoiseMean);
 
-    return clampRssi(rssi + noise);
+    return clampRssi(rssiNoNoise + noise);
 }
 
 float CherrySim::GetReceptionRssiNoNoise(const NodeEntry *sender, const NodeEntry *receiver)
 {
     // If either the sender or the receiver has the other marked as a impossibleConnection, the rssi is set to a unconnectable level.
-    if (!sender->impossibleConnection.empty() || !receiver->impossibleConnection.empty())
+    if (IsImpossibleConnection(sender, receiver))
+    {
+        return -10000;
+    }
+
+    // Only the transmission power depends on the sender, the path loss is cached for both directions
+    const float receivedPowerAtReferenceDistanceDbm = static_cast<float>(sender->gs.config.defaultDBmTX) + static_cast<float>(sender->gs.boardconf.configuration.calibratedTX);
+    const float rssiFromDistance = receivedPowerAtReferenceDistanceDbm - GetPathLossBetween(sender, receiver);
+
+    const auto ceilingAttenuation = std::abs(static_cast<float>(sender->currentFloorNumber - receiver->currentFloorNumber) * simConfig.ceilingAttenuationDb);
+
+    return rssiFromDistance - ceilingAttenuation;
+}
+
+bool CherrySim::IsImpossibleConnection(const NodeEntry* sender, const NodeEntry* receiver)
+{
+    if (sender->impossibleConnection.empty() && receiver->impossibleConnection.empty())
+    {
+        return false;
+    }
+    return std::find(sender->impossibleConnection.begin(), sender->impossibleConnection.end(), receiver->index) != sender->impossibleConnection.end()
+        || std::find(receiver->impossibleConnection.begin(), receiver->impossibleConnection.end(), sender->index) != receiver->impossibleConnection.end();
+}
+
+ReceptionKernel::Parameters CherrySim::GetReceptionKernelParameters(const NodeEntry* sender)
+{
+    ReceptionKernel::Parameters parameters;
+    parameters.senderX = sender->x;
+    parameters.senderY = sender->y;
+    parameters.senderZ = sender->z;
+    parameters.senderFloorNumber = static_cast<float>(sender->currentFloorNumber);
+    parameters.receivedPowerAtReferenceDistanceDbm = static_cast<float>(sender->gs.config.defaultDBmTX) + static_cast<float>(sender->gs.boardconf.configuration.calibratedTX);
+    parameters.mapWidthInMeters = static_cast<float>(simConfig.mapWidthInMeters);
+    parameters.mapHeightInMeters = static_cast<float>(simConfig.mapHeightInMeters);
+    parameters.mapElevationInMeters = static_cast<float>(simConfig.mapElevationInMeters);
+    parameters.maxReceptionDistancePerAxisInMeters = maxReceptionDistancePerAxisInMeters;
+    parameters.ceilingAttenuationDb = simConfig.ceilingAttenuationDb;
+    parameters.receptionProbabilityVeryClose = simConfig.receptionProbabilityVeryClose;
+    parameters.receptionProbabilityClose = simConfig.receptionProbabilityClose;
+    parameters.receptionProbabilityFar = simConfig.receptionProbabilityFar;
+    parameters.receptionProbabilityVeryFar = simConfig.receptionProbabilityVeryFar;
+    return parameters;
+}
+
+void CherrySim::ComputeReceptionBatch(const NodeEntry* sender, const ReceptionKernel::Parameters& parameters, const u32* nodeIndices, ReceptionKernel::Batch& batch)
+{
+    for (u32 lane = 0; lane < batch.count; lane++)
+    {
+        const NodeEntry& receiver = nodes[nodeIndices[lane]];
+        batch.x[lane] = receiver.x;
+        batch.y[lane] = receiver.y;
+        batch.z[lane] = receiver.z;
+        batch.floorNumber[lane] = static_cast<float>(receiver.currentFloorNumber);
+    }
+
+    ReceptionKernel::ComputeInRangeMask(parameters, batch);
+
+    //Only receivers in range need the path loss, this keeps the link cache free of pairs that can't communicate
+    for (u32 lane = 0; lane < batch.count; lane++)
+    {
+        batch.pathLossDb[lane] = (batch.inRangeMask & (1UL << lane)) ? GetPathLossBetween(sender, &nodes[nodeIndices[lane]]) : 0.0f;
+    }
+
+    ReceptionKernel::ComputeRssiNoNoise(parameters, batch);
+
+    //Same special values as returned by GetReceptionRssi
+    for (u32 lane = 0; lane < batch.count; lane++)
     {
-        if (std::find(sender->impossibleConnection.begin(), sender->impossibleConnection.end(), receiver->index) != sender->impossibleConnection.end() ||
-            std::find(receiver->impossibleConnection.begin(), receiver->impossibleConnection.end(), sender->index) != receiver->impossibleConnection.end())
+        if (!(batch.inRangeMask & (1UL << lane)))
         {
-            return -10000;
+            batch.rssi[lane] = -1000;
         }
+        else if (IsImpossibleConnection(sender, &nodes[nodeIndices[lane]]))
+        {
+            batch.rssi[lane] = -10000;
+        }
+    }
+
+    //The probability of a noisy RSSI is only known once the noise was drawn (see CalculateReceptionProbabilityForAdvertisement)
+    if (!simConfig.rssiNoise)
+    {
+        ReceptionKernel::ComputeRssiProbability(parameters, batch);
     }
+}
 
-    const float distance = GetDistanceBetween(sender, receiver);
+float CherrySim::GetPathLossBetween(const NodeEntry* nodeA, const NodeEntry* nodeB)
+{
+    if (   linkCache.empty()
+        || linkCacheMapWidthInMeters     != simConfig.mapWidthInMeters
+        || linkCacheMapHeightInMeters    != simConfig.mapHeightInMeters
+        || linkCacheMapElevationInMeters != simConfig.mapElevationInMeters
+        || linkCachePropagationConstant  != propagationConstant)
+    {
+        ResetLinkCache();
+    }
 
-    const PathLossModelParameters parameters = {
-        .receivedPowerAtReferenceDistanceDbm = static_cast<float>(sender->gs.config.defaultDBmTX) + static_cast<float>(sender->gs.boardconf.configuration.calibratedTX),
-        .propagationConstant                 = propagationConstant,
-    };
-    const float rssiFromDistance = ComputeRssiFromDistance(distance, parameters);
+    if (nodeA->index > nodeB->index) std::swap(nodeA, nodeB);
+    const u32 versionA = GetLinkCacheVersion(nodeA);
+    const u32 versionB = GetLinkCacheVersion(nodeB);
 
-    const auto ceilingAttenuation = std::abs(static_cast<float>(sender->currentFloorNumber - receiver->currentFloorNumber) * simConfig.ceilingAttenuationDb);
+    LinkCacheEntry& entry = linkCache[(nodeA->index * 0x9E3779B1UL ^ nodeB->index) & (linkCache.size() - 1)];
+    if (   entry.nodeIndexA != nodeA->index
+        || entry.nodeIndexB != nodeB->index
+        || entry.versionA   != versionA
+        || entry.versionB   != versionB)
+    {
+        entry.nodeIndexA = nodeA->index;
+        entry.nodeIndexB = nodeB->index;
+        entry.versionA   = versionA;
+        entry.versionB   = versionB;
+        entry.pathLossDb = ComputePathLossFromDistance(GetDistanceBetween(nodeA, nodeB), propagationConstant);
+    }
 
-    return rssiFromDistance - ceilingAttenuation;
+    return entry.pathLossDb;
+}
+
+void CherrySim::ResetLinkCache()
+{
+    //Enough entries to keep the links to all nodes in range of each node, while still being bounded for huge meshes
+    u32 size = 1024;
+    while (size < GetTotalNodes() * 64 && size < (1UL << 20)) size <<= 1;
+
+    linkCache.assign(size, LinkCacheEntry());
+    linkCacheMapWidthInMeters     = simConfig.mapWidthInMeters;
+    linkCacheMapHeightInMeters    = simConfig.mapHeightInMeters;
+    linkCacheMapElevationInMeters = simConfig.mapElevationInMeters;
+    linkCachePropagationConstant  = propagationConstant;
+}
+
+u32 CherrySim::GetLinkCacheVersion(const NodeEntry* node) const
+{
+    //Positions are also written directly (e.g. by tests), which is why they are compared on every access
+    if (node->x != node->linkCacheX || node->y != node->linkCacheY || node->z != node->linkCacheZ)
+    {
+        node->linkCacheX = node->x;
+        node->linkCacheY = node->y;
+        node->linkCacheZ = node->z;
+        node->linkCacheVersion++;
+    }
+    return node->linkCacheVersion;
 }
 
 uint32_t CherrySim::CalculateReceptionProbabilityFromRssi(const float rssi)
@@ -4121,19 +5062,51 @@ uint32_t CherrySim::CalculateReceptionProbabilityForConnection(const NodeEntry *
 uint32_t CherrySim::CalculateReceptionProbabilityForAdvertisement(const NodeEntry *sendingNode, const NodeEntry *receivingNode)
 {
     // If the scanIntervalMs is 0, scanning is effectively disabled (i.e. no reception possible)
-    const auto scanIntervalMs = receivingNode->state.connectingActive ? receivingNode->state.connectingIntervalMs : receivingNode->state.scanIntervalMs;
-    if (scanIntervalMs == 0)
+    if (GetScanIntervalForAdvertisementMs(receivingNode) == 0)
     {
         return 0;
     }
 
     const auto rssiProbability = CalculateReceptionProbabilityFromRssi(GetReceptionRssi(sendingNode, receivingNode));
 
+    return ScaleReceptionProbabilityForAdvertisement(receivingNode, rssiProbability);
+}
+
+uint32_t CherrySim::CalculateReceptionProbabilityForAdvertisement(const NodeEntry *receivingNode, const ReceptionKernel::Batch &batch, const u32 lane)
+{
+    // Must draw the same random numbers as the overload above, i.e. noise is only generated for receivers in range
+    if (GetScanIntervalForAdvertisementMs(receivingNode) == 0)
+    {
+        return 0;
+    }
+
+    const bool inRange = (batch.inRangeMask & (1UL << lane)) != 0;
+    uint32_t rssiProbability = 0;
+    if (inRange && simConfig.rssiNoise)
+    {
+        rssiProbability = CalculateReceptionProbabilityFromRssi(ApplyRssiNoise(batch.rssi[lane]));
+    }
+    else if (inRange)
+    {
+        rssiProbability = batch.rssiProbability[lane];
+    }
+
+    return ScaleReceptionProbabilityForAdvertisement(receivingNode, rssiProbability);
+}
+
+uint32_t CherrySim::GetScanIntervalForAdvertisementMs(const NodeEntry *receivingNode)
+{
+    return receivingNode->state.connectingActive ? receivingNode->state.connectingIntervalMs : receivingNode->state.scanIntervalMs;
+}
+
+uint32_t CherrySim::ScaleReceptionProbabilityForAdvertisement(const NodeEntry *receivingNode, const uint32_t rssiProbability)
+{
     if (simConfig.perfectReceptionProbabilityForAdvertising && rssiProbability > 0)
     {
         return UINT32_MAX;
     }
 
+    const auto scanIntervalMs = GetScanIntervalForAdvertisementMs(receivingNode);
     const auto scanWindowMs = receivingNode->state.connectingActive ? receivingNode->state.connectingWindowMs : receivingNode->state.scanWindowMs;
 
     // The scan window (i.e. the time the node is scanning per interval) can not be greater than
@@ -4272,6 +5245,7 @@ void CherrySim::SetPosition(u32 nodeIndex, float x, float y, float z)
         nodes[nodeIndex].y = y;
         nodes[nodeIndex].z = z;
         nodes[nodeIndex].lastMovementSimTimeMs = simState.simTimeMs;
+        UpdateSpatialGrid(nodeIndex);
     }
 }
 
@@ -4283,9 +5257,16 @@ void CherrySim::AddPosition(u32 nodeIndex, float x, float y, float z)
         nodes[nodeIndex].y += y;
         nodes[nodeIndex].z += z;
         nodes[nodeIndex].lastMovementSimTimeMs = simState.simTimeMs;
+        UpdateSpatialGrid(nodeIndex);
     }
 }
 
+void CherrySim::UpdateSpatialGrid(u32 nodeIndex)
+{
+    const NodeEntry& node = nodes[nodeIndex];
+    advertisingGrid.Update(nodeIndex, node.GetXinMeters(), node.GetYinMeters(), node.GetZinMeters());
+}
+
 
 void CherrySim::AddPacketToStats(PacketStat* statArray, PacketStat* packet)
 {
@@ -44,9 +44,13 @@ into all files in order to rewrite macros and other calls.
 #include <Terminal.h>
 #include <LedWrapper.h>
 #include <CherrySimTypes.h>
+#include <SpatialGrid.h>
+#include <SimSnapshot.h>
+#include <ReceptionKernel.h>
 #include <map>
 #include <chrono>
 #include <string>
+#include <future>
 
 struct ReplayRecordEntry
 {
@@ -91,6 +95,7 @@ public:
     volatile bool receivedDataFromMeshGw = false;
     SimConfiguration simConfig; //The current configuration for the simulator
     SimulatorState simState; //The current state of the simulator
+    SimPhaseTimings phaseTimings; //Wall clock time spent in the phases of SimulateStepForAllNodes, see MeasurePhase
     NodeEntry* currentNode = nullptr; //A pointer to the current node under simulation
     NodeEntry* nodes = nullptr; //A pointer that points to the memory that holds the complete state of all nodes
     std::string logAccumulator;
@@ -102,6 +107,9 @@ public:
     /// Standard deviation of the RSSI noise, over 99% of generated values lie within 3-times this value.
     float rssiNoiseStddev = 5.0f;
 
+    /// Nodes that are further apart than this on any axis can never receive anything from each other.
+    static constexpr float maxReceptionDistancePerAxisInMeters = 50.0f;
+
     CherrySimEventListener* simEventListener = nullptr;
 
     int flashToFileWriteCycle = 0;
@@ -178,13 +186,48 @@ TESTER_PUBLIC:
     void AnimationShake(u32 serialNumber);
     bool AnimationLoadJsonFromPath(const char* path);
 
-    void StoreFlashToFile();
+    void StoreFlashToFile(); //Stores the flash of all nodes, which is all that a fresh simulator loads
+    void StoreSnapshotToFile(); //Stores the flash together with the RAM and the SimulatorState, see CaptureSnapshot
+    void WriteSnapshotToFile(SimSnapshot::Snapshot&& snapshot);
+    void WaitForFlashFileWrite(); //Throws a FileException if the last write failed
     void LoadFlashFromFile();
+    void LoadLegacyFlashFromFile(const std::vector<char>& buffer);
+    static bool ReadFlashFile(const std::string& path, std::vector<char>& buffer);
+    bool IsFlashFileHeaderValid(const FlashFileFormat::Header& header) const;
+    void CaptureNodeState(const NodeEntry& node, std::vector<u8>& out) const;
+    bool RestoreNodeState(NodeEntry& node, SimSnapshot::Reader& reader);
+    std::future<bool> flashFileWriter;
     void PrepareSimulatedFeatureSets();
     void QueueInterrupts();
 
     i8 FindFloorNumber(float zNorm);
 
+    //Buckets all nodes by their position so that advertising only has to look at nodes in range.
+    //The additional meter guards against rounding differences to the per axis check in GetReceptionRssi.
+    SpatialGrid advertisingGrid{ maxReceptionDistancePerAxisInMeters + 1.0f };
+    std::vector<u32> advertisingCandidates;
+    void UpdateSpatialGrid(u32 nodeIndex);
+
+    //Direct mapped cache of the distance dependent path loss between two nodes. As the path loss is
+    //symmetric, each pair is only stored once with the lower node index first. Entries are validated
+    //against the linkCacheVersion of both nodes so that moving a node invalidates all of its links.
+    struct LinkCacheEntry
+    {
+        u32 nodeIndexA = UINT32_MAX;
+        u32 nodeIndexB = UINT32_MAX;
+        u32 versionA = 0;
+        u32 versionB = 0;
+        float pathLossDb = 0;
+    };
+    std::vector<LinkCacheEntry> linkCache;
+    //The parameters that the cached path losses were computed with, the cache is flushed if they change
+    u32 linkCacheMapWidthInMeters = 0;
+    u32 linkCacheMapHeightInMeters = 0;
+    u32 linkCacheMapElevationInMeters = 0;
+    float linkCachePropagationConstant = 0;
+    void ResetLinkCache();
+    u32 GetLinkCacheVersion(const NodeEntry* node) const;
+
 #ifdef GITHUB_RELEASE
     //Used to redirect featuresets on github releases
     bool IsRedirectedFeatureset(const std::string& featureset);
@@ -202,7 +245,31 @@ public:
 
     void Init(); //Creates and flashes all nodes
     void SimulateStepForAllNodes(); //Simulates on timestep for all nodes
+    //Executes the given function and adds its wall clock time to the phaseTimings if they are enabled.
+    //The time is also added if the function throws, e.g. because the node was reset.
+    template<typename Function>
+    void MeasurePhase(SimPhase phase, Function&& function)
+    {
+        if (!phaseTimings.enabled)
+        {
+            function();
+            return;
+        }
+        struct PhaseClock {
+            std::chrono::nanoseconds& duration;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ~PhaseClock() { duration += std::chrono::steady_clock::now() - start; }
+        } clock{ phaseTimings.durations[(u32)phase] };
+        function();
+    }
     void QuitSimulation();
+    //Captures the flash of all nodes and, with includeState, their RAM together with the SimulatorState, see SimSnapshot
+    SimSnapshot::Snapshot CaptureSnapshot(bool includeState = true) const;
+    //Restores a serialized snapshot that was captured by this CherrySim, e.g. to fork several experiments from
+    //a mesh that was clustered once. Snapshots of other CherrySim instances throw a CorruptOrOutdatedSavefile.
+    void RestoreSnapshot(const std::vector<u8>& serializedSnapshot);
+    //Restores the snapshot that was last written to simConfig.storeFlashToFile
+    void RestoreSnapshotFromFile();
 
     //#### Terminal
     #ifdef TERMINAL_ENABLED
@@ -225,12 +292,14 @@ public:
     void BootCurrentNode(); // Starts the node. ShutdownCurrentNode() must be called to clean up
     void ResetCurrentNode(RebootReason rebootReason, bool throwException = true, bool powerLoss = false); //Resets a node and boots it again (Only call this after node was booted already)
     void ShutdownCurrentNode(); //Deletes the memory allocated by the node during runtime
+    static void AllocateNodeMemory(std::unique_ptr<u32[]>& block, u32& blockSize, u32 requiredSize); //Zeroes the block and only reallocates it if its size changed
     static void SendUartCommand(NodeId nodeId, const u8* message, u32 messageLength);
 
     static int ChipsetToPageSize(Chipset chipset);
     static int ChipsetToCodeSize(Chipset chipset);
     static int ChipsetToApplicationSize(Chipset chipset);
     static int ChipsetToBootloaderAddr(Chipset chipset);
+    static const SimFlashImage& GetFactoryFlashImage(BleStackType bleStackType, u32 bootloaderAddr); //The flash that all nodes with this stack start with, created once and shared by them
 
     void CheckForMultiTensorflowUsage();
 
@@ -252,6 +321,8 @@ public:
     void ImportPositionsAndDataFromJson();
     void PositionNodesRandomly();
     void LoadPresetNodePositions();
+    //The distance up to which two nodes with default transmission power have a stable connection
+    double GetStableConnectionRangeInMeters() const;
 
     //Bootloader Simulation
     void SimulateFruityLoader();
@@ -274,6 +345,10 @@ public:
 
     //GATT Simulation
     void SimulateConnections();
+    u32 GetDueConnectionEvents(SoftdeviceConnection* connection);
+    ConnectionEventParameters GetConnectionEventParameters(const SoftdeviceConnection& connection);
+    void SimulateConnectionEvent(SoftdeviceConnection* connection);
+    bool SimulateConnectionPacket(SoftdeviceConnection* connection, SoftDeviceBufferedPacket* packet, u32* unreliablePacketsSent);
     void SendUnreliableTxCompleteEvent(NodeEntry* node, int connHandle, u8 packetCount);
     void GenerateWrite(SoftDeviceBufferedPacket* bufferedPacket);
     void GenerateNotification(SoftDeviceBufferedPacket* bufferedPacket);
@@ -302,6 +377,7 @@ public:
     void SimulateWatchDog();
 
     void SimulateInterrupts();
+    bool IsCurrentNodeIdle();
 
     //Validity Checking
     void CheckMeshingConsistency();
@@ -325,9 +401,21 @@ public:
     float GetDistanceBetween(const NodeEntry * nodeA, const NodeEntry * nodeB);
     float GetReceptionRssi(const NodeEntry* sender, const NodeEntry* receiver);
     float GetReceptionRssiNoNoise(const NodeEntry* sender, const NodeEntry* receiver);
+    float GetPathLossBetween(const NodeEntry* nodeA, const NodeEntry* nodeB);
+
+    //Computes the noise free RSSI and the RSSI dependent reception probability of up to
+    //ReceptionKernel::BATCH_SIZE receivers at once. batch.count and nodeIndices must be set by the caller.
+    //With rssiNoise, the probability is left out as it depends on the noise that is drawn per receiver.
+    ReceptionKernel::Parameters GetReceptionKernelParameters(const NodeEntry* sender);
+    void ComputeReceptionBatch(const NodeEntry* sender, const ReceptionKernel::Parameters& parameters, const u32* nodeIndices, ReceptionKernel::Batch& batch);
 
 private:
     uint32_t CalculateReceptionProbabilityFromRssi(float rssi);
+    float ApplyRssiNoise(float rssiNoNoise);
+    uint32_t GetScanIntervalForAdvertisementMs(const NodeEntry* receivingNode);
+    uint32_t ScaleReceptionProbabilityForAdvertisement(const NodeEntry* receivingNode, uint32_t rssiProbability);
+    uint32_t CalculateReceptionProbabilityForAdvertisement(const NodeEntry* receivingNode, const ReceptionKernel::Batch& batch, u32 lane);
+    bool IsImpossibleConnection(const NodeEntry* sender, const NodeEntry* receiver);
 
 public:
     uint32_t CalculateReceptionProbabilityForConnection(const NodeEntry* sendingNode, const NodeEntry* receivingNode);
@@ -518,7 +518,7 @@ void CherrySimRunner::CherrySimEventHandler(const char* eventType)
 
 }
 
-void CherrySimRunner::CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize)
+void CherrySimRunner::CherrySimBleEventHandler(NodeEntry* currentNode, const ble_evt_t* bleEvent, u16 eventSize)
 {
 
 }
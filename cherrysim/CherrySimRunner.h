@@ -66,7 +66,7 @@ public:
     void TerminalPrintHandler(NodeEntry* currentNode, const char* message) override;
     //Inherited via CherrySimEventListener
     void CherrySimEventHandler(const char* eventType) override;
-    void CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize) override;
+    void CherrySimBleEventHandler(NodeEntry* currentNode, const ble_evt_t* bleEvent, u16 eventSize) override;
 
     void TerminalReaderMain();
 
@@ -74,7 +74,8 @@ void operator delete(void * p) throw()
 }
 #endif
 
-#ifdef CHERRYSIM_TESTER_ENABLED
+//The benchmarks reuse the tester but have their own main function, see bench/CherrySimBench.cpp
+#if defined(CHERRYSIM_TESTER_ENABLED) && !defined(CHERRYSIM_BENCH_ENABLED)
 int main(int argc, char **argv)
 {
     // Copy all arguments passed to the executable into a vector
@@ -257,13 +258,17 @@ NodeEntryPredicate NodeEntryPredicate::AllowNone()
 
 NodeEntryPredicate NodeEntryPredicate::AllowNodeIndex(u32 nodeIndex)
 {
-    return NodeEntryPredicate{[nodeIndex](const NodeEntry *nodeEntry) { return nodeEntry->index == nodeIndex; }};
+    NodeEntryPredicate retVal{[nodeIndex](const NodeEntry *nodeEntry) { return nodeEntry->index == nodeIndex; }};
+    retVal.restrictedTerminalId = static_cast<TerminalId>(nodeIndex + 1);
+    return retVal;
 }
 
 NodeEntryPredicate NodeEntryPredicate::AllowTerminalId(TerminalId terminalId)
 {
-    return NodeEntryPredicate{
+    NodeEntryPredicate retVal{
         [terminalId](const NodeEntry *nodeEntry) { return nodeEntry->GetTerminalId() == terminalId; }};
+    retVal.restrictedTerminalId = terminalId;
+    return retVal;
 }
 
 NodeEntryPredicate NodeEntryPredicate::AllowNodeId(NodeId nodeId)
@@ -387,6 +392,16 @@ void CherrySimTester::Start()
     started = true;
 }
 
+void CherrySimTester::StartWithFeaturesetDeviceTypes()
+{
+    Start();
+    for (u32 i = 0; i < sim->GetTotalNodes(); i++)
+    {
+        NodeIndexSetter setter(i);
+        if (GET_DEVICE_TYPE() == DeviceType::SINK) sim->nodes[i].uicr.CUSTOMER[11] = (u32)DeviceType::SINK;
+    }
+}
+
 void CherrySimTester::SimulateUntilClusteringDone(int timeoutMs, std::function<void()> executePerStep)
 {
     if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
@@ -450,7 +465,7 @@ void CherrySimTester::SimulateBroadcastMessage(double x, double y, ble_gap_evt_a
                 s.bleEvent.evt.gap_evt.params.adv_report.rssi = (i8) sim->GetReceptionRssi(sim->currentNode, &(sim->nodes[i]));
                 s.bleEvent.evt.gap_evt.params.adv_report.scan_rsp = 0;
                 s.bleEvent.evt.gap_evt.params.adv_report.type = (u8)sim->currentNode->state.advertisingType;
-                sim->nodes[i].eventQueue.push_back(s);
+                sim->nodes[i].eventQueue.Push(s);
             }
         }
     }
@@ -550,7 +565,8 @@ void CherrySimTester::_SimulateUntilMessageReceived(int timeoutMs, std::function
 {
     if (timeoutMs == 0) SIMEXCEPTION(ZeroTimeoutNotSupportedException);
     int startTimeMs = sim->simState.simTimeMs;
-    awaitedMessagesFound = false;
+    PrepareAwaitedMessages();
+    awaitedMessagesFound = awaitedMessagesRemaining == 0;
     unwantedMessageOccured = false;
     while (!awaitedMessagesFound) {
         if (executePerStep)
@@ -745,32 +761,84 @@ void CherrySimTester::TerminalPrintHandler(NodeEntry* currentNode, const char* m
 
     if (awaitedMessageResult[awaitedMessagePointer - 1] == '\n') {
         awaitedMessageResult[awaitedMessagePointer - 1] = '\0';
+        awaitedMessagePointer = 0;
+
+        //Only the messages that apply to the printing node are considered, most lines
+        //are therefore dropped before any matching happens.
+        CollectAwaitedMessageCandidates(sim->currentNode);
+        if (awaitedMessageCandidates.empty()) return;
+
+        if (!useRegex) {
+            //A single pass over the line finds all awaited substrings, the candidates
+            //are then checked in their original order.
+            awaitedMessageMatcher.FindAll(awaitedMessageResult.data(), awaitedMessageMatches);
+            if (awaitedMessageMatches.empty()) return;
+        }
+
         std::vector<SimulationMessage>& awaited = *this->awaitedTerminalOutputs;
-        for (unsigned int i = 0; i < awaited.size(); i++) {
-            if (!awaited[i].IsFound()) {
-                if (awaited[i].AppliesToNodeEntry(sim->currentNode))
-                {
-
-                    if (awaited[i].CheckAndSet(awaitedMessageResult.data(), useRegex))
-                    {
-                        if (awaited[i].ShouldOccur())
-                            break; //A received message should validate only one awaited message.
-                        else {
-                            unwantedMessageOccured = true;
-                            break;
-                        }
-                    }
+        for (const u32 i : awaitedMessageCandidates) {
+            if (!useRegex && !std::binary_search(awaitedMessageMatches.begin(), awaitedMessageMatches.end(), i)) continue;
+
+            if (awaited[i].CheckAndSet(awaitedMessageResult.data(), useRegex))
+            {
+                awaitedMessagesRemaining--;
+                if (!awaited[i].ShouldOccur()) {
+                    unwantedMessageOccured = true;
                 }
+                break; //A received message should validate only one awaited message.
             }
         }
 
-        awaitedMessagesFound = std::all_of(awaited.begin(), awaited.end(), [](const SimulationMessage& sm) {return sm.IsFound(); });
+        awaitedMessagesFound = awaitedMessagesRemaining == 0;
+    }
+}
 
-        awaitedMessagePointer = 0;
+void CherrySimTester::PrepareAwaitedMessages()
+{
+    awaitedMessagesByTerminalId.clear();
+    awaitedMessagesForAnyTerminal.clear();
+    awaitedMessagesRemaining = 0;
+
+    const std::vector<SimulationMessage>& awaited = *awaitedTerminalOutputs;
+    std::vector<std::string> patterns;
+    patterns.reserve(awaited.size());
+    for (u32 i = 0; i < awaited.size(); i++) {
+        patterns.push_back(awaited[i].GetMessagePart());
+        if (awaited[i].IsFound()) continue;
+
+        awaitedMessagesRemaining++;
+        const TerminalId terminalId = awaited[i].GetRestrictedTerminalId();
+        if (terminalId != 0) awaitedMessagesByTerminalId[terminalId].push_back(i);
+        else awaitedMessagesForAnyTerminal.push_back(i);
+    }
+
+    awaitedMessageMatcher = useRegex ? MultiPatternMatcher() : MultiPatternMatcher(patterns);
+}
+
+void CherrySimTester::CollectAwaitedMessageCandidates(const NodeEntry* nodeEntry)
+{
+    awaitedMessageCandidates.clear();
+
+    static const std::vector<u32> noMessages;
+    auto entry = awaitedMessagesByTerminalId.find(nodeEntry->GetTerminalId());
+    const std::vector<u32>& forTerminal = entry != awaitedMessagesByTerminalId.end() ? entry->second : noMessages;
+
+    //Both lists are sorted, merging them keeps the order of the awaited messages
+    const std::vector<SimulationMessage>& awaited = *awaitedTerminalOutputs;
+    auto a = forTerminal.begin();
+    auto b = awaitedMessagesForAnyTerminal.begin();
+    while (a != forTerminal.end() || b != awaitedMessagesForAnyTerminal.end()) {
+        u32 i;
+        if (b == awaitedMessagesForAnyTerminal.end() || (a != forTerminal.end() && *a < *b)) i = *a++;
+        else i = *b++;
+
+        if (!awaited[i].IsFound() && awaited[i].AppliesToNodeEntry(nodeEntry)) {
+            awaitedMessageCandidates.push_back(i);
+        }
     }
 }
 
-void CherrySimTester::CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize)
+void CherrySimTester::CherrySimBleEventHandler(NodeEntry* currentNode, const ble_evt_t* bleEvent, u16 eventSize)
 {
     if (
         (awaitedBleEventNodeId == 0 || currentNode->gs.node.configuration.nodeId == awaitedBleEventNodeId)
@@ -781,7 +849,7 @@ void CherrySimTester::CherrySimBleEventHandler(NodeEntry* currentNode, simBleEve
             if (awaitedBleEventDataPartLength <= eventSize) {
                 u16 offset = 0;
                 for (int i = 0; i < eventSize; i++) {
-                    if (((u8*)&simBleEvent->bleEvent)[i] == awaitedBleEventDataPart[offset]) {
+                    if (((const u8*)bleEvent)[i] == awaitedBleEventDataPart[offset]) {
                         offset++;
                         if (offset == awaitedBleEventDataPartLength) {
                             awaitedBleEventFound = true;
@@ -877,8 +945,10 @@ void SimulationMessage::MakeFound(const std::string & messageComplete)
 
 bool SimulationMessage::MatchesRegex(const std::string & message)
 {
-    std::regex reg(messagePart);
-    return std::regex_search(message, reg);
+    if (!compiledRegex) {
+        compiledRegex = std::make_shared<const std::regex>(messagePart);
+    }
+    return std::regex_search(message, *compiledRegex);
 }
 
 void SimulationMessage::PrintState() const
@@ -30,9 +30,13 @@
 #pragma once
 
 #include <CherrySim.h>
+#include <MultiPatternMatcher.h>
 
 #include <functional>
+#include <memory>
+#include <regex>
 #include <type_traits>
+#include <unordered_map>
 
 constexpr int MAX_TERMINAL_OUTPUT = 1024;
 
@@ -69,6 +73,13 @@ public:
         return predicate(nodeEntry);
     }
 
+    /// Returns the only terminal id that the predicate can allow or 0 if it is not
+    /// known to be restricted to a single terminal.
+    TerminalId GetRestrictedTerminalId() const
+    {
+        return restrictedTerminalId;
+    }
+
 private:
     static bool TheAllowAllPredicate(const NodeEntry *) noexcept
     {
@@ -82,6 +93,7 @@ private:
 
 private:
     std::function<bool(const NodeEntry *)> predicate = &TheAllowAllPredicate;
+    TerminalId restrictedTerminalId = 0;
 };
 
 struct CherrySimTesterConfig
@@ -99,6 +111,8 @@ private:
     bool               found           = false;
     // if false e.g. SimulateUntilMessagesReceived will throw an Exception should the message be received
     bool               shouldOccur = true;
+    // compiled on first use and shared between copies as compiling is much more expensive than matching
+    std::shared_ptr<const std::regex> compiledRegex;
 
     bool Matches(const std::string &message);
     void MakeFound(const std::string &messageComplete);
@@ -117,6 +131,13 @@ public:
     {
         return predicate(nodeEntry);
     }
+
+    TerminalId GetRestrictedTerminalId() const
+    {
+        return predicate.GetRestrictedTerminalId();
+    }
+
+    const std::string& GetMessagePart() const { return messagePart; }
 };
 
 class CherrySimTester : public TerminalPrintListener, public CherrySimEventListener
@@ -147,6 +168,17 @@ private:
     bool started = false;
     bool unwantedMessageOccured = false;
 
+    //Index over awaitedTerminalOutputs, built once per awaited set so that a line of
+    //output is only matched against the messages that apply to the printing node.
+    MultiPatternMatcher awaitedMessageMatcher;
+    std::unordered_map<TerminalId, std::vector<u32>> awaitedMessagesByTerminalId;
+    std::vector<u32> awaitedMessagesForAnyTerminal;
+    std::vector<u32> awaitedMessageCandidates;
+    std::vector<u32> awaitedMessageMatches;
+    u32 awaitedMessagesRemaining = 0;
+    void PrepareAwaitedMessages();
+    void CollectAwaitedMessageCandidates(const NodeEntry* nodeEntry);
+
 public:
     CherrySimTester(CherrySimTesterConfig testerConfig, SimConfiguration simConfig);
     
@@ -164,6 +196,10 @@ public:
 
     //### This boots up all nodes after they were initialized and flashed
     void Start();
+    //Like Start, but also flashes the device type of each featureset into the UICR of the node. The simulator flashes
+    //every node as a STATIC device, but as long as none of them is a SINK, all nodes wait to become the
+    //slave of another cluster of the same size and the mesh never clusters.
+    void StartWithFeaturesetDeviceTypes();
 
     //### Simulation methods
     void SimulateUntilClusteringDone(int timeoutMs, std::function<void()> executePerStep = std::function<void()>());
@@ -214,7 +250,7 @@ public:
 
     //Inherited via CherrySimEventListener
     void CherrySimEventHandler(const char* eventType) override;
-    void CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize) override;
+    void CherrySimBleEventHandler(NodeEntry* currentNode, const ble_evt_t* bleEvent, u16 eventSize) override;
 
 private:
     static bool verboseTestsByDefault;
@@ -81,6 +81,9 @@ void to_json(nlohmann::json& j, const SimConfiguration & config)
         { "perfectReceptionProbabilityForConnection" , config.perfectReceptionProbabilityForConnection  },
         { "verboseCommands"                          , config.verboseCommands                           },
         { "simulateAdvertisingIndexStep"             , config.simulateAdvertisingIndexStep              },
+        { "eventDrivenScheduling"                    , config.eventDrivenScheduling                     },
+        { "simulateConnectionEvents"                 , config.simulateConnectionEvents                  },
+        { "targetMeanNeighbourDegree"                , config.targetMeanNeighbourDegree                 },
         { "disableNonCriticalExceptions"             , config.disableNonCriticalExceptions              },
         { "webServerPort"                            , config.webServerPort                             },
         { "socketServerPort"                         , config.socketServerPort                          },
@@ -138,6 +141,9 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
         else if(it.key() == "perfectReceptionProbabilityForConnection"  ) config.perfectReceptionProbabilityForConnection  = *it;
         else if(it.key() == "verboseCommands"                           ) config.verboseCommands                           = *it;
         else if(it.key() == "simulateAdvertisingIndexStep"              ) config.simulateAdvertisingIndexStep              = *it;
+        else if(it.key() == "eventDrivenScheduling"                     ) config.eventDrivenScheduling                     = *it;
+        else if(it.key() == "simulateConnectionEvents"                  ) config.simulateConnectionEvents                  = *it;
+        else if(it.key() == "targetMeanNeighbourDegree"                 ) config.targetMeanNeighbourDegree                 = *it;
         else if(it.key() == "disableNonCriticalExceptions"              ) config.disableNonCriticalExceptions              = *it;
         else if(it.key() == "webServerPort"                             ) config.webServerPort                             = *it;
         else if(it.key() == "socketServerPort"                          ) config.socketServerPort                          = *it;
@@ -145,6 +151,40 @@ void from_json(const nlohmann::json & j, SimConfiguration & config)
     }
 }
 
+const char* SimPhaseToString(SimPhase phase)
+{
+    switch (phase)
+    {
+    case SimPhase::MOVEMENT:                    return "SimulateMovement";
+    case SimPhase::INTERRUPTS:                  return "QueueInterrupts";
+    case SimPhase::TIMER:                       return "SimulateTimer";
+    case SimPhase::TIMEOUTS:                    return "SimulateTimeouts";
+    case SimPhase::ADVERTISING:                 return "SimulateAdvertising";
+    case SimPhase::CONNECTIONS:                 return "SimulateConnections";
+    case SimPhase::SERVICE_DISCOVERY:           return "SimulateServiceDiscovery";
+    case SimPhase::UART_INTERRUPTS:             return "SimulateUartInterrupts";
+    case SimPhase::TIMESLOT:                    return "SimulateTimeslot";
+    case SimPhase::CONNECTION_PARAMETER_UPDATE: return "SimulateConnectionParameterUpdateRequestTimeout";
+    case SimPhase::EVENT_LOOPER:                return "EventLooper";
+    case SimPhase::FLASH_COMMIT:                return "SimulateFlashCommit";
+    case SimPhase::BATTERY_USAGE:               return "SimulateBatteryUsage";
+    case SimPhase::WATCHDOG:                    return "SimulateWatchDog";
+    default:                                    return "Unknown";
+    }
+}
+
+void SimPhaseTimings::Reset()
+{
+    durations.fill(std::chrono::nanoseconds::zero());
+}
+
+std::chrono::nanoseconds SimPhaseTimings::GetTotal() const
+{
+    std::chrono::nanoseconds total = std::chrono::nanoseconds::zero();
+    for (const auto& duration : durations) total += duration;
+    return total;
+}
+
 void NodeEntry::Initialize(u32 nodeIndex)
 {
     this->index                        = nodeIndex;
@@ -156,8 +196,7 @@ void NodeEntry::Initialize(u32 nodeIndex)
     // Initialize UICR memory
     CheckedMemset(&uicr, 0xFF, sizeof(uicr));
 
-    // Initialize flash memory
-    CheckedMemset(&flash, 0xFF, sizeof(flash));
+    // The flash memory is already erased by its constructor
     // TODO: We could load a softdevice and app image into flash, would that help for something?
 
     // Generate device address based on the id works for up to 65535 adresses
@@ -32,11 +32,17 @@
 #include <GlobalState.h>
 #include <queue>
 #include <map>
+#include <memory>
 #include <array>
+#include <chrono>
 #include <string>
 #include "MersenneTwister.h"
 #include "json.hpp"
 #include "MoveAnimation.h"
+#include "SimBleEventQueue.h"
+#include "ConnectionEventModel.h"
+#include "SimFlashMemory.h"
+#include "SimEcb.h"
 
 extern "C" {
 #include <ble_hci.h>
@@ -128,6 +134,9 @@ struct SoftdeviceConnection {
     u32 lastReceivedPacketTimestampMs = 0;
     u32 connectionSetupTimeMs = 0;
     u32 lastConnectionTimestampMs = 0;
+    uint64_t nextConnectionEventUs = 0; //Only used with SimConfiguration::simulateConnectionEvents
+    u32 llDataLength = LL_DEFAULT_DATA_LENGTH; //Maximum payload of a link layer PDU, changed by the data length update
+    uint64_t sentValueBytes = 0; //ATT values of all writes and notifications that were sent over the connection
 
     SoftDeviceBufferedPacket reliableBuffers[SIM_NUM_RELIABLE_BUFFERS] = {};
     SoftDeviceBufferedPacket unreliableBuffers[SIM_NUM_UNRELIABLE_BUFFERS] = {};
@@ -186,6 +195,8 @@ struct SoftdeviceState {
     //Connection
     int connectionParamIntervalMs = 0;
     int connectionTimeoutMs = 0;
+    u32 connectionEventLengthUs = 3 * CONFIG_UNIT_1_25_MS; //BLE_GAP_EVENT_LENGTH_DEFAULT
+    bool connectionEventExtension = false;
 
     //Connecting security
     u8 currentLtkForEstablishingSecurity[16] = {}; //The Long Term key used to initiate the last encryption request for a connection
@@ -254,24 +265,37 @@ struct NodeEntry {
     NRF_UICR_Type uicr;
     NRF_GPIO_Type gpio;
     NRF_RADIO_Type radio;
-    u8 flash[SIM_MAX_FLASH_SIZE];
+    SimFlashMemory flash; //Starts erased, FlashNode maps the factory image of the chipset, see SimFlashMemory
     SoftdeviceState state;
-    std::deque<simBleEvent> eventQueue;
-    simBleEvent currentEvent; //The event currently being processed, as a simBleEvent, this can have some additional data attached to it useful for debugging
+    SimBleEventQueue eventQueue;
     bool led1On = false;
     bool led2On = false;
     bool led3On = false;
     u32 nanoAmperePerMsTotal;
-    u8 *moduleMemoryBlock = nullptr;
+    //The RAM blocks of the modules and of the FruityHal are kept over reboots so that they stay at the same
+    //address, which allows to restore a snapshot of the node (see CherrySim::RestoreSnapshot)
+    std::unique_ptr<u32[]> moduleMemoryBlock;
+    u32 moduleMemoryBlockSize = 0; //In bytes
+    std::unique_ptr<u32[]> halMemory;
+    u32 halMemorySize = 0; //In bytes
+    ScratchArena scratchArena; //Backs the DYNAMIC_ARRAYs of the node, see ScratchArena
+    SimEcb ecb; //The ECB peripheral used by sd_ecb_block_encrypt, caches the key schedules of the node
 
     uint32_t restartCounter = 0; //Counts how many times the node was restarted
     int64_t simulatedFrames = 0;
+    int64_t idleFrames = 0; //Frames in which nothing was due on the node so that only its time advanced (see SimConfiguration::eventDrivenScheduling)
     u32 watchdogTimeout = 0; //After how many simulated unfeed ms the watchdog should kill the node.
     u32 lastWatchdogFeedTime = 0; //The timestamp at which the watchdog was fed last.
     RebootReason rebootReason = RebootReason::UNKNOWN;
 
     std::vector<int> impossibleConnection; //The rssi to these nodes is artificially increased to an unconnectable level.
 
+    //Incremented whenever the position of the node changes, invalidates all cached links of this node (see CherrySim::GetPathLossBetween)
+    mutable u32 linkCacheVersion = 0;
+    mutable float linkCacheX = 0;
+    mutable float linkCacheY = 0;
+    mutable float linkCacheZ = 0;
+
     std::map<u32, InterruptSettings> gpioInitializedPins; // Map from pin to settings
     std::queue<u32> interruptQueue;
 
@@ -348,6 +372,36 @@ struct SimulatorState {
     u32 globalPacketIdCounter = 0;
 };
 
+//The phases of a simulation step for which CherrySim can measure the wall clock time
+enum class SimPhase : u8
+{
+    MOVEMENT,
+    INTERRUPTS,
+    TIMER,
+    TIMEOUTS,
+    ADVERTISING,
+    CONNECTIONS,
+    SERVICE_DISCOVERY,
+    UART_INTERRUPTS,
+    TIMESLOT,
+    CONNECTION_PARAMETER_UPDATE,
+    EVENT_LOOPER,
+    FLASH_COMMIT,
+    BATTERY_USAGE,
+    WATCHDOG,
+    AMOUNT
+};
+const char* SimPhaseToString(SimPhase phase);
+
+//Accumulates the time spent in each SimPhase, only measured while enabled as reading the clock is not free
+struct SimPhaseTimings {
+    bool enabled = false;
+    std::array<std::chrono::nanoseconds, (u32)SimPhase::AMOUNT> durations = {};
+
+    void Reset();
+    std::chrono::nanoseconds GetTotal() const;
+};
+
 struct DevicePosition {
     double x = 0;
     double y = 0;
@@ -416,6 +470,10 @@ struct SimConfiguration {
     bool        enableSimStatistics                = false;
     std::string storeFlashToFile                   = "";
 
+    /// If bigger than 0, PositionNodesRandomly spreads the nodes uniformly over an area in the center of the map
+    /// that is sized so that each none asset node has about this many nodes in stable connection range.
+    float       targetMeanNeighbourDegree          = 0.0f;
+
     /// The base height of the lowest floor. This is subtracted from the height of an asset tag before the floor computation takes place.
     float       floorBiasInMeters                  = 0.0f;
     /// The height of all ceilings in meters. This value, together with `mapElevationInMeters` defines how many floors are available.
@@ -441,6 +499,16 @@ struct SimConfiguration {
     /// advertisement delivery, i.e. three means that a third of all nodes will be considered.
     uint32_t simulateAdvertisingIndexStep = 1;
 
+    /// If set, nodes that have nothing due in a simulation step (no timer, advertising or connection event,
+    /// no queued events, interrupts, terminal commands, ...) are not simulated in that step, only their time advances.
+    /// This does not change the behaviour of the firmware, but the random numbers are drawn in a different order.
+    bool eventDrivenScheduling = false;
+
+    /// If set, the packets of a connection are sent in connection events according to the ConnectionEventModel,
+    /// several events per simulation step if the connection interval is shorter than a step. Otherwise,
+    /// a random amount of packets is sent once per connection interval.
+    bool simulateConnectionEvents = false;
+
     void SetToPerfectConditions();
 };
 
@@ -455,7 +523,7 @@ public:
     virtual ~CherrySimEventListener() {};
 
     virtual void CherrySimEventHandler(const char* eventType) = 0;
-    virtual void CherrySimBleEventHandler(NodeEntry* currentNode, simBleEvent* simBleEvent, u16 eventSize) = 0;
+    virtual void CherrySimBleEventHandler(NodeEntry* currentNode, const ble_evt_t* bleEvent, u16 eventSize) = 0;
 };
 
 //Notifies of Terminal Output
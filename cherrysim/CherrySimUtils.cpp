@@ -49,6 +49,11 @@ std::set<int> CherrySimUtils::GenerateRandomNumbers(const int min, const int max
     return numbers;
 }
 
+u16 CherrySimUtils::ConnectionIntervalMsToUnits(u32 connectionIntervalMs)
+{
+    return (u16)((connectionIntervalMs * 1000 + CONFIG_UNIT_1_25_MS - 1) / CONFIG_UNIT_1_25_MS);
+}
+
 std::string CherrySimUtils::GetNormalizedPath()
 {
     //Check if the working directory was given as an environment variable
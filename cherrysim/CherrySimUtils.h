@@ -39,4 +39,7 @@ public:
     //ATTENTION: Only works if a simulator is instanciated as it relies on its PSRNG
     static std::set<int> GenerateRandomNumbers(const int min, const int max, const unsigned int count);
     static std::string GetNormalizedPath();
+    //Converts a simulated connection interval to the 1.25ms units used in SoftDevice events
+    //The simulator stores intervals as full milliseconds (7.5ms as 7ms), so the result is rounded up
+    static u16 ConnectionIntervalMsToUnits(u32 connectionIntervalMs);
 };
\ No newline at end of file
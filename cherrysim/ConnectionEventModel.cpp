@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ConnectionEventModel.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr u32 BYTE_AIR_TIME_US      = 8; //LE 1M PHY
+    constexpr u32 T_IFS_US              = 150;
+    constexpr u32 LL_PDU_OVERHEAD_BYTES = 10; //Preamble, access address, header and CRC
+    constexpr u32 LL_MIC_BYTES          = 4;
+    constexpr u32 L2CAP_HEADER_BYTES    = 4;
+    constexpr u32 ATT_WRITE_HEADER_BYTES = 3;
+
+    //Legacy advertising with a full advertising payload, every channel might receive a scan request
+    constexpr u32 ADV_ADDRESS_BYTES     = 6;
+    constexpr u32 ADV_DATA_BYTES        = 31;
+    constexpr u32 SCAN_REQ_BYTES        = 12;
+    constexpr u32 ADVERTISING_CHANNELS  = 3;
+
+    //The margin is the smallest multiple of 50 us for which the model matches the rows with data length extension,
+    //the rows without it were not used. The SoftDevices do not limit the amount of PDUs per event but only the event length.
+    const ConnectionEventCalibration calibrations[] = {
+        { BleStackType::NRF_SD_132_ANY, 1150, 0 },
+        { BleStackType::NRF_SD_140_ANY, 1150, 0 },
+    };
+
+    //Data throughput tables of the S132 and S140 SoftDevice specifications, LE 1M PHY, notifications or write
+    //commands. The tables do not contain measurements with concurrent scanning or advertising.
+    const ConnectionThroughputReference references[] = {
+        { BleStackType::NRF_SD_132_ANY, 7500,  7500,  23,  LL_DEFAULT_DATA_LENGTH, 192000 / 8, false },
+        { BleStackType::NRF_SD_132_ANY, 50000, 50000, 247, LL_MAX_DATA_LENGTH,     702720 / 8, true  },
+        { BleStackType::NRF_SD_140_ANY, 7500,  7500,  23,  LL_DEFAULT_DATA_LENGTH, 192000 / 8, false },
+        { BleStackType::NRF_SD_140_ANY, 50000, 50000, 247, LL_MAX_DATA_LENGTH,     702720 / 8, true  },
+    };
+}
+
+const ConnectionEventCalibration& GetConnectionEventCalibration(BleStackType stackType)
+{
+    for (const ConnectionEventCalibration& calibration : calibrations)
+    {
+        if (calibration.stackType == stackType) return calibration;
+    }
+    return calibrations[0];
+}
+
+const ConnectionThroughputReference* GetConnectionThroughputReferences(u32* amount)
+{
+    *amount = sizeof(references) / sizeof(references[0]);
+    return references;
+}
+
+u32 ComputeWritePduCount(u32 valueLength, u32 llDataLength)
+{
+    const u32 frameLength = L2CAP_HEADER_BYTES + ATT_WRITE_HEADER_BYTES + valueLength;
+    return (frameLength + llDataLength - 1) / llDataLength;
+}
+
+u32 ComputeWriteAirTimeUs(u32 valueLength, u32 llDataLength, bool encrypted)
+{
+    const u32 frameLength = L2CAP_HEADER_BYTES + ATT_WRITE_HEADER_BYTES + valueLength;
+    const u32 pduCount = ComputeWritePduCount(valueLength, llDataLength);
+
+    //Empty PDUs do not carry a MIC
+    const u32 pduOverheadBytes = LL_PDU_OVERHEAD_BYTES + (encrypted ? LL_MIC_BYTES : 0);
+    const u32 acknowledgementUs = T_IFS_US + LL_PDU_OVERHEAD_BYTES * BYTE_AIR_TIME_US + T_IFS_US;
+
+    return frameLength * BYTE_AIR_TIME_US + pduCount * (pduOverheadBytes * BYTE_AIR_TIME_US + acknowledgementUs);
+}
+
+u32 ComputeWriteReservedTimeUs(u32 valueLength, u32 llDataLength, bool encrypted)
+{
+    const u32 pduOverheadBytes = LL_PDU_OVERHEAD_BYTES + (encrypted ? LL_MIC_BYTES : 0);
+    const u32 emptyAnswerUs = LL_PDU_OVERHEAD_BYTES * BYTE_AIR_TIME_US;
+    const u32 longestAnswerUs = (pduOverheadBytes + llDataLength) * BYTE_AIR_TIME_US;
+    return ComputeWriteAirTimeUs(valueLength, llDataLength, encrypted) - emptyAnswerUs + longestAnswerUs;
+}
+
+u32 ComputeAdvertisingEventUs()
+{
+    const u32 advIndUs = (LL_PDU_OVERHEAD_BYTES + ADV_ADDRESS_BYTES + ADV_DATA_BYTES) * BYTE_AIR_TIME_US;
+    const u32 scanReqUs = (LL_PDU_OVERHEAD_BYTES + SCAN_REQ_BYTES) * BYTE_AIR_TIME_US;
+    const u32 scanRspUs = (LL_PDU_OVERHEAD_BYTES + ADV_ADDRESS_BYTES + ADV_DATA_BYTES) * BYTE_AIR_TIME_US;
+    return ADVERTISING_CHANNELS * (advIndUs + T_IFS_US + scanReqUs + T_IFS_US + scanRspUs);
+}
+
+u32 ComputeConnectionEventTimeUs(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration)
+{
+    const u32 intervalShareUs = parameters.connectionIntervalUs / std::max<u32>(parameters.activeConnections, 1);
+    const bool otherRadioActivity = parameters.scanning || parameters.advertisingIntervalMs != 0;
+
+    u32 eventTimeUs = (parameters.eventExtension && !otherRadioActivity)
+        ? intervalShareUs
+        : std::min(parameters.eventLengthUs, intervalShareUs);
+
+    if (parameters.advertisingIntervalMs != 0)
+    {
+        const u32 advertisingShareUs = (u32)((uint64_t)ComputeAdvertisingEventUs() * parameters.connectionIntervalUs / (parameters.advertisingIntervalMs * 1000ULL));
+        eventTimeUs -= std::min(eventTimeUs, advertisingShareUs);
+    }
+
+    return eventTimeUs - std::min(eventTimeUs, calibration.eventEndMarginUs);
+}
+
+u32 ComputeWritesPerConnectionEvent(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration, u32 valueLength)
+{
+    //Every write but the last one only needs its air time
+    const u32 eventTimeUs = ComputeConnectionEventTimeUs(parameters, calibration);
+    const u32 reservedTimeUs = ComputeWriteReservedTimeUs(valueLength, parameters.llDataLength, parameters.encrypted);
+    u32 writes = eventTimeUs < reservedTimeUs ? 0 : (eventTimeUs - reservedTimeUs) / ComputeWriteAirTimeUs(valueLength, parameters.llDataLength, parameters.encrypted) + 1;
+
+    if (calibration.maxPdusPerEvent != 0)
+    {
+        writes = std::min(writes, calibration.maxPdusPerEvent / ComputeWritePduCount(valueLength, parameters.llDataLength));
+    }
+
+    //The master always transmits at the anchor point
+    return std::max<u32>(writes, 1);
+}
+
+u32 ComputeConnectionThroughput(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration, u32 valueLength)
+{
+    const uint64_t bytesPerEvent = (uint64_t)ComputeWritesPerConnectionEvent(parameters, calibration, valueLength) * valueLength;
+    return (u32)(bytesPerEvent * 1000000 / parameters.connectionIntervalUs);
+}
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FmTypes.h"
+
+//
+// The Connection-Event-Model
+//
+// Estimates how many writes and notifications a SoftDevice transfers in one connection event on the LE 1M PHY.
+// Every write is an L2CAP frame (4 byte header + 3 byte ATT header + value) that is split into link layer PDUs
+// of at most the negotiated LL data length (27 byte without data length extension). Every PDU is acknowledged by
+// an empty PDU of the partner:
+//
+//     t_PDU      = 8 us/byte ⋅ (10 byte preamble/address/header/CRC + payload + 4 byte MIC if encrypted)
+//     t_exchange = t_PDU + T_IFS + t_emptyPDU + T_IFS
+//
+// The partner may answer each PDU with a PDU of the full LL data length instead of an empty one, so an exchange
+// is only started if there is enough time left for the longest possible answer.
+//
+// A connection event lasts up to the configured event length. If connection event length extension is enabled,
+// the SoftDevice extends the event up to the connection interval as long as no other radio activity is
+// scheduled, which is not the case while scanning or advertising. The connections of a node share the interval,
+// advertising events take away their share of radio time and the SoftDevice stops early enough before the end
+// of the event to prepare the next radio activity.
+//
+
+constexpr u32 LL_DEFAULT_DATA_LENGTH = 27;
+constexpr u32 LL_MAX_DATA_LENGTH = 251;
+
+/// Parameters of a SoftDevice that can not be derived from the air time and were calibrated against measurements
+struct ConnectionEventCalibration
+{
+    BleStackType stackType;
+
+    /// Time at the end of each connection event in which no more packets are started.
+    u32 eventEndMarginUs;
+
+    /// Upper limit of the PDUs that are sent in one connection event, 0 if only limited by the event length.
+    u32 maxPdusPerEvent;
+};
+
+/// A documented throughput measurement of a single connection that the model must reproduce
+struct ConnectionThroughputReference
+{
+    BleStackType stackType;
+    u32 connectionIntervalUs;
+    u32 eventLengthUs;
+    u32 attMtu;
+    u32 llDataLength;
+    /// Throughput of write commands or notifications, only counting the ATT values
+    u32 bytesPerSecond;
+    /// True if the calibration was chosen based on this measurement, the others are only used to check the model
+    bool usedForCalibration;
+};
+
+/// The state of a node that influences the connection events of one of its connections
+struct ConnectionEventParameters
+{
+    u32  connectionIntervalUs = 0;
+    u32  eventLengthUs        = 0;
+    bool eventExtension       = false;
+    u32  llDataLength         = LL_DEFAULT_DATA_LENGTH;
+    bool encrypted            = false;
+    u32  activeConnections    = 1;
+    bool scanning             = false;
+    u32  advertisingIntervalMs = 0; //0 if not advertising
+};
+
+/// Returns the calibration of the given SoftDevice, unknown stacks use the one of the S132.
+const ConnectionEventCalibration& GetConnectionEventCalibration(BleStackType stackType);
+
+/// Returns the measurements that the calibration was checked against.
+const ConnectionThroughputReference* GetConnectionThroughputReferences(u32* amount);
+
+/// Computes the amount of link layer PDUs that are needed to transfer a write with the given value length.
+u32 ComputeWritePduCount(u32 valueLength, u32 llDataLength);
+
+/// Computes the air time of a write with the given value length, including the acknowledgements of the partner.
+u32 ComputeWriteAirTimeUs(u32 valueLength, u32 llDataLength, bool encrypted);
+
+/// Computes the time that must be left in the connection event to start a write, which is its air time
+/// plus the time that a partner needs to answer the last PDU with a PDU of the full LL data length.
+u32 ComputeWriteReservedTimeUs(u32 valueLength, u32 llDataLength, bool encrypted);
+
+/// Computes the radio time of a connectable advertising event on all three advertising channels.
+u32 ComputeAdvertisingEventUs();
+
+/// Computes the radio time that one connection event of a connection can use for packets.
+u32 ComputeConnectionEventTimeUs(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration);
+
+/// Computes how many writes with the given value length are transferred in one connection event, at least one.
+u32 ComputeWritesPerConnectionEvent(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration, u32 valueLength);
+
+/// Computes the throughput in bytes/s of ATT values if the connection always has writes with the given value length queued.
+u32 ComputeConnectionThroughput(const ConnectionEventParameters &parameters, const ConnectionEventCalibration &calibration, u32 valueLength);
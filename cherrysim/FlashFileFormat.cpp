@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "FlashFileFormat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace FlashFileFormat
+{
+    //Encoding: A control byte below 0x80 is followed by (control + 1) literal bytes. A control byte of 0x80 or
+    //above is followed by a single byte that is repeated (control - 0x80 + MIN_RUN_LENGTH) times.
+    constexpr uint32_t MIN_RUN_LENGTH = 3;
+    constexpr uint32_t MAX_RUN_LENGTH = 0x7F + MIN_RUN_LENGTH;
+    constexpr uint32_t MAX_LITERAL_LENGTH = 0x80;
+
+    static uint32_t GetRunLength(const uint8_t* data, uint32_t length, uint32_t offset)
+    {
+        uint32_t run = 1;
+        while (offset + run < length && run < MAX_RUN_LENGTH && data[offset + run] == data[offset]) run++;
+        return run;
+    }
+
+    static void AppendU32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    static bool ReadU32(const uint8_t*& data, const uint8_t* end, uint32_t& value)
+    {
+        if (end - data < (std::ptrdiff_t)sizeof(value)) return false;
+        memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return true;
+    }
+
+    SparseFlash::SparseFlash(uint32_t version, uint32_t flashSize)
+    {
+        header.magic = MAGIC;
+        header.version = version;
+        header.sizeOfHeader = sizeof(Header);
+        header.flashSize = flashSize;
+        header.pageSize = PAGE_SIZE;
+        header.amountOfNodes = 0;
+    }
+
+    void SparseFlash::AddNode(const uint8_t* flash)
+    {
+        uint32_t amountOfPages = 0;
+        for (uint32_t page = 0; page < header.flashSize / PAGE_SIZE; page++)
+        {
+            const uint8_t* pageStart = flash + page * PAGE_SIZE;
+            if (IsErased(pageStart, PAGE_SIZE)) continue;
+
+            pageIndices.push_back(page);
+            pageData.insert(pageData.end(), pageStart, pageStart + PAGE_SIZE);
+            amountOfPages++;
+        }
+        amountOfPagesPerNode.push_back(amountOfPages);
+        header.amountOfNodes++;
+    }
+
+    bool IsErased(const uint8_t* data, uint32_t length)
+    {
+        return std::all_of(data, data + length, [](uint8_t b) { return b == 0xFF; });
+    }
+
+    void Encode(const uint8_t* data, uint32_t length, std::vector<uint8_t>& out)
+    {
+        uint32_t offset = 0;
+        while (offset < length)
+        {
+            const uint32_t run = GetRunLength(data, length, offset);
+            if (run >= MIN_RUN_LENGTH)
+            {
+                out.push_back(static_cast<uint8_t>(0x80 + run - MIN_RUN_LENGTH));
+                out.push_back(data[offset]);
+                offset += run;
+                continue;
+            }
+
+            //Collect literals until the next run that is worth encoding
+            uint32_t literals = run;
+            while (offset + literals < length
+                && literals < MAX_LITERAL_LENGTH
+                && GetRunLength(data, length, offset + literals) < MIN_RUN_LENGTH)
+            {
+                literals++;
+            }
+            out.push_back(static_cast<uint8_t>(literals - 1));
+            out.insert(out.end(), data + offset, data + offset + literals);
+            offset += literals;
+        }
+    }
+
+    bool Decode(const uint8_t* encoded, uint32_t encodedLength, uint8_t* out, uint32_t length)
+    {
+        uint32_t in = 0;
+        uint32_t written = 0;
+        while (in < encodedLength)
+        {
+            const uint8_t control = encoded[in++];
+            if (control >= 0x80)
+            {
+                const uint32_t run = control - 0x80 + MIN_RUN_LENGTH;
+                if (in >= encodedLength || written + run > length) return false;
+                memset(out + written, encoded[in++], run);
+                written += run;
+            }
+            else
+            {
+                const uint32_t literals = control + 1UL;
+                if (in + literals > encodedLength || written + literals > length) return false;
+                memcpy(out + written, encoded + in, literals);
+                in += literals;
+                written += literals;
+            }
+        }
+        return written == length;
+    }
+
+    std::vector<uint8_t> Serialize(const SparseFlash& sparseFlash)
+    {
+        std::vector<uint8_t> out;
+        const uint8_t* header = reinterpret_cast<const uint8_t*>(&sparseFlash.header);
+        out.insert(out.end(), header, header + sizeof(sparseFlash.header));
+
+        std::vector<uint8_t> encoded;
+        size_t page = 0;
+        for (const uint32_t amountOfPages : sparseFlash.amountOfPagesPerNode)
+        {
+            AppendU32(out, amountOfPages);
+            for (uint32_t i = 0; i < amountOfPages; i++, page++)
+            {
+                encoded.clear();
+                Encode(sparseFlash.pageData.data() + page * PAGE_SIZE, PAGE_SIZE, encoded);
+                AppendU32(out, sparseFlash.pageIndices[page]);
+                AppendU32(out, static_cast<uint32_t>(encoded.size()));
+                out.insert(out.end(), encoded.begin(), encoded.end());
+            }
+        }
+        return out;
+    }
+
+    bool DeserializeNode(const uint8_t*& data, const uint8_t* end, uint8_t* flash, uint32_t flashSize)
+    {
+        memset(flash, 0xFF, flashSize);
+
+        uint32_t amountOfPages = 0;
+        if (!ReadU32(data, end, amountOfPages)) return false;
+
+        for (uint32_t i = 0; i < amountOfPages; i++)
+        {
+            uint32_t pageIndex = 0;
+            uint32_t encodedLength = 0;
+            if (!ReadU32(data, end, pageIndex) || !ReadU32(data, end, encodedLength)) return false;
+            if (pageIndex >= flashSize / PAGE_SIZE || end - data < (std::ptrdiff_t)encodedLength) return false;
+            if (!Decode(data, encodedLength, flash + pageIndex * PAGE_SIZE, PAGE_SIZE)) return false;
+            data += encodedLength;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//
+// The format in which the simulator stores the flash of all nodes to a file (see SimConfiguration::storeFlashToFile).
+// Most of the flash of a node is erased, which is why only the pages that contain data are stored. These pages
+// are run length encoded as they mostly consist of records followed by erased space.
+//
+// Layout:
+//     Header
+//     For each node:   u32 amountOfPages
+//         For each page:   u32 pageIndex, u32 encodedLength, encodedLength bytes of encoded page
+//
+namespace FlashFileFormat
+{
+    constexpr uint32_t MAGIC = 0x4C465343; // "CSFL"
+    constexpr uint32_t PAGE_SIZE = 4096;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sizeOfHeader;
+        uint32_t flashSize;
+        uint32_t pageSize;
+        uint32_t amountOfNodes;
+    };
+
+    /// Copy of all pages that are not erased. Collecting the pages is cheap so that it can be done on the simulation
+    /// thread, whereas the expensive encoding and writing can be done on another thread.
+    struct SparseFlash
+    {
+        Header header;
+        std::vector<uint32_t> amountOfPagesPerNode;
+        std::vector<uint32_t> pageIndices;
+        std::vector<uint8_t> pageData;
+
+        SparseFlash(uint32_t version, uint32_t flashSize);
+
+        void AddNode(const uint8_t* flash);
+    };
+
+    bool IsErased(const uint8_t* data, uint32_t length);
+
+    /// Appends the run length encoding of data to out.
+    void Encode(const uint8_t* data, uint32_t length, std::vector<uint8_t>& out);
+
+    /// Decodes exactly length bytes to out, returns false if encoded is malformed.
+    bool Decode(const uint8_t* encoded, uint32_t encodedLength, uint8_t* out, uint32_t length);
+
+    std::vector<uint8_t> Serialize(const SparseFlash& sparseFlash);
+
+    /// Restores the flash of the next node from a serialized file and advances data. All pages that are
+    /// not stored are erased. Returns false if the data is malformed.
+    bool DeserializeNode(const uint8_t*& data, const uint8_t* end, uint8_t* flash, uint32_t flashSize);
+}
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "MultiPatternMatcher.h"
+
+#include <algorithm>
+#include <queue>
+
+MultiPatternMatcher::MultiPatternMatcher()
+    : states(1)
+{
+}
+
+MultiPatternMatcher::MultiPatternMatcher(const std::vector<std::string> &patterns)
+    : states(1), patternCount(static_cast<uint32_t>(patterns.size()))
+{
+    //Build the trie of all patterns
+    for (uint32_t i = 0; i < patterns.size(); i++)
+    {
+        uint32_t state = ROOT;
+        for (const char character : patterns[i])
+        {
+            const uint8_t c = static_cast<uint8_t>(character);
+            uint32_t next = FindEdge(state, c);
+            if (next == ROOT)
+            {
+                next = static_cast<uint32_t>(states.size());
+                states.emplace_back();
+                auto &edges = states[state].edges;
+                edges.insert(std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, 0u)), std::make_pair(c, next));
+            }
+            state = next;
+        }
+        states[state].patterns.push_back(i);
+    }
+
+    //Compute the failure links breadth first so that the links of all shorter
+    //suffixes are known once a state is visited.
+    std::queue<uint32_t> queue;
+    for (const auto &edge : states[ROOT].edges)
+    {
+        queue.push(edge.second);
+    }
+    while (!queue.empty())
+    {
+        const uint32_t state = queue.front();
+        queue.pop();
+
+        for (const auto &edge : states[state].edges)
+        {
+            const uint32_t child = edge.second;
+            uint32_t failure = states[state].failure;
+            while (failure != ROOT && FindEdge(failure, edge.first) == ROOT)
+            {
+                failure = states[failure].failure;
+            }
+            failure = FindEdge(failure, edge.first);
+            states[child].failure = failure;
+            states[child].nextOutput = states[failure].patterns.empty() ? states[failure].nextOutput : failure;
+            queue.push(child);
+        }
+    }
+}
+
+uint32_t MultiPatternMatcher::FindEdge(uint32_t state, uint8_t c) const
+{
+    const auto &edges = states[state].edges;
+    auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, 0u));
+    if (it != edges.end() && it->first == c) return it->second;
+    return ROOT;
+}
+
+uint32_t MultiPatternMatcher::Step(uint32_t state, uint8_t c) const
+{
+    while (true)
+    {
+        const uint32_t next = FindEdge(state, c);
+        if (next != ROOT || state == ROOT) return next;
+        state = states[state].failure;
+    }
+}
+
+void MultiPatternMatcher::FindAll(const char *text, std::vector<uint32_t> &out) const
+{
+    out.clear();
+
+    //Empty patterns end in the root and match everything
+    out.insert(out.end(), states[ROOT].patterns.begin(), states[ROOT].patterns.end());
+
+    uint32_t state = ROOT;
+    for (const char *it = text; *it != '\0'; it++)
+    {
+        state = Step(state, static_cast<uint8_t>(*it));
+        for (uint32_t output = states[state].patterns.empty() ? states[state].nextOutput : state; output != ROOT; output = states[output].nextOutput)
+        {
+            out.insert(out.end(), states[output].patterns.begin(), states[output].patterns.end());
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+uint32_t MultiPatternMatcher::GetPatternCount() const
+{
+    return patternCount;
+}
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// Finds all occurrences of a fixed set of substrings in a text with a single pass
+// over the text (Aho-Corasick). The cost of a search only depends on the length of
+// the text and the amount of matches, not on the amount of patterns. It is used by
+// the CherrySimTester to check every line of terminal output against all awaited
+// messages at once.
+//
+class MultiPatternMatcher
+{
+private:
+    struct State
+    {
+        //Outgoing edges, sorted by their character
+        std::vector<std::pair<uint8_t, uint32_t>> edges;
+        //Longest proper suffix of this state that is also a state
+        uint32_t failure = 0;
+        //Next state on the failure chain that ends at least one pattern, 0 if there is none
+        uint32_t nextOutput = 0;
+        //Indices of the patterns that end in this state
+        std::vector<uint32_t> patterns;
+    };
+
+    static constexpr uint32_t ROOT = 0;
+
+    std::vector<State> states;
+    uint32_t patternCount = 0;
+
+    uint32_t FindEdge(uint32_t state, uint8_t c) const;
+    uint32_t Step(uint32_t state, uint8_t c) const;
+
+public:
+    MultiPatternMatcher();
+
+    /// Builds the automaton for the given patterns. The index of a pattern in the
+    /// vector is reported back on a match. An empty pattern matches every text.
+    explicit MultiPatternMatcher(const std::vector<std::string> &patterns);
+
+    /// Fills out with the indices of all patterns that occur in the given zero
+    /// terminated text. The indices are sorted in ascending order and unique.
+    void FindAll(const char *text, std::vector<uint32_t> &out) const;
+
+    uint32_t GetPatternCount() const;
+};
@@ -39,7 +39,12 @@
 
 float ComputeRssiFromDistance(const float distance, const PathLossModelParameters &parameters)
 {
-    return parameters.receivedPowerAtReferenceDistanceDbm - 10.f * parameters.propagationConstant * std::log10(std::clamp(distance, 0.0001f, FLT_MAX));
+    return parameters.receivedPowerAtReferenceDistanceDbm - ComputePathLossFromDistance(distance, parameters.propagationConstant);
+}
+
+float ComputePathLossFromDistance(const float distance, const float propagationConstant)
+{
+    return 10.f * propagationConstant * std::log10(std::clamp(distance, 0.0001f, FLT_MAX));
 }
 
 float GenerateRssiNoise(MersenneTwister &rng, const float stddev, const float mean)
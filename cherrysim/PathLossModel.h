@@ -71,5 +71,9 @@ struct PathLossModelParameters
 /// Computes the RSSI from the distance using the Path-Loss-Model with the specified parameters.
 float ComputeRssiFromDistance(float distance, const PathLossModelParameters &parameters);
 
+/// Computes the distance dependent part of the Path-Loss-Model (10 N ⋅ log10(d / d_0)) in dB.
+/// It does not depend on the transmission power and can therefore be cached per pair of nodes.
+float ComputePathLossFromDistance(float distance, float propagationConstant);
+
 /// Generates a suitable RSSI noise sample.
 float GenerateRssiNoise(MersenneTwister &rng, float stddev, float mean);
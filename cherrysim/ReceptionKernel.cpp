@@ -0,0 +1,239 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "ReceptionKernel.h"
+
+#include <cmath>
+
+//SSE2 is only required on x86 hosts and not available for Emscripten builds. The default 32 bit build does not
+//enable SSE2 globally, so the SIMD functions are compiled for SSE2 separately and only used if the CPU supports it.
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && !defined(__EMSCRIPTEN__)
+#define RECEPTION_KERNEL_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RECEPTION_KERNEL_TARGET_SSE2
+#else
+#include <cpuid.h>
+#define RECEPTION_KERNEL_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+#else
+#define RECEPTION_KERNEL_SSE2 0
+#endif
+
+namespace ReceptionKernel
+{
+#if RECEPTION_KERNEL_SSE2
+    static bool DetectSse2()
+    {
+        //CPUID leaf 1 reports SSE2 in bit 26 of EDX
+#ifdef _MSC_VER
+        int registers[4] = {};
+        __cpuid(registers, 1);
+        return (registers[3] & (1 << 26)) != 0;
+#else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) return false;
+        return (edx & bit_SSE2) != 0;
+#endif
+    }
+
+    static const bool sse2Supported = DetectSse2();
+
+    //All functions process four lanes at a time, lanes after count are computed as well but masked out or ignored.
+    static_assert(BATCH_SIZE % 4 == 0, "Batch must consist of whole SSE registers");
+
+    static uint32_t GetLaneMask(const Batch &batch)
+    {
+        return batch.count >= BATCH_SIZE ? UINT32_MAX >> (32 - BATCH_SIZE) : (1UL << batch.count) - 1;
+    }
+
+    RECEPTION_KERNEL_TARGET_SSE2
+    static __m128 Abs(const __m128 value)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    }
+
+    RECEPTION_KERNEL_TARGET_SSE2
+    static __m128i Select(const __m128 mask, const __m128i ifSet, const __m128i ifNotSet)
+    {
+        const __m128i maskI = _mm_castps_si128(mask);
+        return _mm_or_si128(_mm_and_si128(maskI, ifSet), _mm_andnot_si128(maskI, ifNotSet));
+    }
+
+    RECEPTION_KERNEL_TARGET_SSE2
+    static void ComputeInRangeMaskSse2(const Parameters &parameters, Batch &batch)
+    {
+        const __m128 senderX = _mm_set1_ps(parameters.senderX);
+        const __m128 senderY = _mm_set1_ps(parameters.senderY);
+        const __m128 senderZ = _mm_set1_ps(parameters.senderZ);
+        const __m128 width = _mm_set1_ps(parameters.mapWidthInMeters);
+        const __m128 height = _mm_set1_ps(parameters.mapHeightInMeters);
+        const __m128 elevation = _mm_set1_ps(parameters.mapElevationInMeters);
+        const __m128 maxDistance = _mm_set1_ps(parameters.maxReceptionDistancePerAxisInMeters);
+
+        uint32_t outOfRangeMask = 0;
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 outOfRangeX = _mm_cmpgt_ps(_mm_mul_ps(Abs(_mm_sub_ps(senderX, _mm_load_ps(batch.x + i))), width), maxDistance);
+            const __m128 outOfRangeY = _mm_cmpgt_ps(_mm_mul_ps(Abs(_mm_sub_ps(senderY, _mm_load_ps(batch.y + i))), height), maxDistance);
+            const __m128 outOfRangeZ = _mm_cmpgt_ps(_mm_mul_ps(Abs(_mm_sub_ps(senderZ, _mm_load_ps(batch.z + i))), elevation), maxDistance);
+            const __m128 outOfRange = _mm_or_ps(outOfRangeX, _mm_or_ps(outOfRangeY, outOfRangeZ));
+            outOfRangeMask |= static_cast<uint32_t>(_mm_movemask_ps(outOfRange)) << i;
+        }
+        batch.inRangeMask = ~outOfRangeMask & GetLaneMask(batch);
+    }
+
+    RECEPTION_KERNEL_TARGET_SSE2
+    static void ComputeRssiNoNoiseSse2(const Parameters &parameters, Batch &batch)
+    {
+        const __m128 receivedPower = _mm_set1_ps(parameters.receivedPowerAtReferenceDistanceDbm);
+        const __m128 senderFloorNumber = _mm_set1_ps(parameters.senderFloorNumber);
+        const __m128 ceilingAttenuationDb = _mm_set1_ps(parameters.ceilingAttenuationDb);
+
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 rssiFromDistance = _mm_sub_ps(receivedPower, _mm_load_ps(batch.pathLossDb + i));
+            const __m128 floorDifference = _mm_sub_ps(senderFloorNumber, _mm_load_ps(batch.floorNumber + i));
+            const __m128 ceilingAttenuation = Abs(_mm_mul_ps(floorDifference, ceilingAttenuationDb));
+            _mm_store_ps(batch.rssi + i, _mm_sub_ps(rssiFromDistance, ceilingAttenuation));
+        }
+    }
+
+    RECEPTION_KERNEL_TARGET_SSE2
+    static void ComputeRssiProbabilitySse2(const Parameters &parameters, Batch &batch)
+    {
+        const __m128i probabilityVeryClose = _mm_set1_epi32(static_cast<int32_t>(parameters.receptionProbabilityVeryClose));
+        const __m128i probabilityClose = _mm_set1_epi32(static_cast<int32_t>(parameters.receptionProbabilityClose));
+        const __m128i probabilityFar = _mm_set1_epi32(static_cast<int32_t>(parameters.receptionProbabilityFar));
+        const __m128i probabilityVeryFar = _mm_set1_epi32(static_cast<int32_t>(parameters.receptionProbabilityVeryFar));
+
+        //Starting with the lowest threshold, each threshold that is exceeded overwrites the previous result.
+        //Everything at or below -90 (including NaN) keeps a probability of 0.
+        for (uint32_t i = 0; i < batch.count; i += 4)
+        {
+            const __m128 rssi = _mm_load_ps(batch.rssi + i);
+            __m128i probability = _mm_setzero_si128();
+            probability = Select(_mm_cmpgt_ps(rssi, _mm_set1_ps(-90.0f)), probabilityVeryFar, probability);
+            probability = Select(_mm_cmpgt_ps(rssi, _mm_set1_ps(-85.0f)), probabilityFar, probability);
+            probability = Select(_mm_cmpgt_ps(rssi, _mm_set1_ps(-80.0f)), probabilityClose, probability);
+            probability = Select(_mm_cmpgt_ps(rssi, _mm_set1_ps(-60.0f)), probabilityVeryClose, probability);
+            _mm_store_si128(reinterpret_cast<__m128i*>(batch.rssiProbability + i), probability);
+        }
+    }
+
+#endif
+
+    //The fallback uses the exact same expressions as the scalar implementation in CherrySim
+    //so that it yields the same results, even if the compiler uses excess precision (x87).
+    static void ComputeInRangeMaskScalar(const Parameters &parameters, Batch &batch)
+    {
+        batch.inRangeMask = 0;
+        for (uint32_t i = 0; i < batch.count; i++)
+        {
+            if (    std::abs(parameters.senderX - batch.x[i]) * parameters.mapWidthInMeters > parameters.maxReceptionDistancePerAxisInMeters
+                ||  std::abs(parameters.senderY - batch.y[i]) * parameters.mapHeightInMeters > parameters.maxReceptionDistancePerAxisInMeters
+                ||  std::abs(parameters.senderZ - batch.z[i]) * parameters.mapElevationInMeters > parameters.maxReceptionDistancePerAxisInMeters)
+            {
+                continue;
+            }
+            batch.inRangeMask |= 1UL << i;
+        }
+    }
+
+    static void ComputeRssiNoNoiseScalar(const Parameters &parameters, Batch &batch)
+    {
+        for (uint32_t i = 0; i < batch.count; i++)
+        {
+            const float rssiFromDistance = parameters.receivedPowerAtReferenceDistanceDbm - batch.pathLossDb[i];
+            const float ceilingAttenuation = std::abs((parameters.senderFloorNumber - batch.floorNumber[i]) * parameters.ceilingAttenuationDb);
+            batch.rssi[i] = rssiFromDistance - ceilingAttenuation;
+        }
+    }
+
+    static void ComputeRssiProbabilityScalar(const Parameters &parameters, Batch &batch)
+    {
+        for (uint32_t i = 0; i < batch.count; i++)
+        {
+            const float rssi = batch.rssi[i];
+            if      (rssi < -100) batch.rssiProbability[i] = 0;
+            else if (rssi > -60)  batch.rssiProbability[i] = parameters.receptionProbabilityVeryClose;
+            else if (rssi > -80)  batch.rssiProbability[i] = parameters.receptionProbabilityClose;
+            else if (rssi > -85)  batch.rssiProbability[i] = parameters.receptionProbabilityFar;
+            else if (rssi > -90)  batch.rssiProbability[i] = parameters.receptionProbabilityVeryFar;
+            else                  batch.rssiProbability[i] = 0;
+        }
+    }
+
+    bool IsSimdEnabled()
+    {
+#if RECEPTION_KERNEL_SSE2
+        return sse2Supported;
+#else
+        return false;
+#endif
+    }
+
+    void ComputeInRangeMask(const Parameters &parameters, Batch &batch)
+    {
+#if RECEPTION_KERNEL_SSE2
+        if (sse2Supported)
+        {
+            ComputeInRangeMaskSse2(parameters, batch);
+            return;
+        }
+#endif
+        ComputeInRangeMaskScalar(parameters, batch);
+    }
+
+    void ComputeRssiNoNoise(const Parameters &parameters, Batch &batch)
+    {
+#if RECEPTION_KERNEL_SSE2
+        if (sse2Supported)
+        {
+            ComputeRssiNoNoiseSse2(parameters, batch);
+            return;
+        }
+#endif
+        ComputeRssiNoNoiseScalar(parameters, batch);
+    }
+
+    void ComputeRssiProbability(const Parameters &parameters, Batch &batch)
+    {
+#if RECEPTION_KERNEL_SSE2
+        if (sse2Supported)
+        {
+            ComputeRssiProbabilitySse2(parameters, batch);
+            return;
+        }
+#endif
+        ComputeRssiProbabilityScalar(parameters, batch);
+    }
+}
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+//
+// Computes the noise free part of the advertisement reception for a batch of receivers
+// at once. The receivers are stored as a structure of arrays so that the per receiver
+// computations (range check, RSSI, RSSI dependent reception probability) can be done
+// with SIMD instructions. The results are bit identical to the scalar computations in
+// CherrySim (GetReceptionRssi, GetReceptionRssiNoNoise, CalculateReceptionProbabilityFromRssi)
+// which are kept as reference. Everything that draws random numbers (RSSI noise, reception)
+// must stay in the simulator so that the order of random numbers does not change.
+//
+namespace ReceptionKernel
+{
+    constexpr uint32_t BATCH_SIZE = 16;
+
+    /// Everything that is shared by all receivers of one advertisement.
+    struct Parameters
+    {
+        /// Position of the sender, normalized to the map like NodeEntry::x/y/z.
+        float senderX = 0;
+        float senderY = 0;
+        float senderZ = 0;
+        float senderFloorNumber = 0;
+        /// Transmission power plus calibration of the sender.
+        float receivedPowerAtReferenceDistanceDbm = 0;
+
+        float mapWidthInMeters = 0;
+        float mapHeightInMeters = 0;
+        float mapElevationInMeters = 0;
+        float maxReceptionDistancePerAxisInMeters = 0;
+        float ceilingAttenuationDb = 0;
+
+        uint32_t receptionProbabilityVeryClose = 0;
+        uint32_t receptionProbabilityClose = 0;
+        uint32_t receptionProbabilityFar = 0;
+        uint32_t receptionProbabilityVeryFar = 0;
+    };
+
+    /// Structure of arrays view of up to BATCH_SIZE receivers, lanes >= count are ignored.
+    struct Batch
+    {
+        uint32_t count = 0;
+
+        //Inputs
+        alignas(16) float x[BATCH_SIZE] = {};
+        alignas(16) float y[BATCH_SIZE] = {};
+        alignas(16) float z[BATCH_SIZE] = {};
+        alignas(16) float floorNumber[BATCH_SIZE] = {};
+        /// Distance dependent path loss, only required for the lanes in inRangeMask.
+        alignas(16) float pathLossDb[BATCH_SIZE] = {};
+
+        //Outputs
+        /// Bit n is set if receiver n passes the per axis range check.
+        uint32_t inRangeMask = 0;
+        /// RSSI without noise and without clamping.
+        alignas(16) float rssi[BATCH_SIZE] = {};
+        /// Reception probability that corresponds to rssi.
+        alignas(16) uint32_t rssiProbability[BATCH_SIZE] = {};
+    };
+
+    /// Fills inRangeMask, receivers that fail the check can not receive anything.
+    void ComputeInRangeMask(const Parameters &parameters, Batch &batch);
+
+    /// Fills rssi from pathLossDb and the difference in floor numbers.
+    void ComputeRssiNoNoise(const Parameters &parameters, Batch &batch);
+
+    /// Fills rssiProbability from rssi.
+    void ComputeRssiProbability(const Parameters &parameters, Batch &batch);
+
+    /// True if the SIMD implementation is used, which requires a CPU with SSE2. Otherwise the scalar fallback is used.
+    bool IsSimdEnabled();
+}
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "FmTypes.h"
+#include "ScratchArena.h"
+#include "Exceptions.h"
+#include "Utility.h"
+#include <algorithm>
+
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/asan_interface.h>
+#define SCRATCH_ARENA_POISON(address, size) ASAN_POISON_MEMORY_REGION(address, size)
+#define SCRATCH_ARENA_UNPOISON(address, size) ASAN_UNPOISON_MEMORY_REGION(address, size)
+#else
+#define SCRATCH_ARENA_POISON(address, size)
+#define SCRATCH_ARENA_UNPOISON(address, size)
+#endif
+
+uint32_t ScratchArena::GetReservedSize(uint32_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT + GUARD_SIZE;
+}
+
+uint8_t* ScratchArena::Allocate(uint32_t size)
+{
+    const uint32_t reservedSize = GetReservedSize(size);
+    if (reservedSize > CAPACITY - used)
+    {
+        heapFallbacks++;
+        return nullptr;
+    }
+    if (buffer.empty())
+    {
+        buffer.resize(CAPACITY);
+        SCRATCH_ARENA_POISON(buffer.data(), CAPACITY);
+    }
+
+    uint8_t* data = buffer.data() + used;
+    used += reservedSize;
+    usedByArrays += size;
+    peakUsage = std::max(peakUsage, usedByArrays);
+
+    //Everything behind the array up to the next allocation is guarded
+    SCRATCH_ARENA_UNPOISON(data, reservedSize);
+    CheckedMemset(data, 0, size);
+    CheckedMemset(data + size, GUARD_PATTERN, reservedSize - size);
+    SCRATCH_ARENA_POISON(data + size, reservedSize - size);
+
+    return data;
+}
+
+void ScratchArena::Release(uint8_t* data, uint32_t size, uint32_t allocationGeneration)
+{
+    if (allocationGeneration != generation) return;
+
+    const uint32_t reservedSize = GetReservedSize(size);
+    if (reservedSize > used || data != buffer.data() + used - reservedSize)
+    {
+        //Arrays are bound to their scope and must therefore be released in reverse order
+        unorderedReleases++;
+        return;
+    }
+    used -= reservedSize;
+    usedByArrays -= size;
+
+    SCRATCH_ARENA_UNPOISON(data + size, reservedSize - size);
+    const bool guardIntact = std::all_of(data + size, data + reservedSize, [](uint8_t value) { return value == GUARD_PATTERN; });
+    SCRATCH_ARENA_POISON(data, reservedSize);
+
+    if (!guardIntact)
+    {
+        //Something was written behind the end of a DYNAMIC_ARRAY
+        corruptedArrays++;
+    }
+}
+
+void ScratchArena::CheckReleaseErrors()
+{
+    if (corruptedArrays != 0)
+    {
+        corruptedArrays = 0;
+        SIMEXCEPTION(MemoryCorruptionException);
+    }
+    if (unorderedReleases != 0)
+    {
+        unorderedReleases = 0;
+        SIMEXCEPTION(IllegalStateException);
+    }
+}
+
+void ScratchArena::Reset()
+{
+    used = 0;
+    usedByArrays = 0;
+    generation++;
+    if (!buffer.empty())
+    {
+        SCRATCH_ARENA_POISON(buffer.data(), CAPACITY);
+    }
+}
+
+uint32_t ScratchArena::GetGeneration() const
+{
+    return generation;
+}
+
+uint32_t ScratchArena::GetUsage() const
+{
+    return usedByArrays;
+}
+
+uint32_t ScratchArena::GetPeakUsage() const
+{
+    return peakUsage;
+}
+
+uint32_t ScratchArena::GetHeapFallbacks() const
+{
+    return heapFallbacks;
+}
+
+void ScratchArena::ResetPeakUsage()
+{
+    peakUsage = usedByArrays;
+}
+
+template<typename T>
+ScratchArray<T>::ScratchArray(size_t count)
+    : arena(simScratchArenaPtr), memory(nullptr), sizeInBytes((uint32_t)(count * sizeof(T))), arenaGeneration(0)
+{
+    if (arena != nullptr)
+    {
+        memory = reinterpret_cast<T*>(arena->Allocate(sizeInBytes));
+        arenaGeneration = arena->GetGeneration();
+    }
+    if (memory == nullptr)
+    {
+        arena = nullptr;
+        memory = new T[count == 0 ? 1 : count]();
+    }
+}
+
+template<typename T>
+ScratchArray<T>::~ScratchArray()
+{
+    if (arena != nullptr)
+    {
+        arena->Release(reinterpret_cast<uint8_t*>(memory), sizeInBytes, arenaGeneration);
+    }
+    else
+    {
+        delete[] memory;
+    }
+}
+
+template class ScratchArray<uint8_t>;
+template class ScratchArray<float>;
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// A per node bump allocator with stack discipline that backs DYNAMIC_ARRAY in the simulator.
+// On the real hardware, DYNAMIC_ARRAY is placed on the stack. Allocating it from the heap in
+// the simulator is very expensive on hot paths such as filling the transmit buffers, so each
+// node gets a fixed region from which the arrays are taken and returned in reverse order once
+// their scope is left. Every allocation is followed by guard bytes that are checked on release
+// (and poisoned for the AddressSanitizer if active) so that overflows are still detected.
+// As arrays are released in destructors, errors are only recorded and thrown by CheckReleaseErrors
+// once the simulation step of the node is done. A reset of the node releases all arrays at once.
+// The peak usage of a node shows how much of its stack budget is used by dynamic arrays.
+//
+class ScratchArena
+{
+public:
+    static constexpr uint32_t CAPACITY = 16 * 1024;
+    static constexpr uint32_t ALIGNMENT = 8;
+    static constexpr uint32_t GUARD_SIZE = 8;
+    static constexpr uint8_t GUARD_PATTERN = 0xFD;
+
+private:
+    std::vector<uint8_t> buffer;
+    uint32_t used = 0; //Including alignment and guard bytes
+    uint32_t usedByArrays = 0;
+    uint32_t peakUsage = 0;
+    uint32_t heapFallbacks = 0;
+    uint32_t generation = 0;
+    uint32_t corruptedArrays = 0;
+    uint32_t unorderedReleases = 0;
+
+    static uint32_t GetReservedSize(uint32_t size);
+
+public:
+    /// Returns zero initialized memory for an array of the given size or nullptr if the
+    /// arena is exhausted, in which case the caller has to fall back to the heap.
+    uint8_t* Allocate(uint32_t size);
+
+    /// Returns the most recent allocation, never throws. Arrays of a previous generation were
+    /// already released by Reset. If the guard bytes were overwritten or the array is not the
+    /// most recent allocation, the error is recorded for CheckReleaseErrors. The memory of an
+    /// array that is released out of order stays in use until the next Reset.
+    void Release(uint8_t* data, uint32_t size, uint32_t allocationGeneration);
+
+    /// Throws a MemoryCorruptionException or an IllegalStateException if Release found an error since the last check.
+    void CheckReleaseErrors();
+
+    /// Releases all arrays, e.g. once the node is reset and the stack it ran on is gone.
+    void Reset();
+    /// Incremented by every Reset.
+    uint32_t GetGeneration() const;
+
+    /// Bytes currently used by dynamic arrays, without alignment and guard bytes.
+    uint32_t GetUsage() const;
+    /// Largest value of GetUsage() since the last reset of the peak.
+    uint32_t GetPeakUsage() const;
+    /// Amount of dynamic arrays that did not fit into the arena and were taken from the heap.
+    uint32_t GetHeapFallbacks() const;
+    void ResetPeakUsage();
+};
+
+//Owns a DYNAMIC_ARRAY for the duration of its scope. The memory is taken from the arena
+//of the current node or from the heap if there is no current node or its arena is full.
+template<typename T>
+class ScratchArray
+{
+private:
+    ScratchArena* arena;
+    T* memory;
+    uint32_t sizeInBytes;
+    uint32_t arenaGeneration;
+
+public:
+    explicit ScratchArray(size_t count);
+    ~ScratchArray();
+
+    ScratchArray(const ScratchArray&) = delete;
+    ScratchArray& operator=(const ScratchArray&) = delete;
+
+    T* data()
+    {
+        return memory;
+    }
+};
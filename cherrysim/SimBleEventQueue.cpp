@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SimBleEventQueue.h"
+#include "CherrySimTypes.h"
+#include "Exceptions.h"
+#include <algorithm>
+
+SimBleEventPool& SimBleEventPool::GetInstance()
+{
+    static SimBleEventPool instance;
+    return instance;
+}
+
+uint8_t* SimBleEventPool::AcquireChunk()
+{
+    if (freeChunks.empty())
+    {
+        chunks.emplace_back(new uint8_t[CHUNK_SIZE]);
+        return chunks.back().get();
+    }
+    uint8_t* chunk = freeChunks.back();
+    freeChunks.pop_back();
+    return chunk;
+}
+
+void SimBleEventPool::ReleaseChunk(uint8_t* chunk)
+{
+    freeChunks.push_back(chunk);
+}
+
+uint32_t SimBleEventPool::GetAmountOfChunks() const
+{
+    return (uint32_t)chunks.size();
+}
+
+uint32_t SimBleEventPool::GetAmountOfFreeChunks() const
+{
+    return (uint32_t)freeChunks.size();
+}
+
+SimBleEventQueue::~SimBleEventQueue()
+{
+    Clear();
+}
+
+uint32_t SimBleEventQueue::GetPayloadSize(const ble_evt_t& event)
+{
+    const uint8_t* start = reinterpret_cast<const uint8_t*>(&event);
+    uint32_t size = sizeof(ble_evt_t);
+
+    //Events with data of variable length use the overflow area behind the ble_evt_t
+    if (event.header.evt_id == BLE_GATTS_EVT_WRITE)
+    {
+        size = (uint32_t)(event.evt.gatts_evt.params.write.data - start) + event.evt.gatts_evt.params.write.len;
+    }
+    else if (event.header.evt_id == BLE_GATTC_EVT_HVX)
+    {
+        size = (uint32_t)(event.evt.gattc_evt.params.hvx.data - start) + event.evt.gattc_evt.params.hvx.len;
+    }
+
+    constexpr uint32_t maxSize = sizeof(simBleEvent::bleEvent) + sizeof(simBleEvent::bleEventOverflowData);
+    return std::min(std::max<uint32_t>(size, sizeof(ble_evt_t)), maxSize);
+}
+
+const SimBleEventRecord* SimBleEventQueue::RecordAt(uint8_t* chunk, uint32_t offset) const
+{
+    return reinterpret_cast<const SimBleEventRecord*>(chunk + offset);
+}
+
+void SimBleEventQueue::Push(const simBleEvent& event)
+{
+    const uint32_t payloadSize = GetPayloadSize(event.bleEvent);
+    const uint32_t recordSize = (sizeof(SimBleEventRecord) + payloadSize + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+    static_assert(sizeof(simBleEvent) + sizeof(SimBleEventRecord) + RECORD_ALIGNMENT <= SimBleEventPool::CHUNK_SIZE, "Every event must fit into a chunk");
+
+    if (chunks.empty() || writeOffset + recordSize > SimBleEventPool::CHUNK_SIZE)
+    {
+        //Mark the rest of the current chunk as unused so that readers skip to the next one
+        if (!chunks.empty() && writeOffset + sizeof(SimBleEventRecord) <= SimBleEventPool::CHUNK_SIZE)
+        {
+            reinterpret_cast<SimBleEventRecord*>(chunks.back() + writeOffset)->recordSize = 0;
+        }
+        chunks.push_back(SimBleEventPool::GetInstance().AcquireChunk());
+        writeOffset = 0;
+    }
+
+    SimBleEventRecord* record = reinterpret_cast<SimBleEventRecord*>(chunks.back() + writeOffset);
+    record->recordSize = recordSize;
+    record->payloadSize = payloadSize;
+    record->globalId = event.globalId;
+    record->additionalInfo = event.additionalInfo;
+    CheckedMemcpy(record + 1, &event.bleEvent, payloadSize);
+
+    writeOffset += recordSize;
+    amountOfEvents++;
+}
+
+const SimBleEventRecord& SimBleEventQueue::Front() const
+{
+    if (amountOfEvents == 0)
+    {
+        SIMEXCEPTIONFORCE(IllegalStateException);
+    }
+    return *RecordAt(chunks.front(), readOffset);
+}
+
+void SimBleEventQueue::PopFront()
+{
+    if (amountOfEvents == 0)
+    {
+        SIMEXCEPTIONFORCE(IllegalStateException);
+    }
+
+    readOffset += Front().recordSize;
+    amountOfEvents--;
+
+    if (amountOfEvents == 0)
+    {
+        //Keep the last chunk so that a node that receives events regularly does not need the pool
+        while (chunks.size() > 1) ReleaseFrontChunk();
+        readOffset = 0;
+        writeOffset = 0;
+    }
+    else if (chunks.size() > 1
+        && (readOffset + sizeof(SimBleEventRecord) > SimBleEventPool::CHUNK_SIZE || RecordAt(chunks.front(), readOffset)->recordSize == 0))
+    {
+        ReleaseFrontChunk();
+        readOffset = 0;
+    }
+}
+
+void SimBleEventQueue::ReleaseFrontChunk()
+{
+    SimBleEventPool::GetInstance().ReleaseChunk(chunks.front());
+    chunks.pop_front();
+}
+
+bool SimBleEventQueue::IsEmpty() const
+{
+    return amountOfEvents == 0;
+}
+
+uint32_t SimBleEventQueue::GetSize() const
+{
+    return amountOfEvents;
+}
+
+void SimBleEventQueue::Clear()
+{
+    while (!chunks.empty()) ReleaseFrontChunk();
+    readOffset = 0;
+    writeOffset = 0;
+    amountOfEvents = 0;
+}
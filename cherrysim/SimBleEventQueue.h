@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <ble.h>
+
+struct simBleEvent;
+
+//
+// Fixed size chunks of memory for the event queues of all nodes. Queues take chunks when
+// they grow and give them back once all events in a chunk were pulled, so that the memory
+// is reused between nodes and no allocation is necessary once the pool has warmed up.
+//
+class SimBleEventPool
+{
+public:
+    static constexpr uint32_t CHUNK_SIZE = 8 * 1024;
+
+private:
+    std::vector<std::unique_ptr<uint8_t[]>> chunks;
+    std::vector<uint8_t*> freeChunks;
+
+public:
+    static SimBleEventPool& GetInstance();
+
+    uint8_t* AcquireChunk();
+    void ReleaseChunk(uint8_t* chunk);
+
+    uint32_t GetAmountOfChunks() const;
+    uint32_t GetAmountOfFreeChunks() const;
+};
+
+//Header of an event in a SimBleEventQueue, the ble_evt_t and its used overflow data follow directly
+struct SimBleEventRecord
+{
+    uint32_t recordSize; //Including this header and padding, 0 marks the end of the used part of a chunk
+    uint32_t payloadSize; //Size of the ble_evt_t including the part of the overflow data that is used by the event
+    uint32_t globalId;
+    uint32_t additionalInfo;
+
+    const ble_evt_t* GetEvent() const
+    {
+        return reinterpret_cast<const ble_evt_t*>(this + 1);
+    }
+};
+
+//
+// The queue of BLE events of a node that were generated by the simulator but not yet pulled
+// by the node with sd_ble_evt_get. Events are stored back to back with only as much of the
+// overflow data as they use (e.g. the length of a write), instead of the full simBleEvent.
+//
+class SimBleEventQueue
+{
+public:
+    static constexpr uint32_t RECORD_ALIGNMENT = 8;
+
+private:
+    std::deque<uint8_t*> chunks;
+    uint32_t readOffset = 0; //In the first chunk
+    uint32_t writeOffset = 0; //In the last chunk
+    uint32_t amountOfEvents = 0;
+
+    const SimBleEventRecord* RecordAt(uint8_t* chunk, uint32_t offset) const;
+    void ReleaseFrontChunk();
+
+public:
+    SimBleEventQueue() = default;
+    ~SimBleEventQueue();
+    SimBleEventQueue(const SimBleEventQueue&) = delete;
+    SimBleEventQueue& operator=(const SimBleEventQueue&) = delete;
+
+    /// Returns how many bytes of the event, starting at its ble_evt_t, are meaningful.
+    static uint32_t GetPayloadSize(const ble_evt_t& event);
+
+    void Push(const simBleEvent& event);
+
+    /// The oldest event, the queue must not be empty.
+    const SimBleEventRecord& Front() const;
+    void PopFront();
+
+    bool IsEmpty() const;
+    uint32_t GetSize() const;
+    void Clear();
+
+    /// Calls function for each queued event from the oldest to the newest one.
+    template<typename Function>
+    void ForEach(Function function) const
+    {
+        uint32_t offset = readOffset;
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            const uint32_t end = i + 1 == chunks.size() ? writeOffset : SimBleEventPool::CHUNK_SIZE;
+            while (offset + sizeof(SimBleEventRecord) <= end)
+            {
+                const SimBleEventRecord* record = RecordAt(chunks[i], offset);
+                if (record->recordSize == 0) break;
+                function(*record);
+                offset += record->recordSize;
+            }
+            offset = 0;
+        }
+    }
+};
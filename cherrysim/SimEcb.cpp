@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SimEcb.h"
+#include "Exceptions.h"
+#include <cstring>
+
+extern "C" {
+#include <aes.h>
+}
+
+static_assert(SimEcb::ROUND_KEYS_SIZE == AES_ROUND_KEY_SIZE, "SimEcb only supports AES128");
+
+//AES-NI is only available on x86 hosts, Emscripten builds always use the software implementation
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && !defined(__EMSCRIPTEN__)
+#define SIM_ECB_AES_NI 1
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SIM_ECB_TARGET_AES
+#else
+#include <cpuid.h>
+//Only the functions using the intrinsics are compiled for AES-NI, the rest of the simulator runs on any x86 CPU
+#define SIM_ECB_TARGET_AES __attribute__((target("aes,sse2")))
+#endif
+#else
+#define SIM_ECB_AES_NI 0
+#endif
+
+#if SIM_ECB_AES_NI
+static bool DetectAesNi()
+{
+    //CPUID leaf 1 reports AES-NI in bit 25 of ECX
+#ifdef _MSC_VER
+    int registers[4] = {};
+    __cpuid(registers, 1);
+    return (registers[2] & (1 << 25)) != 0;
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) return false;
+    return (ecx & bit_AES) != 0;
+#endif
+}
+
+SIM_ECB_TARGET_AES
+static void EncryptBlockAesNi(const uint8_t* roundKeys, const uint8_t* cleartext, uint8_t* ciphertext)
+{
+    const __m128i* keys = (const __m128i*)roundKeys;
+    __m128i block = _mm_loadu_si128((const __m128i*)cleartext);
+    block = _mm_xor_si128(block, _mm_loadu_si128(keys));
+    for (uint32_t round = 1; round < 10; round++)
+    {
+        block = _mm_aesenc_si128(block, _mm_loadu_si128(keys + round));
+    }
+    block = _mm_aesenclast_si128(block, _mm_loadu_si128(keys + 10));
+    _mm_storeu_si128((__m128i*)ciphertext, block);
+}
+#endif
+
+SimEcb::SimEcb()
+    : backend(GetDefaultBackend())
+{
+}
+
+const SimEcb::KeySchedule& SimEcb::GetKeySchedule(const uint8_t* key)
+{
+    useCounter++;
+    KeySchedule* leastRecentlyUsed = &schedules[0];
+    for (KeySchedule& schedule : schedules)
+    {
+        if (schedule.lastUse != 0 && memcmp(schedule.key, key, BLOCK_SIZE) == 0)
+        {
+            cacheHits++;
+            schedule.lastUse = useCounter;
+            return schedule;
+        }
+        if (schedule.lastUse < leastRecentlyUsed->lastUse) leastRecentlyUsed = &schedule;
+    }
+
+    cacheMisses++;
+    memcpy(leastRecentlyUsed->key, key, BLOCK_SIZE);
+    AES_ECB_expand_key(key, leastRecentlyUsed->roundKeys);
+    leastRecentlyUsed->lastUse = useCounter;
+    return *leastRecentlyUsed;
+}
+
+void SimEcb::EncryptBlock(const uint8_t* key, const uint8_t* cleartext, uint8_t* ciphertext)
+{
+    const KeySchedule& schedule = GetKeySchedule(key);
+#if SIM_ECB_AES_NI
+    if (backend == Backend::AES_NI)
+    {
+        EncryptBlockAesNi(schedule.roundKeys, cleartext, ciphertext);
+        return;
+    }
+#endif
+    AES_ECB_encrypt_expanded(cleartext, schedule.roundKeys, ciphertext);
+}
+
+void SimEcb::SetBackend(Backend backend)
+{
+    if (backend == Backend::AES_NI && !IsAesNiSupported())
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return;
+    }
+    this->backend = backend;
+}
+
+SimEcb::Backend SimEcb::GetBackend() const
+{
+    return backend;
+}
+
+uint32_t SimEcb::GetCacheHits() const
+{
+    return cacheHits;
+}
+
+uint32_t SimEcb::GetCacheMisses() const
+{
+    return cacheMisses;
+}
+
+bool SimEcb::IsAesNiSupported()
+{
+#if SIM_ECB_AES_NI
+    static const bool supported = DetectAesNi();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+SimEcb::Backend SimEcb::GetDefaultBackend()
+{
+    return IsAesNiSupported() ? Backend::AES_NI : Backend::SOFTWARE;
+}
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <cstdint>
+
+//
+// Simulates the ECB peripheral of a node that is used through sd_ecb_block_encrypt. The firmware
+// encrypts a lot of blocks with the same few keys (e.g. the session keys of MeshAccessConnections),
+// so the expanded key schedules of the most recently used keys are kept per node instead of expanding
+// the key again for every block. The blocks are encrypted with AES-NI if the host CPU supports it
+// and with the tiny-AES software implementation otherwise. Both produce identical results as the
+// round keys of AES-NI have the same layout as the ones of the software implementation.
+//
+class SimEcb
+{
+public:
+    static constexpr uint32_t BLOCK_SIZE = 16;
+    static constexpr uint32_t ROUND_KEYS_SIZE = 176;
+    static constexpr uint32_t CACHED_SCHEDULES = 4;
+
+    enum class Backend : uint8_t
+    {
+        SOFTWARE = 0,
+        AES_NI = 1,
+    };
+
+private:
+    struct KeySchedule
+    {
+        uint8_t roundKeys[ROUND_KEYS_SIZE];
+        uint8_t key[BLOCK_SIZE];
+        uint32_t lastUse = 0; //0 if the entry is unused
+    };
+
+    KeySchedule schedules[CACHED_SCHEDULES] = {};
+    uint32_t useCounter = 0;
+    uint32_t cacheHits = 0;
+    uint32_t cacheMisses = 0;
+    Backend backend;
+
+    const KeySchedule& GetKeySchedule(const uint8_t* key);
+
+public:
+    SimEcb();
+
+    void EncryptBlock(const uint8_t* key, const uint8_t* cleartext, uint8_t* ciphertext);
+
+    /// Throws an IllegalArgumentException if the backend is not supported by the host.
+    void SetBackend(Backend backend);
+    Backend GetBackend() const;
+
+    uint32_t GetCacheHits() const;
+    uint32_t GetCacheMisses() const;
+
+    static bool IsAesNiSupported();
+    /// AES-NI if supported by the host, the software implementation otherwise.
+    static Backend GetDefaultBackend();
+};
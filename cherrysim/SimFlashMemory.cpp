@@ -0,0 +1,287 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "FmTypes.h"
+#include "SimFlashMemory.h"
+#include "FlashFileFormat.h"
+#include "Exceptions.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define SIM_FLASH_MAPPING_WINDOWS
+#elif !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SIM_FLASH_MAPPING_POSIX
+#endif
+
+SimFlashImage::SimFlashImage(const uint8_t* content, uint32_t size)
+    : size(size)
+{
+    //The content is written through a temporary view, afterwards the image is only mapped read only
+#if defined(SIM_FLASH_MAPPING_WINDOWS)
+    HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size, nullptr);
+    if (handle != nullptr)
+    {
+        void* view = MapViewOfFile(handle, FILE_MAP_WRITE, 0, 0, size);
+        if (view != nullptr)
+        {
+            memcpy(view, content, size);
+            UnmapViewOfFile(view);
+            data = (const uint8_t*)MapViewOfFile(handle, FILE_MAP_READ, 0, 0, size);
+        }
+        if (data == nullptr) CloseHandle(handle);
+        else mappingHandle = handle;
+    }
+#elif defined(SIM_FLASH_MAPPING_POSIX)
+#if defined(__linux__) && defined(MFD_CLOEXEC) && defined(MFD_ALLOW_SEALING)
+    fileDescriptor = memfd_create("CherrySimFlashImage", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    FILE* file = tmpfile();
+    if (file != nullptr) fileDescriptor = dup(fileno(file));
+    if (file != nullptr) fclose(file);
+#endif
+    if (fileDescriptor >= 0 && ftruncate(fileDescriptor, size) == 0)
+    {
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+        if (view != MAP_FAILED)
+        {
+            memcpy(view, content, size);
+            munmap(view, size);
+#if defined(F_ADD_SEALS) && defined(F_SEAL_WRITE)
+            //Nobody can change the image anymore, private copies of it are still allowed
+            fcntl(fileDescriptor, F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_SEAL);
+#endif
+            view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+            if (view != MAP_FAILED) data = (const uint8_t*)view;
+        }
+    }
+    if (data == nullptr && fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+#endif
+    isMapped = data != nullptr;
+
+    //If the OS did not give us a mapping, the image is kept as a plain copy
+    if (data == nullptr)
+    {
+        uint8_t* copy = new uint8_t[size];
+        memcpy(copy, content, size);
+        data = copy;
+    }
+}
+
+SimFlashImage::~SimFlashImage()
+{
+    if (!isMapped)
+    {
+        delete[] data;
+    }
+#if defined(SIM_FLASH_MAPPING_WINDOWS)
+    else
+    {
+        UnmapViewOfFile(data);
+        CloseHandle(mappingHandle);
+    }
+#elif defined(SIM_FLASH_MAPPING_POSIX)
+    else
+    {
+        munmap((void*)data, size);
+        close(fileDescriptor);
+    }
+#endif
+    data = nullptr;
+}
+
+uint8_t* SimFlashImage::MapPrivateCopy() const
+{
+    if (!isMapped) return nullptr;
+#if defined(SIM_FLASH_MAPPING_WINDOWS)
+    return (uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_COPY, 0, 0, size);
+#elif defined(SIM_FLASH_MAPPING_POSIX)
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+    return view == MAP_FAILED ? nullptr : (uint8_t*)view;
+#else
+    return nullptr;
+#endif
+}
+
+const SimFlashImage& SimFlashImage::GetErased()
+{
+    //Created once and lives until the process exits, the temporary content is only needed while creating it
+    static const SimFlashImage image(std::vector<uint8_t>(SIM_MAX_FLASH_SIZE, 0xFF).data(), SIM_MAX_FLASH_SIZE);
+    return image;
+}
+
+//The granularity in which the OS copies the pages of the mappings
+uint32_t SimFlashMemory::GetOsPageSize()
+{
+#if defined(SIM_FLASH_MAPPING_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#elif defined(SIM_FLASH_MAPPING_POSIX)
+    return (uint32_t)sysconf(_SC_PAGESIZE);
+#else
+    return 4096;
+#endif
+}
+
+SimFlashMemory::SimFlashMemory(const SimFlashImage& image)
+{
+    Attach(image);
+}
+
+SimFlashMemory::~SimFlashMemory()
+{
+    Detach();
+}
+
+void SimFlashMemory::Attach(const SimFlashImage& newImage)
+{
+    image = &newImage;
+    size = newImage.GetSize();
+    data = newImage.MapPrivateCopy();
+    isMapped = data != nullptr;
+
+    //If the OS did not give us a mapping, the flash is allocated as a whole
+    if (data == nullptr)
+    {
+        data = new uint8_t[size];
+        memcpy(data, newImage.GetData(), size);
+    }
+}
+
+void SimFlashMemory::Detach()
+{
+    if (!isMapped)
+    {
+        delete[] data;
+    }
+#if defined(SIM_FLASH_MAPPING_WINDOWS)
+    else
+    {
+        UnmapViewOfFile(data);
+    }
+#elif defined(SIM_FLASH_MAPPING_POSIX)
+    else
+    {
+        munmap(data, size);
+    }
+#endif
+    data = nullptr;
+    image = nullptr;
+}
+
+void SimFlashMemory::Map(const SimFlashImage& newImage)
+{
+    Detach();
+    Attach(newImage);
+}
+
+void SimFlashMemory::RestorePage(uint32_t offset, uint32_t length)
+{
+#if defined(__linux__) && defined(SIM_FLASH_MAPPING_POSIX)
+    //Discarding a private copy makes the page fall back to the image
+    if (isMapped && madvise(data + offset, length, MADV_DONTNEED) == 0) return;
+#endif
+    //Reading does not create a private copy, so a page that already matches the image stays shared
+    if (memcmp(data + offset, image->GetData() + offset, length) == 0) return;
+    memcpy(data + offset, image->GetData() + offset, length);
+}
+
+void SimFlashMemory::Erase(uint32_t offset, uint32_t length)
+{
+    if (offset > size || length > size - offset) SIMEXCEPTION(IndexOutOfBoundsException);
+
+    const uint32_t osPageSize = GetOsPageSize();
+    const uint32_t end = offset + length;
+    uint32_t position = offset;
+    while (position < end)
+    {
+        const uint32_t pageStart = position / osPageSize * osPageSize;
+        const uint32_t pageEnd = std::min(pageStart + osPageSize, end);
+        if (position == pageStart && pageEnd - pageStart == osPageSize && FlashFileFormat::IsErased(image->GetData() + pageStart, osPageSize))
+        {
+            RestorePage(pageStart, osPageSize);
+        }
+        else
+        {
+            for (uint32_t i = position; i < pageEnd; i++)
+            {
+                if (data[i] != 0xFF) data[i] = 0xFF;
+            }
+        }
+        position = pageEnd;
+    }
+}
+
+void SimFlashMemory::Write(uint32_t offset, const uint8_t* source, uint32_t length)
+{
+    if (offset > size || length > size - offset) SIMEXCEPTION(IndexOutOfBoundsException);
+
+    //The source might be part of the flash itself, but as bits can only be cleared, overlaps do not matter
+    for (uint32_t i = 0; i < length; i++)
+    {
+        const uint8_t value = data[offset + i] & source[i];
+        if (value != data[offset + i]) data[offset + i] = value;
+    }
+}
+
+void SimFlashMemory::Program(uint32_t offset, const uint8_t* source, uint32_t length)
+{
+    if (offset > size || length > size - offset) SIMEXCEPTION(IndexOutOfBoundsException);
+
+    const uint32_t osPageSize = GetOsPageSize();
+    const uint32_t end = offset + length;
+    uint32_t position = offset;
+    while (position < end)
+    {
+        const uint32_t pageStart = position / osPageSize * osPageSize;
+        const uint32_t pageEnd = std::min(pageStart + osPageSize, end);
+        const uint8_t* pageSource = source + (position - offset);
+        if (position == pageStart && pageEnd - pageStart == osPageSize && memcmp(pageSource, image->GetData() + pageStart, osPageSize) == 0)
+        {
+            RestorePage(pageStart, osPageSize);
+        }
+        else if (memcmp(data + position, pageSource, pageEnd - position) != 0)
+        {
+            memmove(data + position, pageSource, pageEnd - position);
+        }
+        position = pageEnd;
+    }
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+//
+// A read only flash content that any number of SimFlashMemory instances can map copy on write. The
+// content is given once when the image is created and is then shared by all flashes that map it, e.g.
+// the erased flash or the MBR and bootloader that every node of a chipset starts with. Images are
+// expected to outlive all flashes that map them.
+//
+class SimFlashImage
+{
+private:
+    const uint8_t* data = nullptr;
+    uint32_t size = 0;
+    bool isMapped = false;
+    void* mappingHandle = nullptr; //Windows only
+    int fileDescriptor = -1;       //POSIX only
+
+public:
+    SimFlashImage(const uint8_t* content, uint32_t size);
+    ~SimFlashImage();
+
+    SimFlashImage(const SimFlashImage&) = delete;
+    SimFlashImage& operator=(const SimFlashImage&) = delete;
+
+    const uint8_t* GetData() const
+    {
+        return data;
+    }
+    uint32_t GetSize() const
+    {
+        return size;
+    }
+
+    /// Maps a private copy on write view of the image, returns nullptr if the OS does not support it.
+    uint8_t* MapPrivateCopy() const;
+
+    /// The erased image of SIM_MAX_FLASH_SIZE that new flashes start with.
+    static const SimFlashImage& GetErased();
+};
+
+//
+// Backs the simulated flash of a node. All nodes map the same read only SimFlashImage and a page is only
+// copied (and committed by the OS) once it is written to, so the memory of a node scales with the data
+// that differs from the image instead of the full flash size. The firmware accesses the flash through
+// plain pointers, which is why copy on write mappings of the OS are used. Writes done by the simulator
+// should go through Erase, Write and Program, which do not touch bytes that would not change and give
+// pages back to the image once they match it again, so that the pages stay shared as long as possible.
+// Platforms without such mappings (e.g. Emscripten) fall back to a private allocation of the whole flash.
+//
+class SimFlashMemory
+{
+private:
+    const SimFlashImage* image = nullptr;
+    uint8_t* data = nullptr;
+    uint32_t size = 0;
+    bool isMapped = false;
+
+    void Attach(const SimFlashImage& newImage);
+    void Detach();
+    //Brings a whole OS page back to the content of the image
+    void RestorePage(uint32_t offset, uint32_t length);
+
+public:
+    explicit SimFlashMemory(const SimFlashImage& image = SimFlashImage::GetErased());
+    ~SimFlashMemory();
+
+    SimFlashMemory(const SimFlashMemory&) = delete;
+    SimFlashMemory& operator=(const SimFlashMemory&) = delete;
+
+    uint8_t* GetData()
+    {
+        return data;
+    }
+    const uint8_t* GetData() const
+    {
+        return data;
+    }
+    uint32_t GetSize() const
+    {
+        return size;
+    }
+    uint8_t& operator[](uint32_t offset)
+    {
+        return data[offset];
+    }
+
+    /// The granularity in which the OS copies the pages of the mappings.
+    static uint32_t GetOsPageSize();
+
+    /// Discards the whole content and maps the given image instead. Pointers into the flash become invalid.
+    void Map(const SimFlashImage& newImage);
+    /// Sets the range to 0xFF. Pages that are completely covered give up their private copy if the image is erased there.
+    void Erase(uint32_t offset, uint32_t length);
+    /// Simulates a flash write, which can only change bits from 1 to 0.
+    void Write(uint32_t offset, const uint8_t* source, uint32_t length);
+    /// Overwrites the range with the source like a programmer would, e.g. to prepare the flash or restore it from a file.
+    void Program(uint32_t offset, const uint8_t* source, uint32_t length);
+};
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SimSnapshot.h"
+
+namespace SimSnapshot
+{
+    Snapshot::Snapshot(uint32_t version, uint32_t flashSize)
+        : flash(version, flashSize)
+    {
+    }
+
+    std::vector<uint8_t> Serialize(const Snapshot& snapshot)
+    {
+        std::vector<uint8_t> out = FlashFileFormat::Serialize(snapshot.flash);
+        out.insert(out.end(), snapshot.state.begin(), snapshot.state.end());
+        return out;
+    }
+
+    Writer::Writer(std::vector<uint8_t>& out)
+        : out(out)
+    {
+    }
+
+    void Writer::Write(const void* data, uint32_t length)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + length);
+    }
+
+    Reader::Reader(const uint8_t* data, const uint8_t* end)
+        : data(data), end(end)
+    {
+    }
+
+    bool Reader::Read(void* out, uint32_t length)
+    {
+        const uint8_t* source = Skip(length);
+        if (source == nullptr) return false;
+        memcpy(out, source, length);
+        return true;
+    }
+
+    const uint8_t* Reader::Skip(uint32_t length)
+    {
+        if (static_cast<size_t>(end - data) < length)
+        {
+            data = end;
+            return nullptr;
+        }
+        const uint8_t* position = data;
+        data += length;
+        return position;
+    }
+
+    const uint8_t* Reader::GetPosition() const
+    {
+        return data;
+    }
+
+    bool Reader::IsAtEnd() const
+    {
+        return data == end;
+    }
+}
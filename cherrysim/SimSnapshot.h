@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "FlashFileFormat.h"
+
+//
+// A snapshot of a complete simulation (see CherrySim::CaptureSnapshot). It starts with the flash of all nodes
+// in the FlashFileFormat, so that the flash of a fresh simulation can be loaded from it, and continues with a
+// state section that holds the SimulatorState, including its MersenneTwister, and the RAM of all nodes.
+// The RAM contains pointers, so the state section can only be restored into the CherrySim that captured it,
+// which is checked with the address of its nodes and the size of its structures. Restoring it into another
+// CherrySim or process fails with a CorruptOrOutdatedSavefile. This allows to e.g. cluster a mesh once and to
+// fork many experiments from it in the same process. The periodic backups of the flash file do not contain a
+// state section.
+//
+// Layout of the state section:
+//     StateHeader
+//     SimulatorState
+//     For each node:   u32 length, length bytes of node state starting with a NodeStateHeader
+//
+namespace SimSnapshot
+{
+    constexpr uint32_t STATE_MAGIC = 0x54535343; // "CSST"
+
+    struct StateHeader
+    {
+        uint32_t magic;
+        uint32_t sizeOfHeader;
+        uint32_t amountOfNodes;
+        uint32_t sizeOfSimulatorState;
+        uint32_t sizeOfGlobalState;
+        uint32_t sizeOfNodeEntry;
+        uint64_t nodesAddress;
+    };
+
+    /// The module and hal memory of a node are restored in place, so their addresses must not have changed.
+    struct NodeStateHeader
+    {
+        uint64_t moduleMemoryBlockAddress;
+        uint64_t halMemoryAddress;
+        uint32_t moduleMemoryBlockSize;
+        uint32_t halMemorySize;
+    };
+
+    /// The flash pages are encoded once the snapshot is serialized, the state section is already serialized.
+    struct Snapshot
+    {
+        FlashFileFormat::SparseFlash flash;
+        std::vector<uint8_t> state;
+
+        Snapshot(uint32_t version, uint32_t flashSize);
+    };
+
+    std::vector<uint8_t> Serialize(const Snapshot& snapshot);
+
+    /// Appends raw values to the state section.
+    class Writer
+    {
+    private:
+        std::vector<uint8_t>& out;
+
+    public:
+        explicit Writer(std::vector<uint8_t>& out);
+
+        void Write(const void* data, uint32_t length);
+
+        template<typename T>
+        void WriteValue(const T& value)
+        {
+            Write(&value, sizeof(value));
+        }
+    };
+
+    /// Reads raw values from the state section, all reads fail once the end was reached.
+    class Reader
+    {
+    private:
+        const uint8_t* data;
+        const uint8_t* end;
+
+    public:
+        Reader(const uint8_t* data, const uint8_t* end);
+
+        bool Read(void* out, uint32_t length);
+        /// Returns nullptr if less than length bytes are left.
+        const uint8_t* Skip(uint32_t length);
+        const uint8_t* GetPosition() const;
+        bool IsAtEnd() const;
+
+        template<typename T>
+        bool ReadValue(T& value)
+        {
+            return Read(&value, sizeof(value));
+        }
+    };
+}
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+SpatialGrid::SpatialGrid(float cellSizeInMeters)
+    : cellSizeInMeters(cellSizeInMeters)
+{
+}
+
+SpatialGrid::CellKey SpatialGrid::GetCellKey(int32_t cellX, int32_t cellY, int32_t cellZ) const
+{
+    //21 bits per axis are plenty for any map size we will ever simulate
+    constexpr uint64_t mask = (1ull << 21) - 1;
+    return  ((static_cast<uint64_t>(cellX) & mask) << 42)
+          | ((static_cast<uint64_t>(cellY) & mask) << 21)
+          |  (static_cast<uint64_t>(cellZ) & mask);
+}
+
+int32_t SpatialGrid::ToCellCoordinate(float positionInMeters) const
+{
+    return static_cast<int32_t>(std::floor(positionInMeters / cellSizeInMeters));
+}
+
+void SpatialGrid::RemoveFromCell(uint32_t nodeIndex, CellKey key)
+{
+    auto cell = cells.find(key);
+    if (cell == cells.end()) return;
+
+    std::vector<uint32_t> &entries = cell->second;
+    auto it = std::find(entries.begin(), entries.end(), nodeIndex);
+    if (it != entries.end())
+    {
+        *it = entries.back();
+        entries.pop_back();
+    }
+    if (entries.empty()) cells.erase(cell);
+}
+
+void SpatialGrid::Reset(uint32_t nodeCount)
+{
+    cells.clear();
+    nodeCells.assign(nodeCount, INVALID_CELL_KEY);
+}
+
+void SpatialGrid::Update(uint32_t nodeIndex, float xInMeters, float yInMeters, float zInMeters)
+{
+    if (nodeIndex >= nodeCells.size())
+    {
+        nodeCells.resize(nodeIndex + 1, INVALID_CELL_KEY);
+    }
+
+    const CellKey newKey = GetCellKey(ToCellCoordinate(xInMeters), ToCellCoordinate(yInMeters), ToCellCoordinate(zInMeters));
+    const CellKey oldKey = nodeCells[nodeIndex];
+    if (newKey == oldKey) return;
+
+    if (oldKey != INVALID_CELL_KEY) RemoveFromCell(nodeIndex, oldKey);
+    cells[newKey].push_back(nodeIndex);
+    nodeCells[nodeIndex] = newKey;
+}
+
+void SpatialGrid::GetCandidates(float xInMeters, float yInMeters, float zInMeters, std::vector<uint32_t> &out) const
+{
+    out.clear();
+
+    const int32_t cellX = ToCellCoordinate(xInMeters);
+    const int32_t cellY = ToCellCoordinate(yInMeters);
+    const int32_t cellZ = ToCellCoordinate(zInMeters);
+
+    for (int32_t dx = -1; dx <= 1; dx++)
+    {
+        for (int32_t dy = -1; dy <= 1; dy++)
+        {
+            for (int32_t dz = -1; dz <= 1; dz++)
+            {
+                auto cell = cells.find(GetCellKey(cellX + dx, cellY + dy, cellZ + dz));
+                if (cell != cells.end())
+                {
+                    out.insert(out.end(), cell->second.begin(), cell->second.end());
+                }
+            }
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+}
+
+float SpatialGrid::GetCellSizeInMeters() const
+{
+    return cellSizeInMeters;
+}
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//
+// A uniform grid that buckets nodes by their position in meters. It is used by the
+// simulator to only consider nodes in the neighbouring cells when delivering radio
+// events instead of iterating over all nodes. As long as the cell size is at least
+// the maximum reception distance per axis, the neighbouring cells are guaranteed to
+// contain every node that could possibly receive something from a given position.
+//
+class SpatialGrid
+{
+private:
+    using CellKey = uint64_t;
+
+    static constexpr CellKey INVALID_CELL_KEY = UINT64_MAX;
+
+    float cellSizeInMeters;
+
+    std::unordered_map<CellKey, std::vector<uint32_t>> cells;
+    std::vector<CellKey> nodeCells;
+
+    CellKey GetCellKey(int32_t cellX, int32_t cellY, int32_t cellZ) const;
+    int32_t ToCellCoordinate(float positionInMeters) const;
+
+    void RemoveFromCell(uint32_t nodeIndex, CellKey key);
+
+public:
+    explicit SpatialGrid(float cellSizeInMeters);
+
+    /// Removes all nodes from the grid and prepares it for the given amount of nodes.
+    void Reset(uint32_t nodeCount);
+
+    /// Inserts the node into the grid or moves it to its new cell. Cheap if the node did not change its cell.
+    void Update(uint32_t nodeIndex, float xInMeters, float yInMeters, float zInMeters);
+
+    /// Fills out with the indices of all nodes in the cell of the given position and all
+    /// of its neighbouring cells. The indices are sorted in ascending order so that callers
+    /// can visit them in the same order as a linear iteration over all nodes would.
+    void GetCandidates(float xInMeters, float yInMeters, float zInMeters, std::vector<uint32_t> &out) const;
+
+    float GetCellSizeInMeters() const;
+};
@@ -51,7 +51,9 @@ void StackWatcher::Check()
     int someDummyStackVariable = 0;
 
     const u32 uncleanedStackSize = (const char*)StackWatcher::stackBase.back() - (const char*)&someDummyStackVariable;
-    const u32 cleanedStackSize = uncleanedStackSize - sizeof(StackBaseSetter);
+    //Dynamic arrays would be on the stack on the real hardware
+    const u32 scratchArenaUsage = simScratchArenaPtr != nullptr ? simScratchArenaPtr->GetUsage() : 0;
+    const u32 cleanedStackSize = uncleanedStackSize - sizeof(StackBaseSetter) + scratchArenaUsage;
 
     if (cleanedStackSize > 12000)
     {
@@ -33,11 +33,13 @@
 #include <stdio.h>
 #include <FmTypes.h>
 #include <CherrySim.h>
+#include <CherrySimUtils.h>
 #include <FruityMesh.h>
 #include <FruityHalBleGatt.h>
 #include <json.hpp>
 #include <Logger.h>
 #include <fstream>
+#include <algorithm>
 #include <limits>
 #include <optional>
 
@@ -60,14 +62,15 @@ using json = nlohmann::json;
 uint32_t __application_start_address;
 uint32_t __application_end_address;
 uint32_t __application_ram_start_address;
-uint32_t __start_conn_type_resolvers;
-uint32_t __stop_conn_type_resolvers;
+uintptr_t __start_conn_type_resolvers;
+uintptr_t __stop_conn_type_resolvers;
 uint32_t __license_data_start_address;
 uint32_t __StackTop;
 uint32_t __StackLimit;
 
 //Pointer to FruityMesh state
 GlobalState* simGlobalStatePtr;
+ScratchArena* simScratchArenaPtr;
 
 //nRF hardware abstraction
 NRF_FICR_Type* simFicrPtr;
@@ -951,7 +954,7 @@ extern "C"
         s1.bleEvent.evt.gap_evt.params.sec_info_request.enc_info = 0; //TODO: incomplete information
         s1.bleEvent.evt.gap_evt.params.sec_info_request.id_info = 0; //TODO: incomplete information
         s1.bleEvent.evt.gap_evt.params.sec_info_request.sign_info = 0; //TODO: incomplete information
-        connection->partner->eventQueue.push_back(s1);
+        connection->partner->eventQueue.Push(s1);
 
         //Save the key that should be used for encrypting the connection
         CheckedMemcpy(cherrySimInstance->currentNode->state.currentLtkForEstablishingSecurity, p_enc_info->ltk, 16);
@@ -984,7 +987,7 @@ extern "C"
             s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
             s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
             s1.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
-            cherrySimInstance->currentNode->eventQueue.push_back(s1);
+            cherrySimInstance->currentNode->eventQueue.Push(s1);
 
             //Set our own partners connection to encrypted
             connection->partnerConnection->connectionEncrypted = true;
@@ -997,7 +1000,7 @@ extern "C"
             s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
             s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
             s2.bleEvent.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = 3;
-            connection->partner->eventQueue.push_back(s2);
+            connection->partner->eventQueue.Push(s2);
         }
         //Keys do not match, generate a failure
         else {
@@ -1095,7 +1098,7 @@ extern "C"
                     bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
                     bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
 
-                    connection->owningNode->eventQueue.push_back(simEvent);
+                    connection->owningNode->eventQueue.Push(simEvent);
                 }
 
                 { // peripheral event
@@ -1108,7 +1111,7 @@ extern "C"
                     bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
                     bleEvent.evt.gap_evt.params.conn_param_update.conn_params = *params;
 
-                    peripheralConnection->owningNode->eventQueue.push_back(simEvent);
+                    peripheralConnection->owningNode->eventQueue.Push(simEvent);
                 }
             }
             // If a request was rejected, generate an event on the peripheral.
@@ -1123,12 +1126,12 @@ extern "C"
                 bleEvent.evt.gap_evt.conn_handle = connection->connectionHandle;
 
                 auto & connParams = bleEvent.evt.gap_evt.params.conn_param_update.conn_params;
-                connParams.min_conn_interval = peripheralConnection->connectionInterval;
-                connParams.max_conn_interval = peripheralConnection->connectionInterval;
+                connParams.min_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(peripheralConnection->connectionInterval);
+                connParams.max_conn_interval = CherrySimUtils::ConnectionIntervalMsToUnits(peripheralConnection->connectionInterval);
                 connParams.slave_latency = Conf::GetInstance().meshPeripheralSlaveLatency;
                 connParams.conn_sup_timeout = Conf::meshConnectionSupervisionTimeout;
 
-                peripheralConnection->owningNode->eventQueue.push_back(simEvent);
+                peripheralConnection->owningNode->eventQueue.Push(simEvent);
             }
         }
         // Called on the peripheral.
@@ -1169,7 +1172,7 @@ extern "C"
             bleEvent.evt.gap_evt.params.conn_param_update_request.conn_params =
                 *p_conn_params;
             // Push the request event into the event queue of the central node.
-            centralConnection->owningNode->eventQueue.push_back(simEvent);
+            centralConnection->owningNode->eventQueue.Push(simEvent);
         }
 
         return NRF_SUCCESS;
@@ -1384,7 +1387,7 @@ extern "C"
         s1.bleEvent.evt.gatts_evt.conn_handle = connHandle;
         s1.bleEvent.evt.gatts_evt.params.exchange_mtu_request.client_rx_mtu = clientRxMtu;
 
-        connection->partner->eventQueue.push_back(s1);
+        connection->partner->eventQueue.Push(s1);
 
 
         return NRF_SUCCESS;
@@ -1400,6 +1403,21 @@ extern "C"
             return NRF_ERROR_BUSY;
         }
 
+        SoftdeviceConnection* connection = cherrySimInstance->FindConnectionByHandle(cherrySimInstance->currentNode, connHandle);
+        if (connection == nullptr) {
+            return BLE_ERROR_INVALID_CONN_HANDLE;
+        }
+
+        //Without parameters, the SoftDevice uses the maximum that it supports. The update is applied
+        //immediately at both ends, no BLE_GAP_EVT_DATA_LENGTH_UPDATE is generated.
+        u32 llDataLength = LL_MAX_DATA_LENGTH;
+        if (p_dl_params != nullptr && p_dl_params->max_tx_octets != BLE_GAP_DATA_LENGTH_AUTO)
+        {
+            llDataLength = std::clamp<u32>(p_dl_params->max_tx_octets, LL_DEFAULT_DATA_LENGTH, LL_MAX_DATA_LENGTH);
+        }
+        connection->llDataLength = llDataLength;
+        if (connection->partnerConnection != nullptr) connection->partnerConnection->llDataLength = llDataLength;
+
         return NRF_SUCCESS;
 
     }
@@ -1436,7 +1454,7 @@ extern "C"
         s1.bleEvent.evt.gattc_evt.params.exchange_mtu_rsp.server_rx_mtu = serverRxMtu;
 
   
-        connection->partner->eventQueue.push_back(s1);
+        connection->partner->eventQueue.Push(s1);
 
 
         return NRF_SUCCESS;
@@ -1544,11 +1562,7 @@ extern "C"
 
         logt("RS", "Erasing Page %u", page_number);
 
-        u32* p = (u32*)(FLASH_REGION_START_ADDRESS + (u32)page_number * FruityHal::GetCodePageSize());
-
-        for (u32 i = 0; i < FruityHal::GetCodePageSize() / 4; i++) {
-            p[i] = 0xFFFFFFFF;
-        }
+        cherrySimInstance->currentNode->flash.Erase((u32)page_number * FruityHal::GetCodePageSize(), FruityHal::GetCodePageSize());
 
 
         if (cherrySimInstance->simConfig.simulateAsyncFlash) {
@@ -1564,12 +1578,14 @@ extern "C"
     uint32_t sd_flash_write(uint32_t* const p_dst, const uint32_t* const p_src, uint32_t size)
     {
         START_OF_FUNCTION();
-        u32 sourcePage            = ((u32)p_src - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize();
-        u32 sourcePageOffset      = ((u32)p_src - FLASH_REGION_START_ADDRESS) % FruityHal::GetCodePageSize();
-        u32 destinationPage       = ((u32)p_dst - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize();
-        u32 destinationPageOffset = ((u32)p_dst - FLASH_REGION_START_ADDRESS) % FruityHal::GetCodePageSize();
-
-        if ((u32)p_src >= FLASH_REGION_START_ADDRESS && (u32)p_src < FLASH_REGION_START_ADDRESS + FruityHal::GetCodeSize()*FruityHal::GetCodePageSize()) {
+        //Offsets are calculated from the pointers as the source might not be in flash and can therefore not be
+        //converted to a flash address
+        u32 sourcePage            = (u32)((const u8*)p_src - simFlashPtr) / FruityHal::GetCodePageSize();
+        u32 sourcePageOffset      = (u32)((const u8*)p_src - simFlashPtr) % FruityHal::GetCodePageSize();
+        u32 destinationPage       = (u32)((const u8*)p_dst - simFlashPtr) / FruityHal::GetCodePageSize();
+        u32 destinationPageOffset = (u32)((const u8*)p_dst - simFlashPtr) % FruityHal::GetCodePageSize();
+
+        if ((const u8*)p_src >= simFlashPtr && (const u8*)p_src < simFlashPtr + FruityHal::GetCodeSize()*FruityHal::GetCodePageSize()) {
             logt("RS", "Copy from page %u (+%u) to page %u (+%u), len %u", sourcePage, sourcePageOffset, destinationPage, destinationPageOffset, size * 4);
         }
         else {
@@ -1581,21 +1597,19 @@ extern "C"
             return NRF_ERROR_INVALID_LENGTH;
         }
 
-        if (((u32)p_src) % 4 != 0) {
+        if (((uintptr_t)p_src) % 4 != 0) {
             logt("ERROR", "source unaligned");
             SIMEXCEPTION(IllegalArgumentException);
             return NRF_ERROR_INVALID_ADDR;
         }
-        if (((u32)p_dst) % 4 != 0) {
+        if (((uintptr_t)p_dst) % 4 != 0) {
             logt("ERROR", "dest unaligned");
             SIMEXCEPTION(IllegalArgumentException);
             return NRF_ERROR_INVALID_ADDR;
         }
 
         //Only toggle bits from 1 to 0 when writing!
-        for (u32 i = 0; i < size; i++) {
-            p_dst[i] &= p_src[i];
-        }
+        cherrySimInstance->currentNode->flash.Write(POINTER_TO_FLASH_ADDRESS(p_dst) - FLASH_REGION_START_ADDRESS, (const u8*)p_src, size * sizeof(u32));
 
         if (cherrySimInstance->simConfig.simulateAsyncFlash) {
             cherrySimInstance->currentNode->state.numWaitingFlashOperations++;
@@ -1639,6 +1653,7 @@ extern "C"
                 return 1;
             }
             cherrySimInstance->currentNode->state.configuredTotalConnectionCount = cfg->conn_cfg.params.gap_conn_cfg.conn_count;
+            cherrySimInstance->currentNode->state.connectionEventLengthUs = cfg->conn_cfg.params.gap_conn_cfg.event_length * CONFIG_UNIT_1_25_MS;
         }
         else if (type == BLE_GAP_CFG_ROLE_COUNT)
         {
@@ -1672,60 +1687,46 @@ extern "C"
             return NRF_ERROR_INVALID_ADDR;
         }
 
-        if (cherrySimInstance->currentNode->eventQueue.empty())
+        NodeEntry* node = cherrySimInstance->currentNode;
+        if (node->eventQueue.IsEmpty())
         {
             // [SD]: No events ready to be pulled.
             return NRF_ERROR_NOT_FOUND;
         }
 
-        auto simBleEvent = cherrySimInstance->currentNode->eventQueue.front();
-
-        // Compute the number of bytes to copy from the event to the buffer.
-        // The BLE events can contain more data than the native BLE event
-        // structure, where the data member provides that overflow space.
-        constexpr std::size_t eventSize =
-                sizeof(simBleEvent.bleEvent) + sizeof(simBleEvent.bleEventOverflowData);
-
-        // TODO: The actual SoftDevice checks that the event actually fits
-        //       into the buffer. If you compile this check in, the simulator
-        //       fails. This is becaue (in the simulator) we use the evt_len
-        //       field of the header to transport the global event id.
-        //       Tracked in BR-1360.
-        //if (*p_len < simBleEvent.simBleEvent.header.evt_len)
-        //{
-        //    // [SD]: Event ready but could not fit into the supplied buffer.
-        //    return NRF_ERROR_DATA_SIZE;
-        //}
-        // TODO: For now we will use the number of bytes computed above and
-        //       return failure if the buffer was too small. If you arrive
-        //       here during debugging, the buffer you passed in was too small.
-        //       This check (and notice) can be removed after the check above
-        //       works correctly. (BR-1360)
+        // The queue only stores as much of the overflow data behind the
+        // ble_evt_t as the event uses, which is the actual event length.
+        // (The evt_len field of the header can not be used for this as
+        // the simulator uses it to transport the global event id.)
+        const SimBleEventRecord& record = node->eventQueue.Front();
+        const u32 eventSize = record.payloadSize;
+
         if (*p_len < eventSize)
         {
             // [SD]: Event ready but could not fit into the supplied buffer.
             return NRF_ERROR_DATA_SIZE;
         }
 
-        // We store the current event so that we can access it during debugging
-        // if we want to get more information.
-        cherrySimInstance->currentNode->currentEvent = simBleEvent;
-        cherrySimInstance->currentNode->eventQueue.pop_front();
+        // [SD]: Update the pointee of p_len with the used number of bytes.
+        *p_len = (uint16_t)eventSize;
 
-        if (cherrySimInstance->simEventListener != nullptr)
+        // [SD]: If p_dest is the nullptr, just peek the event length.
+        if (p_dest == nullptr)
         {
-            cherrySimInstance->simEventListener->CherrySimBleEventHandler(
-                    cherrySimInstance->currentNode,
-                    &simBleEvent, sizeof(simBleEvent));
+            return NRF_SUCCESS;
         }
 
-        // [SD]: Update the pointee of p_len with the used number of bytes.
-        *p_len = std::min<std::uint16_t>(*p_len, eventSize);
+        // The event is copied straight from the queue, which is its only
+        // copy. The record must not be used after it was popped as its
+        // memory might be reused right away.
+        CheckedMemcpy(p_dest, record.GetEvent(), eventSize);
+        node->eventQueue.PopFront();
 
-        // [SD]: If p_dest is the nullptr, just peek the event length.
-        if (p_dest != nullptr)
+        if (cherrySimInstance->simEventListener != nullptr)
         {
-            CheckedMemcpy(p_dest, &simBleEvent, *p_len);
+            cherrySimInstance->simEventListener->CherrySimBleEventHandler(
+                    node,
+                    (const ble_evt_t*)p_dest, eventSize);
         }
 
         // [SD]: Event pulled and stored into the supplied buffer.
@@ -1889,6 +1890,10 @@ extern "C"
 
     uint32_t sd_ble_opt_set(uint32_t opt_id, ble_opt_t const *p_opt) {
         START_OF_FUNCTION();
+        if (opt_id == BLE_COMMON_OPT_CONN_EVT_EXT)
+        {
+            cherrySimInstance->currentNode->state.connectionEventExtension = p_opt->common_opt.conn_evt_ext.enable;
+        }
         return NRF_SUCCESS;
     }
 
@@ -1941,7 +1946,15 @@ extern "C"
 
     uint32_t sd_ecb_block_encrypt(nrf_ecb_hal_data_t * p_ecb_data) {
         START_OF_FUNCTION();
-        AES_ECB_encrypt(p_ecb_data->cleartext, p_ecb_data->key, p_ecb_data->ciphertext, 16);
+        if (cherrySimInstance != nullptr && cherrySimInstance->currentNode != nullptr)
+        {
+            cherrySimInstance->currentNode->ecb.EncryptBlock(p_ecb_data->key, p_ecb_data->cleartext, p_ecb_data->ciphertext);
+        }
+        else
+        {
+            //Without a node (e.g. in unit tests of the utility functions), there is no key schedule cache to use
+            AES_ECB_encrypt(p_ecb_data->cleartext, p_ecb_data->key, p_ecb_data->ciphertext, 16);
+        }
 
         return 0;
     }
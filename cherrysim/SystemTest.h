@@ -117,6 +117,10 @@ typedef class GlobalState GlobalState;
 //We keep a pointer to our GlobalState, this state contains the whole state of a node as known to FruityMesh
 extern GlobalState* simGlobalStatePtr;
 #define GS (simGlobalStatePtr)
+
+//Memory of the current node from which DYNAMIC_ARRAYs are taken
+typedef class ScratchArena ScratchArena;
+extern ScratchArena* simScratchArenaPtr;
 #endif //__cplusplus
 
 
@@ -787,7 +791,20 @@ extern uint8_t* simFlashPtr;
 //The flash region start address points to the beginning of the flash memory. All address calculations must
 //use the correct addresses including the start address of the flash space.
 //The pages however are always counted from the beginning of the flash memory.
+//Flash addresses are u32 in the firmware and must be converted using FLASH_ADDRESS_TO_POINTER and
+//POINTER_TO_FLASH_ADDRESS before they can be accessed or after they were taken from a pointer.
+#if UINTPTR_MAX > 0xFFFFFFFFUL
+//A pointer does not fit into a flash address in a 64-bit simulator. The flash addresses are therefore
+//virtualised like on the chip, they start at 0 and are relative to the flash of the current node.
+#define SIM_VIRTUAL_FLASH_ADDRESSES
+#define FLASH_REGION_START_ADDRESS 0x00000000UL
+#define FLASH_ADDRESS_TO_POINTER(address) (simFlashPtr + (uint32_t)(address))
+#define POINTER_TO_FLASH_ADDRESS(pointer) ((uint32_t)((const uint8_t*)(pointer) - simFlashPtr))
+#else
 #define FLASH_REGION_START_ADDRESS ((u32)simFlashPtr)
+#define FLASH_ADDRESS_TO_POINTER(address) ((uint8_t*)(uintptr_t)(address))
+#define POINTER_TO_FLASH_ADDRESS(pointer) ((uint32_t)(uintptr_t)(pointer))
+#endif
 
 //Used to collect statistic counts in the simulator, a hashmap is used to count all calls to this function under the given key
 #define SIMSTATCOUNT(key) sim_collect_statistic_count(key)
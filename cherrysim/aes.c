@@ -63,6 +63,10 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
     #define keyExpSize 176
 #endif
 
+#if defined(ECB) && (ECB == 1) && (keyExpSize != AES_ROUND_KEY_SIZE)
+  #error "AES_ECB_expand_key only supports AES128"
+#endif
+
 // jcallan@github points out that declaring Multiply as a function 
 // reduces code size considerably with the Keil ARM compiler.
 // See this link for more information: https://github.com/kokke/tiny-AES128-C/pull/3
@@ -81,6 +85,9 @@ static state_t* state;
 // The array that stores the round keys.
 static uint8_t RoundKey[keyExpSize];
 
+// The round keys used by AddRoundKey, only differs from RoundKey while encrypting with a schedule of the caller.
+static const uint8_t* CipherRoundKey = RoundKey;
+
 // The Key input to the AES Program
 static const uint8_t* Key;
 
@@ -259,7 +266,7 @@ static void AddRoundKey(uint8_t round)
   {
     for (j = 0; j < 4; ++j)
     {
-      (*state)[i][j] ^= RoundKey[round * Nb * 4 + i * Nb + j];
+      (*state)[i][j] ^= CipherRoundKey[round * Nb * 4 + i * Nb + j];
     }
   }
 }
@@ -486,6 +493,24 @@ void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t* output,
   Cipher();
 }
 
+void AES_ECB_expand_key(const uint8_t* key, uint8_t* roundKey)
+{
+  Key = key;
+  KeyExpansion();
+  memcpy(roundKey, RoundKey, keyExpSize);
+}
+
+void AES_ECB_encrypt_expanded(const uint8_t* input, const uint8_t* roundKey, uint8_t* output)
+{
+  // Copy input to output, and work in-memory on output
+  memcpy(output, input, BLOCKLEN);
+  state = (state_t*)output;
+
+  CipherRoundKey = roundKey;
+  Cipher();
+  CipherRoundKey = RoundKey;
+}
+
 void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length)
 {
   // Copy input to output, and work in-memory on output
@@ -27,6 +27,12 @@
 void AES_ECB_encrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length);
 void AES_ECB_decrypt(const uint8_t* input, const uint8_t* key, uint8_t *output, const uint32_t length);
 
+// Splits AES_ECB_encrypt into the key expansion and the encryption of a single block so that the
+// expanded key (AES_ROUND_KEY_SIZE bytes) can be reused for multiple blocks.
+#define AES_ROUND_KEY_SIZE 176
+void AES_ECB_expand_key(const uint8_t* key, uint8_t* roundKey);
+void AES_ECB_encrypt_expanded(const uint8_t* input, const uint8_t* roundKey, uint8_t* output);
+
 #endif // #if defined(ECB) && (ECB == !)
 
 
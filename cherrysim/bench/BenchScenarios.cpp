@@ -0,0 +1,288 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "CherrySimBench.h"
+#include "CherrySim.h"
+#include "ConnectionManager.h"
+#include "Node.h"
+#include "RecordStorage.h"
+#include "Utility.h"
+#include <chrono>
+#include <cmath>
+
+//The standard mesh scenarios of the cherrySim_bench target. Each scenario prepares its mesh outside of the
+//measurement so that the reported numbers only contain the load that the scenario is about.
+
+namespace
+{
+    //Nodes are spread so that every node has a similar amount of neighbours, regardless of the size of the mesh
+    constexpr float squareMetersPerNode = 600.0f;
+
+    SimConfiguration CreateBenchSimConfiguration(u32 meshNodes)
+    {
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.verboseCommands = false;
+        simConfig.nodeConfigName.insert({ "github_sink_nrf52", 1 });
+        simConfig.nodeConfigName.insert({ "github_mesh_nrf52", meshNodes });
+        return simConfig;
+    }
+
+    CherrySimTesterConfig CreateBenchTesterConfiguration()
+    {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        testerConfig.verbose = false;
+        return testerConfig;
+    }
+}
+
+//Clusters a mesh whose nodes are placed by PositionNodesRandomly, the argument is the total amount of nodes
+static void BenchClustering(BenchState& state)
+{
+    constexpr u32 maxClusteringTimeMs = 10 * 60 * 1000;
+
+    const u32 totalNodes = state.GetArgument();
+    SimConfiguration simConfig = CreateBenchSimConfiguration(totalNodes - 1);
+    simConfig.mapWidthInMeters = (u32)std::ceil(std::sqrt(totalNodes * squareMetersPerNode * 4 / 3));
+    simConfig.mapHeightInMeters = simConfig.mapWidthInMeters * 3 / 4;
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+
+    //The mesh might not cluster completely with bad reception, the benchmark therefore runs for a limited simulated time
+    state.StartMeasurement(tester);
+    while (!tester.sim->IsClusteringDone() && tester.sim->simState.simTimeMs < maxClusteringTimeMs)
+    {
+        tester.sim->SimulateStepForAllNodes();
+    }
+    state.StopMeasurement();
+
+    state.SetCounter("clusteringDone", tester.sim->IsClusteringDone() ? 1 : 0);
+    state.SetCounter("clusteringTimeMs", tester.sim->simState.simTimeMs);
+}
+CHERRYSIM_BENCHMARK(BenchClustering)->Arg(50)->Arg(500)->Arg(2000);
+
+//Places the nodes of a sparse mesh so that it is connected, the argument is the total amount of nodes
+static void BenchPositionNodesRandomly(BenchState& state)
+{
+    const u32 totalNodes = state.GetArgument();
+    SimConfiguration simConfig = CreateBenchSimConfiguration(totalNodes - 1);
+    simConfig.mapWidthInMeters = (u32)std::ceil(std::sqrt(totalNodes * squareMetersPerNode * 4 / 3));
+    simConfig.mapHeightInMeters = simConfig.mapWidthInMeters * 3 / 4;
+    simConfig.targetMeanNeighbourDegree = 3.0;
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    tester.Start();
+
+    //The nodes were already placed once during the start, placing them again uses the next random numbers
+    state.StartMeasurement(tester);
+    tester.sim->PositionNodesRandomly();
+    state.StopMeasurement();
+
+    state.SetCounter("placementMs", state.wallSeconds * 1000);
+}
+CHERRYSIM_BENCHMARK(BenchPositionNodesRandomly)->Arg(2000);
+
+//All mesh nodes of a clustered mesh send generate_load chunks to the sink, the argument is the amount of mesh nodes
+static void BenchGenerateLoadFlooding(BenchState& state)
+{
+    constexpr u32 floodingTimeMs = 60 * 1000;
+
+    const u32 meshNodes = state.GetArgument();
+    SimConfiguration simConfig = CreateBenchSimConfiguration(meshNodes);
+    simConfig.SetToPerfectConditions();
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(10 * 60 * 1000);
+
+    state.StartMeasurement(tester);
+    //Every node sends a 20 byte chunk each decisecond, the amount of 200 is multiplied with the request handle of 3
+    tester.SendTerminalCommand(1, "action 0 node generate_load 1 20 200 1 3");
+    tester.SimulateForGivenTime(floodingTimeMs);
+    state.StopMeasurement();
+
+    NodeIndexSetter setter(0);
+    const LoadStatistics::Summary summary = GS->node.GetLoadStatistics().GetSummary(NODE_ID_BROADCAST);
+    state.SetCounter("senders", summary.senders);
+    state.SetCounter("sentPackets", summary.sentPackets);
+    state.SetCounter("receivedPackets", summary.receivedPackets);
+    state.SetCounter("p99DelayMs", summary.p99DelayMs);
+}
+CHERRYSIM_BENCHMARK(BenchGenerateLoadFlooding)->Arg(9)->Arg(49);
+
+//A node repeatedly connects to a node of another network through a MeshAccessConnection, the argument is the amount of handshakes
+static void BenchMeshAccessHandshakes(BenchState& state)
+{
+    constexpr u32 handshakeTimeoutMs = 10 * 1000;
+
+    SimConfiguration simConfig = CreateBenchSimConfiguration(2);
+    simConfig.preDefinedPositions = { {0.5, 0.5},{0.6, 0.5},{0.7, 0.5} };
+    simConfig.SetToPerfectConditions();
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    //Change the network id of the third node so that it can only be reached through a MeshAccessConnection
+    tester.sim->nodes[2].uicr.CUSTOMER[9] = 123;
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateForGivenTime(10 * 1000);
+
+    const auto countMeshAccessConnections = [&tester](bool onlyWithHandshakeDone) {
+        NodeIndexSetter setter(1);
+        const BaseConnections connections = GS->cm.GetConnectionsOfType(ConnectionType::MESH_ACCESS, ConnectionDirection::INVALID);
+        u32 count = 0;
+        for (u32 i = 0; i < connections.count; i++)
+        {
+            const BaseConnection* connection = connections.handles[i].GetConnection();
+            if (connection != nullptr && (!onlyWithHandshakeDone || connection->HandshakeDone())) count++;
+        }
+        return count;
+    };
+    const auto simulateUntil = [&tester](const std::function<bool()>& condition, u32 timeoutMs) {
+        const u32 startTimeMs = tester.sim->simState.simTimeMs;
+        while (!condition())
+        {
+            tester.sim->SimulateStepForAllNodes();
+            if (tester.sim->simState.simTimeMs - startTimeMs > timeoutMs) SIMEXCEPTION(TimeoutException);
+        }
+    };
+
+    state.StartMeasurement(tester);
+    for (u32 i = 0; i < state.GetArgument(); i++)
+    {
+        tester.SendTerminalCommand(2, "action this ma connect 00:00:00:03:00:00 2");
+        simulateUntil([&]() { return countMeshAccessConnections(true) > 0; }, handshakeTimeoutMs);
+        tester.SendTerminalCommand(2, "action this ma disconnect 00:00:00:03:00:00");
+        simulateUntil([&]() { return countMeshAccessConnections(false) == 0; }, handshakeTimeoutMs);
+    }
+    state.StopMeasurement();
+
+    state.SetCounter("handshakes", state.GetArgument());
+}
+CHERRYSIM_BENCHMARK(BenchMeshAccessHandshakes)->Arg(20);
+
+//Every node of a clustered mesh saves and deactivates records in each step, which forces the RecordStorage to
+//defragment its pages regularly. The argument is the amount of mesh nodes.
+static void BenchRecordStorageChurn(BenchState& state)
+{
+    constexpr u32 churnTimeMs = 60 * 1000;
+    constexpr u16 firstRecordId = 2000;
+    constexpr u16 amountOfRecordIds = 16;
+
+    const u32 meshNodes = state.GetArgument();
+    SimConfiguration simConfig = CreateBenchSimConfiguration(meshNodes);
+    simConfig.SetToPerfectConditions();
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(10 * 60 * 1000);
+
+    u32 savedRecords = 0;
+    u32 deactivatedRecords = 0;
+    u32 busyResults = 0;
+    u32 step = 0;
+    u8 data[64];
+
+    state.StartMeasurement(tester);
+    const u32 endTimeMs = tester.sim->simState.simTimeMs + churnTimeMs;
+    while (tester.sim->simState.simTimeMs < endTimeMs)
+    {
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            NodeIndexSetter setter(i);
+            const u16 recordId = firstRecordId + (step + i) % amountOfRecordIds;
+            RecordStorageResultCode result;
+            if ((step + i) % 4 == 3)
+            {
+                result = GS->recordStorage.DeactivateRecord(recordId, nullptr, 0);
+                if (result == RecordStorageResultCode::SUCCESS) deactivatedRecords++;
+            }
+            else
+            {
+                //The record length varies so that the pages fill up unevenly
+                const u16 dataLength = 8 + (step * 4 + i) % (sizeof(data) - 8);
+                CheckedMemset(data, (u8)step, dataLength);
+                result = GS->recordStorage.SaveRecord(recordId, data, dataLength, nullptr, 0);
+                if (result == RecordStorageResultCode::SUCCESS) savedRecords++;
+            }
+            if (result == RecordStorageResultCode::BUSY) busyResults++;
+        }
+        tester.sim->SimulateStepForAllNodes();
+        step++;
+    }
+    state.StopMeasurement();
+
+    state.SetCounter("savedRecords", savedRecords);
+    state.SetCounter("deactivatedRecords", deactivatedRecords);
+    state.SetCounter("busyResults", busyResults);
+}
+CHERRYSIM_BENCHMARK(BenchRecordStorageChurn)->Arg(9);
+
+//Encrypts blocks through Utility::Aes128BlockEncrypt like the MeshAccessConnections do, the argument is the amount of
+//keys that are used in turns. More keys than SimEcb::CACHED_SCHEDULES force the key expansion for every block.
+static void BenchAes128BlockEncrypt(BenchState& state)
+{
+    constexpr u32 blocks = 1000 * 1000;
+
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.verboseCommands = false;
+    simConfig.nodeConfigName.insert({ "github_sink_nrf52", 1 });
+    CherrySimTester tester(CreateBenchTesterConfiguration(), simConfig);
+    tester.Start();
+
+    NodeIndexSetter setter(0);
+    SimEcb& ecb = tester.sim->nodes[0].ecb;
+    std::vector<Aes128Block> keys(state.GetArgument());
+    for (u32 i = 0; i < keys.size(); i++)
+    {
+        CheckedMemset(keys[i].data, (u8)(i + 1), sizeof(keys[i].data));
+    }
+    const auto encryptBlocks = [&keys]() {
+        Aes128Block block = {};
+        for (u32 i = 0; i < blocks; i++)
+        {
+            //Each block is encrypted with the result of the previous one so that no call can be skipped
+            Utility::Aes128BlockEncrypt(&block, &keys[i % keys.size()], &block);
+        }
+    };
+    const u32 cacheHitsBefore = ecb.GetCacheHits();
+
+    state.StartMeasurement(tester);
+    encryptBlocks();
+    state.StopMeasurement();
+
+    state.SetCounter("aesNi", ecb.GetBackend() == SimEcb::Backend::AES_NI ? 1 : 0);
+    state.SetCounter("blocksPerSecond", blocks / state.wallSeconds);
+    state.SetCounter("cacheHitRate", (double)(ecb.GetCacheHits() - cacheHitsBefore) / blocks);
+
+    //The software implementation is reported as well so that both backends can be compared on the same host
+    if (ecb.GetBackend() != SimEcb::Backend::SOFTWARE)
+    {
+        ecb.SetBackend(SimEcb::Backend::SOFTWARE);
+        const auto softwareStart = std::chrono::steady_clock::now();
+        encryptBlocks();
+        const double softwareSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - softwareStart).count();
+        state.SetCounter("softwareBlocksPerSecond", blocks / softwareSeconds);
+        ecb.SetBackend(SimEcb::GetDefaultBackend());
+    }
+}
+CHERRYSIM_BENCHMARK(BenchAes128BlockEncrypt)->Arg(1)->Arg(8);
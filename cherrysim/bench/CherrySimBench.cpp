@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "CherrySimBench.h"
+#include "CherrySim.h"
+#include "Exceptions.h"
+#include "json.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <typeinfo>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+BenchState::BenchState(u32 argument)
+    : argument(argument)
+{
+}
+
+u32 BenchState::GetArgument() const
+{
+    return argument;
+}
+
+void BenchState::StartMeasurement(CherrySimTester& tester)
+{
+    if (measuredSim != nullptr) SIMEXCEPTION(IllegalStateException);
+    measuredSim = tester.sim;
+
+    CherrySimBench::ResetPeakRss();
+    measuredSim->phaseTimings.Reset();
+    measuredSim->phaseTimings.enabled = measurePhases;
+    startSimTimeMs = measuredSim->simState.simTimeMs;
+    startWallTime = std::chrono::steady_clock::now();
+}
+
+void BenchState::StopMeasurement()
+{
+    if (measuredSim == nullptr) SIMEXCEPTION(IllegalStateException);
+
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startWallTime).count();
+    simulatedMs = measuredSim->simState.simTimeMs - startSimTimeMs;
+    peakRssBytes = CherrySimBench::GetPeakRssBytes();
+    phaseTimings = measuredSim->phaseTimings;
+    measuredSim->phaseTimings.enabled = false;
+    measuredSim = nullptr;
+}
+
+void BenchState::SetCounter(const std::string& name, double value)
+{
+    counters[name] = value;
+}
+
+BenchRegistration::BenchRegistration(const char* name, BenchFunction function)
+    : name(name), function(function)
+{
+}
+
+BenchRegistration* BenchRegistration::Arg(u32 argument)
+{
+    arguments.push_back(argument);
+    return this;
+}
+
+static std::vector<std::unique_ptr<BenchRegistration>>& GetMutableRegistrations()
+{
+    //Function local so that the registrations of other translation units find it initialized
+    static std::vector<std::unique_ptr<BenchRegistration>> registrations;
+    return registrations;
+}
+
+BenchRegistration* CherrySimBench::RegisterBenchmark(const char* name, BenchFunction function)
+{
+    GetMutableRegistrations().push_back(std::make_unique<BenchRegistration>(name, function));
+    return GetMutableRegistrations().back().get();
+}
+
+const std::vector<std::unique_ptr<BenchRegistration>>& CherrySimBench::GetRegistrations()
+{
+    return GetMutableRegistrations();
+}
+
+uint64_t CherrySimBench::GetPeakRssBytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+    //VmHWM can be reset through clear_refs, the peak reported by getrusage can not
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        unsigned long long kiloBytes = 0;
+        if (sscanf(line.c_str(), "VmHWM: %llu kB", &kiloBytes) == 1) return kiloBytes * 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (uint64_t)usage.ru_maxrss; //Reported in bytes on macOS
+#endif
+}
+
+void CherrySimBench::ResetPeakRss()
+{
+#if defined(__linux__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+}
+
+struct BenchResult
+{
+    std::string name;
+    u32 argument = 0;
+    BenchState state{ 0 };
+    std::string error;
+};
+
+static nlohmann::json BenchResultToJson(const BenchResult& result)
+{
+    nlohmann::json j;
+    j["name"] = result.name;
+    j["argument"] = result.argument;
+    if (!result.error.empty())
+    {
+        j["error"] = result.error;
+        return j;
+    }
+    const BenchState& state = result.state;
+    j["simulatedMs"] = state.simulatedMs;
+    j["wallSeconds"] = state.wallSeconds;
+    j["simulatedMsPerWallSecond"] = state.wallSeconds > 0 ? state.simulatedMs / state.wallSeconds : 0.0;
+    j["peakRssBytes"] = state.peakRssBytes;
+    if (state.phaseTimings.enabled)
+    {
+        nlohmann::json phases = nlohmann::json::object();
+        for (u32 i = 0; i < (u32)SimPhase::AMOUNT; i++)
+        {
+            phases[SimPhaseToString((SimPhase)i)] = std::chrono::duration<double>(state.phaseTimings.durations[i]).count();
+        }
+        j["phaseSeconds"] = phases;
+    }
+    j["counters"] = state.counters;
+    return j;
+}
+
+static void PrintResult(const BenchResult& result)
+{
+    if (!result.error.empty())
+    {
+        printf("%-32s ERROR: %s" EOL, result.name.c_str(), result.error.c_str());
+        return;
+    }
+    const BenchState& state = result.state;
+    printf("%-32s %10u sim ms %9.3f s %12.1f sim ms/s %8.1f MiB peak RSS" EOL,
+        result.name.c_str(),
+        state.simulatedMs,
+        state.wallSeconds,
+        state.wallSeconds > 0 ? state.simulatedMs / state.wallSeconds : 0.0,
+        state.peakRssBytes / (1024.0 * 1024.0));
+    if (state.phaseTimings.enabled)
+    {
+        const double totalSeconds = std::chrono::duration<double>(state.phaseTimings.GetTotal()).count();
+        for (u32 i = 0; i < (u32)SimPhase::AMOUNT; i++)
+        {
+            const double seconds = std::chrono::duration<double>(state.phaseTimings.durations[i]).count();
+            if (seconds <= 0) continue;
+            printf("    %-48s %9.3f s %5.1f %%" EOL, SimPhaseToString((SimPhase)i), seconds, totalSeconds > 0 ? seconds * 100 / totalSeconds : 0.0);
+        }
+    }
+    for (const auto& counter : state.counters)
+    {
+        printf("    %-48s %g" EOL, counter.first.c_str(), counter.second);
+    }
+}
+
+static void PrintUsage()
+{
+    printf("Usage: cherrySim_bench [--benchmark_filter=<regex>] [--benchmark_out=<file.json>] [--benchmark_list_tests] [--no_phase_timings]" EOL);
+}
+
+int main(int argc, char **argv)
+{
+    std::regex filter(".*");
+    std::string outPath;
+    bool listOnly = false;
+    bool measurePhases = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg.rfind("--benchmark_filter=", 0) == 0)
+        {
+            filter = std::regex(arg.substr(strlen("--benchmark_filter=")));
+        }
+        else if (arg.rfind("--benchmark_out=", 0) == 0)
+        {
+            outPath = arg.substr(strlen("--benchmark_out="));
+        }
+        else if (arg == "--benchmark_list_tests")
+        {
+            listOnly = true;
+        }
+        else if (arg == "--no_phase_timings")
+        {
+            measurePhases = false;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    bool didError = false;
+    for (const auto& registration : CherrySimBench::GetRegistrations())
+    {
+        std::vector<u32> arguments = registration->arguments;
+        if (arguments.empty()) arguments.push_back(0);
+
+        for (u32 argument : arguments)
+        {
+            BenchResult result;
+            result.name = registration->name + "/" + std::to_string(argument);
+            result.argument = argument;
+            if (!std::regex_search(result.name, filter)) continue;
+            if (listOnly)
+            {
+                printf("%s" EOL, result.name.c_str());
+                continue;
+            }
+
+            result.state = BenchState(argument);
+            result.state.measurePhases = measurePhases;
+            try
+            {
+                registration->function(result.state);
+                if (result.state.wallSeconds <= 0) result.error = "Benchmark did not measure anything";
+            }
+            catch (const FruityMeshException& e)
+            {
+                result.error = typeid(e).name();
+            }
+            catch (const std::exception& e)
+            {
+                result.error = e.what();
+            }
+            if (!result.error.empty()) didError = true;
+
+            PrintResult(result);
+            results.push_back(result);
+        }
+    }
+
+    if (!outPath.empty() && !listOnly)
+    {
+        nlohmann::json out;
+        char date[32] = {};
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        out["context"]["date"] = date;
+        out["context"]["executable"] = argv[0];
+        out["context"]["phaseTimings"] = measurePhases;
+        out["benchmarks"] = nlohmann::json::array();
+        for (const BenchResult& result : results)
+        {
+            out["benchmarks"].push_back(BenchResultToJson(result));
+        }
+
+        std::ofstream file(outPath);
+        if (!file)
+        {
+            printf("Could not write %s" EOL, outPath.c_str());
+            return 1;
+        }
+        file << out.dump(4) << std::endl;
+    }
+
+    return didError ? 1 : 0;
+}
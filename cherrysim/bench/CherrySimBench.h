@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <CherrySimTester.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/***
+A small benchmark harness in the style of Google Benchmark that runs standard mesh scenarios on top of the
+CherrySimTester. A scenario sets up its simulation (e.g. waits for the clustering) and only the part between
+StartMeasurement and StopMeasurement is reported: the simulated time per wall clock second, the peak resident
+set size and the time spent in the phases of CherrySim::SimulateStepForAllNodes.
+*/
+
+class BenchState
+{
+private:
+    u32 argument;
+    CherrySim* measuredSim = nullptr;
+    u32 startSimTimeMs = 0;
+    std::chrono::steady_clock::time_point startWallTime;
+
+public:
+    bool measurePhases = true;
+
+    u32 simulatedMs = 0;
+    double wallSeconds = 0;
+    uint64_t peakRssBytes = 0;
+    SimPhaseTimings phaseTimings;
+    std::map<std::string, double> counters;
+
+    explicit BenchState(u32 argument);
+
+    //The argument the benchmark was registered with, e.g. the amount of nodes
+    u32 GetArgument() const;
+
+    //Everything that is simulated between these two calls is reported, only one measurement per benchmark is possible
+    void StartMeasurement(CherrySimTester& tester);
+    void StopMeasurement();
+
+    //Adds a scenario specific value to the report, e.g. the amount of delivered packets
+    void SetCounter(const std::string& name, double value);
+};
+
+typedef void (*BenchFunction)(BenchState& state);
+
+class BenchRegistration
+{
+public:
+    const std::string name;
+    const BenchFunction function;
+    std::vector<u32> arguments;
+
+    BenchRegistration(const char* name, BenchFunction function);
+
+    //Runs the benchmark once more with the given argument, returns itself so that calls can be chained
+    BenchRegistration* Arg(u32 argument);
+};
+
+namespace CherrySimBench
+{
+    BenchRegistration* RegisterBenchmark(const char* name, BenchFunction function);
+    const std::vector<std::unique_ptr<BenchRegistration>>& GetRegistrations();
+
+    //The highest resident set size of the process since the last call to ResetPeakRss, 0 if unknown
+    uint64_t GetPeakRssBytes();
+    //Only supported on Linux, elsewhere the peak is measured since the start of the process
+    void ResetPeakRss();
+}
+
+#define CHERRYSIM_BENCH_CONCAT_INNER(a, b) a##b
+#define CHERRYSIM_BENCH_CONCAT(a, b) CHERRYSIM_BENCH_CONCAT_INNER(a, b)
+
+//Registers a function as a benchmark, use ->Arg(x) to run it with different arguments
+#define CHERRYSIM_BENCHMARK(function) static BenchRegistration* CHERRYSIM_BENCH_CONCAT(benchRegistration, __LINE__) = CherrySimBench::RegisterBenchmark(#function, function)
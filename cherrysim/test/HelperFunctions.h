@@ -33,6 +33,7 @@
 #include "gtest/gtest.h"
 
 #include <Exceptions.h>
+#include <CherrySimTester.h>
 
 #ifndef GITHUB_RELEASE
 #include <AutoSenseModule.h>
@@ -60,6 +61,16 @@ void RetryOrFail(int maxRetries, SetupFn setupFn, ActionFn actionFn)
     ASSERT_LT(retry, maxRetries);
 }
 
+//Configuration of a mesh with one sink (node 1) and the given amount of mesh nodes in perfect conditions.
+inline SimConfiguration CreateSinkMeshSimConfiguration(u32 amountOfMeshNodes)
+{
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.SetToPerfectConditions();
+    simConfig.nodeConfigName.insert({ "github_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "github_mesh_nrf52", (int)amountOfMeshNodes });
+    return simConfig;
+}
+
 #ifndef GITHUB_RELEASE
 struct AutoSenseTableEntryBuilder
 {
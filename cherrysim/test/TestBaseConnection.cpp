@@ -30,6 +30,8 @@
 #include "gtest/gtest.h"
 #include <CherrySimTester.h>
 #include <CherrySimUtils.h>
+#include <HelperFunctions.h>
+#include <MeshConnection.h>
 
 
 TEST(TestBaseConnection, TestSimpleTransmissions) {
@@ -66,4 +68,54 @@ TEST(TestBaseConnection, TestSimpleTransmissions) {
 
     //We wait until they are connected again
     tester.SimulateUntilClusteringDone(10 * 1000);
-}
\ No newline at end of file
+}
+
+TEST(TestBaseConnection, TestLoadChunkAccountingIsPerConnection)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(1));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    {
+        NodeIndexSetter setter(0);
+        MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+        ASSERT_EQ(connections.count, 1);
+        MeshConnection* conn = connections.handles[0].GetConnection();
+
+        //The connection interval must be the one that the simulated SoftDevice uses for this connection
+        bool foundSoftdeviceConnection = false;
+        for (const SoftdeviceConnection& sdConnection : tester.sim->nodes[0].state.connections)
+        {
+            if (sdConnection.connectionActive && sdConnection.connectionHandle == conn->connectionHandle)
+            {
+                ASSERT_EQ(conn->GetConnectionIntervalMs(), (u32)sdConnection.connectionInterval);
+                foundSoftdeviceConnection = true;
+            }
+        }
+        ASSERT_TRUE(foundSoftdeviceConnection);
+
+        //The first write starts no interval as the packet was never sent, the second starts one and the third
+        //is written within it in the same direction as before, which is counted as a collision
+        ConnPacketModule packet;
+        CheckedMemset(&packet, 0, sizeof(packet));
+        packet.actionType = 5; //GENERATE_LOAD_CHUNK
+        for (int i = 0; i < 3; i++)
+        {
+            conn->AccountLoadChunkWrite(&packet);
+        }
+        ASSERT_EQ(conn->GetLoadChunkCounters().sentPackets, 3u);
+        ASSERT_EQ(conn->GetLoadChunkCounters().sameIntervalPackets, 1u);
+        ASSERT_EQ(conn->GetLoadChunkCounters().directionCollisions, 1u);
+        ASSERT_EQ(GS->loadChunkCounters.sentPackets, 3u);
+        ASSERT_EQ(packet.sendtime, packet.packetSendTime);
+    }
+
+    //The other node must not be influenced by the writes of the first one
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_EQ(GS->loadChunkCounters.sentPackets, 0u);
+        MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+        ASSERT_EQ(connections.count, 1);
+        ASSERT_EQ(connections.handles[0].GetConnection()->GetLoadChunkCounters().sentPackets, 0u);
+    }
+}
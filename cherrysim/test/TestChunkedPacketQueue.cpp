@@ -225,3 +225,99 @@ TEST(TestChunkedPacketQueue, TestSimpleAllocations)
         }
     }
 }
+
+TEST(TestChunkedPacketQueue, TestCursorMatchesRandomAccessPeek)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    simConfig.SetToPerfectConditions();
+    //testerConfig.verbose = true;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    // The queues take their chunks from the node like the queues of a connection would, no
+    // connection is necessary for that. We won't simulate another step while they exist.
+    NodeIndexSetter setter(0);
+    ChunkedPriorityPacketQueue priorityQueue;
+    ChunkedPacketQueue& queue = *priorityQueue.GetQueueByPriority(DeliveryPriority::HIGH);
+
+    std::array<u8, MAX_MESH_PACKET_SIZE + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED> data;
+    MersenneTwister mt(2);
+
+    for (int repeat = 0; repeat < 3000; repeat++)
+    {
+        const u32 dice = mt.NextU32() % 8;
+        if (dice < 3 || !queue.HasPackets())
+        {
+            for (size_t i = 0; i < data.size(); i++) data[i] = (u8)mt.NextU32();
+            u32 messageHandle;
+            if (dice == 0)
+            {
+                // Splits are queued with the smaller, non extended header.
+                queue.SplitAndAddMessage(data.data(), mt.NextU32() % (MAX_MESH_PACKET_SIZE - 1) + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED + 1, 20, &messageHandle);
+            }
+            else
+            {
+                queue.AddMessage(data.data(), mt.NextU32() % MAX_MESH_PACKET_SIZE + 1, &messageHandle);
+            }
+        }
+        else if (dice < 5)
+        {
+            queue.PopPacket();
+        }
+        else if (dice < 7)
+        {
+            if (queue.HasMoreToLookAhead()) queue.IncrementLookAhead();
+        }
+        else
+        {
+            queue.RollbackLookAhead();
+        }
+
+        u32 amountOfVisitedEntries = 0;
+        for (ChunkedPacketQueue::Cursor cursor = queue.GetCursor(); cursor.IsValid(); cursor.Next())
+        {
+            const u16 index = (u16)cursor.GetIndex();
+            ASSERT_EQ(index, amountOfVisitedEntries);
+            amountOfVisitedEntries++;
+
+            u8 expected[1024];
+            u32 expectedHandle = 0;
+            const u16 expectedSize = queue.RandomAccessPeek(expected, sizeof(expected), index, &expectedHandle);
+            const ChunkedPacketQueue::EntryView entry = cursor.Get();
+            ASSERT_EQ(entry.size, expectedSize);
+            ASSERT_EQ(entry.firstPartSize + entry.secondPartSize, expectedSize);
+            ASSERT_EQ(entry.messageHandle, expectedHandle);
+            ASSERT_EQ(cursor.IsLookedAhead(), queue.IsRandomAccessIndexLookedAhead(index));
+
+            u8 actual[1024];
+            ASSERT_EQ(entry.CopyTo(actual, sizeof(actual)), expectedSize);
+            ASSERT_EQ(0, memcmp(actual, expected, expectedSize));
+
+            // Partial copies that start inside the entry.
+            const u16 offset = (u16)(mt.NextU32() % expectedSize);
+            ASSERT_EQ(entry.CopyTo(actual, 7, offset), std::min<u16>(7, expectedSize - offset));
+            ASSERT_EQ(0, memcmp(actual, expected + offset, std::min<u16>(7, expectedSize - offset)));
+        }
+        ASSERT_EQ(amountOfVisitedEntries, queue.GetAmountOfPackets());
+    }
+
+    // The cursor of the priority queue visits all priorities in order.
+    u32 messageHandle;
+    priorityQueue.GetQueueByPriority(DeliveryPriority::VITAL)->AddMessage(data.data(), 10, &messageHandle);
+    priorityQueue.GetQueueByPriority(DeliveryPriority::LOW)->AddMessage(data.data(), 10, &messageHandle);
+    u32 amountOfVisitedEntries = 0;
+    u32 amountOfHighEntries = 0;
+    DeliveryPriority lastPriority = DeliveryPriority::VITAL;
+    for (ChunkedPriorityPacketQueue::Cursor cursor = priorityQueue.GetCursor(); cursor.IsValid(); cursor.Next())
+    {
+        ASSERT_GE((u32)cursor.GetPriority(), (u32)lastPriority);
+        lastPriority = cursor.GetPriority();
+        if (cursor.GetPriority() == DeliveryPriority::HIGH) amountOfHighEntries++;
+        amountOfVisitedEntries++;
+    }
+    ASSERT_EQ(amountOfVisitedEntries, priorityQueue.GetAmountOfPackets());
+    ASSERT_EQ(amountOfHighEntries, queue.GetAmountOfPackets());
+}
@@ -30,6 +30,7 @@
 #include "gtest/gtest.h"
 #include <CherrySimTester.h>
 #include <CherrySimUtils.h>
+#include <HelperFunctions.h>
 #include <ConnectionManager.h>
 #include <cmath>
 #include <algorithm>
@@ -195,6 +196,30 @@ TEST(TestClustering, TestClusteringWithManySdBusy) {
     printf("Average clustering time %d seconds" EOL, clusteringTimeTotalMs / clusteringIterations / 1000);
 }
 
+TEST(TestClustering, TestClusteringWithEventDrivenScheduling) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CreateSinkMeshSimConfiguration(9);
+    simConfig.eventDrivenScheduling = true;
+    //testerConfig.verbose = true;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //Nodes must have skipped the steps in which nothing was due on them
+    int64_t idleFrames = 0;
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        idleFrames += tester.sim->nodes[i].idleFrames;
+        ASSERT_EQ(tester.sim->nodes[i].simulatedFrames, tester.sim->nodes[0].simulatedFrames);
+    }
+    ASSERT_GT(idleFrames, 0);
+
+    //Terminal commands and mesh messages must still wake up the nodes
+    tester.SendTerminalCommand(1, "action 10 status get_device_info");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"nodeId\":10,\"type\":\"device_info\"");
+}
+
 TEST(TestClustering, TestMessagesInOrder) {
     // This test makes sure that messages from the same priority (in this case the priority of raw_data_light)
     // are always received in the order in which they were sent, without a message overtaking a previous message.
@@ -1090,6 +1115,83 @@ TEST(TestClustering, TestUnlikelySdBusy) {
 }
 
 
+TEST(TestClustering, TestPositionNodesRandomlyWithTargetDegree)
+{
+    constexpr u32 totalNodes = 300;
+    constexpr u32 mapSizeInMeters = 1000;
+    double range = 0;
+    //Returns the positions in meters, only one simulator can exist at a time
+    const auto placeNodes = [&range](double targetMeanNeighbourDegree, u32 seed) {
+        CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+        SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+        simConfig.seed = seed;
+        simConfig.mapWidthInMeters = mapSizeInMeters;
+        simConfig.mapHeightInMeters = mapSizeInMeters;
+        simConfig.targetMeanNeighbourDegree = targetMeanNeighbourDegree;
+        simConfig.nodeConfigName.insert({ "github_sink_nrf52", 1 });
+        simConfig.nodeConfigName.insert({ "github_mesh_nrf52", totalNodes - 1 });
+        CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+        tester.Start();
+
+        range = tester.sim->GetStableConnectionRangeInMeters();
+        std::vector<std::pair<double, double>> positions;
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            positions.push_back({ (double)tester.sim->nodes[i].x * mapSizeInMeters, (double)tester.sim->nodes[i].y * mapSizeInMeters });
+        }
+        return positions;
+    };
+    const auto getNeighbours = [&range](const std::vector<std::pair<double, double>>& positions) {
+        std::vector<std::vector<u32>> neighbours(positions.size());
+        for (u32 i = 0; i < positions.size(); i++)
+        {
+            for (u32 k = i + 1; k < positions.size(); k++)
+            {
+                const double dx = positions[i].first - positions[k].first;
+                const double dy = positions[i].second - positions[k].second;
+                if (dx * dx + dy * dy > range * range) continue;
+                neighbours[i].push_back(k);
+                neighbours[k].push_back(i);
+            }
+        }
+        return neighbours;
+    };
+    const auto isConnected = [](const std::vector<std::vector<u32>>& neighbours) {
+        std::vector<bool> visited(neighbours.size(), false);
+        std::vector<u32> open = { 0 };
+        visited[0] = true;
+        u32 visitedCount = 1;
+        while (!open.empty())
+        {
+            const u32 current = open.back();
+            open.pop_back();
+            for (u32 other : neighbours[current])
+            {
+                if (visited[other]) continue;
+                visited[other] = true;
+                visitedCount++;
+                open.push_back(other);
+            }
+        }
+        return visitedCount == neighbours.size();
+    };
+
+    //The degree is a bit lower than the target as nodes at the border of the area have fewer neighbours
+    const std::vector<std::pair<double, double>> dense = placeNodes(8.0, 1);
+    const std::vector<std::vector<u32>> denseNeighbours = getNeighbours(dense);
+    double degreeSum = 0;
+    for (const std::vector<u32>& n : denseNeighbours) degreeSum += n.size();
+    ASSERT_NEAR(degreeSum / totalNodes, 8.0, 2.0);
+    ASSERT_TRUE(isConnected(denseNeighbours));
+
+    //Many nodes have to be moved to connect a sparse mesh
+    ASSERT_TRUE(isConnected(getNeighbours(placeNodes(1.5, 1))));
+
+    //The positions only depend on the seed
+    ASSERT_EQ(placeNodes(8.0, 1), dense);
+    ASSERT_NE(placeNodes(8.0, 2), dense);
+}
+
 //TODO: Write a test that checks reestablishing while the mesh is flooded
 
 //This executes all MultiStackFixture Tests with the S130 and S132 stacks
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+#include <HelperFunctions.h>
+#include <ConnectionEventModel.h>
+#include <MeshConnection.h>
+#include <vector>
+
+
+TEST(TestConnectionEventModel, TestConnectionEventModelMatchesReferences)
+{
+    //The model must reproduce the documented throughput of the SoftDevices, including the measurements that were not used for the calibration.
+    //One write more or less per connection event is a difference of more than 1% for all of them.
+    u32 amountOfReferences = 0;
+    u32 amountOfUncalibratedReferences = 0;
+    const ConnectionThroughputReference* references = GetConnectionThroughputReferences(&amountOfReferences);
+    for (u32 i = 0; i < amountOfReferences; i++)
+    {
+        const ConnectionThroughputReference& reference = references[i];
+        ConnectionEventParameters parameters;
+        parameters.connectionIntervalUs = reference.connectionIntervalUs;
+        parameters.eventLengthUs = reference.eventLengthUs;
+        parameters.llDataLength = reference.llDataLength;
+        if (!reference.usedForCalibration) amountOfUncalibratedReferences++;
+
+        const u32 throughput = ComputeConnectionThroughput(parameters, GetConnectionEventCalibration(reference.stackType), reference.attMtu - FruityHal::ATT_HEADER_SIZE);
+        ASSERT_NEAR((double)throughput, (double)reference.bytesPerSecond, reference.bytesPerSecond * 0.01) << i;
+    }
+    ASSERT_GT(amountOfUncalibratedReferences, 0u);
+
+    const ConnectionEventCalibration& calibration = GetConnectionEventCalibration(BleStackType::NRF_SD_132_ANY);
+    ConnectionEventParameters parameters;
+    parameters.connectionIntervalUs = 30000;
+    parameters.eventLengthUs = 10000;
+    parameters.eventExtension = true;
+    parameters.encrypted = true;
+
+    //Without other radio activity, the event is extended up to the interval, which is shared by all connections
+    const u32 single = ComputeConnectionThroughput(parameters, calibration, 20);
+    parameters.activeConnections = 3;
+    ASSERT_EQ(ComputeConnectionEventTimeUs(parameters, calibration), 10000u - calibration.eventEndMarginUs);
+    const u32 shared = ComputeConnectionThroughput(parameters, calibration, 20);
+    ASSERT_LT(shared * 2, single);
+
+    //Scanning prevents the extension and advertising takes away radio time
+    parameters.activeConnections = 1;
+    parameters.scanning = true;
+    ASSERT_EQ(ComputeConnectionEventTimeUs(parameters, calibration), 10000u - calibration.eventEndMarginUs);
+    parameters.advertisingIntervalMs = 100;
+    ASSERT_LT(ComputeConnectionEventTimeUs(parameters, calibration), 10000u - calibration.eventEndMarginUs);
+
+    //Data length extension transfers large writes in a single PDU
+    ASSERT_EQ(ComputeWritePduCount(60, LL_DEFAULT_DATA_LENGTH), 3u);
+    ASSERT_EQ(ComputeWritePduCount(60, LL_MAX_DATA_LENGTH), 1u);
+    ASSERT_LT(ComputeWriteAirTimeUs(60, LL_MAX_DATA_LENGTH, true), ComputeWriteAirTimeUs(60, LL_DEFAULT_DATA_LENGTH, true));
+
+    //A write is only started if the partner can still answer it with a PDU of the full LL data length
+    parameters.scanning = false;
+    parameters.advertisingIntervalMs = 0;
+    parameters.eventExtension = false;
+    parameters.encrypted = false;
+    parameters.llDataLength = LL_MAX_DATA_LENGTH;
+    parameters.eventLengthUs = calibration.eventEndMarginUs + ComputeWriteAirTimeUs(60, LL_MAX_DATA_LENGTH, false) + ComputeWriteReservedTimeUs(60, LL_MAX_DATA_LENGTH, false);
+    ASSERT_EQ(ComputeWritesPerConnectionEvent(parameters, calibration, 60), 2u);
+    parameters.eventLengthUs--;
+    ASSERT_EQ(ComputeWritesPerConnectionEvent(parameters, calibration, 60), 1u);
+
+    //At least one packet is sent per event, even if it does not fit
+    parameters.eventLengthUs = 0;
+    ASSERT_EQ(ComputeWritesPerConnectionEvent(parameters, calibration, 200), 1u);
+}
+
+TEST(TestConnectionEventModel, TestSimulateConnectionEvents)
+{
+    SimConfiguration simConfig = CreateSinkMeshSimConfiguration(2);
+    simConfig.simulateConnectionEvents = true;
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //The SoftDevice configuration of the firmware is used by the model
+    ASSERT_EQ(tester.sim->nodes[0].state.connectionEventLengthUs, 8 * CONFIG_UNIT_1_25_MS);
+    ASSERT_TRUE(tester.sim->nodes[0].state.connectionEventExtension);
+
+    //Load still arrives completely, the amount is multiplied with the request handle
+    tester.SendTerminalCommand(1, "action 3 node generate_load 1 10 5 1 1");
+    tester.SimulateForGivenTime(10 * 1000);
+    {
+        NodeIndexSetter setter(0);
+        const LoadStatistics::SenderStatistics* statistics = GS->node.GetLoadStatistics().GetSender(3);
+        ASSERT_NE(statistics, nullptr);
+        ASSERT_EQ(statistics->receivedPackets, 5u);
+    }
+
+    //Connection intervals that are shorter than a simulation step result in several events per step
+    {
+        NodeIndexSetter setter(1);
+        SoftdeviceConnection* connection = nullptr;
+        for (SoftdeviceConnection& c : tester.sim->nodes[1].state.connections)
+        {
+            if (c.connectionActive) connection = &c;
+        }
+        ASSERT_NE(connection, nullptr);
+
+        const int connectionInterval = connection->connectionInterval;
+        connection->connectionInterval = 7; //7.5 ms
+        connection->nextConnectionEventUs = (uint64_t)(tester.sim->simState.simTimeMs - 50) * 1000;
+        ASSERT_EQ(tester.sim->GetDueConnectionEvents(connection), 7u);
+        ASSERT_EQ(tester.sim->GetDueConnectionEvents(connection), 0u);
+        ASSERT_EQ(connection->nextConnectionEventUs, (uint64_t)tester.sim->simState.simTimeMs * 1000 + 2500);
+        connection->connectionInterval = connectionInterval;
+    }
+}
+
+TEST(TestConnectionEventModel, TestSimulatedThroughputMatchesReferences)
+{
+    u32 amountOfReferences = 0;
+    const ConnectionThroughputReference* references = GetConnectionThroughputReferences(&amountOfReferences);
+    u32 measuredReferences = 0;
+    for (u32 i = 0; i < amountOfReferences; i++)
+    {
+        const ConnectionThroughputReference& reference = references[i];
+
+        //The ATT MTU can not be changed while packets are queued, so every reference is measured in its own mesh
+        SimConfiguration simConfig = CreateSinkMeshSimConfiguration(1);
+        simConfig.simulateConnectionEvents = true;
+        CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), simConfig);
+        tester.StartWithFeaturesetDeviceTypes();
+        tester.SimulateUntilClusteringDone(100 * 1000);
+
+        NodeEntry* sender = &tester.sim->nodes[1];
+        if (reference.stackType != sender->bleStackType) continue;
+        measuredReferences++;
+
+        //The references were measured without scanning or advertising at the same time
+        {
+            NodeIndexSetter setter(1);
+            GS->node.ChangeState(DiscoveryState::OFF);
+            GS->advertisingController.Deactivate();
+        }
+        tester.SimulateForGivenTime(1000);
+        ASSERT_FALSE(sender->state.scanningActive);
+        ASSERT_FALSE(sender->state.advertisingActive);
+
+        SoftdeviceConnection* connection = nullptr;
+        for (SoftdeviceConnection& c : sender->state.connections)
+        {
+            if (c.connectionActive) connection = &c;
+        }
+        ASSERT_NE(connection, nullptr);
+
+        //Both firmwares split their messages into writes of the ATT MTU of the reference. The firmware does not support
+        //the ATT MTU of the references with data length extension, those are checked with the largest one it supports.
+        const u16 valueLength = (u16)(std::min<u32>(reference.attMtu, NRF_SDH_BLE_GATT_MAX_MTU_SIZE) - FruityHal::ATT_HEADER_SIZE);
+        u32 expectedBytesPerSecond = reference.bytesPerSecond;
+        if (valueLength != reference.attMtu - FruityHal::ATT_HEADER_SIZE)
+        {
+            ConnectionEventParameters parameters;
+            parameters.connectionIntervalUs = reference.connectionIntervalUs;
+            parameters.eventLengthUs = reference.eventLengthUs;
+            parameters.llDataLength = reference.llDataLength;
+            expectedBytesPerSecond = ComputeConnectionThroughput(parameters, GetConnectionEventCalibration(reference.stackType), valueLength);
+        }
+        for (u32 nodeIndex = 0; nodeIndex < 2; nodeIndex++)
+        {
+            NodeIndexSetter setter(nodeIndex);
+            MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+            ASSERT_EQ(connections.count, 1);
+            connections.handles[0].GetConnection()->connectionMtu = valueLength;
+            connections.handles[0].GetConnection()->connectionPayloadSize = valueLength;
+        }
+
+        //The firmware might update the connection parameters, so the conditions of the reference are applied before every step
+        const auto applyReferenceConditions = [&]() {
+            for (SoftdeviceConnection* c : { connection, connection->partnerConnection })
+            {
+                c->connectionInterval = (int)(reference.connectionIntervalUs / 1000);
+                c->connectionMtu = valueLength;
+                c->llDataLength = reference.llDataLength;
+                c->connectionEncrypted = false;
+            }
+            sender->state.connectionEventLengthUs = reference.eventLengthUs;
+            sender->state.connectionEventExtension = false;
+        };
+
+        //Load chunks are sized so that all of their writes are full
+        const u16 splitPayload = valueLength - SIZEOF_CONN_PACKET_SPLIT_HEADER;
+        const u16 chunkLength = (u16)((MAX_MESH_PACKET_SIZE / splitPayload) * splitPayload);
+        std::vector<u8> chunk(chunkLength - SIZEOF_CONN_PACKET_MODULE, 0x91); //generateLoadMagicNumber
+
+        //The battery usage is only known for some connection intervals, which do not include all of the references
+        Exceptions::ExceptionDisabler<IllegalStateException> ise;
+
+        //The firmware keeps the buffers filled as long as there are packets queued,
+        //the throughput is measured once the queues have filled up
+        constexpr u32 measurementSteps = 100;
+        uint64_t sentValueBytesAtStart = 0;
+        for (u32 step = 0; step < measurementSteps * 2; step++)
+        {
+            if (step == measurementSteps) sentValueBytesAtStart = connection->sentValueBytes;
+            applyReferenceConditions();
+            {
+                NodeIndexSetter setter(1);
+                for (u32 k = 0; k < 50 && GS->cm.GetPendingPackets() < 150; k++)
+                {
+                    GS->cm.SendModuleActionMessage(MessageType::MODULE_TRIGGER_ACTION, ModuleId::NODE, 1, 5 /*GENERATE_LOAD_CHUNK*/, 0, chunk.data(), (u16)chunk.size(), false, false);
+                }
+            }
+            tester.SimulateGivenNumberOfSteps(1);
+        }
+
+        const uint64_t measuredBytesPerSecond = (connection->sentValueBytes - sentValueBytesAtStart) * 1000 / (measurementSteps * tester.sim->simConfig.simTickDurationMs);
+        ASSERT_NEAR((double)measuredBytesPerSecond, (double)expectedBytesPerSecond, expectedBytesPerSecond * 0.05) << i;
+
+        //All of the chunks arrive intact at the sink
+        NodeIndexSetter setter(0);
+        const LoadStatistics::SenderStatistics* statistics = GS->node.GetLoadStatistics().GetSender(2);
+        ASSERT_NE(statistics, nullptr);
+        ASSERT_GT(statistics->receivedPackets, 0u);
+        ASSERT_EQ(statistics->corruptedPackets, 0u);
+    }
+    ASSERT_GT(measuredReferences, 0u);
+}
@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+#include <HelperFunctions.h>
+#include <ConnectionManager.h>
+#include <MeshConnection.h>
+
+
+TEST(TestConnectionManager, TestDutyCycleSlots)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(1));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //The sink (node 1) is the root of the tree and node 2 its child
+    {
+        NodeIndexSetter setter(0);
+        ASSERT_EQ(GS->node.depth, 0);
+        GS->cm.StartDutyCycle(100);
+    }
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_EQ(GS->node.depth, 1);
+        ASSERT_EQ(GS->node.parent, 1);
+        GS->cm.StartDutyCycle(100);
+
+        const u32 connectionIntervalUs = Conf::GetInstance().meshMinConnectionInterval * CONFIG_UNIT_1_25_MS;
+        ASSERT_GE(GS->cm.GetDutyCycleSlotLengthUs(), 100u * 1000);
+        ASSERT_EQ(GS->cm.GetDutyCycleSlotLengthUs() % connectionIntervalUs, 0u);
+    }
+
+    //Both partners must agree on the slots in which their connection is enabled, which is every other slot
+    for (u32 slot = 0; slot < 4; slot++)
+    {
+        bool enabledForParent = false;
+        bool enabledForChild = false;
+        {
+            NodeIndexSetter setter(0);
+            enabledForParent = GS->cm.IsEnabledInDutyCycleSlot(2, slot);
+        }
+        {
+            NodeIndexSetter setter(1);
+            enabledForChild = GS->cm.IsEnabledInDutyCycleSlot(1, slot);
+        }
+        ASSERT_EQ(enabledForParent, enabledForChild);
+        ASSERT_EQ(enabledForChild, slot % 2 == 1);
+    }
+
+    //The connection follows the slots and packets that are sent during a disabled slot are kept in the queue
+    u32 disabledSteps = 0;
+    u32 enabledSteps = 0;
+    for (int step = 0; step < 10000 && (disabledSteps < 10 || enabledSteps < 10); step++)
+    {
+        tester.SimulateGivenNumberOfSteps(1);
+
+        NodeIndexSetter setter(1);
+        MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+        ASSERT_EQ(connections.count, 1);
+        MeshConnection* conn = connections.handles[0].GetConnection();
+        if (GS->cm.IsEnabledInDutyCycleSlot(conn->partnerId, GS->cm.dutyCycleSlot))
+        {
+            ASSERT_EQ(conn->connectionState, ConnectionState::HANDSHAKE_DONE);
+            enabledSteps++;
+        }
+        else
+        {
+            ASSERT_EQ(conn->connectionState, ConnectionState::DISABLED);
+            GS->cm.SendModuleActionMessage(MessageType::MODULE_TRIGGER_ACTION, ModuleId::NODE, 1, 8 /*GET_TIME*/, 0, nullptr, 0, false, false);
+            ASSERT_GT(conn->GetPendingPackets(), 0u);
+            disabledSteps++;
+        }
+    }
+    ASSERT_GE(disabledSteps, 10u);
+    ASSERT_GE(enabledSteps, 10u);
+
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_GT(GS->cm.dutyCycleCompletedSlots, 0u);
+        ASSERT_GE(GS->cm.dutyCycleTotalCounters.queuedPackets + GS->cm.dutyCycleSlotCounters.queuedPackets, disabledSteps);
+        ASSERT_GT(GS->cm.dutyCycleTotalCounters.sentPackets, 0u);
+        ASSERT_EQ(GS->cm.dutyCycleTotalCounters.droppedPackets, 0u);
+        GS->cm.StopDutyCycle();
+    }
+    {
+        NodeIndexSetter setter(0);
+        GS->cm.StopDutyCycle();
+    }
+
+    //After stopping, everything that was queued is sent
+    tester.SimulateForGivenTime(1000);
+    for (u32 i = 0; i < 2; i++)
+    {
+        NodeIndexSetter setter(i);
+        MeshConnections connections = GS->cm.GetMeshConnections(ConnectionDirection::INVALID);
+        ASSERT_EQ(connections.count, 1);
+        ASSERT_EQ(connections.handles[0].GetConnection()->connectionState, ConnectionState::HANDSHAKE_DONE);
+        ASSERT_EQ(connections.handles[0].GetConnection()->GetPendingPackets(), 0u);
+    }
+}
+
+TEST(TestConnectionManager, TestLoadAggregation)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(3));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SimulateForGivenTime(5 * 1000);
+
+    //Chunks of three different senders are forwarded by node 2 on their way to the sink
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_GT(GS->node.depth, 0);
+        LoadAggregator& aggregator = GS->cm.loadAggregator;
+
+        u8 buffer[SIZEOF_CONN_PACKET_MODULE + 10];
+        CheckedMemset(buffer, 0x91, sizeof(buffer)); //generateLoadMagicNumber
+        ConnPacketModule* packet = (ConnPacketModule*)buffer;
+        packet->header.messageType = MessageType::MODULE_TRIGGER_ACTION;
+        packet->header.receiver = 1;
+        packet->moduleId = ModuleId::NODE;
+        packet->actionType = 5; //GENERATE_LOAD_CHUNK
+        packet->timestamp = GS->delaytimer;
+
+        //Nothing is taken over as long as aggregation is disabled
+        ASSERT_FALSE(aggregator.TakeOver(&packet->header, sizeof(buffer)));
+
+        aggregator.enabled = true;
+        aggregator.flushDeadlineMs = 1000;
+        for (NodeId sender = 7; sender <= 9; sender++)
+        {
+            packet->header.sender = sender;
+            ASSERT_TRUE(aggregator.TakeOver(&packet->header, sizeof(buffer)));
+        }
+        ASSERT_TRUE(aggregator.IsPending());
+        ASSERT_EQ(aggregator.aggregatedChunks, 3u);
+
+        //Other actions are routed as usual
+        packet->actionType = 6;
+        ASSERT_FALSE(aggregator.TakeOver(&packet->header, sizeof(buffer)));
+    }
+
+    //The aggregate is sent once the flush deadline has passed
+    tester.SimulateForGivenTime(3 * 1000);
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_FALSE(GS->cm.loadAggregator.IsPending());
+        ASSERT_GE(GS->cm.loadAggregator.sentAggregates, 1u);
+    }
+
+    //The sink unpacks every chunk with the timestamp of its sender, all of them were generated at the same time
+    {
+        NodeIndexSetter setter(0);
+        const u32 delayMs = GS->node.GetLoadStatistics().GetSummary(7).maxDelayMs;
+        for (NodeId sender = 7; sender <= 9; sender++)
+        {
+            const LoadStatistics::SenderStatistics* statistics = GS->node.GetLoadStatistics().GetSender(sender);
+            ASSERT_NE(statistics, nullptr);
+            ASSERT_EQ(statistics->receivedPackets, 1u);
+            ASSERT_EQ(statistics->corruptedPackets, 0u);
+            ASSERT_EQ(statistics->maxDelayMs, delayMs);
+        }
+    }
+
+    //Load that is generated with aggregation enabled on all nodes must still arrive completely
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        NodeIndexSetter setter(i);
+        GS->cm.loadAggregator.enabled = true;
+        GS->cm.loadAggregator.flushDeadlineMs = 100;
+    }
+    //The amount is multiplied with the request handle
+    tester.SendTerminalCommand(1, "action 4 node generate_load 1 10 5 1 1");
+    tester.SimulateForGivenTime(10 * 1000);
+    {
+        NodeIndexSetter setter(0);
+        const LoadStatistics::SenderStatistics* statistics = GS->node.GetLoadStatistics().GetSender(4);
+        ASSERT_NE(statistics, nullptr);
+        ASSERT_EQ(statistics->receivedPackets, 5u);
+    }
+}
+
+TEST(TestConnectionManager, TestLoadAggregateOfHighSenderIds)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(1));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SimulateForGivenTime(5 * 1000);
+
+    //The high byte of the first sender is at the offset of the actionType of a ConnPacketModule. With a
+    //value of 5 (GENERATE_LOAD_CHUNK), the aggregate must still not be accounted as a load chunk.
+    constexpr NodeId firstSender = 1280 + 7;
+    u32 sentLoadChunks = 0;
+    {
+        NodeIndexSetter setter(1);
+        LoadAggregator& aggregator = GS->cm.loadAggregator;
+        aggregator.enabled = true;
+        aggregator.flushDeadlineMs = 1000;
+
+        u8 buffer[SIZEOF_CONN_PACKET_MODULE + 10];
+        CheckedMemset(buffer, 0x91, sizeof(buffer)); //generateLoadMagicNumber
+        ConnPacketModule* packet = (ConnPacketModule*)buffer;
+        packet->header.messageType = MessageType::MODULE_TRIGGER_ACTION;
+        packet->header.receiver = 1;
+        packet->moduleId = ModuleId::NODE;
+        packet->actionType = 5; //GENERATE_LOAD_CHUNK
+        packet->timestamp = GS->delaytimer;
+        for (NodeId sender = firstSender; sender < firstSender + 3; sender++)
+        {
+            packet->header.sender = sender;
+            ASSERT_TRUE(aggregator.TakeOver(&packet->header, sizeof(buffer)));
+        }
+        sentLoadChunks = GS->loadChunkCounters.sentPackets;
+    }
+
+    tester.SimulateForGivenTime(3 * 1000);
+    {
+        NodeIndexSetter setter(1);
+        ASSERT_GE(GS->cm.loadAggregator.sentAggregates, 1u);
+        ASSERT_EQ(GS->loadChunkCounters.sentPackets, sentLoadChunks);
+    }
+    {
+        NodeIndexSetter setter(0);
+        for (NodeId sender = firstSender; sender < firstSender + 3; sender++)
+        {
+            const LoadStatistics::SenderStatistics* statistics = GS->node.GetLoadStatistics().GetSender(sender);
+            ASSERT_NE(statistics, nullptr);
+            ASSERT_EQ(statistics->receivedPackets, 1u);
+            ASSERT_EQ(statistics->corruptedPackets, 0u);
+        }
+    }
+}
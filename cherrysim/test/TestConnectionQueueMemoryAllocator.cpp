@@ -124,7 +124,7 @@ TEST(TestConnectionQueueMemoryAllocator, TestSimpleAllocations) {
 
 static std::array<u8, CONNECTION_QUEUE_MEMORY_CHUNK_SIZE> GenerateUniqueChunkData(ConnectionQueueMemoryChunk* chunk)
 {
-    MersenneTwister chunkFingerprint((uint32_t)chunk); //Using the chunk memory address as seed to generate unique chunk data.
+    MersenneTwister chunkFingerprint((uint32_t)(uintptr_t)chunk); //Using the chunk memory address as seed to generate unique chunk data.
 
     std::array<u8, CONNECTION_QUEUE_MEMORY_CHUNK_SIZE> retVal;
     for (u32 i = 0; i < CONNECTION_QUEUE_MEMORY_CHUNK_SIZE; i++)
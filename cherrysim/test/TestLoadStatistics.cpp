@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "LoadStatistics.h"
+#include <memory>
+
+TEST(TestLoadStatistics, TestSummariesAndGrowingSenderTable)
+{
+    std::unique_ptr<LoadStatistics> statistics = std::make_unique<LoadStatistics>();
+
+    for (u32 delayMs = 1; delayMs <= 100; delayMs++)
+    {
+        statistics->RecordReceivedPacket(7, delayMs, true);
+    }
+    statistics->RecordReceivedPacket(7, 5000, false);
+    statistics->RecordSentPackets(7, 110);
+    statistics->RecordReceivedPacket(1500, 20, true);
+
+    const LoadStatistics::Summary sender = statistics->GetSummary(7);
+    ASSERT_EQ(sender.senders, 1u);
+    ASSERT_EQ(sender.receivedPackets, 100u);
+    ASSERT_EQ(sender.corruptedPackets, 1u);
+    ASSERT_EQ(sender.sentPackets, 110u);
+    ASSERT_EQ(sender.minDelayMs, 1u);
+    ASSERT_EQ(sender.maxDelayMs, 100u);
+    ASSERT_EQ(sender.averageDelayMs, 50u);
+    //Percentiles are taken from the histogram and must be within its precision of 25%
+    ASSERT_GE(sender.medianDelayMs, 50u);
+    ASSERT_LE(sender.medianDelayMs, 62u);
+    ASSERT_GE(sender.p99DelayMs, 99u);
+    ASSERT_LE(sender.p99DelayMs, 100u);
+
+    const LoadStatistics::Summary all = statistics->GetSummary(NODE_ID_BROADCAST);
+    ASSERT_EQ(all.senders, 2u);
+    ASSERT_EQ(all.receivedPackets, 101u);
+    ASSERT_EQ(statistics->GetSender(1500)->receivedPackets, 1u);
+    ASSERT_EQ(statistics->GetSender(8), nullptr);
+
+    //The table grows beyond the amount of senders it was reset for without losing the tracked ones
+    statistics->Reset(2);
+    statistics->RecordReceivedPacket(7, 10, true);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        statistics->RecordSentPackets((NodeId)(2000 + i * 3), 1);
+    }
+    ASSERT_EQ(statistics->GetAmountOfSenders(), 1001u);
+    ASSERT_EQ(statistics->GetSummary(7).receivedPackets, 1u);
+    ASSERT_EQ(statistics->GetSummary(NODE_ID_BROADCAST).sentPackets, 1000u);
+    ASSERT_EQ(statistics->GetSender(2000 + 999 * 3)->sentPackets, 1u);
+
+    //More packets than fit into a u16 must still be ranked correctly
+    statistics->Reset(1);
+    for (u32 i = 0; i < 70000; i++) statistics->RecordReceivedPacket(7, 1, true);
+    for (u32 i = 0; i < 1000; i++) statistics->RecordReceivedPacket(7, 100, true);
+    for (u32 i = 0; i < 10; i++) statistics->RecordReceivedPacket(7, 1000, true);
+    ASSERT_EQ(statistics->GetSummary(7).medianDelayMs, 1u);
+    ASSERT_GE(statistics->GetSummary(7).p99DelayMs, 100u);
+    ASSERT_LE(statistics->GetSummary(7).p99DelayMs, 125u);
+
+    statistics->Reset(0);
+    ASSERT_EQ(statistics->GetAmountOfSenders(), 0u);
+    ASSERT_EQ(statistics->GetSummary(NODE_ID_BROADCAST).receivedPackets, 0u);
+}
@@ -58,6 +58,99 @@ TEST(TestLogger, TestTags) {
     ASSERT_FALSE(Logger::GetInstance().IsTagEnabled(tag));
 }
 
+static_assert(Logger::GetTagId("") == 2166136261UL, "FNV-1a offset basis");
+static_assert(Logger::GetTagId("ERROR") != Logger::GetTagId("WARNING"), "Tag ids must differ");
+static_assert(LOG_TAG_ID("ERROR") == Logger::GetTagId("ERROR"), "logt hashes literal tags at compile time");
+static_assert(LOG_TAG_ID("WARNING") == Logger::GetTagId("WARNING"), "ERROR and WARNING pass the collision check");
+static_assert(Logger::AreTagsEqual("ERROR", "ERROR") && !Logger::AreTagsEqual("ERROR", "ERRORS") && !Logger::AreTagsEqual("ERRORS", "ERROR"), "Tags are compared by name");
+
+TEST(TestLogger, TestTagsWithCollidingBits) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.nodeConfigName.insert( { "prod_mesh_nrf52", 2 } );
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    NodeIndexSetter setter(0);
+    Logger& logger = Logger::GetInstance();
+    logger.DisableAll();
+
+    //ERROR and WARNING are always enabled, even if every other tag was disabled
+    ASSERT_TRUE(logger.IsTagEnabled("ERROR"));
+    ASSERT_TRUE(logger.IsTagEnabled("WARNING"));
+
+    const char* tag = "TEST123";
+    logger.EnableTag(tag);
+    ASSERT_TRUE(logger.IsTagEnabled(tag));
+    ASSERT_TRUE(logger.IsTagEnabled(tag, Logger::GetTagId(tag)));
+
+    //Find another tag that maps to the same bit, it must not be reported as enabled
+    std::string collidingTag;
+    for (u32 i = 0; collidingTag.empty(); i++)
+    {
+        std::string candidate = "T" + std::to_string(i);
+        if (candidate != tag && Logger::GetTagId(candidate.c_str()) % LOG_TAG_BITSET_SIZE == Logger::GetTagId(tag) % LOG_TAG_BITSET_SIZE)
+        {
+            collidingTag = candidate;
+        }
+    }
+    ASSERT_FALSE(logger.IsTagEnabled(collidingTag.c_str()));
+
+    //A wrong id must not match even if the name does
+    ASSERT_FALSE(logger.IsTagEnabled(tag, Logger::GetTagId(tag) + LOG_TAG_BITSET_SIZE));
+
+    logger.EnableTag(collidingTag.c_str());
+    ASSERT_TRUE(logger.IsTagEnabled(collidingTag.c_str()));
+    logger.DisableTag(tag);
+    ASSERT_FALSE(logger.IsTagEnabled(tag));
+    ASSERT_TRUE(logger.IsTagEnabled(collidingTag.c_str()));
+
+    logger.DisableAll();
+    ASSERT_FALSE(logger.IsTagEnabled(collidingTag.c_str()));
+    ASSERT_TRUE(logger.IsTagEnabled("ERROR"));
+}
+
+TEST(TestLogger, TestLogtEnabledSkipsFormatting) {
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.nodeConfigName.insert( { "prod_mesh_nrf52", 2 } );
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    NodeIndexSetter setter(0);
+    Logger& logger = Logger::GetInstance();
+    logger.DisableAll();
+
+    u32 formattedLogs = 0;
+    const auto logWithHex = [&formattedLogs]() {
+        if (LOGT_ENABLED("TEST123"))
+        {
+            formattedLogs++;
+            const u8 data[] = { 0x12, 0x34 };
+            TO_HEX(data, sizeof(data));
+            logt("TEST123", "Data %s", dataHex);
+        }
+    };
+
+    logWithHex();
+    ASSERT_EQ(formattedLogs, 0);
+
+    logger.EnableTag("TEST123");
+    logWithHex();
+    ASSERT_EQ(formattedLogs, 1);
+
+    logger.DisableTag("TEST123");
+    logger.logEverything = true;
+    logWithHex();
+    ASSERT_EQ(formattedLogs, 2);
+    logger.logEverything = false;
+
+    //ERRORs are checked by the simulator even if nothing is printed
+    ASSERT_TRUE(LOGT_ENABLED("ERROR"));
+}
+
 TEST(TestLogger, TestParseHexStringToBuffer) 
 {
     {
@@ -1370,3 +1370,72 @@ TEST(TestNode, TestConnectionParameterUpdateRequestedByPeripheral)
         peripheralConnection->connectionInterval
     );
 }
+
+TEST(TestNode, TestMultiGenerateLoadStatistics)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(3));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //All other nodes of the cluster send 2 chunks to the sink, which does not send load itself
+    tester.SendTerminalCommand(1, "action this node multi_generate_load 10 2 1");
+    tester.SimulateForGivenTime(10 * 1000);
+    {
+        NodeIndexSetter setter(0);
+        const LoadStatistics& statistics = GS->node.GetLoadStatistics();
+        ASSERT_EQ(statistics.GetAmountOfSenders(), 3u);
+        ASSERT_EQ(statistics.GetSender(1), nullptr);
+        for (NodeId sender = 2; sender <= 4; sender++)
+        {
+            ASSERT_NE(statistics.GetSender(sender), nullptr);
+            ASSERT_EQ(statistics.GetSender(sender)->receivedPackets, 2u);
+        }
+    }
+
+    tester.SendTerminalCommand(1, "action this node result");
+    tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"load_statistics_result\",\"nodeId\":1,\"sender\":0,\"senders\":3,");
+}
+
+TEST(TestNode, TestTreePositionFollowsTopology)
+{
+    CherrySimTester tester = CherrySimTester(CherrySimTester::CreateDefaultTesterConfiguration(), CreateSinkMeshSimConfiguration(4));
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    //Cluster info updates with the hops to the sink might still be on their way
+    tester.SimulateForGivenTime(5 * 1000);
+
+    //Every node must be one hop deeper than its parent, the sink is the root
+    const auto checkTree = [&tester]() {
+        for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+        {
+            NodeIndexSetter setter(i);
+            if (GET_DEVICE_TYPE() == DeviceType::SINK)
+            {
+                ASSERT_EQ(GS->node.depth, 0);
+                ASSERT_EQ(GS->node.parent, NODE_ID_INVALID);
+                continue;
+            }
+            ASSERT_GT(GS->node.depth, 0);
+            const NodeId parent = GS->node.parent;
+            const ClusterSize depth = GS->node.depth;
+            ASSERT_TRUE(GS->cm.GetMeshConnectionToPartner(parent));
+
+            NodeIndexSetter parentSetter(tester.sim->FindNodeById(parent)->index);
+            ASSERT_EQ(GS->node.depth, depth - 1);
+        }
+    };
+    checkTree();
+
+    //A node that loses all of its connections immediately knows that it has no parent anymore
+    {
+        NodeIndexSetter setter(1);
+        GS->cm.ForceDisconnectAllConnections(AppDisconnectReason::USER_REQUEST);
+        ASSERT_EQ(GS->node.parent, NODE_ID_INVALID);
+        ASSERT_EQ(GS->node.depth, -1);
+    }
+
+    //After the network has healed, the tree must be consistent again
+    tester.SimulateUntilClusteringDone(100 * 1000);
+    tester.SimulateForGivenTime(5 * 1000);
+    checkTree();
+}
@@ -43,6 +43,11 @@
 #include "SimpleQueue.h"
 #include "DebugModule.h"
 #include "PathLossModel.h"
+#include "SpatialGrid.h"
+#include "ReceptionKernel.h"
+#include "FlashFileFormat.h"
+#include "MultiPatternMatcher.h"
+#include <memory>
 
 extern "C"{
 #include <ccm_soft.h>
@@ -383,6 +388,9 @@ TEST(TestOther, TestJsonConfigSerialization)
     simConfig->perfectReceptionProbabilityForConnection = true;
     simConfig->verboseCommands = true;
     simConfig->simulateAdvertisingIndexStep = 32;
+    simConfig->eventDrivenScheduling = true;
+    simConfig->simulateConnectionEvents = true;
+    simConfig->targetMeanNeighbourDegree = 6.5;
 
     simConfig->disableNonCriticalExceptions = true;
     new (&simConfig->floorplanImage) std::string;
@@ -394,9 +402,10 @@ TEST(TestOther, TestJsonConfigSerialization)
     for (size_t i = 0; i < sizeof(memoryArea) / sizeof(*memoryArea); i++)
     {
 #define myOffsetOf(x, y) ((size_t)((char*)(&(x->y)) - (char*)((x))))
-#define IsInSTLRange(x) (byteIndex >= myOffsetOf(simConfig, x) && byteIndex < myOffsetOf(simConfig, x) + sizeof(SimConfiguration::x))
+#define IsInSTLRange(x) (byteIndex + alignof(decltype(SimConfiguration::x)) >= myOffsetOf(simConfig, x) + sizeof(u32) && byteIndex < myOffsetOf(simConfig, x) + sizeof(SimConfiguration::x))
         const size_t byteIndex = i * sizeof(u32);
         //The byte is ignored if it's in the range of an STL type as those are allowed to have uninitialized memory.
+        //In 64 bit builds, this includes the padding in front of them as they are 8 byte aligned.
 
         if(IsInSTLRange(siteJsonPath)
             || IsInSTLRange(devicesJsonPath)
@@ -464,6 +473,9 @@ TEST(TestOther, TestJsonConfigSerialization)
     ASSERT_EQ(copy.perfectReceptionProbabilityForConnection, true);
     ASSERT_EQ(copy.verboseCommands, true);
     ASSERT_EQ(copy.simulateAdvertisingIndexStep, 32);
+    ASSERT_EQ(copy.eventDrivenScheduling, true);
+    ASSERT_EQ(copy.simulateConnectionEvents, true);
+    ASSERT_NEAR(copy.targetMeanNeighbourDegree, 6.5, 0.01);
 
 
     ASSERT_EQ(copy.disableNonCriticalExceptions, true);
@@ -795,7 +807,7 @@ TEST(TestOther, TestGattcEvtTimeoutReporting) {
     s.bleEvent.evt.gattc_evt.conn_handle = conn->connectionHandle;
     //s.bleEvent.evt.gattc_evt.gatt_status = ?
     s.bleEvent.evt.gattc_evt.params.timeout.src = BLE_GATT_TIMEOUT_SRC_PROTOCOL;
-    tester.sim->nodes[0].eventQueue.push_back(s);
+    tester.sim->nodes[0].eventQueue.Push(s);
 
     //Wait until the live report about the mesh disconnect with the proper disconnect reason is received
     tester.SimulateUntilMessageReceived(10 * 1000, 1, "{\"type\":\"live_report\",\"nodeId\":1,\"module\":3,\"code\":51,\"extra\":2,\"extra2\":31}");
@@ -1299,6 +1311,119 @@ TEST(TestOther, TestNoOfReceivedMsgs) {
     tester.SimulateUntilRegexMessageReceived(10 * 1000, 1, "\\{\"type\":\"error_log_entry\",\"nodeId\":2,\"module\":3,\"errType\":2,\"code\":81,\"extra\":[3-9],\"time\":\\d+");
 }
 
+TEST(TestOther, TestFlashFileFormatRoundTrip)
+{
+    constexpr u32 flashSize = FlashFileFormat::PAGE_SIZE * 8;
+    std::vector<u8> flash(flashSize * 2, 0xFF);
+
+    //Node 0 has a page full of noise and a page with a few records, node 1 only changed its last byte
+    MersenneTwister rng(7);
+    for (u32 i = 0; i < FlashFileFormat::PAGE_SIZE; i++) flash[FlashFileFormat::PAGE_SIZE + i] = (u8)rng.NextU32();
+    for (u32 i = 0; i < 100; i++) flash[3 * FlashFileFormat::PAGE_SIZE + i] = (u8)(i % 3);
+    flash[2 * flashSize - 1] = 0;
+
+    FlashFileFormat::SparseFlash sparseFlash(0, flashSize);
+    sparseFlash.AddNode(flash.data());
+    sparseFlash.AddNode(flash.data() + flashSize);
+
+    //Erased pages are not stored
+    ASSERT_EQ(sparseFlash.amountOfPagesPerNode, std::vector<uint32_t>({ 2, 1 }));
+
+    const std::vector<u8> data = FlashFileFormat::Serialize(sparseFlash);
+    ASSERT_LT(data.size(), 3 * FlashFileFormat::PAGE_SIZE);
+
+    std::vector<u8> restored(flashSize * 2, 0);
+    const u8* cursor = data.data() + sizeof(FlashFileFormat::Header);
+    ASSERT_TRUE(FlashFileFormat::DeserializeNode(cursor, data.data() + data.size(), restored.data(), flashSize));
+    ASSERT_TRUE(FlashFileFormat::DeserializeNode(cursor, data.data() + data.size(), restored.data() + flashSize, flashSize));
+    ASSERT_EQ(cursor, data.data() + data.size());
+    ASSERT_EQ(restored, flash);
+
+    //Truncated files must be detected
+    cursor = data.data() + sizeof(FlashFileFormat::Header);
+    ASSERT_FALSE(FlashFileFormat::DeserializeNode(cursor, data.data() + data.size() / 2, restored.data(), flashSize));
+}
+
+//Returns the state of all nodes that must be the same if two runs of a simulation are identical
+static std::vector<u32> GetComparableNodeStates(CherrySimTester& tester)
+{
+    std::vector<u32> states;
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        const NodeEntry& node = tester.sim->nodes[i];
+        states.push_back(node.gs.node.clusterId);
+        states.push_back((u32)node.gs.node.GetClusterSize());
+        states.push_back(node.gs.appTimerDs);
+        states.push_back(node.state.timeMs);
+        states.push_back(node.eventQueue.GetSize());
+    }
+    return states;
+}
+
+TEST(TestOther, TestSnapshotForksClusteredMesh)
+{
+    Exceptions::DisableDebugBreakOnException ddboe;
+    const char* testFilePath = "TestSnapshotFile.bin";
+    remove(testFilePath);
+
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CreateSinkMeshSimConfiguration(3);
+    simConfig.storeFlashToFile = testFilePath;
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateUntilClusteringDone(100 * 1000);
+
+    //The periodic backups only contain the flash, restoring them as a snapshot must fail
+    tester.sim->StoreFlashToFile();
+    ASSERT_THROW(tester.sim->RestoreSnapshotFromFile(), CorruptOrOutdatedSavefile);
+
+    //The file is written through a temporary file that is renamed once it is complete
+    tester.sim->StoreSnapshotToFile();
+    tester.sim->WaitForFlashFileWrite();
+    ASSERT_TRUE(std::ifstream(testFilePath).good());
+    ASSERT_FALSE(std::ifstream(std::string(testFilePath) + ".tmp").good());
+    //Makes sure that the file is not overwritten by the periodic backup
+    tester.sim->flashToFileWriteCycle = 0;
+
+    const std::vector<u8> snapshot = SimSnapshot::Serialize(tester.sim->CaptureSnapshot());
+    const u32 snapshotTimeMs = tester.sim->simState.simTimeMs;
+    const std::vector<u32> snapshotStates = GetComparableNodeStates(tester);
+
+    //A reset node is clustered again as soon as the file is restored
+    tester.SendTerminalCommand(2, "reset");
+    tester.SimulateForGivenTime(1000);
+    ASSERT_FALSE(tester.sim->IsClusteringDone());
+    tester.sim->RestoreSnapshotFromFile();
+    ASSERT_EQ(tester.sim->simState.simTimeMs, snapshotTimeMs);
+    ASSERT_EQ(GetComparableNodeStates(tester), snapshotStates);
+    ASSERT_TRUE(tester.sim->IsClusteringDone());
+
+    tester.SimulateForGivenTime(10 * 1000);
+    const std::vector<u32> continuedStates = GetComparableNodeStates(tester);
+    const u32 continuedRandom = tester.sim->simState.rnd.NextU32();
+
+    //The fork starts from the clustered mesh and continues exactly like the original run
+    tester.sim->RestoreSnapshot(snapshot);
+    ASSERT_EQ(tester.sim->simState.simTimeMs, snapshotTimeMs);
+    ASSERT_EQ(GetComparableNodeStates(tester), snapshotStates);
+    tester.SimulateForGivenTime(10 * 1000);
+    ASSERT_EQ(GetComparableNodeStates(tester), continuedStates);
+    ASSERT_EQ(tester.sim->simState.rnd.NextU32(), continuedRandom);
+
+    //Errors of the background write are reported once it is waited for
+    tester.sim->simConfig.storeFlashToFile = "NotExistingDirectory/TestSnapshotFile.bin";
+    tester.sim->StoreFlashToFile();
+    ASSERT_THROW(tester.sim->WaitForFlashFileWrite(), FileException);
+    tester.sim->simConfig.storeFlashToFile = testFilePath;
+
+    //A truncated snapshot is rejected instead of restoring a partial RAM image
+    std::vector<u8> truncatedSnapshot = snapshot;
+    truncatedSnapshot.resize(truncatedSnapshot.size() - 1);
+    ASSERT_THROW(tester.sim->RestoreSnapshot(truncatedSnapshot), CorruptOrOutdatedSavefile);
+
+    remove(testFilePath);
+}
+
 #ifndef GITHUB_RELEASE
 TEST(TestOther, TestSimulatorFlashToFileStorage) {
     const char* testFilePath = "TestFlashStorageFile.bin";
@@ -1458,6 +1583,30 @@ TEST(TestOther, TestConnectionSupervisionTimeoutWontDisconnect) {
 }
 #endif //GITHUB_RELEASE
 
+TEST(TestOther, TestSpatialGridReturnsAllNodesInRange)
+{
+    SpatialGrid grid{ 50.0f };
+    grid.Reset(5);
+
+    grid.Update(0, 0.0f, 0.0f, 0.0f);
+    grid.Update(1, 49.0f, 10.0f, 0.0f);
+    grid.Update(2, 99.9f, 0.0f, 0.0f);
+    grid.Update(3, 200.0f, 0.0f, 0.0f);
+    grid.Update(4, -30.0f, -30.0f, 0.0f);
+
+    std::vector<uint32_t> candidates;
+    grid.GetCandidates(0.0f, 0.0f, 0.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<uint32_t>({ 0, 1, 2, 4 }));
+
+    //Moving a node must remove it from its old cell
+    grid.Update(2, 150.0f, 0.0f, 0.0f);
+    grid.GetCandidates(0.0f, 0.0f, 0.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<uint32_t>({ 0, 1, 4 }));
+
+    grid.GetCandidates(190.0f, 0.0f, 0.0f, candidates);
+    ASSERT_EQ(candidates, std::vector<uint32_t>({ 2, 3 }));
+}
+
 TEST(TestOther, TestDataSentSplit) {
     CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
     //testerConfig.verbose = true;
@@ -1659,3 +1808,144 @@ TEST(TestOther, TestRssiPenaltyFromCeilingPenetration)
 
     ASSERT_NEAR(baseRssi - 20.0f, rssiWithAttenuation, 0.01f);
 }
+
+TEST(TestOther, TestCachedPathLossFollowsNodeMovement)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.SetToPerfectConditions();
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2 });
+    simConfig.mapWidthInMeters = 100;
+    simConfig.mapHeightInMeters = 100;
+    simConfig.preDefinedPositions = { {0.1, 0.1}, {0.2, 0.1}, };
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    NodeEntry* nodeA = &tester.sim->nodes[0];
+    NodeEntry* nodeB = &tester.sim->nodes[1];
+
+    const auto expectedPathLoss = [&]() {
+        return ComputePathLossFromDistance(tester.sim->GetDistanceBetween(nodeA, nodeB), tester.sim->propagationConstant);
+    };
+
+    //The path loss is symmetric and must be the same if queried from both sides
+    ASSERT_FLOAT_EQ(tester.sim->GetPathLossBetween(nodeA, nodeB), expectedPathLoss());
+    ASSERT_FLOAT_EQ(tester.sim->GetPathLossBetween(nodeB, nodeA), expectedPathLoss());
+
+    //Writing the position directly must invalidate the cached value
+    nodeB->x = 0.4f;
+    ASSERT_FLOAT_EQ(tester.sim->GetPathLossBetween(nodeA, nodeB), expectedPathLoss());
+
+    tester.sim->SetPosition(0, 0.3f, 0.1f, 0.0f);
+    ASSERT_FLOAT_EQ(tester.sim->GetPathLossBetween(nodeA, nodeB), expectedPathLoss());
+
+    //Changing the model parameters must flush the cache
+    tester.sim->propagationConstant = 2.5f;
+    ASSERT_FLOAT_EQ(tester.sim->GetPathLossBetween(nodeA, nodeB), expectedPathLoss());
+}
+
+TEST(TestOther, TestReceptionKernelMatchesScalarPath)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 40 });
+    simConfig.mapWidthInMeters = 150;
+    simConfig.mapHeightInMeters = 150;
+    simConfig.mapElevationInMeters = 10;
+    simConfig.ceilingHeightInMeters = 3;
+    simConfig.ceilingAttenuationDb = 7.5f;
+    simConfig.rssiNoise = false;
+    simConfig.perfectReceptionProbabilityForConnection = false;
+
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+    tester.SimulateGivenNumberOfSteps(1);
+
+    tester.sim->nodes[3].impossibleConnection.push_back(7);
+
+    //The batched computation must yield exactly the same values as the scalar one, including the special values
+    for (u32 senderIndex = 0; senderIndex < tester.sim->GetTotalNodes(); senderIndex++)
+    {
+        const NodeEntry* sender = &tester.sim->nodes[senderIndex];
+        const ReceptionKernel::Parameters parameters = tester.sim->GetReceptionKernelParameters(sender);
+
+        for (u32 firstIndex = 0; firstIndex < tester.sim->GetTotalNodes(); firstIndex += ReceptionKernel::BATCH_SIZE)
+        {
+            ReceptionKernel::Batch batch;
+            u32 nodeIndices[ReceptionKernel::BATCH_SIZE];
+            for (u32 i = firstIndex; i < tester.sim->GetTotalNodes() && batch.count < ReceptionKernel::BATCH_SIZE; i++)
+            {
+                nodeIndices[batch.count] = i;
+                batch.count++;
+            }
+
+            tester.sim->ComputeReceptionBatch(sender, parameters, nodeIndices, batch);
+
+            for (u32 lane = 0; lane < batch.count; lane++)
+            {
+                const NodeEntry* receiver = &tester.sim->nodes[nodeIndices[lane]];
+                const float scalarRssi = tester.sim->GetReceptionRssi(sender, receiver);
+                if (batch.inRangeMask & (1UL << lane))
+                {
+                    ASSERT_EQ(batch.rssi[lane], tester.sim->GetReceptionRssiNoNoise(sender, receiver));
+                }
+                else
+                {
+                    ASSERT_EQ(scalarRssi, -1000);
+                    ASSERT_EQ(batch.rssi[lane], -1000);
+                }
+                ASSERT_EQ(batch.rssiProbability[lane], tester.sim->CalculateReceptionProbabilityForConnection(sender, receiver));
+            }
+        }
+    }
+}
+
+TEST(TestOther, TestMultiPatternMatcher)
+{
+    const std::vector<std::string> patterns = { "he", "she", "his", "hers", "", "she", "xyz" };
+    const MultiPatternMatcher matcher(patterns);
+    ASSERT_EQ(matcher.GetPatternCount(), patterns.size());
+
+    //The result must be the same as searching every pattern on its own
+    const char* texts[] = { "ushers", "", "h", "this is his house", "hershey", "xyxyz" };
+    std::vector<u32> matches;
+    for (const char* text : texts)
+    {
+        std::vector<u32> expected;
+        for (u32 i = 0; i < patterns.size(); i++)
+        {
+            if (std::string(text).find(patterns[i]) != std::string::npos) expected.push_back(i);
+        }
+        matcher.FindAll(text, matches);
+        ASSERT_EQ(matches, expected) << text;
+    }
+}
+
+//Awaited messages are indexed by terminal id, messages with other predicates must still be found
+TEST(TestOther, TestAwaitManyMessagesWithMixedPredicates)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 9 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    std::vector<SimulationMessage> messages;
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        const NodeId nodeId = tester.sim->nodes[i].GetNodeId();
+        if (i % 2 == 0) messages.push_back(SimulationMessage(i + 1, "(nodeId: " + std::to_string(nodeId) + ")"));
+        else messages.push_back(SimulationMessage(NodeEntryPredicate::AllowNodeId(nodeId), "(nodeId: " + std::to_string(nodeId) + ")"));
+    }
+    tester.SendTerminalCommandToAllNodes("status");
+    tester.SimulateUntilMessagesReceived(1000, messages);
+
+    for (const SimulationMessage& message : messages)
+    {
+        ASSERT_TRUE(message.IsFound());
+    }
+}
+
@@ -36,6 +36,7 @@
 #include <Utility.h>
 #include <Logger.h>
 #include <CherrySimTester.h>
+#include <chrono>
 
 class TestRecordStorage : public ::testing::Test, public RecordStorageEventListener
 {
@@ -57,7 +58,7 @@ public:
         tester->Start();
         NodeIndexSetter setter(0);
 
-        startPage = (u8*)Utility::GetSettingsPageBaseAddress();
+        startPage = FLASH_ADDRESS_TO_POINTER(Utility::GetSettingsPageBaseAddress());
     }
 
     u8* GetFreeSpace(u8 dataLength) {
@@ -87,6 +88,12 @@ public:
     void DefragmentPage(RecordStoragePage* pageToDefragment, bool force) {
         GS->recordStorage.DefragmentPage(*pageToDefragment, force);
     }
+    RecordStorageRecord* FindRecordOnPages(u16 recordId) {
+        return GS->recordStorage.FindRecordOnPages(recordId);
+    }
+    RecordStoragePage* FindPageToDefragment() {
+        return GS->recordStorage.FindPageToDefragment();
+    }
 
     u8 AddressToRecordStoragePageIdx(u8* address) {
         return (u8)((address - startPage) / FruityHal::GetCodePageSize());
@@ -772,3 +779,72 @@ TEST_F(TestRecordStorage, TestRandomMultiRecordUpdates) {
         }
     }
 }
+
+TEST_F(TestRecordStorage, TestRecordIndexLookupBenchmark) {
+    NodeIndexSetter setter(0);
+
+    constexpr u32 lookupRounds = 200;
+    const u32 recordCounts[] = { 8, 32, RECORD_STORAGE_INDEX_SIZE, RECORD_STORAGE_INDEX_SIZE * 2 };
+    for (const u32 recordCount : recordCounts)
+    {
+        CheckedMemset(startPage, 0xff, numPages * FruityHal::GetCodePageSize());
+        RepairPages();
+        cherrySimInstance->SimCommitFlashOperations();
+
+        //Store the records and update some of them, so that older versions exist as well
+        u8 data[8];
+        for (u32 round = 0; round < 2; round++)
+        {
+            for (u32 recordId = 1; recordId <= recordCount; recordId++)
+            {
+                if (round == 1 && recordId % 4 != 0) continue;
+                CheckedMemset(data, (u8)(recordId + round), sizeof(data));
+                ASSERT_EQ(GS->recordStorage.SaveRecord(recordId, data, sizeof(data), nullptr, 0), RecordStorageResultCode::SUCCESS);
+                cherrySimInstance->SimCommitFlashOperations();
+            }
+        }
+
+        u32 foundRecords = 0;
+        const auto indexStart = std::chrono::steady_clock::now();
+        for (u32 round = 0; round < lookupRounds; round++)
+        {
+            for (u32 recordId = 1; recordId <= recordCount; recordId++)
+            {
+                if (GS->recordStorage.GetRecord(recordId) != nullptr) foundRecords++;
+            }
+        }
+        const auto indexEnd = std::chrono::steady_clock::now();
+        for (u32 round = 0; round < lookupRounds; round++)
+        {
+            for (u32 recordId = 1; recordId <= recordCount; recordId++)
+            {
+                if (FindRecordOnPages(recordId) != nullptr) foundRecords++;
+            }
+        }
+        const auto scanEnd = std::chrono::steady_clock::now();
+        ASSERT_EQ(foundRecords, recordCount * lookupRounds * 2);
+
+        printf("RecordStorage lookup of %u records: index %lld us, scan %lld us" EOL,
+            recordCount,
+            (long long)std::chrono::duration_cast<std::chrono::microseconds>(indexEnd - indexStart).count(),
+            (long long)std::chrono::duration_cast<std::chrono::microseconds>(scanEnd - indexEnd).count());
+
+        //The index must deliver the same records as the scan, also for records that did not fit into it
+        for (u32 recordId = 1; recordId <= recordCount; recordId++)
+        {
+            RecordStorageRecord* record = GS->recordStorage.GetRecord(recordId);
+            ASSERT_EQ(record, FindRecordOnPages(recordId));
+            ASSERT_EQ(record->data[0], (u8)(recordId % 4 == 0 ? recordId + 1 : recordId));
+        }
+        ASSERT_EQ(GS->recordStorage.GetRecord(recordCount + 1), nullptr);
+
+        //After a defragmentation, the records moved to another page
+        DefragmentPage(FindPageToDefragment(), true);
+        cherrySimInstance->SimCommitFlashOperations();
+        for (u32 recordId = 1; recordId <= recordCount; recordId++)
+        {
+            ASSERT_EQ(GS->recordStorage.GetRecord(recordId), FindRecordOnPages(recordId));
+            ASSERT_NE(GS->recordStorage.GetRecord(recordId), nullptr);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+#include <Utility.h>
+
+TEST(TestScratchArena, TestDynamicArrays)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.terminalId = 0;
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 1 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    NodeIndexSetter setter(0);
+    ScratchArena& arena = tester.sim->nodes[0].scratchArena;
+    arena.ResetPeakUsage();
+    const u32 usageBefore = arena.GetUsage();
+    const u32 heapFallbacksBefore = arena.GetHeapFallbacks();
+
+    {
+        DYNAMIC_ARRAY(outer, 100);
+        ASSERT_EQ(arena.GetUsage(), usageBefore + 100);
+        //Arrays are zero initialized and aligned
+        ASSERT_EQ((uintptr_t)outer % ScratchArena::ALIGNMENT, 0u);
+        for (u32 i = 0; i < 100; i++) ASSERT_EQ(outer[i], 0);
+        CheckedMemset(outer, 0xAB, 100);
+        {
+            DYNAMIC_ARRAY(inner, 30);
+            DYNAMIC_ARRAY_FLOAT(floats, 10);
+            ASSERT_EQ(arena.GetUsage(), usageBefore + 100 + 30 + 10 * sizeof(float));
+            CheckedMemset(inner, 0xCD, 30);
+            floats[9] = 1.0f;
+        }
+        ASSERT_EQ(arena.GetUsage(), usageBefore + 100);
+        ASSERT_EQ(outer[99], 0xAB);
+
+        //Arrays that do not fit are taken from the heap
+        DYNAMIC_ARRAY(huge, ScratchArena::CAPACITY);
+        huge[ScratchArena::CAPACITY - 1] = 1;
+        ASSERT_EQ(arena.GetHeapFallbacks(), heapFallbacksBefore + 1);
+    }
+    ASSERT_EQ(arena.GetUsage(), usageBefore);
+    ASSERT_EQ(arena.GetPeakUsage(), usageBefore + 100 + 30 + 10 * sizeof(float));
+
+#if !defined(SANITIZERS_ENABLED) && !defined(__SANITIZE_ADDRESS__)
+    //Writing behind the end of an array is detected once the array goes out of scope and reported after the destructor
+    {
+        Exceptions::ExceptionDisabler<MemoryCorruptionException> mce;
+        {
+            DYNAMIC_ARRAY(buffer, 13);
+            buffer[13] = 0;
+        }
+        ASSERT_FALSE(tester.sim->CheckExceptionWasThrown(typeid(MemoryCorruptionException)));
+        arena.CheckReleaseErrors();
+        ASSERT_TRUE(tester.sim->CheckExceptionWasThrown(typeid(MemoryCorruptionException)));
+    }
+#endif
+
+    //An array that is released out of order keeps its memory until the arena is reset
+    {
+        Exceptions::DisableDebugBreakOnException ddboe;
+        const u32 generation = arena.GetGeneration();
+        u8* first = arena.Allocate(10);
+        arena.Allocate(20);
+        arena.Release(first, 10, generation);
+        ASSERT_EQ(arena.GetUsage(), usageBefore + 10 + 20);
+        ASSERT_THROW(arena.CheckReleaseErrors(), IllegalStateException);
+        arena.CheckReleaseErrors();
+    }
+
+    //Resetting the node releases all arrays, the arrays of its previous run are ignored once they go out of scope
+    {
+        DYNAMIC_ARRAY(previousRun, 50);
+        previousRun[0] = 1;
+        tester.sim->ResetCurrentNode(RebootReason::UNKNOWN, false);
+        ASSERT_EQ(arena.GetUsage(), 0u);
+        DYNAMIC_ARRAY(currentRun, 30);
+        currentRun[0] = 1;
+        ASSERT_EQ(arena.GetUsage(), 30u);
+    }
+    ASSERT_EQ(arena.GetUsage(), 0u);
+    arena.CheckReleaseErrors();
+}
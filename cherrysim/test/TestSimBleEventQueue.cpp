@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "Utility.h"
+#include "CherrySimTypes.h"
+#include "SimBleEventQueue.h"
+
+TEST(TestSimBleEventQueue, TestPushPopAndChunkReuse)
+{
+    const u32 usedChunksBefore = SimBleEventPool::GetInstance().GetAmountOfChunks() - SimBleEventPool::GetInstance().GetAmountOfFreeChunks();
+    SimBleEventQueue queue;
+    const auto createWrite = [](u32 id, u16 length) {
+        simBleEvent s;
+        CheckedMemset(&s, 0, sizeof(s));
+        s.globalId = id;
+        s.additionalInfo = id * 3;
+        s.bleEvent.header.evt_id = BLE_GATTS_EVT_WRITE;
+        s.bleEvent.evt.gatts_evt.params.write.len = length;
+        for (u16 i = 0; i < length; i++) s.bleEvent.evt.gatts_evt.params.write.data[i] = (u8)(id + i);
+        return s;
+    };
+
+    //Events only take as much space as they use
+    simBleEvent advReport;
+    CheckedMemset(&advReport, 0, sizeof(advReport));
+    advReport.bleEvent.header.evt_id = BLE_GAP_EVT_ADV_REPORT;
+    ASSERT_EQ(SimBleEventQueue::GetPayloadSize(advReport.bleEvent), sizeof(ble_evt_t));
+    const simBleEvent bigWrite = createWrite(0, NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+    ASSERT_GT(SimBleEventQueue::GetPayloadSize(bigWrite.bleEvent), sizeof(ble_evt_t));
+    ASSERT_LE(SimBleEventQueue::GetPayloadSize(bigWrite.bleEvent), sizeof(simBleEvent::bleEvent) + sizeof(simBleEvent::bleEventOverflowData));
+
+    //Push and pull enough events of different sizes to use several chunks
+    u32 nextPushId = 0;
+    u32 nextPopId = 0;
+    for (u32 round = 0; round < 20; round++)
+    {
+        for (u32 i = 0; i < 100; i++)
+        {
+            queue.Push(createWrite(nextPushId, (u16)((nextPushId * 7) % NRF_SDH_BLE_GATT_MAX_MTU_SIZE)));
+            nextPushId++;
+        }
+        ASSERT_EQ(queue.GetSize(), nextPushId - nextPopId);
+
+        u32 expectedId = nextPopId;
+        queue.ForEach([&expectedId](const SimBleEventRecord& record) {
+            ASSERT_EQ(record.globalId, expectedId);
+            expectedId++;
+        });
+        ASSERT_EQ(expectedId, nextPushId);
+
+        for (u32 i = 0; i < 70; i++)
+        {
+            const SimBleEventRecord& record = queue.Front();
+            const u16 length = (u16)((nextPopId * 7) % NRF_SDH_BLE_GATT_MAX_MTU_SIZE);
+            ASSERT_EQ(record.globalId, nextPopId);
+            ASSERT_EQ(record.additionalInfo, nextPopId * 3);
+            ASSERT_EQ(record.GetEvent()->evt.gatts_evt.params.write.len, length);
+            ASSERT_EQ(record.payloadSize, SimBleEventQueue::GetPayloadSize(*record.GetEvent()));
+            for (u16 k = 0; k < length; k++) ASSERT_EQ(record.GetEvent()->evt.gatts_evt.params.write.data[k], (u8)(nextPopId + k));
+            queue.PopFront();
+            nextPopId++;
+        }
+    }
+
+    //Chunks go back to the shared pool once the queue is emptied
+    while (!queue.IsEmpty()) queue.PopFront();
+    queue.Clear();
+    ASSERT_EQ(SimBleEventPool::GetInstance().GetAmountOfChunks() - SimBleEventPool::GetInstance().GetAmountOfFreeChunks(), usedChunksBefore);
+}
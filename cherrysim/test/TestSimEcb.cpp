@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH. 
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "Utility.h"
+#include "SimEcb.h"
+#include <cstring>
+#include <vector>
+
+extern "C"{
+#include <aes.h>
+}
+
+TEST(TestSimEcb, TestKeyScheduleCacheAndBackends)
+{
+    //Test vector from FIPS-197, Appendix C.1
+    const u8 key[SimEcb::BLOCK_SIZE] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+    const u8 cleartext[SimEcb::BLOCK_SIZE] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    const u8 expectedCiphertext[SimEcb::BLOCK_SIZE] = { 0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a };
+
+    std::vector<SimEcb::Backend> backends = { SimEcb::Backend::SOFTWARE };
+    if (SimEcb::IsAesNiSupported()) backends.push_back(SimEcb::Backend::AES_NI);
+
+    for (SimEcb::Backend backend : backends)
+    {
+        SimEcb ecb;
+        ecb.SetBackend(backend);
+        u8 ciphertext[SimEcb::BLOCK_SIZE] = {};
+        ecb.EncryptBlock(key, cleartext, ciphertext);
+        ASSERT_EQ(memcmp(ciphertext, expectedCiphertext, sizeof(ciphertext)), 0);
+
+        //More keys than there are cached schedules, the least recently used schedule is replaced
+        u8 otherKeys[SimEcb::CACHED_SCHEDULES][SimEcb::BLOCK_SIZE] = {};
+        for (u32 i = 0; i < SimEcb::CACHED_SCHEDULES; i++)
+        {
+            CheckedMemset(otherKeys[i], 0x10 + i, SimEcb::BLOCK_SIZE);
+            ecb.EncryptBlock(otherKeys[i], cleartext, ciphertext);
+            ecb.EncryptBlock(key, cleartext, ciphertext);
+            ASSERT_EQ(memcmp(ciphertext, expectedCiphertext, sizeof(ciphertext)), 0);
+        }
+        ASSERT_EQ(ecb.GetCacheMisses(), 1 + SimEcb::CACHED_SCHEDULES);
+        ASSERT_EQ(ecb.GetCacheHits(), SimEcb::CACHED_SCHEDULES);
+
+        //Only the first of the other keys was evicted, all blocks match the uncached software implementation
+        for (u32 i = SimEcb::CACHED_SCHEDULES; i > 0; i--)
+        {
+            u8 expected[SimEcb::BLOCK_SIZE] = {};
+            AES_ECB_encrypt(cleartext, otherKeys[i - 1], expected, SimEcb::BLOCK_SIZE);
+            ecb.EncryptBlock(otherKeys[i - 1], cleartext, ciphertext);
+            ASSERT_EQ(memcmp(ciphertext, expected, sizeof(ciphertext)), 0);
+        }
+        ASSERT_EQ(ecb.GetCacheMisses(), 2 + SimEcb::CACHED_SCHEDULES);
+    }
+}
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+#include <HelperFunctions.h>
+#include "FlashFileFormat.h"
+#include "SimFlashMemory.h"
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+//Counts the pages of the flash that the OS copied for it, pages that are still shared with the image are not counted
+static u32 CountPrivateFlashPages(const SimFlashMemory& flash)
+{
+    const uintptr_t begin = (uintptr_t)flash.GetData();
+    const uintptr_t end = begin + flash.GetSize();
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inFlash = false;
+    u32 privateKiloBytes = 0;
+    while (std::getline(smaps, line))
+    {
+        unsigned long long mappingBegin = 0;
+        unsigned long long mappingEnd = 0;
+        unsigned long kiloBytes = 0;
+        if (sscanf(line.c_str(), "%llx-%llx ", &mappingBegin, &mappingEnd) == 2)
+        {
+            inFlash = mappingBegin >= begin && mappingEnd <= end;
+        }
+        //Copied pages of a private file mapping are accounted as anonymous memory
+        else if (inFlash && sscanf(line.c_str(), "Anonymous: %lu kB", &kiloBytes) == 1)
+        {
+            privateKiloBytes += kiloBytes;
+        }
+    }
+    return privateKiloBytes * 1024 / (u32)sysconf(_SC_PAGESIZE);
+}
+#endif
+
+TEST(TestSimFlashMemory, TestCopyOnWrite)
+{
+#if defined(__linux__)
+    const u32 pageSize = (u32)sysconf(_SC_PAGESIZE);
+    ASSERT_EQ(SimFlashMemory::GetOsPageSize(), pageSize);
+#else
+    const u32 pageSize = SimFlashMemory::GetOsPageSize();
+#endif
+    SimFlashMemory first;
+    SimFlashMemory second;
+    ASSERT_EQ(first.GetSize(), SIM_MAX_FLASH_SIZE);
+    ASSERT_TRUE(FlashFileFormat::IsErased(first.GetData(), first.GetSize()));
+
+    //Writing to one flash must not be visible in another one even though both start with the same erased image
+    const u8 data[] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77 };
+    first.Program(2 * pageSize, data, sizeof(data));
+    ASSERT_EQ(memcmp(first.GetData() + 2 * pageSize, data, sizeof(data)), 0);
+    ASSERT_EQ(first[2 * pageSize - 1], 0xFF);
+    ASSERT_TRUE(FlashFileFormat::IsErased(second.GetData(), second.GetSize()));
+
+    //Flash writes can only clear bits
+    const u8 pattern[] = { 0xF0, 0xF0, 0xF0, 0xF0 };
+    second.Write(0, pattern, sizeof(pattern));
+    second.Write(0, data + 1, 1);
+    ASSERT_EQ(second[0], 0x10);
+    ASSERT_EQ(second[1], 0xF0);
+
+    //Erasing a whole page as well as only a part of it
+    first.Erase(2 * pageSize, pageSize);
+    ASSERT_TRUE(FlashFileFormat::IsErased(first.GetData(), first.GetSize()));
+    second.Erase(1, 2);
+    ASSERT_EQ(second[0], 0x10);
+    ASSERT_EQ(second[1], 0xFF);
+    ASSERT_EQ(second[3], 0xF0);
+
+    //Programming a range restores it exactly, including erased pages
+    std::vector<u8> content(3 * pageSize, 0xFF);
+    content[pageSize + 5] = 0x42;
+    second.Program(0, content.data(), (u32)content.size());
+    ASSERT_EQ(memcmp(second.GetData(), content.data(), content.size()), 0);
+
+    //Many flashes map the same image that is not erased, like the MBR that every node starts with
+    content.assign(SIM_MAX_FLASH_SIZE, 0xFF);
+    for (u32 i = 0; i < pageSize + 16; i++) content[i] = (u8)i;
+    const SimFlashImage image(content.data(), (u32)content.size());
+    constexpr u32 amountOfFlashes = 32;
+    std::vector<std::unique_ptr<SimFlashMemory>> flashes;
+    for (u32 i = 0; i < amountOfFlashes; i++)
+    {
+        flashes.emplace_back(new SimFlashMemory(image));
+        ASSERT_EQ(memcmp(flashes[i]->GetData(), content.data(), content.size()), 0);
+        //Programming the content of the image again, e.g. from a file, must not copy any page
+        flashes[i]->Program(0, content.data(), (u32)content.size());
+    }
+    first.Map(image);
+    ASSERT_EQ(memcmp(first.GetData(), content.data(), content.size()), 0);
+
+    //Only the pages that differ from the image are copied
+    flashes[3]->Program(pageSize, data, sizeof(data));
+    flashes[5]->Erase(0, pageSize);
+    ASSERT_TRUE(FlashFileFormat::IsErased(flashes[5]->GetData(), pageSize));
+    ASSERT_EQ(flashes[5]->GetData()[pageSize], 0x00);
+    ASSERT_EQ(memcmp(flashes[4]->GetData(), content.data(), content.size()), 0);
+
+#if defined(__linux__)
+    u32 privatePages = 0;
+    for (u32 i = 0; i < amountOfFlashes; i++) privatePages += CountPrivateFlashPages(*flashes[i]);
+    ASSERT_EQ(CountPrivateFlashPages(*flashes[3]), 1u);
+    ASSERT_EQ(CountPrivateFlashPages(*flashes[5]), 1u);
+    //The memory scales with the written pages, not with the amount of flashes
+    ASSERT_EQ(privatePages, 2u);
+
+    //Programming the content of the image gives the page back to it
+    flashes[3]->Program(pageSize, content.data() + pageSize, pageSize);
+    ASSERT_EQ(CountPrivateFlashPages(*flashes[3]), 0u);
+#endif
+    ASSERT_EQ(memcmp(flashes[3]->GetData(), content.data(), content.size()), 0);
+}
+
+TEST(TestSimFlashMemory, TestFactoryImageIsSharedByNodes)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CreateSinkMeshSimConfiguration(10);
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.StartWithFeaturesetDeviceTypes();
+    tester.SimulateForGivenTime(10 * 1000);
+
+    for (u32 i = 0; i < tester.sim->GetTotalNodes(); i++)
+    {
+        const SimFlashMemory& flash = tester.sim->nodes[i].flash;
+        const SimFlashImage& image = CherrySim::GetFactoryFlashImage(tester.sim->nodes[i].bleStackType, tester.sim->nodes[i].uicr.BOOTLOADERADDR);
+        //The MBR and the bootloader are part of the image
+        ASSERT_EQ(memcmp(flash.GetData(), image.GetData(), SimFlashMemory::GetOsPageSize()), 0);
+        ASSERT_FALSE(FlashFileFormat::IsErased(image.GetData(), SimFlashMemory::GetOsPageSize()));
+#if defined(__linux__)
+        //Only the pages that the firmware changed are copied for a node, e.g. its settings
+        const u32 pageSize = SimFlashMemory::GetOsPageSize();
+        u32 changedPages = 0;
+        for (u32 offset = 0; offset < flash.GetSize(); offset += pageSize)
+        {
+            if (memcmp(flash.GetData() + offset, image.GetData() + offset, pageSize) != 0) changedPages++;
+        }
+        ASSERT_EQ(CountPrivateFlashPages(flash), changedPages);
+        ASSERT_LT(changedPages, flash.GetSize() / pageSize / 4);
+#endif
+    }
+}
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include <CherrySimTester.h>
+
+TEST(TestSimPhaseTimings, TestPhasesAreMeasuredWhenEnabled)
+{
+    CherrySimTesterConfig testerConfig = CherrySimTester::CreateDefaultTesterConfiguration();
+    SimConfiguration simConfig = CherrySimTester::CreateDefaultSimConfiguration();
+    simConfig.nodeConfigName.insert({ "prod_sink_nrf52", 1 });
+    simConfig.nodeConfigName.insert({ "prod_mesh_nrf52", 2 });
+    CherrySimTester tester = CherrySimTester(testerConfig, simConfig);
+    tester.Start();
+
+    //Nothing is measured unless it is enabled
+    tester.SimulateGivenNumberOfSteps(10);
+    ASSERT_EQ(tester.sim->phaseTimings.GetTotal().count(), 0);
+
+    tester.sim->phaseTimings.enabled = true;
+    tester.SimulateGivenNumberOfSteps(10);
+    ASSERT_GT(tester.sim->phaseTimings.durations[(u32)SimPhase::TIMER].count(), 0);
+    ASSERT_GT(tester.sim->phaseTimings.durations[(u32)SimPhase::CONNECTIONS].count(), 0);
+    ASSERT_GE(tester.sim->phaseTimings.GetTotal(), tester.sim->phaseTimings.durations[(u32)SimPhase::TIMER]);
+    for (u32 i = 0; i < (u32)SimPhase::AMOUNT; i++)
+    {
+        ASSERT_STRNE(SimPhaseToString((SimPhase)i), "Unknown");
+    }
+
+    tester.sim->phaseTimings.Reset();
+    ASSERT_EQ(tester.sim->phaseTimings.GetTotal().count(), 0);
+}
@@ -34,6 +34,7 @@
 #include "MultiScheduler.h"
 #include "BitMask.h"
 #include "SlotStorage.h"
+#include "JsonStreamValidator.h"
 #include <set>
 
 TEST(TestUtility, TestGetIndexForSerial) {
@@ -206,6 +207,21 @@ TEST(TestUtility, TestCRC) {
     ASSERT_EQ(Utility::CalculateCrc8 ((u8*)data, len), 70);
     ASSERT_EQ(Utility::CalculateCrc16((u8*)data, len, nullptr), 55639);
     ASSERT_EQ(Utility::CalculateCrc32((u8*)data, len), 1322553117);
+
+    //The CRC32 must not depend on the alignment of the data or how it is split into parts
+    u8 buffer[64 + 8];
+    for (u32 i = 0; i < sizeof(buffer); i++) buffer[i] = (u8)(i * 37 + 11);
+    const u32 fullCrc32 = Utility::CalculateCrc32(buffer + 3, 64);
+    for (u32 offset = 0; offset < 8; offset++)
+    {
+        CheckedMemmove(buffer + offset, buffer + 3, 64);
+        ASSERT_EQ(Utility::CalculateCrc32(buffer + offset, 64), fullCrc32);
+        CheckedMemmove(buffer + 3, buffer + offset, 64);
+    }
+    for (u32 split = 0; split <= 64; split++)
+    {
+        ASSERT_EQ(Utility::CalculateCrc32(buffer + 3 + split, 64 - split, Utility::CalculateCrc32(buffer + 3, split)), fullCrc32);
+    }
 }
 
 TEST(TestUtility, TestFindLast) {
@@ -909,4 +925,58 @@ TEST(TestUtility, TestSlotStorageErrorCases)
         ASSERT_EQ(slotStorage.getSizeOfSlot(0), 512);
         ASSERT_EQ(slotStorage.registerSlot(1, 1), nullptr);
     }
-}
\ No newline at end of file
+}
+TEST(TestUtility, TestJsonStreamValidator)
+{
+    JsonStreamValidator validator;
+
+    const char* validJsons[] = {
+        "{}",
+        " [ ] \r\n",
+        "{\"nodeId\":1,\"type\":\"status\",\"module\":3,\"values\":[1,-2,0.5,3e-2,true,false,null]}",
+        "\"escaped \\\" \\\\ \\u00e4 \xC3\xA4\"",
+        "-0",
+        "[[[{\"a\":{\"b\":[]}}]]]",
+    };
+    for (const char* json : validJsons)
+    {
+        validator.Feed(json);
+        ASSERT_TRUE(validator.Finish()) << json;
+    }
+
+    const char* invalidJsons[] = {
+        "",
+        "{",
+        "{\"a\":1,}",
+        "[1,]",
+        "{\"a\" 1}",
+        "{1:2}",
+        "01",
+        "1.",
+        "-",
+        "tru",
+        "{}{}",
+        "\"unterminated",
+        "\"\t\"",
+        "\"\\x\"",
+        "\"\xC3\"",
+        "[}",
+    };
+    for (const char* json : invalidJsons)
+    {
+        validator.Feed(json);
+        ASSERT_FALSE(validator.Finish()) << json;
+    }
+
+    //A message can be fed in arbitrary fragments, just like it is logged with logjson_partial
+    validator.Feed("{\"nodeId\":1");
+    validator.Feed("2,\"ty");
+    validator.Feed("pe\":\"x\",\"v\":[tr");
+    validator.Feed("ue]}");
+    ASSERT_TRUE(validator.Finish());
+
+    //Nesting deeper than supported is reported as invalid instead of overflowing
+    for (u32 i = 0; i <= JsonStreamValidator::MAX_NESTING_DEPTH; i++) validator.Feed("[");
+    for (u32 i = 0; i <= JsonStreamValidator::MAX_NESTING_DEPTH; i++) validator.Feed("]");
+    ASSERT_FALSE(validator.Finish());
+}
@@ -566,8 +566,8 @@ class Conf
     extern u32 __application_start_address;
     extern u32 __application_end_address;
     extern u32 __application_ram_start_address;
-    extern u32 __start_conn_type_resolvers;
-    extern u32 __stop_conn_type_resolvers;
+    extern uintptr_t __start_conn_type_resolvers;
+    extern uintptr_t __stop_conn_type_resolvers;
     extern u32 __license_data_start_address;
 #else
     extern u32 __application_start_address[]; //Variable is set in the linker script
@@ -77,9 +77,12 @@ ErrorType GATTController::BleWriteCharacteristic(u16 connectionHandle, u16 chara
 {
     logt("CONN_DATA", "TX Data size is: %d, handles(%d, %d), reliable %d", dataLength.GetRaw(), connectionHandle, characteristicHandle, reliable);
 
-    char stringBuffer[100];
-    Logger::ConvertBufferToHexString(data, dataLength.GetRaw(), stringBuffer, sizeof(stringBuffer));
-    logt("CONN_DATA", "%s", stringBuffer);
+    if (LOGT_ENABLED("CONN_DATA"))
+    {
+        char stringBuffer[100];
+        Logger::ConvertBufferToHexString(data, dataLength.GetRaw(), stringBuffer, sizeof(stringBuffer));
+        logt("CONN_DATA", "%s", stringBuffer);
+    }
 
 
     //Configure the write parameters with reliable/unreliable, writehandle, etc...
@@ -115,9 +118,12 @@ ErrorType GATTController::BleSendNotification(u16 connectionHandle, u16 characte
 {
     logt("CONN_DATA", "hvx Data size is: %d, handles(%d, %d)", dataLength.GetRaw(), connectionHandle, characteristicHandle);
 
-    char stringBuffer[100];
-    Logger::ConvertBufferToHexString(data, dataLength.GetRaw(), stringBuffer, sizeof(stringBuffer));
-    logt("CONN_DATA", "%s", stringBuffer);
+    if (LOGT_ENABLED("CONN_DATA"))
+    {
+        char stringBuffer[100];
+        Logger::ConvertBufferToHexString(data, dataLength.GetRaw(), stringBuffer, sizeof(stringBuffer));
+        logt("CONN_DATA", "%s", stringBuffer);
+    }
 
 
     FruityHal::BleGattWriteParams notificationParams = {};
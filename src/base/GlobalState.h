@@ -102,6 +102,7 @@ class GlobalState
         u32 CollsndCount =0; //(包含碰撞)
         u32 MultipleUnit =0;
         u32 MultipleCount=0;
+        LoadChunkCounters loadChunkCounters; //Sum of the per connection counters of all connections of this node
         //#################### App timer ###########################
         //To keep track of timer ticks
         u32 previousRtcTicks = 0;
@@ -115,6 +116,7 @@ class GlobalState
         u32 inittimeSinceSyncTime =0; // new test use to add tick(ms) ; 
         u32 caltime=0; // new Rtc
         u32 caltick=0; // new rtc 調整用
+        bool calDelayPending = true; //Set to recalibrate caltime with the next GetRtcMs call
         TimeManager timeManager;
 
         u32 amountOfRemovedConnections = 0;
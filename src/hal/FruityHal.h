@@ -383,6 +383,10 @@ namespace FruityHal
     ErrorType BleStackInit();
     void BleStackDeinit();
     void EventLooper();
+#ifdef SIM_ENABLED
+    //Dispatches all pending BLE events, used by the simulator to let the firmware react within a connection event
+    void PullBleEvents();
+#endif
     u16 GetEventBufferSize();
     void DispatchBleEvents(void const * evt);
     void SetPendingEventIRQ();
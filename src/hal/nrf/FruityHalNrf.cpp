@@ -144,14 +144,6 @@ extern "C" {
 static_assert(SD_EVT_IRQ_PRIORITY == APP_TIMER_CONFIG_IRQ_PRIORITY, "Check irq priorities");
 #endif
 
-//new
-bool CalDelay=1; // CalDelay
-u32 errTime=0; // sendtime - forwardingtime  
-u32 delay=0; // delay
-u32 Ctime=0; // Cur CI time
-bool Currdirection=0; // configuration Cur conn
-u32 CI=100; // CI
-
 constexpr u8 MAX_GPIOTE_HANDLERS = 4;
 struct GpioteHandlerValues
 {
@@ -183,7 +175,7 @@ struct NrfHalMemory
     nrf_radio_request_t timeslotRadioRequest                                  = {};
 #endif // IS_ACTIVE(TIMESLOT)
 };
-static_assert(alignof(NrfHalMemory) <= 4, "The HAL Memory is allocated in a memory block with an alignment of 4. Thus the alignment must not be greater!");
+static_assert(alignof(NrfHalMemory) <= alignof(void*), "The HAL Memory is allocated in a memory block with the alignment of a pointer (4 on the chip). Thus the alignment must not be greater!");
 
 //In SDK17, the ble db discovery library has a dependency on the nrf queue
 //so we need to define an instance here
@@ -368,7 +360,7 @@ ErrorType FruityHal::BleStackInit()
 
     logt("FH", "ENReq %u", err);
 
-    uint32_t ram_start = (u32)__application_ram_start_address;
+    uint32_t ram_start = (u32)(uintptr_t)__application_ram_start_address;
 
     //######### Sets our custom SoftDevice configuration
 
@@ -453,9 +445,10 @@ ErrorType FruityHal::BleStackInit()
 
     //######### Enables the BLE stack
     err = nrf_sdh_ble_enable(&ram_start);
-    const char* tag = "FH";
-    if (err) tag = "ERROR";
-    logt(tag, "Err %u, Linker Ram section should be at %x, len %x", err, (u32)ram_start, (u32)(getramend() - ram_start));
+    //Once something failed, the following messages are logged as errors as well
+    bool failed = err != 0;
+    if (failed) logt("ERROR", "Err %u, Linker Ram section should be at %x, len %x", err, (u32)ram_start, (u32)(getramend() - ram_start));
+    else        logt("FH",    "Err %u, Linker Ram section should be at %x, len %x", err, (u32)ram_start, (u32)(getramend() - ram_start));
     FRUITYMESH_ERROR_CHECK(finalErr);
     FRUITYMESH_ERROR_CHECK(err);
 
@@ -477,14 +470,16 @@ ErrorType FruityHal::BleStackInit()
 
     //Enable DC/DC (needs external LC filter, cmp. nrf51 reference manual page 43)
     err = sd_power_dcdc_mode_set(Boardconfig->dcDcEnabled ? NRF_POWER_DCDC_ENABLE : NRF_POWER_DCDC_DISABLE);
-    if (err) tag = "ERROR";
-    logt(tag, "sd_power_dcdc_mode_set %u", err);
+    failed = failed || err != 0;
+    if (failed) logt("ERROR", "sd_power_dcdc_mode_set %u", err);
+    else        logt("FH",    "sd_power_dcdc_mode_set %u", err);
     FRUITYMESH_ERROR_CHECK(err); //OK
 
     // Set power mode
     err = sd_power_mode_set(NRF_POWER_MODE_LOWPWR);
-    if (err) tag = "ERROR";
-    logt(tag, "sd_power_mode_set %u", err);
+    failed = failed || err != 0;
+    if (failed) logt("ERROR", "sd_power_mode_set %u", err);
+    else        logt("FH",    "sd_power_mode_set %u", err);
     FRUITYMESH_ERROR_CHECK(err); //OK
 
     err = (u32)FruityHal::RadioSetTxPower(Conf::defaultDBmTX, FruityHal::TxRole::SCAN_INIT, 0);
@@ -592,18 +587,8 @@ void ProcessAppEvents()
 }
 
 #if defined(SIM_ENABLED)
-void FruityHal::EventLooper()
+void FruityHal::PullBleEvents()
 {
-    //TODO: We could execute this in a separate thread as this will typically be interrupted by interrupts
-    //Call all main context handlers
-    for (u32 i = 0; i < GS->numMainContextHandlers; i++)
-    {
-        GS->mainContextHandlers[i]();
-    }
-
-    //Check for waiting events from the application
-    ProcessAppEvents();
-
     while (true)
     {
         //Fetch BLE events
@@ -634,6 +619,21 @@ void FruityHal::EventLooper()
             break;
         }
     }
+}
+
+void FruityHal::EventLooper()
+{
+    //TODO: We could execute this in a separate thread as this will typically be interrupted by interrupts
+    //Call all main context handlers
+    for (u32 i = 0; i < GS->numMainContextHandlers; i++)
+    {
+        GS->mainContextHandlers[i]();
+    }
+
+    //Check for waiting events from the application
+    ProcessAppEvents();
+
+    PullBleEvents();
 
     GS->inPullEventsLoop = true;
     // Pull event from soc
@@ -1879,71 +1879,15 @@ ErrorType FruityHal::BleGattWrite(u16 connHandle, BleGattWriteParams const & par
 //new 
     ConnPacketModule* outPacket = (ConnPacketModule*)params.p_data;
  
-    if (outPacket->actionType == 5) {
-        
-        errTime=GS->delaytimer-Ctime; //errTime
-
-        if(errTime>CI && outPacket->packetSendTime!=0){
-            Ctime=outPacket->packetSendTime;
-        } // if err > CI then update Cur CI TIME 
-
-        //trace("errTime : %u , Ctime : %u , outPacket->packetSendTime : %u , errTime : %u ," EOL, errTime, Ctime, outPacket->packetSendTime, errTime);   
-        if(errTime<=CI)
-        {
-            if(!outPacket->DirectionSet && Ctime!=0){
-                if(!(Currdirection ^ outPacket->Predirection))
-                {
-                    outPacket->Currdirection=Currdirection;
-                    outPacket->DirectionSet=true;
-                }
-            }// set cur 
-
-
-            if(!(outPacket->Predirection ^ outPacket->Currdirection) && outPacket->DirectionSet)
-            {
-                //GS->CollsndCount++;
-                //delay+=CI;
-                //trace("CollsndCount++ : %u , Nowtime : %u , sendtime : %u , errTime : %u ," EOL, GS->CollsndCount, GS->delaytimer, outPacket->packetSendTime, errTime);                
-            }
-            //trace("Pre : %u , Cur : %u , Coll? : %u , Set? : %u ," EOL, outPacket->Predirection, outPacket->Currdirection, !(outPacket->Predirection ^ outPacket->Currdirection), outPacket->DirectionSet);
-        } // if err < CI then whether M/S Coll?
-        
-
-     /*   //new collision test
-        if(outPacket->sendtime!=0)
-        {
-            errTime=GS->delaytimer-outPacket->packetSendTime;
-            if(errTime<=10 && !(outPacket->Predirection ^ outPacket->Currdirection) && outPacket->DirectionSet)
-            {
-                GS->CollsndCount++;
-                delay+=10;
-                trace("CollsndCount++ : %u , Nowtime : %u , sendtime : %u , errTime : %u ," EOL, GS->CollsndCount, GS->delaytimer, outPacket->packetSendTime, errTime);
-            }
-        }
-        trace("Pre : %u , Cur : %u , Coll? : %u , Set? : %u ," EOL, outPacket->Predirection, outPacket->Currdirection, !(outPacket->Predirection ^ outPacket->Currdirection), outPacket->DirectionSet);
-*/
-        outPacket->Predirection=outPacket->Currdirection;
-        outPacket->DirectionSet = true;
-
-        if(outPacket->DirectionSet)
-        {
-            Currdirection=outPacket->Currdirection;
-        }  //set cur con //new
-
-        outPacket->packetSendTime = GS->delaytimer+delay;        //+=delay?
-        delay=0; //update packetsendtime 
-
-        if (outPacket->sendtime == 0) {
-            outPacket->sendtime=outPacket->packetSendTime;
-        } // update sendtime
-
-
-        GS->CollsndCount++; //cal Coll count
-        if (GS->MultipleUnit != 0) {
-            if (GS->CollsndCount / GS->MultipleUnit != 0) {
-                GS->MultipleCount += GS->CollsndCount / GS->MultipleUnit;
-                GS->CollsndCount = GS->CollsndCount % GS->MultipleUnit;
-            } // cal Coll unit
+    //Shorter writes are no load chunks and must not be written behind their end. Other messages, such as
+    //LOAD_AGGREGATE, have different fields at the offset of the actionType.
+    if (params.len.GetRaw() >= SIZEOF_CONN_PACKET_MODULE
+        && outPacket->header.messageType == MessageType::MODULE_TRIGGER_ACTION
+        && outPacket->moduleId == ModuleId::NODE
+        && outPacket->actionType == 5) {
+        BaseConnectionHandle connection = GS->cm.GetConnectionFromHandle(connHandle);
+        if (connection) {
+            connection.GetConnection()->AccountLoadChunkWrite(outPacket);
         }
 
     trace("node id : %d, now index node id : %d, receiver node id : %d, generateTime : %u ms, sendTime : %u ms, forwardingTime : %u ms," EOL, outPacket->header.sender,GS->node.configuration.nodeId,outPacket->header.receiver,outPacket->timestamp,outPacket->sendtime,outPacket->packetSendTime);
@@ -2273,9 +2217,9 @@ u32 FruityHal::GetRtcMs()
     }
 
     //new CalDelaytimer
-    if (CalDelay) {
+    if (GS->calDelayPending) {
         GS->caltime = ((rtcTicks * 1000) / APP_TIMER_CLOCK_FREQ) + ((NrfHalMemory*)GS->halMemory)->time_ms;
-        CalDelay = 0;
+        GS->calDelayPending = false;
     }
     GS->delaytimer = ((rtcTicks * 1000) / APP_TIMER_CLOCK_FREQ) + ((NrfHalMemory*)GS->halMemory)->time_ms;
     GS->delaytimer = GS->delaytimer - GS->caltime + ((GS->caltick * 1000) / APP_TIMER_CLOCK_FREQ) + (GS->inittimeSinceSyncTime * 1000);
@@ -2288,7 +2232,7 @@ u32 FruityHal::GetRtcMs()
 //new
 u32 FruityHal::UpdateDelayTimer() 
 {
-    CalDelay = 1;
+    GS->calDelayPending = true;
     return FruityHal::GetRtcMs();
 }
 
@@ -2358,7 +2302,7 @@ extern "C"
 u32 FruityHal::GetBootloaderVersion()
 {
     if(BOOTLOADER_UICR_ADDRESS != 0xFFFFFFFF){
-        return *(u32*)(FLASH_REGION_START_ADDRESS + BOOTLOADER_UICR_ADDRESS + 1024);
+        return *(u32*)FLASH_ADDRESS_TO_POINTER(FLASH_REGION_START_ADDRESS + BOOTLOADER_UICR_ADDRESS + 1024);
     } else {
         return 0;
     }
@@ -3011,7 +2955,7 @@ u32 FruityHal::GetSoftDeviceSize(u32 sdBaseAddress)
     {
     case Chipset::CHIP_NRF52:
     case Chipset::CHIP_NRF52840:
-        return SD_SIZE_GET(sdBaseAddress);
+        return SD_SIZE_GET((uintptr_t)FLASH_ADDRESS_TO_POINTER(sdBaseAddress));
     default:
         SIMEXCEPTION(IllegalStateException);
     }
@@ -3029,7 +2973,7 @@ u32 FruityHal::GetSoftDeviceVersion()
     case BleStackType::NRF_SD_132_ANY:
     case BleStackType::NRF_SD_140_ANY:
         // Sim flash region does not start at 0x0, therefore the offset
-        return SD_VERSION_GET(FLASH_REGION_START_ADDRESS + GetMasterBootRecordSize());
+        return SD_VERSION_GET((uintptr_t)FLASH_ADDRESS_TO_POINTER(FLASH_REGION_START_ADDRESS + GetMasterBootRecordSize()));
     default:
         SIMEXCEPTION(IllegalStateException);
     }
@@ -3071,21 +3015,21 @@ void FruityHal::BleStackErrorHandler(u32 id, u32 info)
         }
         case NRF_FAULT_ID_SDK_ASSERT: //SDK asserts
         {
-            GS->ramRetainStructPtr->code2 = ((assert_info_t *)info)->line_num;
-            u8 len = (u8)strlen((const char*)((assert_info_t *)info)->p_file_name);
+            GS->ramRetainStructPtr->code2 = ((assert_info_t *)(uintptr_t)info)->line_num;
+            u8 len = (u8)strlen((const char*)((assert_info_t *)(uintptr_t)info)->p_file_name);
             if (len > (RAM_PERSIST_STACKSTRACE_SIZE - 1) * 4) len = (RAM_PERSIST_STACKSTRACE_SIZE - 1) * 4;
-            CheckedMemcpy(GS->ramRetainStructPtr->stacktrace + 1, ((assert_info_t *)info)->p_file_name, len);
+            CheckedMemcpy(GS->ramRetainStructPtr->stacktrace + 1, ((assert_info_t *)(uintptr_t)info)->p_file_name, len);
             break;
         }
         case NRF_FAULT_ID_SDK_ERROR: //SDK errors
         {
-            GS->ramRetainStructPtr->code2 = ((error_info_t *)info)->line_num;
-            GS->ramRetainStructPtr->code3 = ((error_info_t *)info)->err_code;
+            GS->ramRetainStructPtr->code2 = ((error_info_t *)(uintptr_t)info)->line_num;
+            GS->ramRetainStructPtr->code3 = ((error_info_t *)(uintptr_t)info)->err_code;
 
             //Copy filename to stacktrace
-            u8 len = (u8)strlen((const char*)((error_info_t *)info)->p_file_name);
+            u8 len = (u8)strlen((const char*)((error_info_t *)(uintptr_t)info)->p_file_name);
             if (len > (RAM_PERSIST_STACKSTRACE_SIZE - 1) * 4) len = (RAM_PERSIST_STACKSTRACE_SIZE - 1) * 4;
-            CheckedMemcpy(GS->ramRetainStructPtr->stacktrace + 1, ((error_info_t *)info)->p_file_name, len);
+            CheckedMemcpy(GS->ramRetainStructPtr->stacktrace + 1, ((error_info_t *)(uintptr_t)info)->p_file_name, len);
             break;
         }
     }
@@ -36,12 +36,6 @@
 #include <GlobalState.h>
 #include <MeshConnection.h>
 
-//new
-extern int flag;
-//extern int* deg;
-extern int deg[10];
-int maxdeg = -1;
-
 constexpr int BASE_CONNECTION_MAX_SEND_FAIL  = 10;
 
 /*
@@ -112,6 +106,68 @@ void BaseConnection::HANDSHAKE_DONE()
     connectionState = ConnectionState::HANDSHAKE_DONE;
 }
 
+u32 BaseConnection::GetConnectionIntervalMs() const
+{
+    const u16 intervalUnits = connectionIntervalUnits != 0 ? connectionIntervalUnits : Conf::GetInstance().meshMinConnectionInterval;
+    return intervalUnits * CONFIG_UNIT_1_25_MS / 1000;
+}
+
+void BaseConnection::ResetLoadChunkCounters()
+{
+    loadChunkCounters = LoadChunkCounters();
+}
+
+void BaseConnection::AccountLoadChunkWrite(ConnPacketModule* packet)
+{
+    const u32 connectionIntervalMs = GetConnectionIntervalMs();
+    const u32 timeSinceIntervalStartMs = GS->delaytimer - loadChunkIntervalStartMs;
+
+    //A packet that is sent more than one connection interval after the last one starts a new interval
+    if (timeSinceIntervalStartMs > connectionIntervalMs && packet->packetSendTime != 0)
+    {
+        loadChunkIntervalStartMs = packet->packetSendTime;
+    }
+
+    //Within the same interval, master and slave collide if the packet keeps the direction of the previous one
+    if (timeSinceIntervalStartMs <= connectionIntervalMs)
+    {
+        loadChunkCounters.sameIntervalPackets++;
+        GS->loadChunkCounters.sameIntervalPackets++;
+
+        if (!packet->DirectionSet && loadChunkIntervalStartMs != 0 && loadChunkCurrentDirection == packet->Predirection)
+        {
+            packet->Currdirection = loadChunkCurrentDirection;
+            packet->DirectionSet = true;
+        }
+        if (packet->DirectionSet && packet->Predirection == packet->Currdirection)
+        {
+            loadChunkCounters.directionCollisions++;
+            GS->loadChunkCounters.directionCollisions++;
+        }
+    }
+
+    packet->Predirection = packet->Currdirection;
+    packet->DirectionSet = true;
+    loadChunkCurrentDirection = packet->Currdirection;
+
+    packet->packetSendTime = GS->delaytimer;
+    if (packet->sendtime == 0)
+    {
+        packet->sendtime = packet->packetSendTime;
+    }
+
+    loadChunkCounters.sentPackets++;
+    GS->loadChunkCounters.sentPackets++;
+
+    //The sent packets are counted in multiples of MultipleUnit to report them with small action messages
+    GS->CollsndCount++;
+    if (GS->MultipleUnit != 0 && GS->CollsndCount >= GS->MultipleUnit)
+    {
+        GS->MultipleCount += GS->CollsndCount / GS->MultipleUnit;
+        GS->CollsndCount = GS->CollsndCount % GS->MultipleUnit;
+    }
+}
+
 /*######## PRIVATE FUNCTIONS ###################################*/
 
 
@@ -138,12 +194,14 @@ bool BaseConnection::QueueData(const BaseConnectionSendData &sendData, u8 const
     const bool successfullyQueued = queue.SplitAndAddMessage(overwritePriority == DeliveryPriority::INVALID ? GetPriorityOfMessage(data, sendData.dataLength) : overwritePriority, buffer, bufferSize, connectionPayloadSize, messageHandle);
 
     if(successfullyQueued){
+        if (connectionState == ConnectionState::DISABLED && GS->cm.IsDutyCycleActive()) GS->cm.dutyCycleSlotCounters.queuedPackets++;
         if (fillTxBuffers && connectionState != ConnectionState::DISABLED) FillTransmitBuffers(); //maybe sure?
        //update new if (fillTxBuffers) FillTransmitBuffers();
         return true;
     } else {
         GS->cm.droppedMeshPackets++;
         droppedPackets++;
+        if (GS->cm.IsDutyCycleActive()) GS->cm.dutyCycleSlotCounters.droppedPackets++;
 
         GS->logger.LogCustomCount(CustomErrorTypes::COUNT_DROPPED_PACKETS);
 
@@ -198,9 +256,10 @@ void BaseConnection::FillTransmitBuffers()
         ConnPacketHeader const* packetHeader = (ConnPacketHeader const*)data;
         //new
         ConnPacketModule* outPacket = (ConnPacketModule*)data;
-        if (packetHeader->messageType == MessageType::MODULE_TRIGGER_ACTION) {
+        //Shorter packets do not contain the direction and must not be written behind their end
+        if (packetHeader->messageType == MessageType::MODULE_TRIGGER_ACTION && packetLength >= SIZEOF_CONN_PACKET_MODULE) {
             ConnPacketModule const* packet = (ConnPacketModule const*)packetHeader;
-            if (packet->actionType == 5) {
+            if (packet->moduleId == ModuleId::NODE && packet->actionType == 5) {
                 outPacket->Currdirection= (direction == ConnectionDirection::DIRECTION_IN) ? 1 : 0;
             }
         }
@@ -255,6 +314,7 @@ void BaseConnection::FillTransmitBuffers()
                 SIMEXCEPTION(IllegalStateException);
             }
             activeQueue->IncrementLookAhead();
+            if (GS->cm.IsDutyCycleActive()) GS->cm.dutyCycleSlotCounters.sentPackets++;
             PacketSuccessfullyQueuedWithSoftdevice(&sizedData);
         }
         else if(err == ErrorType::BUSY)
@@ -269,14 +329,16 @@ void BaseConnection::FillTransmitBuffers()
         }
         else
         {
-            const char* tag = "WARNING";
             if (
                 err != ErrorType::BLE_INVALID_CONN_HANDLE // May happen e.g. if the connection is not fully created yet or was destroyed already.
                 )
             {
-                tag = "ERROR";
+                logt("ERROR", "GATT WRITE ERROR 0x%x on handle %u", (u32)err, connectionHandle);
+            }
+            else
+            {
+                logt("WARNING", "GATT WRITE ERROR 0x%x on handle %u", (u32)err, connectionHandle);
             }
-            logt(tag, "GATT WRITE ERROR 0x%x on handle %u", (u32)err, connectionHandle);
 
             GS->logger.LogCustomError(CustomErrorTypes::WARN_GATT_WRITE_ERROR, (u32)err);
 
@@ -368,18 +430,24 @@ void BaseConnection::HandlePacketSent(u8 sentUnreliable, u8 sentReliable)
             dataSentLength += (length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED - SIZEOF_CONN_PACKET_SPLIT_HEADER);
             DataSentHandler(dataSentBuffer, dataSentLength, messageHandle);
 #ifdef SIM_ENABLED
-            char stringBuffer[1000];
-            Logger::ConvertBufferToBase64String(dataSentBuffer, dataSentLength, stringBuffer, sizeof(stringBuffer));
-            logt("CONN", "DataSentHandler: %s", stringBuffer);
+            if (LOGT_ENABLED("CONN"))
+            {
+                char stringBuffer[1000];
+                Logger::ConvertBufferToBase64String(dataSentBuffer, dataSentLength, stringBuffer, sizeof(stringBuffer));
+                logt("CONN", "DataSentHandler: %s", stringBuffer);
+            }
 #endif
         }
         else
         {
             DataSentHandler(queueBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, messageHandle);
 #ifdef SIM_ENABLED
-            char stringBuffer[1000];
-            Logger::ConvertBufferToBase64String(queueBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, stringBuffer, sizeof(stringBuffer));
-            logt("CONN", "DataSentHandler: %s", stringBuffer);
+            if (LOGT_ENABLED("CONN"))
+            {
+                char stringBuffer[1000];
+                Logger::ConvertBufferToBase64String(queueBuffer + SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, length - SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED, stringBuffer, sizeof(stringBuffer));
+                logt("CONN", "DataSentHandler: %s", stringBuffer);
+            }
 #endif
         }
 
@@ -553,6 +621,7 @@ void BaseConnection::GapReconnectionSuccessfulHandler(const FruityHal::GapConnec
     //=> We expect the MTU to be the exact same value as the previous connection, otherwhise it gets dropped, so we do not need to reset it here even though a new gap connection will start with a smaller MTU
 
     connectionHandle = connectedEvent.GetConnectionHandle();
+    connectionIntervalUnits = connectedEvent.GetMinConnectionInterval();
 
     connectionState = ConnectionState::HANDSHAKE_DONE;
 }
@@ -593,6 +662,8 @@ bool BaseConnection::GapDisconnectionHandler(FruityHal::BleHciError hciDisconnec
 void BaseConnection::GapConnParamUpdateHandler(
         const FruityHal::BleGapConnParams & params)
 {
+    connectionIntervalUnits = params.minConnInterval;
+
 #if IS_ACTIVE(CONN_PARAM_UPDATE_LOGGING)
     logt(
         "CONN",
@@ -65,6 +65,22 @@ typedef struct BaseConnectionSendDataPacked {
 #pragma pack(pop)
 STATIC_ASSERT_SIZE(BaseConnectionSendDataPacked, SIZEOF_BASE_CONNECTION_SEND_DATA_PACKED);
 
+//Counters for the GENERATE_LOAD_CHUNK packets that are written on a connection
+struct LoadChunkCounters
+{
+    u32 sentPackets = 0;         //All packets that were written, including the colliding ones
+    u32 sameIntervalPackets = 0; //Packets that were written within the same connection interval as the previous one
+    u32 directionCollisions = 0; //Packets within the same connection interval that kept the direction of the previous one
+};
+
+//Counters of the slotted duty cycling of the mesh connections, see ConnectionManager::StartDutyCycle
+struct DutyCycleCounters
+{
+    u32 queuedPackets = 0;  //Packets that were queued on a connection while it was disabled
+    u32 sentPackets = 0;    //Packets that were handed to the BLE stack
+    u32 droppedPackets = 0; //Packets that were dropped because the send queue was full
+};
+
 class Node;
 class ConnectionManager;
 
@@ -154,6 +170,11 @@ class BaseConnection
 {
     private: 
         bool currentMessageIsMissingASplit = false;
+
+        //State of the GENERATE_LOAD_CHUNK delay and collision accounting, see AccountLoadChunkWrite
+        u32 loadChunkIntervalStartMs = 0; //Send time of the packet that started the current connection interval
+        bool loadChunkCurrentDirection = false; //Direction of the last packet written on this connection
+        LoadChunkCounters loadChunkCounters;
     protected:
         DeliveryPriority overwritePriority = DeliveryPriority::INVALID;
         u8 dataSentBuffer[MAX_MESH_PACKET_SIZE];
@@ -205,6 +226,9 @@ class BaseConnection
         //to this function is encrypted as well (e.g. in the MeshAccessConnection). This means that the data passed
         //to this function is the same as was returned by ProcessDataBeforeTransmission.
         virtual void DataSentHandler(const u8* data, MessageLength length, u32 messageHandle) {};
+        //Called by the HAL right before a GENERATE_LOAD_CHUNK packet is written, updates its timing and direction
+        //fields using the connection interval of this connection and counts it for this connection and the node
+        void AccountLoadChunkWrite(ConnPacketModule* packet);
 
         //Calls GetPriorityOfMessage of all modules to determine the priority of the message.
         DeliveryPriority GetPriorityOfMessage(const u8* data, MessageLength size);
@@ -247,6 +271,10 @@ class BaseConnection
         bool IsDisconnected() const{ return connectionState == ConnectionState::DISCONNECTED; };
         bool IsConnected() const{ return connectionState >= ConnectionState::CONNECTED; };
         bool HandshakeDone() const{ return connectionState >= ConnectionState::HANDSHAKE_DONE; };
+        //Returns the connection interval reported by the BLE stack or the configured one if none was reported yet
+        u32 GetConnectionIntervalMs() const;
+        const LoadChunkCounters& GetLoadChunkCounters() const{ return loadChunkCounters; };
+        void ResetLoadChunkCounters();
 
         //Variables
         u8 connectionId;
@@ -275,6 +303,7 @@ class BaseConnection
         //Partner
         NodeId partnerId = 0;
         u16 connectionHandle = FruityHal::FH_BLE_INVALID_HANDLE; //The handle that is given from the BLE stack to identify a connection
+        u16 connectionIntervalUnits = 0; //Connection interval in units of 1.25ms as reported by the BLE stack, 0 if unknown
         FruityHal::BleGapAddr partnerAddress;
 
         //Times
@@ -217,15 +217,115 @@ void ConnectionManager::SetMeshConnectionInterval(u16 connectionInterval) const
     }
 }
 
-//new ******* 參考node    GS->cm.SetMeshConnectionInterval(packet->newInterval);
+void ConnectionManager::StartDutyCycle(u32 slotLengthMs)
+{
+    if (slotLengthMs == 0) slotLengthMs = DUTY_CYCLE_DEFAULT_SLOT_LENGTH_MS;
 
-void ConnectionManager::UpdateState() {
-    BaseConnections conn = GS->cm.GetBaseConnections(ConnectionDirection::INVALID);
-    for (u32 i = 0; i < conn.count; i++)
+    //Slots are aligned to the connection interval so that both partners switch between the same connection events
+    const u32 connectionIntervalUs = Conf::GetInstance().meshMinConnectionInterval * CONFIG_UNIT_1_25_MS;
+    u32 slotLengthUs = slotLengthMs * 1000;
+    if (connectionIntervalUs != 0)
     {
-        if (conn.handles[i]) {
-            if ((conn.handles[i].GetConnectionState()) == ConnectionState::DISABLED) conn.handles[i].HANDSHAKE_DONE();
-            else if ((conn.handles[i].GetConnectionState()) == ConnectionState::HANDSHAKE_DONE) conn.handles[i].Disabled();
+        slotLengthUs = ((slotLengthUs + connectionIntervalUs - 1) / connectionIntervalUs) * connectionIntervalUs;
+    }
+
+    dutyCycleActive = true;
+    dutyCycleSlotLengthUs = slotLengthUs;
+    dutyCycleSlotCounters = DutyCycleCounters();
+    dutyCycleLastSlotCounters = DutyCycleCounters();
+    dutyCycleTotalCounters = DutyCycleCounters();
+    dutyCycleCompletedSlots = 0;
+    dutyCycleSlot = GetCurrentDutyCycleSlot();
+
+    logt("DUTY", "Duty cycle started, slot %u us, depth %d", slotLengthUs, GS->node.depth);
+
+    ApplyDutyCycleSlot();
+}
+
+void ConnectionManager::StopDutyCycle()
+{
+    if (!dutyCycleActive) return;
+    dutyCycleActive = false;
+
+    logt("DUTY", "Duty cycle stopped");
+
+    //Enable all connections again and send everything that was queued in the meantime
+    MeshConnections conns = GetMeshConnections(ConnectionDirection::INVALID);
+    for (u32 i = 0; i < conns.count; i++)
+    {
+        BaseConnection* conn = conns.handles[i].GetConnection();
+        if (conn != nullptr && conn->connectionState == ConnectionState::DISABLED)
+        {
+            conn->HANDSHAKE_DONE();
+            conn->FillTransmitBuffers();
+        }
+    }
+}
+
+bool ConnectionManager::UpdateDutyCycle()
+{
+    if (!dutyCycleActive) return false;
+
+    const u32 slot = GetCurrentDutyCycleSlot();
+    if (slot == dutyCycleSlot) return false;
+
+    logt("DUTY", "Slot %u done: queued %u, sent %u, dropped %u",
+        dutyCycleSlot,
+        dutyCycleSlotCounters.queuedPackets,
+        dutyCycleSlotCounters.sentPackets,
+        dutyCycleSlotCounters.droppedPackets);
+
+    dutyCycleLastSlotCounters = dutyCycleSlotCounters;
+    dutyCycleTotalCounters.queuedPackets += dutyCycleSlotCounters.queuedPackets;
+    dutyCycleTotalCounters.sentPackets += dutyCycleSlotCounters.sentPackets;
+    dutyCycleTotalCounters.droppedPackets += dutyCycleSlotCounters.droppedPackets;
+    dutyCycleCompletedSlots++;
+    dutyCycleSlotCounters = DutyCycleCounters();
+
+    dutyCycleSlot = slot;
+    ApplyDutyCycleSlot();
+
+    return true;
+}
+
+u32 ConnectionManager::GetCurrentDutyCycleSlot() const
+{
+    //GetRtcMs updates the synchronized delaytimer
+    FruityHal::GetRtcMs();
+    return (u32)((uint64_t)GS->delaytimer * 1000 / dutyCycleSlotLengthUs);
+}
+
+bool ConnectionManager::IsEnabledInDutyCycleSlot(NodeId partnerId, u32 slot) const
+{
+    //Without a sink, there is no tree and the connections stay enabled
+    if (GS->node.depth < 0) return true;
+
+    //A connection uses the phase of its child, which is our own depth for the connection to our parent
+    //and our depth + 1 for the connections to our children
+    const u32 phase = partnerId == GS->node.parent ? GS->node.depth : GS->node.depth + 1;
+    return slot % 2 == phase % 2;
+}
+
+void ConnectionManager::ApplyDutyCycleSlot() const
+{
+    MeshConnections conns = GetMeshConnections(ConnectionDirection::INVALID);
+    for (u32 i = 0; i < conns.count; i++)
+    {
+        BaseConnection* conn = conns.handles[i].GetConnection();
+        if (conn == nullptr) continue;
+
+        //Connections that are not set up completely or that are reestablishing are left alone
+        if (conn->connectionState != ConnectionState::HANDSHAKE_DONE && conn->connectionState != ConnectionState::DISABLED) continue;
+
+        if (!IsEnabledInDutyCycleSlot(conn->partnerId, dutyCycleSlot))
+        {
+            if (conn->connectionState == ConnectionState::HANDSHAKE_DONE) conn->Disabled();
+        }
+        else if (conn->connectionState == ConnectionState::DISABLED)
+        {
+            //Send everything that piled up while the connection was disabled right at the start of the slot
+            conn->HANDSHAKE_DONE();
+            conn->FillTransmitBuffers();
         }
     }
 }
@@ -319,7 +419,7 @@ void ConnectionManager::GATTServiceDiscoveredHandler(u16 connHandle, FruityHal::
 void ConnectionManager::ResolveConnection(BaseConnection* oldConnection, BaseConnectionSendData* sendData, u8 const * data)
 {
     //ConnectionTypeResolvers are collected in a special linker section
-    u8 numConnTypeResolvers = (((u32)__stop_conn_type_resolvers) - ((u32)__start_conn_type_resolvers)) / sizeof(u32);
+    u8 numConnTypeResolvers = (((uintptr_t)__stop_conn_type_resolvers) - ((uintptr_t)__start_conn_type_resolvers)) / sizeof(ConnTypeResolver);
     ConnTypeResolver* resolvers = (ConnTypeResolver*)__start_conn_type_resolvers;
 
     logt("RCONN", "numConnTypeResolvers %u", numConnTypeResolvers);
@@ -338,6 +438,7 @@ void ConnectionManager::ResolveConnection(BaseConnection* oldConnection, BaseCon
                     //First, we must update the pointer because the new connection might look for itself in the array
                     allConnections[i] = newConnection;
 
+                    newConnection->connectionIntervalUnits = oldConnection->connectionIntervalUnits;
                     newConnection->ConnectionSuccessfulHandler(oldConnection->connectionHandle);
                     newConnection->ReceiveDataHandler(sendData, data);
 
@@ -671,7 +772,7 @@ bool ConnectionManager::BroadcastMeshPacket(u8* data, u16 dataLength, bool relia
         if (conn.handles[i].IsHandshakeDone() == false) continue;
 
         //new
-        if(outPacket->actionType==5 && conn.handles[i].GetPartnerId() != GS->node.parent) continue;
+        if((outPacket->actionType==5 || packetHeader->messageType == MessageType::LOAD_AGGREGATE) && conn.handles[i].GetPartnerId() != GS->node.parent) continue;
 
         if (packetHeader->receiver == NODE_ID_ANYCAST_THEN_BROADCAST) {
             packetHeader->receiver = NODE_ID_BROADCAST;
@@ -775,9 +876,12 @@ void ConnectionManager::ForwardReceivedDataToConnection(u16 connectionHandle, Ba
 {
     logt("CM", "RX Data size is: %d, handles(%d, %d), delivery %d", sendData.dataLength.GetRaw(), connectionHandle, sendData.characteristicHandle, (u32)sendData.deliveryOption);
 
-    char stringBuffer[100];
-    Logger::ConvertBufferToHexString(data, sendData.dataLength, stringBuffer, sizeof(stringBuffer));
-    logt("CM", "%s", stringBuffer);
+    if (LOGT_ENABLED("CM"))
+    {
+        char stringBuffer[100];
+        Logger::ConvertBufferToHexString(data, sendData.dataLength, stringBuffer, sizeof(stringBuffer));
+        logt("CM", "%s", stringBuffer);
+    }
     //Get the handling connection for this write
     BaseConnection* connection = GS->cm.GetRawConnectionFromHandle(connectionHandle);
 
@@ -869,6 +973,13 @@ void ConnectionManager::RouteMeshData(BaseConnection* connection, BaseConnection
         if(packetHeader->messageType != MessageType::CLUSTER_INFO_UPDATE
             && packetHeader->messageType != MessageType::UPDATE_TIMESTAMP)
         {
+            //Load chunks on their way to the sink are sent to the parent in aggregates instead of one by one
+            if (!(routingDecision & ROUTING_DECISION_BLOCK_TO_MESH)
+                && GS->cm.loadAggregator.TakeOver(packetHeader, sendData->dataLength.GetRaw()))
+            {
+                return;
+            }
+
             //Send to all other connections
             BroadcastMeshData(connection, sendData, (const u8*)packetHeader, routingDecision);
         }
@@ -886,7 +997,7 @@ void ConnectionManager::BroadcastMeshData(const BaseConnection* ignoreConnection
             if (conn.handles[i] && conn.handles[i].GetConnection() != ignoreConnection) {
 
                 //new There's no need to broadcast; just send the packet to the root.
-                if (outPacket->actionType == 5 && conn.handles[i].GetPartnerId() != GS->node.parent) continue; 
+                if ((outPacket->actionType == 5 || outPacket->header.messageType == MessageType::LOAD_AGGREGATE) && conn.handles[i].GetPartnerId() != GS->node.parent) continue; 
 
                 sendData->characteristicHandle = ((MeshConnection*)conn.handles[i].GetConnection())->partnerWriteCharacteristicHandle;
                 ((MeshConnection*)conn.handles[i].GetConnection())->SendData(sendData, data);
@@ -1020,6 +1131,8 @@ u32 ConnectionManager::MessageTypeToMinimumPacketSize(MessageType messageType)
         return SIZEOF_CONN_PACKET_HEADER;
     case MessageType::CLC_DATA:
         return SIZEOF_CONN_PACKET_HEADER;
+    case MessageType::LOAD_AGGREGATE:
+        return SIZEOF_CONN_PACKET_LOAD_AGGREGATE;
     case MessageType::INVALID:
         // Fall-through
     case MessageType::RESERVED_BIT_END:
@@ -1144,6 +1257,7 @@ void ConnectionManager::GapConnectionConnectedHandler(const FruityHal::GapConnec
         peerAddress.addr = connectedEvent.GetPeerAddr();
 
         c = allConnections[id] = ConnectionAllocator::GetInstance().AllocateResolverConnection(id, ConnectionDirection::DIRECTION_IN, &peerAddress);
+        c->connectionIntervalUnits = connectedEvent.GetMinConnectionInterval();
         c->ConnectionSuccessfulHandler(connectedEvent.GetConnectionHandle());
 
 
@@ -1163,6 +1277,7 @@ void ConnectionManager::GapConnectionConnectedHandler(const FruityHal::GapConnec
         c = pendingConnection;
         pendingConnection = nullptr;
 
+        c->connectionIntervalUnits = connectedEvent.GetMinConnectionInterval();
         //Call Prepare again so that the clusterID and size backup are created with up to date values
         c->ConnectionSuccessfulHandler(connectedEvent.GetConnectionHandle());
 
@@ -1607,6 +1722,8 @@ void ConnectionManager::TimerEventHandler(u16 passedTimeDs)
         FillTransmitBuffers();
     }
 
+    loadAggregator.TimerEventHandler();
+
     {
         //Go through all connections to do periodic cleanup tasks and other periodic work
         BaseConnections conns = GetConnectionsOfType(ConnectionType::INVALID, ConnectionDirection::INVALID);
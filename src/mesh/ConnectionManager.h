@@ -40,6 +40,7 @@
 #include <BaseConnection.h>
 #include <MeshConnection.h>
 #include <ConnectionHandle.h>
+#include <LoadAggregator.h>
 
 struct BaseConnections
 {
@@ -95,9 +96,19 @@ private:
     BaseConnection* GetRawConnectionByUniqueId(u32 uniqueConnectionId) const;
     BaseConnection* GetRawConnectionFromHandle(u16 connectionHandle) const;
 
+    u32 GetCurrentDutyCycleSlot() const;
+    void ApplyDutyCycleSlot() const;
+
 TESTER_PUBLIC:
     BaseConnection* allConnections[TOTAL_NUM_CONNECTIONS];
 
+    //State of the slotted duty cycling, see StartDutyCycle
+    bool dutyCycleActive = false;
+    u32 dutyCycleSlotLengthUs = 0;  //Multiple of the mesh connection interval
+    u32 dutyCycleSlot = 0;          //Index of the current slot, counted from the start of the synchronized time
+
+    bool IsEnabledInDutyCycleSlot(NodeId partnerId, u32 slot) const;
+
 
 
 public:
@@ -117,6 +128,15 @@ public:
     u16 sentMeshPacketsUnreliable = 0;
     u16 sentMeshPacketsReliable = 0;
 
+    static constexpr u32 DUTY_CYCLE_DEFAULT_SLOT_LENGTH_MS = 100;
+    DutyCycleCounters dutyCycleSlotCounters;     //Counters of the current slot
+    DutyCycleCounters dutyCycleLastSlotCounters; //Counters of the last completed slot
+    DutyCycleCounters dutyCycleTotalCounters;    //Sum of all completed slots since the duty cycle was started
+    u32 dutyCycleCompletedSlots = 0;
+
+    //Coalesces forwarded GENERATE_LOAD_CHUNK messages, disabled by default
+    LoadAggregator loadAggregator;
+
     //ConnectionType Resolving
     void ResolveConnection(BaseConnection* oldConnection, BaseConnectionSendData* sendData, u8 const * data);
 
@@ -193,8 +213,16 @@ public:
 
     void SetMeshConnectionInterval(u16 connectionInterval) const;
 
-    //new *********************** 參考Setmeshconnectioninterval
-    void UpdateState();
+    //Slotted duty cycling of the mesh connections: Time is divided into slots and the connection to the parent
+    //is only enabled in every other slot, the connections to the children in the remaining ones. The phase is given by
+    //the parity of the tree depth (Node::depth), so both partners of a connection always agree on its state.
+    //The slot length is rounded up to a multiple of the mesh connection interval.
+    void StartDutyCycle(u32 slotLengthMs);
+    void StopDutyCycle();
+    bool IsDutyCycleActive() const { return dutyCycleActive; }
+    u32 GetDutyCycleSlotLengthUs() const { return dutyCycleSlotLengthUs; }
+    //Must be called periodically, returns true if a new slot was entered
+    bool UpdateDutyCycle();
 
 #if IS_ACTIVE(CONN_PARAM_UPDATE)
     /// Iterate through the mesh connections and update the connection
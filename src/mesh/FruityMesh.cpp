@@ -636,7 +636,7 @@ void HardFaultErrorHandler(stacked_regs_t* stack)
     }
 
     // The call to CalculateCrc32 is not valid inside a HARDFAULT-handler as it executes a return-instruction.
-    // This lambda will be inlined - it is copy-pasta from the code of CalculateCrc32.
+    // This lambda will be inlined - it is the bitwise variant of CalculateCrc32 which does not need the lookup tables.
     ramRetainStruct.crc32 = [] (const u8* message, const u32 messageLength, const u32 previousCrc = 0) {
         u32 crc = ~previousCrc;
         for(u32 i = 0; i < messageLength; i++) {
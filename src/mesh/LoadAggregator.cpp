@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#include "LoadAggregator.h"
+#include "GlobalState.h"
+#include "Utility.h"
+
+bool LoadAggregator::TakeOver(ConnPacketHeader const * packetHeader, u16 dataLength)
+{
+    if (!enabled) return false;
+
+    //Load chunks are only sent along the tree towards the sink, so must be the aggregates
+    if (packetHeader->receiver < NODE_ID_DEVICE_BASE || packetHeader->receiver >= NODE_ID_DEVICE_BASE + NODE_ID_DEVICE_BASE_SIZE) return false;
+    if (GS->node.parent == NODE_ID_INVALID || !GS->cm.GetMeshConnectionToPartner(GS->node.parent)) return false;
+
+    constexpr u32 maxPayloadLength = MAX_MESH_PACKET_SIZE - SIZEOF_CONN_PACKET_LOAD_AGGREGATE - SIZEOF_LOAD_AGGREGATE_ENTRY;
+
+    if (packetHeader->messageType == MessageType::MODULE_TRIGGER_ACTION)
+    {
+        ConnPacketModule const * packet = (ConnPacketModule const *)packetHeader;
+        if (dataLength < SIZEOF_CONN_PACKET_MODULE
+            || dataLength - SIZEOF_CONN_PACKET_MODULE > maxPayloadLength
+            || packet->moduleId != ModuleId::NODE
+            || packet->actionType != 5) //GENERATE_LOAD_CHUNK
+        {
+            return false;
+        }
+
+        AddEntry(packetHeader->receiver, packetHeader->sender, packet->timestamp, packet->data, dataLength - SIZEOF_CONN_PACKET_MODULE);
+        return true;
+    }
+    else if (packetHeader->messageType == MessageType::LOAD_AGGREGATE)
+    {
+        if (dataLength < SIZEOF_CONN_PACKET_LOAD_AGGREGATE) return false;
+        ConnPacketLoadAggregate const * packet = (ConnPacketLoadAggregate const *)packetHeader;
+        u8 const * begin = (u8 const *)packet + SIZEOF_CONN_PACKET_LOAD_AGGREGATE;
+        u8 const * end = (u8 const *)packet + dataLength;
+
+        //Check all entries first, a malformed aggregate is forwarded unchanged
+        u8 const * entryData = begin;
+        for (u32 i = 0; i < packet->amountOfEntries; i++)
+        {
+            LoadAggregateEntry const * entry = (LoadAggregateEntry const *)entryData;
+            if (entryData + SIZEOF_LOAD_AGGREGATE_ENTRY > end
+                || entryData + SIZEOF_LOAD_AGGREGATE_ENTRY + entry->payloadLength > end)
+            {
+                return false;
+            }
+            entryData += SIZEOF_LOAD_AGGREGATE_ENTRY + entry->payloadLength;
+        }
+
+        entryData = begin;
+        for (u32 i = 0; i < packet->amountOfEntries; i++)
+        {
+            LoadAggregateEntry const * entry = (LoadAggregateEntry const *)entryData;
+            AddEntry(packetHeader->receiver, entry->sender, entry->timestamp, entryData + SIZEOF_LOAD_AGGREGATE_ENTRY, entry->payloadLength);
+            entryData += SIZEOF_LOAD_AGGREGATE_ENTRY + entry->payloadLength;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void LoadAggregator::AddEntry(NodeId receiver, NodeId sender, u32 timestamp, u8 const * payload, u8 payloadLength)
+{
+    ConnPacketLoadAggregate* aggregate = (ConnPacketLoadAggregate*)buffer;
+    const u16 entryLength = SIZEOF_LOAD_AGGREGATE_ENTRY + payloadLength;
+
+    if (bufferLength > 0
+        && (aggregate->header.receiver != receiver
+            || bufferLength + entryLength > maxBufferLength
+            || aggregate->amountOfEntries == UINT8_MAX))
+    {
+        Flush();
+    }
+
+    if (bufferLength == 0)
+    {
+        CheckedMemset(buffer, 0, sizeof(buffer));
+        aggregate->header.messageType = MessageType::LOAD_AGGREGATE;
+        aggregate->header.sender = GS->node.configuration.nodeId;
+        aggregate->header.receiver = receiver;
+        aggregate->amountOfEntries = 0;
+        bufferLength = SIZEOF_CONN_PACKET_LOAD_AGGREGATE;
+        pendingSinceMs = GS->delaytimer;
+
+        //An aggregate should fit into a single write to the parent, an entry that is larger is still sent alone
+        MeshConnectionHandle parentConnection = GS->cm.GetMeshConnectionToPartner(GS->node.parent);
+        maxBufferLength = parentConnection ? parentConnection.GetConnection()->connectionPayloadSize : MAX_DATA_SIZE_PER_WRITE;
+        if (maxBufferLength < bufferLength + entryLength) maxBufferLength = bufferLength + entryLength;
+        if (maxBufferLength > sizeof(buffer)) maxBufferLength = sizeof(buffer);
+    }
+
+    LoadAggregateEntry* entry = (LoadAggregateEntry*)(buffer + bufferLength);
+    entry->sender = sender;
+    entry->timestamp = timestamp;
+    entry->payloadLength = payloadLength;
+    if (payloadLength > 0) CheckedMemcpy(buffer + bufferLength + SIZEOF_LOAD_AGGREGATE_ENTRY, payload, payloadLength);
+    bufferLength += entryLength;
+    aggregate->amountOfEntries++;
+    aggregatedChunks++;
+}
+
+void LoadAggregator::Flush()
+{
+    if (bufferLength == 0) return;
+
+    //The parent might have changed since the aggregate was started, it is routed as usual then
+    MeshConnectionHandle parentConnection = GS->cm.GetMeshConnectionToPartner(GS->node.parent);
+    if (GS->node.parent == NODE_ID_INVALID || !parentConnection || !parentConnection.SendData(buffer, bufferLength, false))
+    {
+        GS->cm.SendMeshMessage(buffer, bufferLength);
+    }
+    sentAggregates++;
+    bufferLength = 0;
+}
+
+bool LoadAggregator::IsPending() const
+{
+    return bufferLength > 0;
+}
+
+void LoadAggregator::TimerEventHandler()
+{
+    if (bufferLength > 0 && GS->delaytimer - pendingSinceMs >= flushDeadlineMs)
+    {
+        logt("CM", "Flushing load aggregate after %u ms", GS->delaytimer - pendingSinceMs);
+        Flush();
+    }
+}
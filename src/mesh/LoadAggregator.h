@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "FmTypes.h"
+#include "Config.h"
+
+/*
+ * Coalesces the GENERATE_LOAD_CHUNK messages that this node forwards towards its parent into LOAD_AGGREGATE messages.
+ * Chunks are collected as long as the aggregate fits into a single write on the connection to the parent. The aggregate
+ * is sent once the next chunk does not fit, a chunk for another receiver arrives or the flush deadline has passed.
+ * Every entry keeps the sender and the generation timestamp of its chunk, so that the receiver can still compute
+ * the delay per source. Aggregates that are only forwarded are merged in the same way.
+ */
+class LoadAggregator
+{
+private:
+    u8 buffer[MAX_MESH_PACKET_SIZE];
+    u16 bufferLength = 0;    //0 if no aggregate is pending
+    u16 maxBufferLength = 0; //Size limit of the pending aggregate
+    u32 pendingSinceMs = 0;  //delaytimer at which the first entry of the pending aggregate was added
+
+    void AddEntry(NodeId receiver, NodeId sender, u32 timestamp, u8 const * payload, u8 payloadLength);
+
+public:
+    static constexpr u32 DEFAULT_FLUSH_DEADLINE_MS = 100;
+
+    bool enabled = false;
+    u32 flushDeadlineMs = DEFAULT_FLUSH_DEADLINE_MS;
+
+    u32 aggregatedChunks = 0; //Chunks that were put into an aggregate
+    u32 sentAggregates = 0;
+
+    //Takes over a GENERATE_LOAD_CHUNK or LOAD_AGGREGATE message that this node has to forward
+    //Returns false if aggregation is disabled or not possible and the message must be routed as usual
+    bool TakeOver(ConnPacketHeader const * packetHeader, u16 dataLength);
+
+    //Sends the pending aggregate, if there is one
+    void Flush();
+    bool IsPending() const;
+
+    void TimerEventHandler();
+};
@@ -604,10 +604,13 @@ void MeshAccessConnection::OnCorruptedMessage()
 void MeshAccessConnection::LogKeys()
 {
     //Log encryption and decryption keys
-    TO_HEX(sessionEncryptionKey, 16);
-    TO_HEX(sessionDecryptionKey, 16);
-    logt("MACONN", "EncrKey: %s", sessionEncryptionKeyHex);
-    logt("MACONN", "DecrKey: %s", sessionDecryptionKeyHex);
+    if (LOGT_ENABLED("MACONN"))
+    {
+        TO_HEX(sessionEncryptionKey, 16);
+        TO_HEX(sessionDecryptionKey, 16);
+        logt("MACONN", "EncrKey: %s", sessionEncryptionKeyHex);
+        logt("MACONN", "DecrKey: %s", sessionDecryptionKeyHex);
+    }
 }
 
 /**
@@ -623,8 +626,11 @@ void MeshAccessConnection::LogKeys()
  */
 void MeshAccessConnection::EncryptPacket(u8* data, MessageLength dataLength)
 {
-    TO_HEX(data, dataLength.GetRaw());
-    logt("MACONN", "Encrypting %s (%u) with nonce %u", dataHex, dataLength.GetRaw(), encryptionNonce[1]);
+    if (LOGT_ENABLED("MACONN"))
+    {
+        TO_HEX(data, dataLength.GetRaw());
+        logt("MACONN", "Encrypting %s (%u) with nonce %u", dataHex, dataLength.GetRaw(), encryptionNonce[1]);
+    }
 
     u8 cleartext[16];
     u8 keystream[16];
@@ -693,18 +699,24 @@ void MeshAccessConnection::EncryptPacket(u8* data, MessageLength dataLength)
     CheckedMemcpy(micPtr, keystream, MESH_ACCESS_MIC_LENGTH);
 
     //Log the encrypted packet
-    DYNAMIC_ARRAY(data2, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
-    CheckedMemcpy(data2, data, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
-    TO_HEX(data2, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
-    logt("MACONN", "Encrypted as %s (%u)", data2Hex, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
+    if (LOGT_ENABLED("MACONN"))
+    {
+        DYNAMIC_ARRAY(data2, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
+        CheckedMemcpy(data2, data, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
+        TO_HEX(data2, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
+        logt("MACONN", "Encrypted as %s (%u)", data2Hex, dataLength.GetRaw() + MESH_ACCESS_MIC_LENGTH);
+    }
 }
 
 bool MeshAccessConnection::DecryptPacket(u8 const * data, u8 * decryptedOut, MessageLength dataLength)
 {
     if(dataLength < 4) return false;
 
-    TO_HEX(data, dataLength.GetRaw());
-    logt("MACONN", "Decrypting %s (%u) with nonce %u", dataHex, dataLength.GetRaw(), decryptionNonce[1]);
+    if (LOGT_ENABLED("MACONN"))
+    {
+        TO_HEX(data, dataLength.GetRaw());
+        logt("MACONN", "Decrypting %s (%u) with nonce %u", dataHex, dataLength.GetRaw(), decryptionNonce[1]);
+    }
 
     u8 cleartext[16];
     u8 keystream[16];
@@ -761,8 +773,11 @@ bool MeshAccessConnection::DecryptPacket(u8 const * data, u8 * decryptedOut, Mes
     //logt("MACONN", "MIC nonce %u, Keystream %s", decryptionNonce[1], keystream2Hex);
 
 
-    TO_HEX(decryptedOut, dataLength.GetRaw() - MESH_ACCESS_MIC_LENGTH);
-    logt("MACONN", "Decrypted as %s (%u) micValid %u", decryptedOutHex, dataLength.GetRaw() - MESH_ACCESS_MIC_LENGTH, micCheck == 0);
+    if (LOGT_ENABLED("MACONN"))
+    {
+        TO_HEX(decryptedOut, dataLength.GetRaw() - MESH_ACCESS_MIC_LENGTH);
+        logt("MACONN", "Decrypted as %s (%u) micValid %u", decryptedOutHex, dataLength.GetRaw() - MESH_ACCESS_MIC_LENGTH, micCheck == 0);
+    }
 
     return micCheck == 0;
 }
@@ -1089,16 +1104,22 @@ void MeshAccessConnection::ReceiveMeshAccessMessageHandler(BaseConnectionSendDat
         tunnelType == MeshAccessTunnelType::PEER_TO_PEER
         || tunnelType == MeshAccessTunnelType::REMOTE_MESH
     ){
-        TO_HEX(data, sendData->dataLength.GetRaw());
-        logt("MACONN", "Received remote mesh data %s (%u) from %u", dataHex, sendData->dataLength.GetRaw(), packetHeader->sender);
+        if (LOGT_ENABLED("MACONN"))
+        {
+            TO_HEX(data, sendData->dataLength.GetRaw());
+            logt("MACONN", "Received remote mesh data %s (%u) from %u", dataHex, sendData->dataLength.GetRaw(), packetHeader->sender);
+        }
 
         //Only dispatch to the local node, virtualPartnerId and remote nodeIds are kept in tact
         if(auth <= MeshAccessAuthorization::LOCAL_ONLY) GS->cm.DispatchMeshMessage(this, sendData, packetHeader, true);
     }
     else if(tunnelType == MeshAccessTunnelType::LOCAL_MESH)
     {
-        TO_HEX(data, sendData->dataLength.GetRaw());
-        logt("MACONN", "Received data for local mesh %s (%u) from %u aka %u", dataHex, sendData->dataLength.GetRaw(), packetHeader->sender, virtualPartnerId);
+        if (LOGT_ENABLED("MACONN"))
+        {
+            TO_HEX(data, sendData->dataLength.GetRaw());
+            logt("MACONN", "Received data for local mesh %s (%u) from %u aka %u", dataHex, sendData->dataLength.GetRaw(), packetHeader->sender, virtualPartnerId);
+        }
 
         //Send to other Mesh-like Connections
         if(auth <= MeshAccessAuthorization::WHITELIST) GS->cm.RouteMeshData(this, sendData, (u8 const*)packetHeader);
@@ -387,9 +387,6 @@ bool MeshConnection::SendData(BaseConnectionSendData* sendData, u8 const * data,
         }
     }*/
 
-    char stringBuffer[100];
-    Logger::ConvertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
-
     //Mesh connections only support write cmd and req, no notifications,...
     if(sendData->deliveryOption != DeliveryOption::WRITE_CMD
         && sendData->deliveryOption != DeliveryOption::WRITE_REQ){
@@ -402,8 +399,13 @@ bool MeshConnection::SendData(BaseConnectionSendData* sendData, u8 const * data,
     //sending of packets by a factor of 14, so we only use them for mesh critical functionality such as clustering
     sendData->deliveryOption = DeliveryOption::WRITE_CMD;
 
-    logt("CONN_DATA", "PUT_PACKET(%d):len:%d,type:%d,hex:%s",
-            connectionId, sendData->dataLength.GetRaw(), (u32)packetHeader->messageType, stringBuffer);
+    if (LOGT_ENABLED("CONN_DATA"))
+    {
+        char stringBuffer[100];
+        Logger::ConvertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
+        logt("CONN_DATA", "PUT_PACKET(%d):len:%d,type:%d,hex:%s",
+                connectionId, sendData->dataLength.GetRaw(), (u32)packetHeader->messageType, stringBuffer);
+    }
 
     //Put packet in the queue for sending
     return QueueData(*sendData, data, messageHandle);
@@ -516,9 +518,12 @@ void MeshConnection::ReceiveDataHandler(BaseConnectionSendData* sendData, u8 con
         GS->lastReceivedFromSinkTimestamp = FruityHal::GetRtcMs();
     }
 
-    char stringBuffer[200];
-    Logger::ConvertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
-    logt("CONN_DATA", "Mesh RX %d,length:%d,deliv:%d,data:%s", (u32)packetHeader->messageType, sendData->dataLength.GetRaw(), (u32)sendData->deliveryOption, stringBuffer);
+    if (LOGT_ENABLED("CONN_DATA"))
+    {
+        char stringBuffer[200];
+        Logger::ConvertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
+        logt("CONN_DATA", "Mesh RX %d,length:%d,deliv:%d,data:%s", (u32)packetHeader->messageType, sendData->dataLength.GetRaw(), (u32)sendData->deliveryOption, stringBuffer);
+    }
 
     //This will reassemble the data for us
     data = ReassembleData(sendData, data);
@@ -546,6 +551,7 @@ void MeshConnection::ReceiveMeshMessageHandler(BaseConnectionSendData* sendData,
         GS->logger.LogCustomCount(CustomErrorTypes::COUNT_WARN_RX_WRONG_DATA);
     }
     //Print packet as hex
+    if (LOGT_ENABLED("CONN_DATA"))
     {
         char stringBuffer[100];
         Logger::ConvertBufferToHexString(data, sendData->dataLength, stringBuffer, sizeof(stringBuffer));
@@ -965,6 +971,7 @@ bool MeshConnection::IsValidMessageType(MessageType t)
         case(MessageType::COMPONENT_ACT):
         case(MessageType::TIME_SYNC):
         case(MessageType::CAPABILITY):
+        case(MessageType::LOAD_AGGREGATE):
             return true;
         default:
             SIMEXCEPTION(MessageTypeInvalidException);
@@ -1004,6 +1011,7 @@ void MeshConnection::PrintStatus()
 void MeshConnection::SetHopsToSink(ClusterSize hops)
 {
     hopsToSink = hops;
+    GS->node.UpdateTreePosition();
 }
 
 ClusterSize MeshConnection::GetHopsToSink()
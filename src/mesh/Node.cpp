@@ -70,18 +70,9 @@ constexpr u16 MESH_SERVICE_CHARACTERISTIC_UUID = 0x1524;
 
 //new
 NodeId root;
-int init =-1;  //初始化
 int numNodes = -1; //Node數
-int flag = -1; // 開關用
 int counta = 0; // 測試關閉啟用count數
-int testdis=0;
-//new: avg delay
-u8 TOTAL_NODE_NUM = -1;//nnber 注意 17
 
-u32 MultipleCount[16];
-u32 CollsndCount[16];
-u32 avgDelay[16];
-int rcvCount[16];
 
 int ssettime=-1; // ssettime 開關
 int adjust=-1; //調整誤差 開關
@@ -398,6 +389,8 @@ void Node::HandshakeDoneHandler(MeshConnection* connection, bool completedAsWinn
     //the cluster update above, but that requires more debugging to get it correctly working
     SendClusterInfoUpdate(connection, nullptr);
 
+    UpdateTreePosition();
+
     //Call our lovely modules
     for(u32 i=0; i<GS->amountOfModules; i++){
         if(GS->activeModules[i]->configurationPointer->moduleActive){
@@ -565,6 +558,9 @@ void Node::MeshConnectionDisconnectedHandler(AppDisconnectReason appDisconnectRe
     //Pass on the masterbit to someone if necessary
     HandOverMasterBitIfNecessary();
 
+    //The lost connection might have been the one to our parent
+    UpdateTreePosition();
+
     //Revert to discovery high
     // FIXME: is it needed?
     noNodesFoundCounter = 0;
@@ -605,6 +601,7 @@ void Node::ReceiveClusterInfoUpdate(MeshConnection* connection, ConnPacketCluste
     //Another sink may have joined or left the network, update this
     //FIXME: race conditions can cause this to work incorrectly...
     connection->hopsToSink = packet->payload.hopsToSink > -1 ? packet->payload.hopsToSink + 1 : -1;
+    UpdateTreePosition();
     
     //Now look if our partner has passed over the connection master bit
     if(packet->payload.connectionMasterBitHandover){
@@ -639,6 +636,34 @@ void Node::ReceiveClusterInfoUpdate(MeshConnection* connection, ConnPacketCluste
      */
 }
 
+void Node::UpdateTreePosition()
+{
+    NodeId newParent = NODE_ID_INVALID;
+    ClusterSize newDepth = -1;
+
+    if (GET_DEVICE_TYPE() == DeviceType::SINK)
+    {
+        newDepth = 0;
+    }
+    else
+    {
+        //The hops that our partners report exclude the connection to us, so a child is never chosen as our parent
+        MeshConnectionHandle conn = GS->cm.GetMeshConnectionToShortestSink(nullptr);
+        if (conn)
+        {
+            newParent = conn.GetPartnerId();
+            newDepth = conn.GetHopsToSink();
+        }
+    }
+
+    if (newParent != parent || newDepth != depth)
+    {
+        logt("NODE", "Tree position changed, parent %u, depth %d", newParent, newDepth);
+        parent = newParent;
+        depth = newDepth;
+    }
+}
+
 void Node::HandOverMasterBitIfNecessary()  const{
     //If we have all masterbits, we can give 1 at max
     //We do this, if the connected cluster size is bigger than all the other connected cluster sizes summed together
@@ -768,6 +793,29 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
     }
 
 
+    //Unpack the chunks that forwarding nodes coalesced on their way to us
+    if(packetHeader->messageType == MessageType::LOAD_AGGREGATE
+        && sendData->dataLength >= SIZEOF_CONN_PACKET_LOAD_AGGREGATE)
+    {
+        ConnPacketLoadAggregate const * packet = (ConnPacketLoadAggregate const *)packetHeader;
+        u8 const * entryData = (u8 const *)packet + SIZEOF_CONN_PACKET_LOAD_AGGREGATE;
+        u8 const * end = (u8 const *)packet + sendData->dataLength.GetRaw();
+
+        for (u32 i = 0; i < packet->amountOfEntries; i++)
+        {
+            LoadAggregateEntry const * entry = (LoadAggregateEntry const *)entryData;
+            if (entryData + SIZEOF_LOAD_AGGREGATE_ENTRY > end
+                || entryData + SIZEOF_LOAD_AGGREGATE_ENTRY + entry->payloadLength > end)
+            {
+                logt("WARNING", "Malformed load aggregate");
+                break;
+            }
+            //The time at which the chunk was first sent is not transported in aggregates
+            ReceiveLoadChunk(entry->sender, packetHeader->receiver, entry->timestamp, 0, entryData + SIZEOF_LOAD_AGGREGATE_ENTRY, entry->payloadLength);
+            entryData += SIZEOF_LOAD_AGGREGATE_ENTRY + entry->payloadLength;
+        }
+    }
+
     if(packetHeader->messageType == MessageType::MODULE_TRIGGER_ACTION){
         ConnPacketModule const * packet = (ConnPacketModule const *)packetHeader;
 
@@ -837,7 +885,9 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
                 );
             }
 
-            else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::START_GENERATE_LOAD) {
+            //multi_generate_load broadcasts the trigger, the target of the load does not send load to itself
+            else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::START_GENERATE_LOAD
+                && !(packetHeader->receiver == NODE_ID_BROADCAST && ((GenerateLoadTriggerMessage const *)packet->data)->target == configuration.nodeId)) {
                 GenerateLoadTriggerMessage const * message = (GenerateLoadTriggerMessage const *)packet->data;
                 generateLoadTarget = message->target;
                 generateLoadPayloadSize = message->size;
@@ -869,44 +919,8 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
             }
 
             else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::GENERATE_LOAD_CHUNK) {
-                u8 const * payload = packet->data;
-                bool payloadCorrect = true;
                 const u8 payloadLength = sendData->dataLength.GetRaw() - SIZEOF_CONN_PACKET_MODULE;
-                for (u32 i = 0; i < payloadLength; i++)
-                {
-                    if (payload[i] != generateLoadMagicNumber)
-                    {
-                        payloadCorrect = false;
-                    }
-                }
-                //new: calculate packet delay nonimportant
-                u32 packetReceivedTime = GS->delaytimer;
-                u32 packetDelay = 0;
-                if (packetReceivedTime >= packet->timestamp)
-                    packetDelay = packetReceivedTime - packet->timestamp;
-                else
-                    packetDelay = packet->timestamp - packetReceivedTime;
-
-                avgDelay[packetHeader->sender - 1] += packetDelay;
-                rcvCount[packetHeader->sender - 1] += 1;
-
-
-                for (u32 i = 0; i < payloadLength; i++)
-                {
-                    if (payload[i] != generateLoadMagicNumber)
-                    {
-                        payloadCorrect = false;
-                    }
-                }
-
-                if (payloadCorrect == true && configuration.nodeId == packetHeader->receiver && packetHeader->sender != 10)
-                    GS->rcvCount += 1;
-
-                if ((GS->rcvCount % 1000) == 0)
-                {
-                    logjson("NODE", "{\"type\":\"generate_load_chunk\",\"nodeId\":%d,\"size\":%u,\"payloadCorrect\":%u,\"receivedTime\":%u, \"stamp\":%u, \"delay\":%u}" SEP, packetHeader->sender, (u32)payloadLength, (u32)payloadCorrect, packetReceivedTime, packet->timestamp, packetDelay);
-                }
-                trace("node id : %d, generateTime : %u ms, sendTime : %u ms, receivedTime : %u ms, delay : %u ms," EOL, packetHeader->sender,packet->timestamp,packet->sendtime,packetReceivedTime,packetDelay);
+                ReceiveLoadChunk(packetHeader->sender, packetHeader->receiver, packet->timestamp, packet->sendtime, packet->data, payloadLength);
             }
             //new collect data
             else if(packet->actionType == (u8)NodeModuleTriggerActionMessages::COLLECT_TRANSMIT_DATA)
@@ -937,58 +951,75 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
             else if(packet->actionType == (u8)NodeModuleTriggerActionMessages::TRANSMIT_DATA_CollsndCount)
             {
                 GS->CollsndCount+=(u32)packet->requestHandle;
-                CollsndCount[packetHeader->sender-1]+=(u32)packet->requestHandle;
+#ifdef SIM_ENABLED
+                loadStatistics.RecordSentPackets(packetHeader->sender, packet->requestHandle);
+#endif
             }
             //new collect data
             else if(packet->actionType == (u8)NodeModuleTriggerActionMessages::TRANSMIT_DATA_MultipleCount)
             {
-                 GenerateLoadTriggerMessage const * message = (GenerateLoadTriggerMessage const *)packet->data; //new
                 GS->MultipleCount+=(u32)packet->requestHandle;
-                MultipleCount[packetHeader->sender-1]+=(u32)packet->requestHandle;
+#ifdef SIM_ENABLED
+                loadStatistics.RecordSentPackets(packetHeader->sender, packet->requestHandle * GS->MultipleUnit);
+#endif
                 trace("GS->MultipleCount %u" EOL, GS->MultipleCount);
-               
+            }
+            else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::GET_LOAD_STATISTICS)
+            {
+                GetLoadStatisticsMessage const * message = (GetLoadStatisticsMessage const *)packet->data;
 
-                
+                GetLoadStatisticsResponseMessage response;
+                CheckedMemset(&response, 0, sizeof(response));
+                response.sender = message->sender;
+#ifdef SIM_ENABLED
+                const LoadStatistics::Summary summary = loadStatistics.GetSummary(message->sender);
+                response.senders = (u16)summary.senders;
+                response.receivedPackets = summary.receivedPackets;
+                response.corruptedPackets = summary.corruptedPackets;
+                response.sentPackets = summary.sentPackets;
+                response.minDelayMs = summary.minDelayMs;
+                response.medianDelayMs = summary.medianDelayMs;
+                response.p99DelayMs = summary.p99DelayMs;
+                response.maxDelayMs = summary.maxDelayMs;
+                response.averageDelayMs = summary.averageDelayMs;
+#else
+                //The firmware keeps no statistics per sender and no delays, only the packet counts of all senders
+                if (message->sender == NODE_ID_BROADCAST)
+                {
+                    response.receivedPackets = GS->rcvCount;
+                    response.sentPackets = GS->CollsndCount + GS->MultipleCount * GS->MultipleUnit;
+                }
+#endif
+
+                SendModuleActionMessage(
+                    MessageType::MODULE_ACTION_RESPONSE,
+                    packetHeader->sender,
+                    (u8)NodeModuleActionResponseMessages::GET_LOAD_STATISTICS_RESULT,
+                    packet->requestHandle,
+                    (u8*)&response,
+                    sizeof(response),
+                    false
+                );
             }
 
             //new find_degree
+            //The depth (deg) and the parent are kept up to date from the hops to the sink, see UpdateTreePosition,
+            //so this only reports them and passes the request down the tree
             else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::FIND_DEGREE)
             {
-                TOTAL_NODE_NUM = 3;
-
-                    /*初始化deg記憶體空間==-1*/
-                if (init == -1) {
-
-
-                    for (int i = 0; i <= TOTAL_NODE_NUM; i++) {
-                        deg[i] = -1;
-                    }
-
-                    init = 1;
-                 }
-
-                    /*設置deg*/
-                deg[packetHeader->sender]= ((u32)packet->requestHandle);
-                trace("Node: %d  deg: %d\n" EOL, packetHeader->sender, deg[packetHeader->sender]);//test
-                if (packetHeader->receiver != root) {
-                    deg[packetHeader->receiver] = ((u32)packet->requestHandle) + 1;
-                    GS->node.parent = packetHeader->sender;
-                }
-                else GS->node.parent = 255; // 如顯示255;
-
-                trace("Node: %d  deg: %d\n" EOL, packetHeader->receiver, deg[packetHeader->receiver]);
+                UpdateTreePosition();
+                trace("Node: %d  deg: %d  parent: %d\n" EOL, configuration.nodeId, depth, parent);
                 
                  BaseConnections conn = GS->cm.GetBaseConnections(ConnectionDirection::INVALID);
                  for (u8 i = 0; i < conn.count; i++)
                   {
                   if (conn.handles[i]) {
                     if (GS->node.parent != conn.handles[i].GetPartnerId()) {
-                        deg[conn.handles[i].GetPartnerId()] = deg[packetHeader->receiver] + 1;
                        SendModuleActionMessage(
                        MessageType::MODULE_TRIGGER_ACTION, //MessageType messageType
                        conn.handles[i].GetPartnerId(),     //NodeId toNode
                        (u8)NodeModuleTriggerActionMessages::FIND_DEGREE,                                 //u8 actionType
-                       deg[packetHeader->receiver],                                  //u8 requestHandle 將目前deg的值傳給兒子
+                       (u8)depth,                          //u8 requestHandle 將目前deg的值傳給兒子
                        nullptr,                            //const u8* additionalData
                        0,                                  //u16 additionalDataSize
                        false                              //bool reliable
@@ -1015,7 +1046,7 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
                                 false                              //bool reliable
                             );
                         }
-                        else if (deg[packetHeader->receiver] % 2 != 0) {
+                        else if (depth > 0 && depth % 2 != 0) {
                             trace("禁用\n");//test
                             SendModuleActionMessage(
                                 MessageType::MODULE_TRIGGER_ACTION, //MessageType messageType
@@ -1052,7 +1083,24 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
             }
             //new set_flag 切換啟用禁用 (當網路完成初始化)
             else if (packet->actionType == (u8)NodeModuleTriggerActionMessages::SET_FLAG)
-            {   flag=1;
+            {
+                u32 slotLengthMs = ConnectionManager::DUTY_CYCLE_DEFAULT_SLOT_LENGTH_MS;
+                if (sendData->dataLength.GetRaw() >= SIZEOF_CONN_PACKET_MODULE + sizeof(SetFlagMessage))
+                {
+                    slotLengthMs = ((SetFlagMessage const *)packet->data)->slotLengthMs;
+                }
+
+                //The phase of the slots is given by our depth, without a sink the connections stay enabled
+                if (depth < 0)
+                {
+                    logt("WARNING", "Duty cycle needs a sink to find the depth of the node");
+                }
+                GS->cm.StartDutyCycle(slotLengthMs);
+
+                SetFlagMessage message;
+                CheckedMemset(&message, 0x00, sizeof(message));
+                message.slotLengthMs = (u16)slotLengthMs;
+
                 BaseConnections conn = GS->cm.GetBaseConnections(ConnectionDirection::INVALID);
                 for (u8 i = 0; i < conn.count; i++)
                 {
@@ -1062,9 +1110,9 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
                         MessageType::MODULE_TRIGGER_ACTION, //MessageType messageType
                         conn.handles[i].GetPartnerId(),     //NodeId toNode
                         (u8)NodeModuleTriggerActionMessages::SET_FLAG,                                 //u8 actionType
-                        deg[packetHeader->receiver],                                  //u8 requestHandle 將目前deg的值傳給兒子
-                        nullptr,                            //const u8* additionalData
-                        0,                                  //u16 additionalDataSize
+                        (u8)depth,                          //u8 requestHandle 將目前deg的值傳給兒子
+                        (u8*)&message,                      //const u8* additionalData
+                        sizeof(message),                    //u16 additionalDataSize
                         false                              //bool reliable
                         );
                     }
@@ -1354,6 +1402,27 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
             {
                 logjson("NODE", "{\"type\":\"start_generate_load_result\",\"nodeId\":%d,\"requestHandle\":%u}" SEP, packetHeader->sender, packet->requestHandle);
             }
+            else if (packet->actionType == (u8)NodeModuleActionResponseMessages::GET_LOAD_STATISTICS_RESULT)
+            {
+                GetLoadStatisticsResponseMessage const * message = (GetLoadStatisticsResponseMessage const *)packet->data;
+                //The packet delivery ratio is given in per mille of the packets that the senders reported as sent
+                const u32 pdrPerMille = message->sentPackets == 0 ? 0 : (u32)(1000.0f * message->receivedPackets / message->sentPackets);
+                logjson("NODE", "{\"type\":\"load_statistics_result\",\"nodeId\":%d,\"sender\":%u,\"senders\":%u,\"sent\":%u,\"received\":%u,\"corrupted\":%u,\"pdrPerMille\":%u,"
+                    "\"delayMs\":{\"min\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u,\"avg\":%u},\"requestHandle\":%u}" SEP,
+                    packetHeader->sender,
+                    message->sender,
+                    message->senders,
+                    message->sentPackets,
+                    message->receivedPackets,
+                    message->corruptedPackets,
+                    pdrPerMille,
+                    message->minDelayMs,
+                    message->medianDelayMs,
+                    message->p99DelayMs,
+                    message->maxDelayMs,
+                    message->averageDelayMs,
+                    packet->requestHandle);
+            }
             else if (packet->actionType == (u8)NodeModuleActionResponseMessages::EMERGENCY_DISCONNECT_RESULT)
             {
                 EmergencyDisconnectResponseMessage const * msg = (EmergencyDisconnectResponseMessage const *)packet->data;
@@ -1892,10 +1961,13 @@ void Node::MeshMessageReceivedHandler(BaseConnection* connection, BaseConnection
     {
         ConnPacketComponentMessage const* packet = (ConnPacketComponentMessage const*)packetHeader;
 
-        char payload[50];
-        MessageLength payloadLength = sendData->dataLength - sizeof(packet->componentHeader);
-        Logger::ConvertBufferToHexString(packet->payload, payloadLength, payload, sizeof(payload));
-        logt("NODE", "component_act payload = %s", payload);
+        if (LOGT_ENABLED("NODE"))
+        {
+            char payload[50];
+            MessageLength payloadLength = sendData->dataLength - sizeof(packet->componentHeader);
+            Logger::ConvertBufferToHexString(packet->payload, payloadLength, payload, sizeof(payload));
+            logt("NODE", "component_act payload = %s", payload);
+        }
     }
 #if IS_ACTIVE(SIG_MESH)
     //Forwards tunneled SIG mesh messages to the implementation
@@ -2142,7 +2214,7 @@ Node::DecisionStruct Node::DetermineBestClusterAvailable(void)
     // 取得當前設備類型
     DeviceConfiguration config;
     ErrorType err = FruityHal::GetDeviceConfiguration(config);
-    DeviceType deviceType;
+    DeviceType deviceType = DeviceType::INVALID;
     if (err == ErrorType::SUCCESS) {
         deviceType = static_cast<DeviceType>(config.deviceType);
     }
@@ -2175,6 +2247,7 @@ Node::DecisionStruct Node::DetermineBestClusterAvailable(void)
             result.preferredPartner = bestClusterAsMaster->payload.sender;
             return result;
         }
+        return result;
     }else {
         //If no good cluster could be found (all are bigger than mine)
         //Find the best cluster that should connect to us (we as slave)
@@ -2831,16 +2904,8 @@ void Node::TimerEventHandler(u16 passedTimeDs)
     
 
     //reporter dis/enb
-    if (flag == 1) {
-        testdis++;
-        //if(testdis==100){      
-            if(switchReporter==1){
-             trace("dis/enb switch" EOL);
-            }   
-        GS->cm.UpdateState();
-        GS->cm.FillTransmitBuffers();//sure?
-        testdis=0;
-        //}
+    if (GS->cm.UpdateDutyCycle() && switchReporter == 1) {
+        trace("dis/enb switch" EOL);
     }
 
     //multi_generate_load
@@ -3145,6 +3210,45 @@ ClusterSize Node::GetClusterSize(void) const
     return this->clusterSize;
 }
 
+#ifdef SIM_ENABLED
+const LoadStatistics& Node::GetLoadStatistics() const
+{
+    return loadStatistics;
+}
+#endif
+
+void Node::ReceiveLoadChunk(NodeId sender, NodeId receiver, u32 timestamp, u32 sendtime, u8 const * payload, u8 payloadLength)
+{
+    bool payloadCorrect = true;
+    for (u32 i = 0; i < payloadLength; i++)
+    {
+        if (payload[i] != generateLoadMagicNumber)
+        {
+            payloadCorrect = false;
+        }
+    }
+    //new: calculate packet delay nonimportant
+    u32 packetReceivedTime = GS->delaytimer;
+    u32 packetDelay = 0;
+    if (packetReceivedTime >= timestamp)
+        packetDelay = packetReceivedTime - timestamp;
+    else
+        packetDelay = timestamp - packetReceivedTime;
+
+#ifdef SIM_ENABLED
+    loadStatistics.RecordReceivedPacket(sender, packetDelay, payloadCorrect);
+#endif
+
+    if (payloadCorrect == true && configuration.nodeId == receiver && sender != 10)
+        GS->rcvCount += 1;
+
+    if ((GS->rcvCount % 1000) == 0)
+    {
+        logjson("NODE", "{\"type\":\"generate_load_chunk\",\"nodeId\":%d,\"size\":%u,\"payloadCorrect\":%u,\"receivedTime\":%u, \"stamp\":%u, \"delay\":%u}" SEP, sender, (u32)payloadLength, (u32)payloadCorrect, packetReceivedTime, timestamp, packetDelay);
+    }
+    trace("node id : %d, generateTime : %u ms, sendTime : %u ms, receivedTime : %u ms, delay : %u ms," EOL, sender, timestamp, sendtime, packetReceivedTime, packetDelay);
+}
+
 void Node::SetClusterSize(ClusterSize clusterSize)
 {
     if (clusterSize < GS->node.configuration.numberOfEnrolledDevices || GS->node.configuration.numberOfEnrolledDevices <= 1)
@@ -3241,7 +3345,7 @@ void Node::PrintStatus(void) const
             RamConfig->GetNodeKey()[0], RamConfig->GetNodeKey()[1], RamConfig->GetNodeKey()[14], RamConfig->GetNodeKey()[15]);
     
     DeviceConfiguration config;
-    DeviceType deviceType;
+    DeviceType deviceType = DeviceType::INVALID;
     ErrorType err = FruityHal::GetDeviceConfiguration(config);
     if (err == ErrorType::SUCCESS)
     deviceType = static_cast<DeviceType>(config.deviceType);
@@ -3507,27 +3611,24 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
         generateLoadPayloadSize = Utility::TerminalArgumentToNodeId(commandArgs[2]); //size
         generateLoadRequestHandle = 0; //new
         GS->MultipleUnit=Utility::TerminalArgumentToNodeId(commandArgs[3]); //單位
-        for (int j = 1; j <= TOTAL_NODE_NUM; j++) // for (int j = 1; j < TOTAL_NODE_NUM; j++)
-            {
-                if (j != configuration.nodeId) { //new
-                    SendModuleActionMessage(
-                        MessageType::MODULE_TRIGGER_ACTION,
-                        j,
-                        (u8)NodeModuleTriggerActionMessages::SET_UNIT,
-                        GS->MultipleUnit,
-                        nullptr,
-                        0,
-                        false
-                    );
-                }
-            }
+        //A broadcast reaches all other nodes of the cluster, their node ids do not have to be contiguous
+        SendModuleActionMessage(
+            MessageType::MODULE_TRIGGER_ACTION,
+            NODE_ID_BROADCAST,
+            (u8)NodeModuleTriggerActionMessages::SET_UNIT,
+            GS->MultipleUnit,
+            nullptr,
+            0,
+            false
+        );
         generate_load = 1;   
         return TerminalCommandHandlerReturnType::SUCCESS;        
     }        
     //new test 四個目前沒用到
     if (TERMARGS(0, "flag")) {
-        flag = 1;
-        //printf("已設置flag=1\n\n");
+        //flag [slotLengthMs]
+        const u32 slotLengthMs = commandArgsSize >= 2 ? Utility::StringToU16(commandArgs[1]) : ConnectionManager::DUTY_CYCLE_DEFAULT_SLOT_LENGTH_MS;
+        GS->cm.StartDutyCycle(slotLengthMs);
         trace("已設置flag=1\n\n");
         
     }
@@ -3540,8 +3641,7 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
         errorIndex=Utility::TerminalArgumentToNodeId(commandArgs[2]); // 誤差值
     }
     if (TERMARGS(0, "flag0")) {
-        flag = 0;
-        //printf("已設置flag=0\n\n");
+        GS->cm.StopDutyCycle();
         trace("已設置flag=0\n\n");
     }
 
@@ -3612,15 +3712,19 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
             //new test
             if (TERMARGS(3, "flag")) 
             {
-                flag=1;
+                //action [nodeId] node flag [slotLengthMs]
+                SetFlagMessage message;
+                CheckedMemset(&message, 0x00, sizeof(message));
+                message.slotLengthMs = commandArgsSize >= 5 ? Utility::StringToU16(commandArgs[4]) : (u16)ConnectionManager::DUTY_CYCLE_DEFAULT_SLOT_LENGTH_MS;
+
                 root = destinationNode; //將root設為目標node
                 SendModuleActionMessage(
                     MessageType::MODULE_TRIGGER_ACTION,
                     destinationNode,
                     (u8)NodeModuleTriggerActionMessages::SET_FLAG,
                     0,
-                    nullptr,
-                    0,
+                    (u8*)&message,
+                    sizeof(message),
                     false
                 ); //發送一個SET_FLAG行動的封包給目標node
                    
@@ -3778,33 +3882,26 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
                 gltm.timeBetweenMessagesDs = Utility::StringToU8(commandArgs[6]);
 
                 const u8 requestHandle = commandArgsSize > 8 ? Utility::StringToU8(commandArgs[7]) : 1; // new :0 update :1
+                const NodeId amountOfNodes = (NodeId)GetClusterSize();
                 GS->MultipleUnit=requestHandle; //new
-                GS->sndCount = gltm.amount * (TOTAL_NODE_NUM - 1)*requestHandle;
+                GS->sndCount = gltm.amount * (amountOfNodes - 1)*requestHandle;
                 //reset avg delay, PDR count
                 GS->rcvCount = 0;
-                for (int i = 0; i < TOTAL_NODE_NUM ; i++) //  for (int i = 0; i < TOTAL_NODE_NUM - 1; i++)
-                {
-                        MultipleCount[i]=0;
-                        CollsndCount[i]=0;
-                        avgDelay[i] = 0;
-                        rcvCount[i] = 0;
-                }
+#ifdef SIM_ENABLED
+                loadStatistics.Reset(amountOfNodes - 1);
+#endif
 
-                // start generating for 1 sink only
-                for (int j = 1; j <= TOTAL_NODE_NUM; j++) // for (int j = 1; j < TOTAL_NODE_NUM; j++)
-                {
-                    if (j != destinationNode) { //new
-                        SendModuleActionMessage(
-                            MessageType::MODULE_TRIGGER_ACTION,
-                            j,
-                            (u8)NodeModuleTriggerActionMessages::START_GENERATE_LOAD,
-                            requestHandle,
-                            (u8*)&gltm,
-                            sizeof(gltm),
-                            false
-                        );
-                    }
-                }
+                // start generating for 1 sink only, the target itself ignores the broadcast so that
+                // the node ids of the cluster do not have to be contiguous
+                SendModuleActionMessage(
+                    MessageType::MODULE_TRIGGER_ACTION,
+                    NODE_ID_BROADCAST,
+                    (u8)NodeModuleTriggerActionMessages::START_GENERATE_LOAD,
+                    requestHandle,
+                    (u8*)&gltm,
+                    sizeof(gltm),
+                    false
+                );
                 return TerminalCommandHandlerReturnType::SUCCESS;
             }
 
@@ -3812,58 +3909,38 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
             if (commandArgsSize >3 && TERMARGS(3, "snd"))
             {   GS->CollsndCount=0;
                 GS->MultipleCount=0;
-                // COLLECT_TRANSMIT_DATA
-                for (int j = 1; j <= TOTAL_NODE_NUM; j++) 
-                {
-                    if (j != destinationNode) { //new
-                        SendModuleActionMessage(
-                            MessageType::MODULE_TRIGGER_ACTION,
-                            j,
-                            (u8)NodeModuleTriggerActionMessages::COLLECT_TRANSMIT_DATA,
-                            0,
-                            nullptr,
-                            0,
-                            false
-                        );
-                    }
-                }
+                // COLLECT_TRANSMIT_DATA from all nodes of the cluster, this node only reports to itself if it is not the destination
+                SendModuleActionMessage(
+                    MessageType::MODULE_TRIGGER_ACTION,
+                    NODE_ID_BROADCAST,
+                    (u8)NodeModuleTriggerActionMessages::COLLECT_TRANSMIT_DATA,
+                    0,
+                    nullptr,
+                    0,
+                    false,
+                    destinationNode != configuration.nodeId
+                );
                 return TerminalCommandHandlerReturnType::SUCCESS;                
             }
-            //new command: avg delay result
+            //new command: delay, PDR and collision result
             if (commandArgsSize > 3 && TERMARGS(3, "result"))
             {                
-                //  0     1    2      3
-                //action this node result
-                u32 avg = 0;
-                for (int i = 0; i < TOTAL_NODE_NUM; i++)
-                {
-                    if ((i+1) != destinationNode) { //new
-                        u32 temp;
-                        u32 sendcount=0;
-                        sendcount = (CollsndCount[i]+(GS->MultipleUnit*MultipleCount[i]));
-                        if (rcvCount[i] == 0)
-                            temp = 0;
-                        else
-                            temp = avgDelay[i] / rcvCount[i];
-                        trace("Avg delay of node %d = %u ms , send count = %u , rcv count = %d " EOL, i + 1, temp, sendcount, rcvCount[i]);
-                        avg += temp;
-                    }
-                }
+                //  0     1    2      3       4           5
+                //action this node result {sender} {requestHandle}
+                GetLoadStatisticsMessage message;
+                CheckedMemset(&message, 0, sizeof(message));
+                message.sender = commandArgsSize > 4 ? Utility::TerminalArgumentToNodeId(commandArgs[4]) : NODE_ID_BROADCAST;
+                const u8 requestHandle = commandArgsSize > 5 ? Utility::StringToU8(commandArgs[5]) : 0;
 
-                //printf("Avg delay of all nodes = %u ms\n", avg / (TOTAL_NODE_NUM - 1));
-                //printf("send count = %u, rcv count = %u\n", GS->sndCount, GS->rcvCount);
-               // trace("Avg delay of all nodes = %u ms" EOL,  avg / (TOTAL_NODE_NUM - 1));
-                trace("MultipleCount : %u , MultipleUnit : %u , CollsndCount : %u ," EOL, GS->MultipleCount, GS->MultipleUnit, GS->CollsndCount);
-                trace("Avg delay of all nodes = %u ms" EOL,  avg / (TOTAL_NODE_NUM - 1));
-                trace("COL send count = %u, send count = %u, rcv count = %u" EOL, GS->CollsndCount+(GS->MultipleUnit*GS->MultipleCount), GS->sndCount, GS->rcvCount);
-                GS->rcvCount=0;
-                for (int i = 0; i < TOTAL_NODE_NUM ; i++) //  for (int i = 0; i < TOTAL_NODE_NUM - 1; i++)
-                {
-                        MultipleCount[i]=0;
-                        CollsndCount[i]=0;
-                        avgDelay[i] = 0;
-                        rcvCount[i] = 0;
-                }
+                SendModuleActionMessage(
+                    MessageType::MODULE_TRIGGER_ACTION,
+                    destinationNode,
+                    (u8)NodeModuleTriggerActionMessages::GET_LOAD_STATISTICS,
+                    requestHandle,
+                    (u8*)&message,
+                    sizeof(message),
+                    false
+                );
                 return TerminalCommandHandlerReturnType::SUCCESS;
             }
 
@@ -4441,6 +4518,82 @@ TerminalCommandHandlerReturnType Node::TerminalCommandHandler(const char* comman
         PrintBufferStatus();
         return TerminalCommandHandlerReturnType::SUCCESS;
     }
+    //Print the GENERATE_LOAD_CHUNK counters of all connections and of the node, "loadcounters reset" clears them afterwards
+    else if (TERMARGS(0, "loadcounters"))
+    {
+        BaseConnections conn = GS->cm.GetBaseConnections(ConnectionDirection::INVALID);
+        for (u8 i = 0; i < conn.count; i++)
+        {
+            BaseConnection* connection = conn.handles[i].GetConnection();
+            if (connection == nullptr) continue;
+            const LoadChunkCounters& counters = connection->GetLoadChunkCounters();
+            logjson("NODE", "{\"type\":\"load_chunk_link_counters\",\"nodeId\":%u,\"partnerId\":%u,\"connectionIntervalMs\":%u,\"sent\":%u,\"sameInterval\":%u,\"collisions\":%u}" SEP,
+                configuration.nodeId,
+                connection->partnerId,
+                connection->GetConnectionIntervalMs(),
+                counters.sentPackets,
+                counters.sameIntervalPackets,
+                counters.directionCollisions);
+            if (commandArgsSize > 1 && TERMARGS(1, "reset")) connection->ResetLoadChunkCounters();
+        }
+        logjson("NODE", "{\"type\":\"load_chunk_node_counters\",\"nodeId\":%u,\"sent\":%u,\"sameInterval\":%u,\"collisions\":%u}" SEP,
+            configuration.nodeId,
+            GS->loadChunkCounters.sentPackets,
+            GS->loadChunkCounters.sameIntervalPackets,
+            GS->loadChunkCounters.directionCollisions);
+        if (commandArgsSize > 1 && TERMARGS(1, "reset")) GS->loadChunkCounters = LoadChunkCounters();
+        return TerminalCommandHandlerReturnType::SUCCESS;
+    }
+    //Print the counters of the slotted duty cycling
+    else if (TERMARGS(0, "dutycycle"))
+    {
+        logjson("NODE", "{\"type\":\"duty_cycle_counters\",\"nodeId\":%u,\"active\":%u,\"slotLengthUs\":%u,\"slots\":%u,"
+            "\"lastSlot\":{\"queued\":%u,\"sent\":%u,\"dropped\":%u},"
+            "\"total\":{\"queued\":%u,\"sent\":%u,\"dropped\":%u}}" SEP,
+            configuration.nodeId,
+            GS->cm.IsDutyCycleActive() ? 1 : 0,
+            GS->cm.GetDutyCycleSlotLengthUs(),
+            GS->cm.dutyCycleCompletedSlots,
+            GS->cm.dutyCycleLastSlotCounters.queuedPackets,
+            GS->cm.dutyCycleLastSlotCounters.sentPackets,
+            GS->cm.dutyCycleLastSlotCounters.droppedPackets,
+            GS->cm.dutyCycleTotalCounters.queuedPackets,
+            GS->cm.dutyCycleTotalCounters.sentPackets,
+            GS->cm.dutyCycleTotalCounters.droppedPackets);
+        return TerminalCommandHandlerReturnType::SUCCESS;
+    }
+    //Coalesce forwarded load chunks: "aggregate [flushDeadlineMs]" enables it, "aggregate off" disables it and "aggregate stat" prints the counters
+    else if (TERMARGS(0, "aggregate"))
+    {
+        LoadAggregator& aggregator = GS->cm.loadAggregator;
+        if (commandArgsSize > 1 && TERMARGS(1, "off"))
+        {
+            aggregator.Flush();
+            aggregator.enabled = false;
+        }
+        else if (commandArgsSize > 1 && TERMARGS(1, "stat"))
+        {
+            logjson("NODE", "{\"type\":\"load_aggregate_counters\",\"nodeId\":%u,\"enabled\":%u,\"flushDeadlineMs\":%u,\"chunks\":%u,\"aggregates\":%u}" SEP,
+                configuration.nodeId,
+                aggregator.enabled ? 1 : 0,
+                aggregator.flushDeadlineMs,
+                aggregator.aggregatedChunks,
+                aggregator.sentAggregates);
+        }
+        else
+        {
+            u32 flushDeadlineMs = LoadAggregator::DEFAULT_FLUSH_DEADLINE_MS;
+            if (commandArgsSize > 1)
+            {
+                bool didError = false;
+                flushDeadlineMs = Utility::StringToU32(commandArgs[1], &didError);
+                if (didError) return TerminalCommandHandlerReturnType::WRONG_ARGUMENT;
+            }
+            aggregator.flushDeadlineMs = flushDeadlineMs;
+            aggregator.enabled = true;
+        }
+        return TerminalCommandHandlerReturnType::SUCCESS;
+    }
     //Send some large data that is split over a few messages
     else if(TERMARGS(0, "datal"))
     {
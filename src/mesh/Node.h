@@ -45,6 +45,7 @@
 #include <Terminal.h>
 #include <array>
 #include "ConnectionHandle.h"
+#include "LoadStatistics.h"
 
 constexpr int MAX_RAW_DATA_CHUNK_SIZE = 60;
 
@@ -108,6 +109,7 @@ enum class NodeSaveActions : u8 {
  */
 class Node: public Module, public RecordStorageEventListener
 {
+    friend class CherrySim;
 
 private:
         enum class NodeModuleTriggerActionMessages : u8
@@ -136,6 +138,7 @@ private:
             SET_FLAG=15,
             TRANSMIT_DATA_MultipleCount=16,
             SET_UNIT=17,
+            GET_LOAD_STATISTICS=22,
         };
 
         enum class NodeModuleActionResponseMessages : u8
@@ -151,6 +154,7 @@ private:
             REMOVE_DYNAMIC_GROUP             = 10,
             CLEAR_DYNAMIC_GROUPS             = 11,
             GET_DYNAMIC_GROUPS               = 12,
+            GET_LOAD_STATISTICS_RESULT       = 13,
         };
 
         #pragma pack(push, 1)
@@ -197,6 +201,34 @@ private:
         };
         STATIC_ASSERT_SIZE(SetEnrolledNodesResponseMessage, 2);
 
+        struct GetLoadStatisticsMessage
+        {
+            NodeId sender; //NODE_ID_BROADCAST to aggregate all senders
+        };
+        STATIC_ASSERT_SIZE(GetLoadStatisticsMessage, 2);
+
+        static constexpr size_t SIZEOF_GET_LOAD_STATISTICS_RESPONSE_MESSAGE = 36;
+        struct GetLoadStatisticsResponseMessage
+        {
+            NodeId sender;
+            u16 senders;
+            u32 receivedPackets;
+            u32 corruptedPackets;
+            u32 sentPackets;
+            u32 minDelayMs;
+            u32 medianDelayMs;
+            u32 p99DelayMs;
+            u32 maxDelayMs;
+            u32 averageDelayMs;
+        };
+        STATIC_ASSERT_SIZE(GetLoadStatisticsResponseMessage, SIZEOF_GET_LOAD_STATISTICS_RESPONSE_MESSAGE);
+
+        struct SetFlagMessage
+        {
+            u16 slotLengthMs; //Length of the duty cycle slots, see ConnectionManager::StartDutyCycle
+        };
+        STATIC_ASSERT_SIZE(SetFlagMessage, 2);
+
         struct AddOrRemoveDynamicGroupMessage
         {
             NodeId id;
@@ -283,6 +315,12 @@ private:
         u8 generateLoadRequestHandle = 0;
         constexpr static u8 generateLoadMagicNumber = 0x91;
         NodeId generateLoadTarget = 0;
+#ifdef SIM_ENABLED
+        //Delay, PDR and collision statistics of the load tests that targeted this node
+        LoadStatistics loadStatistics;
+#endif
+        //Checks a received GENERATE_LOAD_CHUNK payload and records it, either sent alone or unpacked from a LOAD_AGGREGATE
+        void ReceiveLoadChunk(NodeId sender, NodeId receiver, u32 timestamp, u32 sendtime, u8 const * payload, u8 payloadLength);
 
         u32 emergencyDisconnectTimerDs = 0; //The time since this node was not involved in any mesh. Can be reset by other means as well, e.g. when an emergency disconnect was sent.
         constexpr static u32 emergencyDisconnectTimerTriggerDs = SEC_TO_DS(/*Two minutes*/ 2 * 60);
@@ -315,9 +353,10 @@ private:
         //new: node type init static
 		DeviceType nodeType = DeviceType::STATIC; //default static
 
-        //new
-        NodeId parent;
-        int deg[7]; //需設node數 當前 3+1
+        //new: Position of this node in the tree that is spanned by the shortest paths to the sink
+        //Both are derived from the hopsToSink of the mesh connections and updated with every change, see UpdateTreePosition
+        NodeId parent = NODE_ID_INVALID; //Partner on the shortest path to the sink, NODE_ID_INVALID for the sink or without a sink
+        ClusterSize depth = -1;          //deg, the hops to the sink or -1 if no sink is reachable
 
         AdvJob* meshAdvJobHandle = nullptr;
 
@@ -421,6 +460,9 @@ private:
         void SetClusterSize(ClusterSize clusterSize);
         void SetEnrolledNodes(u16 enrolledNodes, NodeId sender);
         void SendEnrolledNodes(u16 enrolledNodes, NodeId destinationNode);
+#ifdef SIM_ENABLED
+        const LoadStatistics& GetLoadStatistics() const;
+#endif
 
         Module* GetModuleById(ModuleId id) const;
         Module* GetModuleById(VendorModuleId id) const;
@@ -428,6 +470,9 @@ private:
         void SendClusterInfoUpdate(MeshConnection* ignoreConnection, ConnPacketClusterInfoUpdate* packet) const;
         void ReceiveClusterInfoUpdate(MeshConnection* connection, ConnPacketClusterInfoUpdate const * packet);
 
+        //Recomputes parent and depth, must be called whenever the hopsToSink of a mesh connection changed
+        void UpdateTreePosition();
+
         void HandOverMasterBitIfNecessary() const;
         
         bool HasAllMasterBits() const;
@@ -850,7 +850,7 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
     else if (TERMARGS(0, "heap"))
     {
         u8 checkvar = 1;
-        logjson("NODE", "{\"stack\":%u}" SEP, (u32)(&checkvar - 0x20000000));
+        logjson("NODE", "{\"stack\":%u}" SEP, (u32)((uintptr_t)&checkvar - 0x20000000));
         logt("NODE", "Module usage: %u" SEP, GS->moduleAllocator.GetMemorySize());
 
         return TerminalCommandHandlerReturnType::SUCCESS;
@@ -864,12 +864,15 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
 
         u16 blockSize = 1024;
 
+        //The offset is the printed address, the memory is where it can be read from
         u32 offset = FLASH_REGION_START_ADDRESS;
-        if(TERMARGS(1, "flash")) offset = (u32)FLASH_REGION_START_ADDRESS;
-        else if(TERMARGS(1, "uicr")) offset = (u32)FruityHal::GetUserMemoryAddress();
-        else if(TERMARGS(1, "ficr")) offset = (u32)FruityHal::GetDeviceMemoryAddress();
-        else if(TERMARGS(1, "ram")) offset = (u32)0x20000000;
+        const u8* memory = FLASH_ADDRESS_TO_POINTER(FLASH_REGION_START_ADDRESS);
+        if(TERMARGS(1, "flash")) memory = FLASH_ADDRESS_TO_POINTER(FLASH_REGION_START_ADDRESS);
+        else if(TERMARGS(1, "uicr")) memory = (const u8*)FruityHal::GetUserMemoryAddress();
+        else if(TERMARGS(1, "ficr")) memory = (const u8*)FruityHal::GetDeviceMemoryAddress();
+        else if(TERMARGS(1, "ram")) memory = (const u8*)(uintptr_t)0x20000000;
         else return TerminalCommandHandlerReturnType::WRONG_ARGUMENT;
+        if(!TERMARGS(1, "flash")) offset = (u32)(uintptr_t)memory;
 
         bool didError = false;
 
@@ -894,7 +897,7 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
 
             for(u32 i=0; i<blockSize/bufferSize; i++)
             {
-                CheckedMemcpy(buffer, (u8*)(block*blockSize+i*bufferSize + offset), bufferSize);
+                CheckedMemcpy(buffer, memory + block*blockSize + i*bufferSize, bufferSize);
                 Logger::ConvertBufferToHexString(buffer, bufferSize, (char*)charBuffer, bufferSize*3+1);
                 trace("0x%08X: %s" EOL,(block*blockSize)+i*bufferSize + offset, charBuffer);
             }
@@ -913,7 +916,7 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
         for(u32 j=0; j<numBlocks; j++){
             u32 buffer = 0xFFFFFFFF;
             for(u32 i=0; i<blockSize; i+=4){
-                buffer = buffer & *(u32*)(j*blockSize+i+offset);
+                buffer = buffer & *(u32*)FLASH_ADDRESS_TO_POINTER(j*blockSize+i+offset);
             }
             if(buffer == 0xFFFFFFFF) trace("0");
             else trace("1");
@@ -1120,7 +1123,7 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
         u16 dataLength = Logger::ParseEncodedStringToBuffer(commandArgs[2], buffer, 200);
 
 
-        GS->flashStorage.CacheAndWriteData((u32*)buffer, (u32*)addr, dataLength, nullptr, 0);
+        GS->flashStorage.CacheAndWriteData((u32*)buffer, (u32*)FLASH_ADDRESS_TO_POINTER(addr), dataLength, nullptr, 0);
 
         return TerminalCommandHandlerReturnType::SUCCESS;
     }
@@ -1173,7 +1176,7 @@ TerminalCommandHandlerReturnType DebugModule::TerminalCommandHandler(const char*
         u32 buffer[16];
         u16 len = Logger::ParseEncodedStringToBuffer(commandArgs[2], (u8*)buffer, 64);
 
-        GS->flashStorage.CacheAndWriteData(buffer, (u32*)destAddr, len, nullptr, 0);
+        GS->flashStorage.CacheAndWriteData(buffer, (u32*)FLASH_ADDRESS_TO_POINTER(destAddr), len, nullptr, 0);
 
 
         return TerminalCommandHandlerReturnType::SUCCESS;
@@ -1398,7 +1401,7 @@ void DebugModule::MeshMessageReceivedHandler(BaseConnection* connection, BaseCon
                 CheckedMemset(&response, 0x00, sizeof(response));
 
                 response.address = data->address;
-                u8* memoryAddress = (u8*)(FLASH_REGION_START_ADDRESS + data->address);
+                u8* memoryAddress = FLASH_ADDRESS_TO_POINTER(FLASH_REGION_START_ADDRESS + data->address);
                 CheckedMemcpy(response.data, memoryAddress, data->length);
 
                 SendModuleActionMessage(
@@ -1606,7 +1609,7 @@ void DebugModule::MeshMessageReceivedHandler(BaseConnection* connection, BaseCon
                         break;
                     }
                 }
-                logjson("DEBUGMOD", "{\"nodeId\":%u,\"type\":\"send_max_message_response\", \"correctValues\":%u, \"expectedCorrectValues\":%u}" SEP, packet->header.sender, i, sizeof(message->data));
+                logjson("DEBUGMOD", "{\"nodeId\":%u,\"type\":\"send_max_message_response\", \"correctValues\":%u, \"expectedCorrectValues\":%u}" SEP, packet->header.sender, i, (u32)sizeof(message->data));
             }
             else if (actionType == DebugModuleActionResponseMessages::MEMORY) {
                 if (sendData->dataLength < SIZEOF_CONN_PACKET_MODULE + SIZEOF_DEBUG_MODULE_MEMORY_MESSAGE_HEADER) return;
@@ -1778,6 +1781,9 @@ void DebugModule::CauseHardfault() const
 #ifdef __clang__
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Winfinite-recursion"
+#elif defined(__GNUC__) && __GNUC__ >= 12
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winfinite-recursion"
 #endif
 void DebugModule::CauseStackOverflow() const
 {
@@ -1786,11 +1792,13 @@ void DebugModule::CauseStackOverflow() const
     {
         someDummyData[i] = 0x12;
     }
-    logt("MAIN", "Dummy data addr: %u", (u32)&someDummyData);
+    logt("MAIN", "Dummy data addr: %u", (u32)(uintptr_t)&someDummyData);
     CauseStackOverflow();
 }
 #ifdef __clang__
 #pragma clang diagnostic pop
+#elif defined(__GNUC__) && __GNUC__ >= 12
+#pragma GCC diagnostic pop
 #endif
 
 u32 DebugModule::GetThroughputTestResult()
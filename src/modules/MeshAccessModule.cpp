@@ -359,9 +359,12 @@ void MeshAccessModule::UpdateMeshAccessBroadcastPacket(u16 advIntervalMs)
 
     //FIXME: Adv data must be worng, not advertising
 
-    char cbuffer[100];
-    Logger::ConvertBufferToHexString(buffer, length, cbuffer, sizeof(cbuffer));
-    logt("MAMOD", "Broadcasting mesh access %s, len %u", cbuffer, length);
+    if (LOGT_ENABLED("MAMOD"))
+    {
+        char cbuffer[100];
+        Logger::ConvertBufferToHexString(buffer, length, cbuffer, sizeof(cbuffer));
+        logt("MAMOD", "Broadcasting mesh access %s, len %u", cbuffer, length);
+    }
 
 }
 
@@ -287,7 +287,7 @@ bool ScanningModule::AddTrackedAsset(const AdvPacketLegacyV2AssetServiceData * p
 
     //If a slot was found, add the packet
     if (slot != nullptr) {
-        u16 slotNum = ((u32)slot - (u32)assetPackets.data()) / sizeof(ScannedAssetTrackingStorage);
+        u16 slotNum = slot - assetPackets.data();
         logt("SCANMOD", "Tracked packet %u in slot %d", packet->assetNodeId, slotNum);
 
         //Clean up first, if we overwrite another assetId
@@ -117,6 +117,7 @@ enum class MessageType : u8
     DATA_1_VITAL = 81,
 
     CLC_DATA = 83,
+    LOAD_AGGREGATE = 84, //Several GENERATE_LOAD_CHUNK payloads coalesced by a forwarding node, see LoadAggregator
 
     // The most significant bit of the MessageType is reserved for future use.
     // Such a use could be (but is not limited to) to extend the ConnPacketHeader
@@ -755,6 +756,25 @@ typedef struct
 }ConnPacketDataClcData;
 STATIC_ASSERT_SIZE(ConnPacketDataClcData, SIZEOF_CONN_PACKET_CLC_DATA);
 
+//LOAD_AGGREGATE is sent towards the sink by nodes that forward GENERATE_LOAD_CHUNK messages
+constexpr size_t SIZEOF_CONN_PACKET_LOAD_AGGREGATE = (SIZEOF_CONN_PACKET_HEADER + 1);
+typedef struct
+{
+    ConnPacketHeader header;
+    u8 amountOfEntries;
+    //Followed by amountOfEntries LoadAggregateEntries, each directly followed by its payload
+}ConnPacketLoadAggregate;
+STATIC_ASSERT_SIZE(ConnPacketLoadAggregate, SIZEOF_CONN_PACKET_LOAD_AGGREGATE);
+
+constexpr size_t SIZEOF_LOAD_AGGREGATE_ENTRY = 7;
+typedef struct
+{
+    NodeId sender; //The node that generated the chunk
+    u32 timestamp; //Time at which the chunk was generated on the synchronized delaytimer of the sender
+    u8 payloadLength;
+}LoadAggregateEntry;
+STATIC_ASSERT_SIZE(LoadAggregateEntry, SIZEOF_LOAD_AGGREGATE_ENTRY);
+
 //UPDATE_CONNECTION_INTERVAL is used to tell nodes to update their connection interval settings
 constexpr size_t SIZEOF_CONN_PACKET_UPDATE_CONNECTION_INTERVAL = (SIZEOF_CONN_PACKET_HEADER + 2);
 typedef struct
@@ -73,6 +73,7 @@ extern "C" {
 
 #ifdef SIM_ENABLED
 #include "StackWatcher.h"
+#include "ScratchArena.h"
 #define START_OF_FUNCTION() StackWatcher::Check(); if(cherrySimInstance != nullptr) {cherrySimInstance->SimulateInterrupts();}
 #else
 #define START_OF_FUNCTION
@@ -286,6 +287,9 @@ constexpr u32 BOOTLOADER_BITMASK_SIZE = 60;
 #ifndef SIM_ENABLED
 // Location of the flash start
 #define FLASH_REGION_START_ADDRESS            0x00000000UL
+// Conversion between flash addresses and pointers, which differ in the simulator
+#define FLASH_ADDRESS_TO_POINTER(address)     ((u8*)(uintptr_t)(address))
+#define POINTER_TO_FLASH_ADDRESS(pointer)     ((u32)(uintptr_t)(pointer))
 #endif
 
 // Image types supported by the bootloader or component if a 3rd party device should be updated
@@ -340,16 +344,26 @@ STATIC_ASSERT_SIZE(BootloaderSettings, (16 + BOOTLOADER_BITMASK_SIZE + BOOTLOADE
 //Because the sizeof operator does not work in the intended way when a struct
 //is aligned, we have to calculate the size by extending the struct and aligning it
 #define DECLARE_CONFIG_AND_PACKED_STRUCT(structname) struct structname##Aligned : structname {} __attribute__((packed, aligned(4))); structname##Aligned configuration
+#ifndef SIM_ENABLED
 //Because Visual Studio does not support C99 dynamic arrays
 #define DYNAMIC_ARRAY(arrayName, size) alignas(4) u8 arrayName[size]
 #define DYNAMIC_ARRAY_FLOAT(arrayName, size) float arrayName[size]
 #endif
+#endif
 #if defined(_MSC_VER)
 #include <malloc.h>
 #define DECLARE_CONFIG_AND_PACKED_STRUCT(structname) structname configuration = {}
+#ifndef SIM_ENABLED
 #define DYNAMIC_ARRAY(arrayName, size) std::vector<uint8_t> arrayName##Base(size); uint8_t* arrayName = arrayName##Base.data()
 #define DYNAMIC_ARRAY_FLOAT(arrayName, size) std::vector<float> arrayName##Base(size); float* arrayName = arrayName##Base.data()
 #endif
+#endif
+#ifdef SIM_ENABLED
+//The simulator takes dynamic arrays from a per node arena, which is much cheaper than the heap
+//and still detects writes behind the end of an array, see ScratchArena
+#define DYNAMIC_ARRAY(arrayName, size) ScratchArray<u8> arrayName##Base(size); u8* arrayName = arrayName##Base.data()
+#define DYNAMIC_ARRAY_FLOAT(arrayName, size) ScratchArray<float> arrayName##Base(size); float* arrayName = arrayName##Base.data()
+#endif
 
 // ########### TIMER ############
 #define MSEC_TO_UNITS(TIME, RESOLUTION) (((TIME) * 1000) / (RESOLUTION))
@@ -105,8 +105,12 @@ u16 ChunkedPacketQueue::PeekPacketRaw(u8* outData, u16 outDataSize, const Connec
     {
         if (header->isExtended)
         {
-            const ExtendedQueueEntryHeader* header = (const ExtendedQueueEntryHeader*)(chunk->data.data() + head);
-            *messageHandle = header->handle;
+            // The handle is the only part of the header that might already be in the next chunk.
+            const u32 handleOffset = head + sizeof(QueueEntryHeader);
+            const u8* handle = handleOffset < CONNECTION_QUEUE_MEMORY_CHUNK_SIZE
+                ? chunk->data.data() + handleOffset
+                : chunk->nextChunk->data.data() + (handleOffset - CONNECTION_QUEUE_MEMORY_CHUNK_SIZE);
+            CheckedMemcpy(messageHandle, handle, sizeof(*messageHandle));
         }
         else
         {
@@ -539,6 +543,147 @@ u32 ChunkedPacketQueue::GetAmountOfPackets() const
     return amountOfPackets;
 }
 
+u16 ChunkedPacketQueue::EntryView::CopyTo(u8* outData, u16 outDataSize, u16 offset) const
+{
+    if (outData == nullptr || offset > size)
+    {
+        SIMEXCEPTION(IllegalArgumentException);
+        return 0;
+    }
+    const u16 amountToCopy = (size - offset) < outDataSize ? (size - offset) : outDataSize;
+    u16 amountCopied = 0;
+    if (offset < firstPartSize)
+    {
+        amountCopied = (firstPartSize - offset) < amountToCopy ? (firstPartSize - offset) : amountToCopy;
+        CheckedMemcpy(outData, firstPart + offset, amountCopied);
+    }
+    if (amountCopied < amountToCopy)
+    {
+        const u16 offsetInSecondPart = offset + amountCopied - firstPartSize;
+        CheckedMemcpy(outData + amountCopied, secondPart + offsetInSecondPart, amountToCopy - amountCopied);
+    }
+    return amountToCopy;
+}
+
+ChunkedPacketQueue::Cursor::Cursor(const ChunkedPacketQueue* queue) :
+    queue(queue),
+    chunk(queue->readChunk),
+    head(queue->readChunk->currentReadHead),
+    index(0),
+    reachedLookAheadChunk(queue->readChunk == queue->lookAheadChunk)
+{
+}
+
+bool ChunkedPacketQueue::Cursor::IsValid() const
+{
+    return queue != nullptr && index < queue->amountOfPackets;
+}
+
+u32 ChunkedPacketQueue::Cursor::GetIndex() const
+{
+    return index;
+}
+
+ChunkedPacketQueue::EntryView ChunkedPacketQueue::Cursor::Get() const
+{
+    EntryView view;
+    CheckedMemset(&view, 0, sizeof(view));
+    if (!IsValid())
+    {
+        SIMEXCEPTION(IllegalStateException);
+        return view;
+    }
+
+    const QueueEntryHeader* header = (const QueueEntryHeader*)(chunk->data.data() + head);
+    if (header->reserved != 0 || header->size == 0)
+    {
+        SIMEXCEPTION(MemoryCorruptionException);
+        return view;
+    }
+    const u32 headerSize = header->isExtended ? sizeof(ExtendedQueueEntryHeader) : sizeof(QueueEntryHeader);
+    const u32 messageStartOffset = head + headerSize;
+    const bool reachesIntoNextChunk = messageStartOffset + header->size > CONNECTION_QUEUE_MEMORY_CHUNK_SIZE;
+    if (reachesIntoNextChunk && chunk->nextChunk == nullptr)
+    {
+        SIMEXCEPTION(IllegalStateException);
+        return view;
+    }
+
+    view.size = header->size;
+    view.isSplit = header->isSplit;
+    if (header->isExtended)
+    {
+        // The handle is the only part of the header that might already be in the next chunk.
+        const u32 handleOffset = head + sizeof(QueueEntryHeader);
+        const u8* handle = handleOffset < CONNECTION_QUEUE_MEMORY_CHUNK_SIZE
+            ? chunk->data.data() + handleOffset
+            : chunk->nextChunk->data.data() + (handleOffset - CONNECTION_QUEUE_MEMORY_CHUNK_SIZE);
+        CheckedMemcpy(&view.messageHandle, handle, sizeof(view.messageHandle));
+    }
+
+    if (!reachesIntoNextChunk)
+    {
+        view.firstPart = chunk->data.data() + messageStartOffset;
+        view.firstPartSize = header->size;
+    }
+    else
+    {
+        view.firstPartSize = CONNECTION_QUEUE_MEMORY_CHUNK_SIZE > messageStartOffset ? CONNECTION_QUEUE_MEMORY_CHUNK_SIZE - messageStartOffset : 0;
+        view.firstPart = view.firstPartSize > 0 ? chunk->data.data() + messageStartOffset : nullptr;
+        const u32 secondChunkOffset = messageStartOffset > CONNECTION_QUEUE_MEMORY_CHUNK_SIZE ? messageStartOffset - CONNECTION_QUEUE_MEMORY_CHUNK_SIZE : 0;
+        view.secondPart = chunk->nextChunk->data.data() + secondChunkOffset;
+        view.secondPartSize = header->size - view.firstPartSize;
+    }
+    return view;
+}
+
+bool ChunkedPacketQueue::Cursor::IsLookedAhead() const
+{
+    if (chunk == queue->lookAheadChunk)
+    {
+        return head < queue->lookAheadChunk->currentLookAheadHead;
+    }
+    // All chunks before the lookAheadChunk are looked ahead completely.
+    return !reachedLookAheadChunk;
+}
+
+void ChunkedPacketQueue::Cursor::Next()
+{
+    if (!IsValid())
+    {
+        SIMEXCEPTION(IllegalStateException);
+        return;
+    }
+    index++;
+    if (index >= queue->amountOfPackets)
+    {
+        // The last entry might end exactly at the end of the last chunk, there is nothing more to walk to.
+        return;
+    }
+
+    const QueueEntryHeader* header = (const QueueEntryHeader*)(chunk->data.data() + head);
+    const u32 headerSize = header->isExtended ? sizeof(ExtendedQueueEntryHeader) : sizeof(QueueEntryHeader);
+    head = Utility::NextMultipleOf(head + headerSize + header->size, sizeof(u32));
+    if (head >= CONNECTION_QUEUE_MEMORY_CHUNK_SIZE)
+    {
+        if (chunk->nextChunk == nullptr)
+        {
+            // Same as in GetChunkHeadPairOfIndex, the amount of packets does not match the chunks.
+            SIMEXCEPTION(IllegalStateException);
+            index = queue->amountOfPackets;
+            return;
+        }
+        chunk = chunk->nextChunk;
+        head -= CONNECTION_QUEUE_MEMORY_CHUNK_SIZE;
+        if (chunk == queue->lookAheadChunk) reachedLookAheadChunk = true;
+    }
+}
+
+ChunkedPacketQueue::Cursor ChunkedPacketQueue::GetCursor() const
+{
+    return Cursor(this);
+}
+
 void ChunkedPacketQueue::Print() const
 {
     trace("Amount of Packets: %u" EOL, GetAmountOfPackets());
@@ -550,10 +695,11 @@ void ChunkedPacketQueue::Print() const
         trace("     |SendPckd|ConnPacketHdr |" EOL);
     }
 
-    for (u32 i = 0; i < GetAmountOfPackets(); i++)
+    for (Cursor cursor = GetCursor(); cursor.IsValid(); cursor.Next())
     {
+        const u32 i = cursor.GetIndex();
         u8 buffer[MAX_MESH_PACKET_SIZE];
-        const u16 size = RandomAccessPeek(buffer, sizeof(buffer), i);
+        const u16 size = cursor.Get().CopyTo(buffer, sizeof(buffer));
         if (size == 0)
         {
             trace("#%03u:|Failed to read" EOL, i);
@@ -107,6 +107,50 @@ public:
     u32 GetAmountOfPackets() const;
     void Print() const;
 
+    // A view into a single queued entry that does not copy its data. An entry may reach
+    // into the next chunk, which is why its data consists of up to two parts.
+    struct EntryView
+    {
+        const u8* firstPart;
+        u16 firstPartSize;
+        const u8* secondPart;
+        u16 secondPartSize;
+        u16 size;
+        u32 messageHandle;
+        bool isSplit;
+
+        // Copies up to outDataSize bytes of the entry, starting at offset, and returns the amount of copied bytes.
+        u16 CopyTo(u8* outData, u16 outDataSize, u16 offset = 0) const;
+    };
+
+    // Walks the queued entries from the read head to the end of the queue. Other than
+    // RandomAccessPeek, which walks from the read head for every index, each step is O(1).
+    // The cursor must not be used anymore once the queue was modified.
+    class Cursor
+    {
+        friend class ChunkedPacketQueue;
+    private:
+        const ChunkedPacketQueue* queue = nullptr;
+        const ConnectionQueueMemoryChunk* chunk = nullptr;
+        u32 head = 0;
+        u32 index = 0;
+        bool reachedLookAheadChunk = false;
+
+        explicit Cursor(const ChunkedPacketQueue* queue);
+
+    public:
+        Cursor() = default;
+
+        bool IsValid() const;
+        u32 GetIndex() const;
+        EntryView Get() const;
+        // Same as IsRandomAccessIndexLookedAhead(GetIndex()), but without walking the queue.
+        bool IsLookedAhead() const;
+        void Next();
+    };
+
+    Cursor GetCursor() const;
+
     DeliveryPriority GetPriority() const;
     void SetPriority(DeliveryPriority prio);
 
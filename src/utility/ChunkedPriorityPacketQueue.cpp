@@ -179,3 +179,56 @@ void ChunkedPriorityPacketQueue::RollbackLookAhead()
         queues[i].RollbackLookAhead();
     }
 }
+
+ChunkedPriorityPacketQueue::Cursor::Cursor(const ChunkedPriorityPacketQueue* queue) :
+    queue(queue),
+    priority(0),
+    cursor(queue->queues[0].GetCursor())
+{
+    SkipEmptyPriorities();
+}
+
+void ChunkedPriorityPacketQueue::Cursor::SkipEmptyPriorities()
+{
+    while (!cursor.IsValid() && priority + 1 < queue->queues.size())
+    {
+        priority++;
+        cursor = queue->queues[priority].GetCursor();
+    }
+}
+
+bool ChunkedPriorityPacketQueue::Cursor::IsValid() const
+{
+    return cursor.IsValid();
+}
+
+DeliveryPriority ChunkedPriorityPacketQueue::Cursor::GetPriority() const
+{
+    return (DeliveryPriority)priority;
+}
+
+u32 ChunkedPriorityPacketQueue::Cursor::GetIndex() const
+{
+    return cursor.GetIndex();
+}
+
+ChunkedPacketQueue::EntryView ChunkedPriorityPacketQueue::Cursor::Get() const
+{
+    return cursor.Get();
+}
+
+bool ChunkedPriorityPacketQueue::Cursor::IsLookedAhead() const
+{
+    return cursor.IsLookedAhead();
+}
+
+void ChunkedPriorityPacketQueue::Cursor::Next()
+{
+    cursor.Next();
+    SkipEmptyPriorities();
+}
+
+ChunkedPriorityPacketQueue::Cursor ChunkedPriorityPacketQueue::GetCursor() const
+{
+    return Cursor(this);
+}
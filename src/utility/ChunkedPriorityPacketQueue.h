@@ -68,6 +68,30 @@ public:
     QueuePriorityPair GetSendQueue();
     ChunkedPacketQueue* GetQueueByPriority(DeliveryPriority prio);
     void RollbackLookAhead();
+
+    // Walks the entries of all priorities, starting with the highest priority (VITAL).
+    class Cursor
+    {
+        friend class ChunkedPriorityPacketQueue;
+    private:
+        const ChunkedPriorityPacketQueue* queue = nullptr;
+        u32 priority = 0;
+        ChunkedPacketQueue::Cursor cursor;
+
+        explicit Cursor(const ChunkedPriorityPacketQueue* queue);
+        void SkipEmptyPriorities();
+
+    public:
+        bool IsValid() const;
+        DeliveryPriority GetPriority() const;
+        // The index inside the queue of the current priority.
+        u32 GetIndex() const;
+        ChunkedPacketQueue::EntryView Get() const;
+        bool IsLookedAhead() const;
+        void Next();
+    };
+
+    Cursor GetCursor() const;
 };
 
 
@@ -54,7 +54,6 @@ ConnectionAllocator::AnyConnection * ConnectionAllocator::AllocateMemory()
         return nullptr;                                                                           //LCOV_EXCL_LINE assertion
     }
     AnyConnection* oldHead = dataHead; 
-    static_assert(sizeof(void*) == 4, "Only 32 bit supported!");
     if (!Utility::CompareMem(0x00, (u8*)oldHead + sizeof(void*), sizeof(AnyConnection) - sizeof(void*))) {
         SIMEXCEPTION(MemoryCorruptionException); //LCOV_EXCL_LINE assertion
     }
@@ -0,0 +1,309 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "JsonStreamValidator.h"
+
+void JsonStreamValidator::Feed(const char* fragment)
+{
+    if (state == State::INVALID) return;
+
+    for (const char* it = fragment; *it != '\0'; it++)
+    {
+        //A character that terminates a number is not part of it and has to be consumed again
+        while (!Consume(*it))
+        {
+            if (state == State::INVALID) return;
+        }
+    }
+}
+
+bool JsonStreamValidator::Finish()
+{
+    if (IsInNumber()) EndValue();
+
+    const bool valid = state == State::AFTER_VALUE && depth == 0 && foundValue;
+    Reset();
+    return valid;
+}
+
+void JsonStreamValidator::Reset()
+{
+    state = State::VALUE;
+    depth = 0;
+    stringIsKey = false;
+    foundValue = false;
+    remainingCharacters = 0;
+    remainingLiteral = nullptr;
+}
+
+//Returns false if the character was not consumed, either because the json is invalid
+//or because it ended a number and has to be consumed in the new state
+bool JsonStreamValidator::Consume(char c)
+{
+    const u8 byte = (u8)c;
+
+    switch (state)
+    {
+        case State::VALUE:
+            if (IsWhitespace(c)) return true;
+            return StartValue(c);
+
+        case State::VALUE_OR_ARRAY_END:
+            if (IsWhitespace(c)) return true;
+            if (c == ']')
+            {
+                depth--;
+                EndValue();
+                return true;
+            }
+            return StartValue(c);
+
+        case State::KEY:
+        case State::KEY_OR_OBJECT_END:
+            if (IsWhitespace(c)) return true;
+            if (c == '"')
+            {
+                stringIsKey = true;
+                state = State::STRING;
+                return true;
+            }
+            if (c == '}' && state == State::KEY_OR_OBJECT_END)
+            {
+                depth--;
+                EndValue();
+                return true;
+            }
+            break;
+
+        case State::COLON:
+            if (IsWhitespace(c)) return true;
+            if (c == ':')
+            {
+                state = State::VALUE;
+                return true;
+            }
+            break;
+
+        case State::AFTER_VALUE:
+            if (IsWhitespace(c)) return true;
+            if (depth == 0) break; //Only a single value is allowed
+
+            if (c == ',')
+            {
+                state = isObject[depth - 1] ? State::KEY : State::VALUE;
+                return true;
+            }
+            if (c == (isObject[depth - 1] ? '}' : ']'))
+            {
+                depth--;
+                EndValue();
+                return true;
+            }
+            break;
+
+        case State::STRING:
+            if (c == '"')
+            {
+                if (stringIsKey) state = State::COLON;
+                else EndValue();
+                stringIsKey = false;
+                return true;
+            }
+            if (c == '\\')
+            {
+                state = State::STRING_ESCAPE;
+                return true;
+            }
+            if (byte < 0x20) break; //Control characters must be escaped
+            if (byte < 0x80) return true;
+
+            //Lead byte of a multi byte UTF-8 sequence
+            if (byte >= 0xC2 && byte <= 0xDF) remainingCharacters = 1;
+            else if (byte >= 0xE0 && byte <= 0xEF) remainingCharacters = 2;
+            else if (byte >= 0xF0 && byte <= 0xF4) remainingCharacters = 3;
+            else break;
+            state = State::STRING_UTF8_CONTINUATION;
+            return true;
+
+        case State::STRING_UTF8_CONTINUATION:
+            if ((byte & 0xC0) != 0x80) break;
+            remainingCharacters--;
+            if (remainingCharacters == 0) state = State::STRING;
+            return true;
+
+        case State::STRING_ESCAPE:
+            if (c == 'u')
+            {
+                remainingCharacters = 4;
+                state = State::STRING_UNICODE_ESCAPE;
+                return true;
+            }
+            if (c == '"' || c == '\\' || c == '/' || c == 'b' || c == 'f' || c == 'n' || c == 'r' || c == 't')
+            {
+                state = State::STRING;
+                return true;
+            }
+            break;
+
+        case State::STRING_UNICODE_ESCAPE:
+            if (!IsHexDigit(c)) break;
+            remainingCharacters--;
+            if (remainingCharacters == 0) state = State::STRING;
+            return true;
+
+        case State::NUMBER_MINUS:
+            if (c == '0') state = State::NUMBER_ZERO;
+            else if (IsDigit(c)) state = State::NUMBER_INTEGER;
+            else break;
+            return true;
+
+        case State::NUMBER_ZERO:
+        case State::NUMBER_INTEGER:
+            if (IsDigit(c) && state == State::NUMBER_INTEGER) return true;
+            if (c == '.')
+            {
+                state = State::NUMBER_FRACTION_START;
+                return true;
+            }
+            if (c == 'e' || c == 'E')
+            {
+                state = State::NUMBER_EXPONENT_START;
+                return true;
+            }
+            EndValue();
+            return false;
+
+        case State::NUMBER_FRACTION_START:
+            if (!IsDigit(c)) break;
+            state = State::NUMBER_FRACTION;
+            return true;
+
+        case State::NUMBER_FRACTION:
+            if (IsDigit(c)) return true;
+            if (c == 'e' || c == 'E')
+            {
+                state = State::NUMBER_EXPONENT_START;
+                return true;
+            }
+            EndValue();
+            return false;
+
+        case State::NUMBER_EXPONENT_START:
+            if (c == '+' || c == '-') state = State::NUMBER_EXPONENT_SIGN;
+            else if (IsDigit(c)) state = State::NUMBER_EXPONENT;
+            else break;
+            return true;
+
+        case State::NUMBER_EXPONENT_SIGN:
+            if (!IsDigit(c)) break;
+            state = State::NUMBER_EXPONENT;
+            return true;
+
+        case State::NUMBER_EXPONENT:
+            if (IsDigit(c)) return true;
+            EndValue();
+            return false;
+
+        case State::LITERAL:
+            if (c != *remainingLiteral) break;
+            remainingLiteral++;
+            if (*remainingLiteral == '\0') EndValue();
+            return true;
+
+        case State::INVALID:
+            break;
+    }
+
+    state = State::INVALID;
+    return false;
+}
+
+bool JsonStreamValidator::StartValue(char c)
+{
+    if (c == '{' || c == '[')
+    {
+        if (depth >= MAX_NESTING_DEPTH)
+        {
+            state = State::INVALID;
+            return false;
+        }
+        isObject[depth] = c == '{';
+        depth++;
+        state = c == '{' ? State::KEY_OR_OBJECT_END : State::VALUE_OR_ARRAY_END;
+    }
+    else if (c == '"')
+    {
+        stringIsKey = false;
+        state = State::STRING;
+    }
+    else if (c == '-') state = State::NUMBER_MINUS;
+    else if (c == '0') state = State::NUMBER_ZERO;
+    else if (IsDigit(c)) state = State::NUMBER_INTEGER;
+    else if (c == 't') remainingLiteral = "rue";
+    else if (c == 'f') remainingLiteral = "alse";
+    else if (c == 'n') remainingLiteral = "ull";
+    else
+    {
+        state = State::INVALID;
+        return false;
+    }
+
+    if (c == 't' || c == 'f' || c == 'n') state = State::LITERAL;
+    return true;
+}
+
+void JsonStreamValidator::EndValue()
+{
+    state = State::AFTER_VALUE;
+    if (depth == 0) foundValue = true;
+}
+
+bool JsonStreamValidator::IsInNumber() const
+{
+    return state == State::NUMBER_ZERO
+        || state == State::NUMBER_INTEGER
+        || state == State::NUMBER_FRACTION
+        || state == State::NUMBER_EXPONENT;
+}
+
+bool JsonStreamValidator::IsWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool JsonStreamValidator::IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool JsonStreamValidator::IsHexDigit(char c)
+{
+    return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
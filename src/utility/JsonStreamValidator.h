@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FmTypes.h"
+
+/*
+ * Checks that a stream of characters is exactly one well formed json value without building
+ * it in memory. The text can be fed in arbitrary fragments, e.g. as the parts of a json message
+ * are logged. Only the nesting of objects and arrays is stored, so the cost is a single pass
+ * over the text with a fixed amount of memory.
+ */
+class JsonStreamValidator
+{
+public:
+    static constexpr u8 MAX_NESTING_DEPTH = 64;
+
+private:
+    enum class State : u8
+    {
+        VALUE,
+        VALUE_OR_ARRAY_END,
+        KEY,
+        KEY_OR_OBJECT_END,
+        COLON,
+        AFTER_VALUE,
+        STRING,
+        STRING_ESCAPE,
+        STRING_UNICODE_ESCAPE,
+        STRING_UTF8_CONTINUATION,
+        NUMBER_MINUS,
+        NUMBER_ZERO,
+        NUMBER_INTEGER,
+        NUMBER_FRACTION_START,
+        NUMBER_FRACTION,
+        NUMBER_EXPONENT_START,
+        NUMBER_EXPONENT_SIGN,
+        NUMBER_EXPONENT,
+        LITERAL,
+        INVALID,
+    };
+
+    State state = State::VALUE;
+    //true for objects and false for arrays
+    bool isObject[MAX_NESTING_DEPTH] = {};
+    u8 depth = 0;
+    bool stringIsKey = false;
+    bool foundValue = false;
+    //Remaining hex digits of a \u escape or continuation bytes of a UTF-8 sequence
+    u8 remainingCharacters = 0;
+    const char* remainingLiteral = nullptr;
+
+    bool Consume(char c);
+    bool StartValue(char c);
+    void EndValue();
+    bool IsInNumber() const;
+
+    static bool IsWhitespace(char c);
+    static bool IsDigit(char c);
+    static bool IsHexDigit(char c);
+
+public:
+    /// Continues the validation with the given zero terminated fragment.
+    void Feed(const char* fragment);
+
+    /// Returns true if everything fed since the last reset was exactly one json value
+    /// (surrounded by optional whitespace). Resets the validator for the next message.
+    bool Finish();
+
+    void Reset();
+};
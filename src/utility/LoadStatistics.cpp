@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+
+#include "LoadStatistics.h"
+
+#ifdef SIM_ENABLED
+#include "Utility.h"
+
+LoadStatistics::LoadStatistics()
+{
+    Reset(0);
+}
+
+void LoadStatistics::Reset(u32 expectedSenders)
+{
+    senders.clear();
+    senders.reserve(expectedSenders);
+    u32 amountOfSlots = 8;
+    while (amountOfSlots < 2 * expectedSenders) amountOfSlots *= 2;
+    ResizeIndex(amountOfSlots);
+}
+
+u32 LoadStatistics::GetSlot(NodeId sender) const
+{
+    const u32 mask = (u32)indexSlots.size() - 1;
+    u32 slot = ((u32)sender * 2654435761UL) & mask;
+    while (indexSlots[slot] != EMPTY_SLOT && senders[indexSlots[slot]].sender != sender)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void LoadStatistics::ResizeIndex(u32 amountOfSlots)
+{
+    indexSlots.assign(amountOfSlots, EMPTY_SLOT);
+    for (u32 i = 0; i < senders.size(); i++)
+    {
+        indexSlots[GetSlot(senders[i].sender)] = i;
+    }
+}
+
+LoadStatistics::SenderStatistics* LoadStatistics::GetOrCreateSender(NodeId sender)
+{
+    u32 slot = GetSlot(sender);
+    if (indexSlots[slot] != EMPTY_SLOT) return &senders[indexSlots[slot]];
+
+    //Keep the table at most half full so that lookups stay short
+    if (2 * (senders.size() + 1) > indexSlots.size())
+    {
+        ResizeIndex((u32)indexSlots.size() * 2);
+        slot = GetSlot(sender);
+    }
+
+    SenderStatistics entry;
+    CheckedMemset(&entry, 0, sizeof(entry));
+    entry.sender = sender;
+    entry.minDelayMs = UINT32_MAX;
+    indexSlots[slot] = (u32)senders.size();
+    senders.push_back(entry);
+    return &senders.back();
+}
+
+const LoadStatistics::SenderStatistics* LoadStatistics::GetSender(NodeId sender) const
+{
+    const u32 slot = GetSlot(sender);
+    if (indexSlots[slot] == EMPTY_SLOT) return nullptr;
+    return &senders[indexSlots[slot]];
+}
+
+u32 LoadStatistics::GetDelayBin(u32 delayMs)
+{
+    if (delayMs < 4) return delayMs;
+
+    u32 exponent = 2;
+    while ((delayMs >> (exponent + 1)) != 0) exponent++;
+
+    const u32 bin = 4 + (exponent - 2) * 4 + ((delayMs >> (exponent - 2)) & 3);
+    return bin < NUM_DELAY_BINS ? bin : NUM_DELAY_BINS - 1;
+}
+
+u32 LoadStatistics::GetDelayBinUpperBoundMs(u32 bin)
+{
+    if (bin < 4) return bin;
+    if (bin >= NUM_DELAY_BINS - 1) return UINT32_MAX;
+
+    const u32 exponent = (bin - 4) / 4 + 2;
+    const u32 lowerBoundMs = (4 + (bin - 4) % 4) << (exponent - 2);
+    return lowerBoundMs + (1UL << (exponent - 2)) - 1;
+}
+
+u32 LoadStatistics::GetDelayPercentileMs(const u32* bins, u32 amount, u32 percent)
+{
+    if (amount == 0) return 0;
+
+    //Rounded up without overflowing for large amounts
+    const u32 rank = amount / 100 * percent + (amount % 100 * percent + 99) / 100;
+    u32 cumulated = 0;
+    for (u32 i = 0; i < NUM_DELAY_BINS; i++)
+    {
+        cumulated += bins[i];
+        if (cumulated >= rank) return GetDelayBinUpperBoundMs(i);
+    }
+    return GetDelayBinUpperBoundMs(NUM_DELAY_BINS - 1);
+}
+
+void LoadStatistics::RecordReceivedPacket(NodeId sender, u32 delayMs, bool payloadCorrect)
+{
+    SenderStatistics* entry = GetOrCreateSender(sender);
+    if (!payloadCorrect)
+    {
+        entry->corruptedPackets++;
+        return;
+    }
+
+    entry->receivedPackets++;
+    entry->delaySumMs += delayMs;
+    if (delayMs < entry->minDelayMs) entry->minDelayMs = delayMs;
+    if (delayMs > entry->maxDelayMs) entry->maxDelayMs = delayMs;
+    entry->delayBins[GetDelayBin(delayMs)]++;
+}
+
+void LoadStatistics::RecordSentPackets(NodeId sender, u32 amount)
+{
+    GetOrCreateSender(sender)->sentPackets += amount;
+}
+
+u32 LoadStatistics::GetAmountOfSenders() const
+{
+    return (u32)senders.size();
+}
+
+const std::vector<LoadStatistics::SenderStatistics>& LoadStatistics::GetSenders() const
+{
+    return senders;
+}
+
+void LoadStatistics::SetSenders(const std::vector<SenderStatistics>& senders)
+{
+    Reset((u32)senders.size());
+    this->senders = senders;
+    ResizeIndex((u32)indexSlots.size());
+}
+
+LoadStatistics::Summary LoadStatistics::GetSummary(NodeId sender) const
+{
+    Summary summary;
+    CheckedMemset(&summary, 0, sizeof(summary));
+    summary.minDelayMs = UINT32_MAX;
+
+    u32 bins[NUM_DELAY_BINS];
+    CheckedMemset(bins, 0, sizeof(bins));
+    float delaySumMs = 0;
+
+    for (const SenderStatistics& entry : senders)
+    {
+        if (sender != NODE_ID_BROADCAST && entry.sender != sender) continue;
+
+        summary.senders++;
+        summary.receivedPackets += entry.receivedPackets;
+        summary.corruptedPackets += entry.corruptedPackets;
+        summary.sentPackets += entry.sentPackets;
+        delaySumMs += (float)entry.delaySumMs;
+        if (entry.receivedPackets > 0)
+        {
+            if (entry.minDelayMs < summary.minDelayMs) summary.minDelayMs = entry.minDelayMs;
+            if (entry.maxDelayMs > summary.maxDelayMs) summary.maxDelayMs = entry.maxDelayMs;
+        }
+        for (u32 k = 0; k < NUM_DELAY_BINS; k++) bins[k] += entry.delayBins[k];
+    }
+
+    if (summary.receivedPackets == 0)
+    {
+        summary.minDelayMs = 0;
+        return summary;
+    }
+
+    //The percentiles are only as exact as the histogram bins, but never outside of the observed range
+    summary.medianDelayMs = GetDelayPercentileMs(bins, summary.receivedPackets, 50);
+    summary.p99DelayMs = GetDelayPercentileMs(bins, summary.receivedPackets, 99);
+    if (summary.medianDelayMs > summary.maxDelayMs) summary.medianDelayMs = summary.maxDelayMs;
+    if (summary.p99DelayMs > summary.maxDelayMs) summary.p99DelayMs = summary.maxDelayMs;
+    if (summary.medianDelayMs < summary.minDelayMs) summary.medianDelayMs = summary.minDelayMs;
+    if (summary.p99DelayMs < summary.minDelayMs) summary.p99DelayMs = summary.minDelayMs;
+    summary.averageDelayMs = (u32)(delaySumMs / summary.receivedPackets);
+
+    return summary;
+}
+#endif //SIM_ENABLED
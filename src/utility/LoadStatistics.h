@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// /****************************************************************************
+// **
+// ** Copyright (C) 2015-2022 M-Way Solutions GmbH
+// ** Contact: https://www.blureange.io/licensing
+// **
+// ** This file is part of the Bluerange/FruityMesh implementation
+// **
+// ** $BR_BEGIN_LICENSE:GPL-EXCEPT$
+// ** Commercial License Usage
+// ** Licensees holding valid commercial Bluerange licenses may use this file in
+// ** accordance with the commercial license agreement provided with the
+// ** Software or, alternatively, in accordance with the terms contained in
+// ** a written agreement between them and M-Way Solutions GmbH.
+// ** For licensing terms and conditions see https://www.bluerange.io/terms-conditions. For further
+// ** information use the contact form at https://www.bluerange.io/contact.
+// **
+// ** GNU General Public License Usage
+// ** Alternatively, this file may be used under the terms of the GNU
+// ** General Public License version 3 as published by the Free Software
+// ** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+// ** included in the packaging of this file. Please review the following
+// ** information to ensure the GNU General Public License requirements will
+// ** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+// **
+// ** $BR_END_LICENSE$
+// **
+// ****************************************************************************/
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "FmTypes.h"
+
+#ifdef SIM_ENABLED
+#include <vector>
+
+/*
+ * Collects streaming statistics about the GENERATE_LOAD_CHUNK packets of a load test, kept per sending node.
+ * Senders are looked up by their NodeId in an open addressing table that is sized for the amount of senders
+ * given to Reset, e.g. the cluster size, and grows if more senders report. Delays are stored in a log-linear
+ * histogram with 4 bins per power of two, so that the reported percentiles are within 25% of the real value.
+ * Only used by the simulator, the firmware does not spend any RAM on it.
+ */
+class LoadStatistics
+{
+public:
+    static constexpr u32 NUM_DELAY_BINS = 64;
+
+    struct SenderStatistics
+    {
+        NodeId sender;
+        u32 receivedPackets; //Packets with a correct payload
+        u32 corruptedPackets; //Packets with a wrong payload
+        u32 sentPackets; //Packets that the sender reported to have written, including collisions
+        u32 minDelayMs;
+        u32 maxDelayMs;
+        u32 delaySumMs;
+        u32 delayBins[NUM_DELAY_BINS]; //Counts up to receivedPackets, so the percentiles can be ranked by it
+    };
+
+    //Aggregated view on one or all senders
+    struct Summary
+    {
+        u32 senders;
+        u32 receivedPackets;
+        u32 corruptedPackets;
+        u32 sentPackets;
+        u32 minDelayMs;
+        u32 medianDelayMs;
+        u32 p99DelayMs;
+        u32 maxDelayMs;
+        u32 averageDelayMs;
+    };
+
+private:
+    static constexpr u32 EMPTY_SLOT = UINT32_MAX;
+
+    std::vector<SenderStatistics> senders;
+    //Indices into senders, the size is a power of two and at least twice the amount of senders
+    std::vector<u32> indexSlots;
+
+    u32 GetSlot(NodeId sender) const;
+    void ResizeIndex(u32 amountOfSlots);
+    SenderStatistics* GetOrCreateSender(NodeId sender);
+    static u32 GetDelayBin(u32 delayMs);
+    static u32 GetDelayBinUpperBoundMs(u32 bin);
+    static u32 GetDelayPercentileMs(const u32* bins, u32 amount, u32 percent);
+
+public:
+    LoadStatistics();
+
+    //Removes all senders and reserves memory for the given amount of senders
+    void Reset(u32 expectedSenders);
+
+    void RecordReceivedPacket(NodeId sender, u32 delayMs, bool payloadCorrect);
+    void RecordSentPackets(NodeId sender, u32 amount);
+
+    //Returns nullptr if nothing was recorded for this sender
+    const SenderStatistics* GetSender(NodeId sender) const;
+    u32 GetAmountOfSenders() const;
+
+    //Used by the simulator to store the statistics in a snapshot and to restore them again
+    const std::vector<SenderStatistics>& GetSenders() const;
+    void SetSenders(const std::vector<SenderStatistics>& senders);
+
+    //Aggregates a single sender or all senders if sender is NODE_ID_BROADCAST
+    Summary GetSummary(NodeId sender) const;
+};
+#endif //SIM_ENABLED
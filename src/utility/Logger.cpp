@@ -37,14 +37,16 @@
 
 #ifdef SIM_ENABLED
 #include <CherrySim.h>
-#include "json.hpp"
 #endif
 
 // Size for tracing messages to the log transport, if it is too short, messages will get truncated
 constexpr size_t TRACE_BUFFER_SIZE = 500;
+static constexpr u32 ERROR_TAG_ID = Logger::GetTagId("ERROR");
+static constexpr u32 WARNING_TAG_ID = Logger::GetTagId("WARNING");
 
 Logger::Logger() : errorLog{}
 {
+    UpdateEnabledTagBits();
 }
 
 Logger &Logger::GetInstance()
@@ -104,9 +106,9 @@ void Logger::Log_f(bool printLine, bool isJson, bool isEndOfMessage, bool skipJs
         }
 
 #ifdef SIM_ENABLED
-        //Accumulate the messages in another buffer used for validating the json content
-        //This is only enabled if stdout is active to improve performance
-        if(Terminal::stdioActive) currentString += mhTraceBuffer;
+        //Validate the json content incrementally as the parts of the message are logged
+        //This is only enabled if stdout is active
+        if(Terminal::stdioActive) jsonValidator.Feed(mhTraceBuffer);
 #endif
         log_transport_putstring(mhTraceBuffer);
 
@@ -119,13 +121,10 @@ void Logger::Log_f(bool printLine, bool isJson, bool isEndOfMessage, bool skipJs
             }
 #ifdef SIM_ENABLED
             //Check that we have a valid json
-            //As this costs quite a bit of performance it is only enabled if stdout is active
             if (Terminal::stdioActive) {
-                nlohmann::json j = nlohmann::json::parse(currentString, nullptr, false);
-                if (j.is_discarded()) {
+                if (!jsonValidator.Finish()) {
                     SIMEXCEPTION(JsonParseException);
                 }
-                currentString = "";
             }
 #endif
         }
@@ -136,7 +135,7 @@ void Logger::Log_f(bool printLine, bool isJson, bool isEndOfMessage, bool skipJs
     }
 }
 
-void Logger::LogTag_f(LogType logType, const char* file, i32 line, const char* tag, const char* message, ...) const
+void Logger::LogTag_f(LogType logType, const char* file, i32 line, const char* tag, u32 tagId, const char* message, ...) const
 {
 #ifdef SIM_ENABLED
     //Early return improves the simulator performance if the terminal is not active in the simulator
@@ -148,11 +147,11 @@ void Logger::LogTag_f(LogType logType, const char* file, i32 line, const char* t
             //UART communication (json mode)
             (
                 Conf::GetInstance().terminalMode != TerminalMode::PROMPT
-                && (logEverything || logType == LogType::UART_COMMUNICATION || IsTagEnabled(tag))
+                && (logEverything || logType == LogType::UART_COMMUNICATION || IsTagEnabled(tag, tagId))
             )
             //User interaction (prompt mode)
             || (Conf::GetInstance().terminalMode == TerminalMode::PROMPT
-                && (logEverything || logType == LogType::TRACE || IsTagEnabled(tag))
+                && (logEverything || logType == LogType::TRACE || IsTagEnabled(tag, tagId))
             )
         )
     {
@@ -187,7 +186,7 @@ void Logger::LogTag_f(LogType logType, const char* file, i32 line, const char* t
         }
     }
 #ifdef SIM_ENABLED
-    if (strcmp(tag, "ERROR") == 0)
+    if (tagId == ERROR_TAG_ID)
     {
         //ERRORs are classified as severe enough that they should not happend
         //during normal execution. If they are logged, something went wrong
@@ -269,6 +268,8 @@ void Logger::EnableTag(const char* tag)
 
     if (!found && emptySpot >= 0) {
         strcpy(&activeLogTags[emptySpot * MAX_LOG_TAG_LENGTH], tagUpper);
+        activeLogTagIds[emptySpot] = GetTagId(tagUpper);
+        UpdateEnabledTagBits();
     }
     else if (!found && emptySpot < 0)
     {
@@ -281,7 +282,18 @@ void Logger::EnableTag(const char* tag)
 #endif
 }
 
+u32 Logger::TagIdCollidesWithErrorOrWarning()
+{
+    //Only referenced by GetLiteralTagId to stop the compilation of a colliding tag, it is never called
+    return 0;
+}
+
 bool Logger::IsTagEnabled(const char* tag) const
+{
+    return IsTagEnabled(tag, GetTagId(tag));
+}
+
+bool Logger::IsTagEnabled(const char* tag, u32 tagId) const
 {
 #ifdef SIM_ENABLED
     //Early return improves the simulator performance if the terminal is not active in the simulator
@@ -290,18 +302,59 @@ bool Logger::IsTagEnabled(const char* tag) const
 
 #if IS_ACTIVE(LOGGING) && defined(TERMINAL_ENABLED)
 
-    if (strcmp(tag, "ERROR") == 0 || strcmp(tag, "WARNING") == 0) {
+    const u32 bit = tagId % LOG_TAG_BITSET_SIZE;
+    if ((enabledTagBits[bit / 32] & (1UL << (bit % 32))) == 0) {
+        return false;
+    }
+
+    //No tag of a logt shares the id of ERROR or WARNING, see GetLiteralTagId
+    if (tagId == ERROR_TAG_ID || tagId == WARNING_TAG_ID) {
         return true;
     }
+    //Other tags can share the same bit or even the same id, so the name must be compared as well
     for (u32 i = 0; i < MAX_ACTIVATE_LOG_TAG_NUM; i++)
     {
-        if (strcmp(&activeLogTags[i * MAX_LOG_TAG_LENGTH], tag) == 0) return true;
+        if (activeLogTagIds[i] == tagId && strcmp(&activeLogTags[i * MAX_LOG_TAG_LENGTH], tag) == 0) return true;
     }
 #endif
 
     return false;
 }
 
+bool Logger::IsLogLineEnabled(const char* tag, u32 tagId) const
+{
+#if IS_ACTIVE(LOGGING) && defined(TERMINAL_ENABLED)
+    //Must match the conditions under which LogTag_f handles a LogType::LOG_LINE
+#ifdef SIM_ENABLED
+    if (!GS->terminal.IsTermActive()) return false;
+    //Logged ERRORs raise an exception in the simulator, even if the tag is disabled
+    if (tagId == ERROR_TAG_ID) return true;
+#endif
+    return logEverything || IsTagEnabled(tag, tagId);
+#else
+    return false;
+#endif
+}
+
+//Must be called whenever activeLogTags changed
+void Logger::UpdateEnabledTagBits()
+{
+    enabledTagBits = {};
+
+    const u32 alwaysEnabledTagIds[] = { ERROR_TAG_ID, WARNING_TAG_ID };
+    for (u32 tagId : alwaysEnabledTagIds)
+    {
+        const u32 bit = tagId % LOG_TAG_BITSET_SIZE;
+        enabledTagBits[bit / 32] |= 1UL << (bit % 32);
+    }
+    for (u32 i = 0; i < MAX_ACTIVATE_LOG_TAG_NUM; i++)
+    {
+        if (activeLogTags[i * MAX_LOG_TAG_LENGTH] == '\0') continue;
+        const u32 bit = activeLogTagIds[i] % LOG_TAG_BITSET_SIZE;
+        enabledTagBits[bit / 32] |= 1UL << (bit % 32);
+    }
+}
+
 void Logger::DisableTag(const char* tag)
 {
 #if IS_ACTIVE(LOGGING) && defined(TERMINAL_ENABLED)
@@ -319,6 +372,7 @@ void Logger::DisableTag(const char* tag)
     for (u32 i = 0; i < MAX_ACTIVATE_LOG_TAG_NUM; i++) {
         if (strcmp(&activeLogTags[i * MAX_LOG_TAG_LENGTH], tagUpper) == 0) {
             activeLogTags[i * MAX_LOG_TAG_LENGTH] = '\0';
+            UpdateEnabledTagBits();
             return;
         }
     }
@@ -355,6 +409,7 @@ void Logger::ToggleTag(const char* tag)
     //If we haven't found it, we enable it by using the previously found empty spot
     if (!found && emptySpot >= 0) {
         strcpy(&activeLogTags[emptySpot * MAX_LOG_TAG_LENGTH], tagUpper);
+        activeLogTagIds[emptySpot] = GetTagId(tagUpper);
         logt("WARNING", "Tag enabled");
     }
     else if (!found && emptySpot < 0) {
@@ -365,6 +420,7 @@ void Logger::ToggleTag(const char* tag)
     {
         logt("WARNING", "Tag disabled");
     }
+    UpdateEnabledTagBits();
 
 #endif
 }
@@ -1181,6 +1237,8 @@ u32 Logger::ParseBase64StringToBuffer(const char * base64String, const u32 base6
 void Logger::DisableAll()
 {
     activeLogTags = {};
+    activeLogTagIds = {};
+    UpdateEnabledTagBits();
     logEverything = false;
 }
 
@@ -36,14 +36,17 @@
 #include <ErrorLog.h>
 
 #ifdef SIM_ENABLED
-#include <string>
+#include <JsonStreamValidator.h>
 #endif
 
 #include <array>
 #include <limits>
+#include <type_traits>
 
 constexpr int MAX_ACTIVATE_LOG_TAG_NUM = 40;
 constexpr int MAX_LOG_TAG_LENGTH = 11;
+//Number of bits that are used to quickly check if a tag is enabled, must be a multiple of 32
+constexpr int LOG_TAG_BITSET_SIZE = 256;
 
 #ifdef _MSC_VER
 #include <string.h>
@@ -54,7 +57,7 @@ constexpr int MAX_LOG_TAG_LENGTH = 11;
 
 /*
  * The Logger enables outputting debug data to UART.
- * Any log tag can be used with the logt() command. The message will be logged
+ * Any log tag can be used with the logt() command as a string literal. The message will be logged
  * only if the applicable logtag has been enabled previously.
  * It will also print strings for common error codes.
  */
@@ -82,11 +85,17 @@ public:
 
 private:
     std::array<char, MAX_ACTIVATE_LOG_TAG_NUM * MAX_LOG_TAG_LENGTH> activeLogTags = {};
+    //The tag id of each slot in activeLogTags
+    std::array<u32, MAX_ACTIVATE_LOG_TAG_NUM> activeLogTagIds = {};
+    //One bit per (tag id % LOG_TAG_BITSET_SIZE) that is set if a tag with this id may be enabled
+    std::array<u32, LOG_TAG_BITSET_SIZE / 32> enabledTagBits = {};
+
+    void UpdateEnabledTagBits();
 
     u32 currentJsonCrc = 0;
 
 #ifdef SIM_ENABLED
-    std::string currentString = "";
+    JsonStreamValidator jsonValidator;
 #endif
 
     ErrorLog errorLog;
@@ -107,7 +116,7 @@ public:
 #define CheckPrintfFormating(...) /*do nothing*/
 #endif
     void Log_f(bool printLine, bool isJson, bool isEndOfMessage, bool skipJsonEvent, const char* file, i32 line, const char* message, ...) CheckPrintfFormating(8, 9);
-    void LogTag_f(LogType logType, const char* file, i32 line, const char* tag, const char* message, ...) const CheckPrintfFormating(6, 7);
+    void LogTag_f(LogType logType, const char* file, i32 line, const char* tag, u32 tagId, const char* message, ...) const CheckPrintfFormating(7, 8);
 #undef CheckPrintfFormating
 
     void LogError(LoggingError errorType, u32 errorCode, u32 extraInfo);
@@ -127,9 +136,33 @@ public:
     void DisableAll();
     void EnableAll();
 
+    //A tag is identified by a hash (FNV-1a) of its name. logt and LOGT_ENABLED compute it at compile time,
+    //which is why they only accept string literals as tags, so that checking a tag is mostly a single bit test.
+    static constexpr u32 GetTagId(const char* tag, u32 hash = 2166136261UL)
+    {
+        return *tag == '\0' ? hash : GetTagId(tag + 1, (hash ^ (u8)*tag) * 16777619UL);
+    }
+    static constexpr bool AreTagsEqual(const char* a, const char* b)
+    {
+        return *a == *b && (*a == '\0' || AreTagsEqual(a + 1, b + 1));
+    }
+    //ERROR and WARNING are recognized by their id alone. A tag that shares the id of one of them calls
+    //a function that is not constexpr, so LOG_TAG_ID does not compile for it.
+    static constexpr u32 GetLiteralTagId(const char* tag)
+    {
+        return (GetTagId(tag) == GetTagId("ERROR") && !AreTagsEqual(tag, "ERROR"))
+            || (GetTagId(tag) == GetTagId("WARNING") && !AreTagsEqual(tag, "WARNING"))
+            ? TagIdCollidesWithErrorOrWarning() : GetTagId(tag);
+    }
+    static u32 TagIdCollidesWithErrorOrWarning();
+
     //These functions are used to enable/disable a debug tag, it will then be printed to the output
     void EnableTag(const char* tag);
     bool IsTagEnabled(const char* tag) const;
+    bool IsTagEnabled(const char* tag, u32 tagId) const;
+    //Returns true if a logt with this tag would print something. Formatting log arguments (e.g. with TO_HEX)
+    //is expensive on the data path, LOGT_ENABLED uses this to skip it if the log would be dropped anyway.
+    bool IsLogLineEnabled(const char* tag, u32 tagId) const;
     void DisableTag(const char* tag);
     void ToggleTag(const char* tag);
 
@@ -192,12 +225,17 @@ private:
 #endif
 
 #if IS_ACTIVE(LOGGING)
+//Forces the compiler to hash the tag at compile time, even in debug builds
+#define LOG_TAG_ID(tag) std::integral_constant<u32, Logger::GetLiteralTagId(tag)>::value
 #define logs(message, ...) Logger::GetInstance().Log_f(true, false, true, false, __FILE_S__, __LINE__, message, ##__VA_ARGS__)
-#define logt(tag, message, ...) Logger::GetInstance().LogTag_f(Logger::LogType::LOG_LINE, __FILE_S__, __LINE__, tag, message, ##__VA_ARGS__)
+#define logt(tag, message, ...) Logger::GetInstance().LogTag_f(Logger::LogType::LOG_LINE, __FILE_S__, __LINE__, tag, LOG_TAG_ID(tag), message, ##__VA_ARGS__)
 #define TO_BASE64(data, dataSize) DYNAMIC_ARRAY(data##Hex, (dataSize)*3+1); Logger::ConvertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
 #define TO_BASE64_2(data, dataSize) Logger::ConvertBufferToBase64String(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
 #define TO_HEX(data, dataSize) DYNAMIC_ARRAY(data##Hex, (dataSize)*3+1); Logger::ConvertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
 #define TO_HEX_2(data, dataSize) Logger::ConvertBufferToHexString(data, (dataSize), (char*)data##Hex, (dataSize)*3+1)
+//Guards the formatting of log arguments together with the logt that prints them, e.g.
+//if (LOGT_ENABLED("MACONN")) { TO_HEX(data, dataLength); logt("MACONN", "Data %s", dataHex); }
+#define LOGT_ENABLED(tag) Logger::GetInstance().IsLogLineEnabled(tag, LOG_TAG_ID(tag))
 
 #else //ACTIVATE_LOGGING
 
@@ -207,5 +245,6 @@ private:
 #define TO_BASE64_2(data, dataSize) do{}while(0)
 #define TO_HEX(data, dataSize)      do{}while(0)
 #define TO_HEX_2(data, dataSize)    do{}while(0)
+#define LOGT_ENABLED(tag)           false
 
 #endif //ACTIVATE_LOGGING
\ No newline at end of file
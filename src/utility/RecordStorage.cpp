@@ -72,7 +72,7 @@
 #include <GlobalState.h>
 #include <FruityHal.h>
 
-#define TO_PAGE(addr) (u32)(((((u32)(addr)) - FLASH_REGION_START_ADDRESS)/FruityHal::GetCodePageSize()))
+#define TO_PAGE(addr) (u32)(((POINTER_TO_FLASH_ADDRESS(addr) - FLASH_REGION_START_ADDRESS)/FruityHal::GetCodePageSize()))
 
 RecordStorage::RecordStorage()
     : opQueue(opBuffer, RECORD_STORAGE_QUEUE_SIZE)
@@ -81,7 +81,7 @@ RecordStorage::RecordStorage()
 
 void RecordStorage::Init()
 {
-    startPage = (u8*)Utility::GetSettingsPageBaseAddress();
+    startPage = FLASH_ADDRESS_TO_POINTER(Utility::GetSettingsPageBaseAddress());
     RepairPages();
     isInit = true;
 }
@@ -219,6 +219,9 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
 {
     //If any of the previous operations failed, call the callback with an error code
     if (op.op.flashStorageErrorCode != FlashStorageError::SUCCESS) {
+        //The record might have been written partially, so the index does not know what is in the flash
+        if (recordBeingSaved != nullptr) InvalidateRecordIndex();
+        recordBeingSaved = nullptr;
         return RecordOperationFinished(op.op, RecordStorageResultCode::BUSY);
     }
 
@@ -289,6 +292,7 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
             //The crc is calculated over the record header and data, excluding the first two byte (crc and flags)
             newRecord->crc = Utility::CalculateCrc8(((u8*)newRecord) + 2, newRecord->recordLength - 2);
             op.stage = RecordStorageSaveStage::CALLBACKS_AND_FINISH;
+            recordBeingSaved = (RecordStorageRecord*)freeSpace;
             FlashStorageError result = GS->flashStorage.CacheAndWriteData((u32*)newRecord, (u32*)freeSpace, recordLength, this, (u32)FlashUserTypes::DEFAULT);
             op.op.flashStorageErrorCode = result;
             return;
@@ -301,7 +305,7 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
             for (u32 i = 0; i < RECORD_STORAGE_NUM_PAGES; i++) {
                 RecordStoragePage& page = getPage(i);
                 u16 freeSpaceAfterDefragment = GetFreeSpaceWhenDefragmented(page);
-                logt("ERROR", "freeSpace in page %u: %u", ((u32)&page - (u32)FLASH_REGION_START_ADDRESS) / (u32)FruityHal::GetCodePageSize(), freeSpaceAfterDefragment);
+                logt("ERROR", "freeSpace in page %u: %u", TO_PAGE(&page), freeSpaceAfterDefragment);
             }
 
             return RecordOperationFinished(op.op, RecordStorageResultCode::NO_SPACE);
@@ -310,6 +314,16 @@ void RecordStorage::SaveRecordInternal(SaveRecordOperation& op)
     
     if (op.stage == RecordStorageSaveStage::CALLBACKS_AND_FINISH)
     {
+        //The new version of the record is now in the flash and replaces the old one in the index
+        if (recordBeingSaved != nullptr && recordBeingSaved->recordId == op.recordId && recordIndexValid)
+        {
+            UpdateRecordIndex(recordBeingSaved);
+        }
+        else
+        {
+            InvalidateRecordIndex();
+        }
+        recordBeingSaved = nullptr;
         return RecordOperationFinished(op.op, RecordStorageResultCode::SUCCESS);
     }
 }
@@ -331,6 +345,7 @@ void RecordStorage::DeactivateRecordInternal(DeactivateRecordOperation& op)
             return RecordOperationFinished(op.op, RecordStorageResultCode::SUCCESS);
         }
 
+        //The record is deactivated in place, so the index still points to the right record
         RecordStorageRecord newRecordHeader;
         CheckedMemset(&newRecordHeader, 0xFF, SIZEOF_RECORD_STORAGE_RECORD_HEADER);
         newRecordHeader.recordActive = 0;
@@ -432,7 +447,7 @@ void RecordStorage::ClearPageAndSaveImmortals(RecordStoragePage& page, bool forc
             return;
         }
 
-        logt("RS", "Defragmenting Page %u (free %u, after %u)", ((u32)defragmentPage - (u32)FLASH_REGION_START_ADDRESS) / (u32)FruityHal::GetCodePageSize(), GetFreeSpaceOnPage(*defragmentPage), GetFreeSpaceWhenDefragmented(*defragmentPage));
+        logt("RS", "Defragmenting Page %u (free %u, after %u)", TO_PAGE(defragmentPage), GetFreeSpaceOnPage(*defragmentPage), GetFreeSpaceWhenDefragmented(*defragmentPage));
     }
 
     //If there are items in the flashStorage queue, we wait until we get called after the queue is empty
@@ -467,7 +482,7 @@ void RecordStorage::ClearPageAndSaveImmortals(RecordStoragePage& page, bool forc
                 }
                 //If the record was not found on the swap page, we must move it
                 if (!found) {
-                    logt("RS", "Moving record %u", (u32)record);
+                    logt("RS", "Moving record %u", POINTER_TO_FLASH_ADDRESS(record));
                     GS->flashStorage.CacheAndWriteData((u32*)record, (u32*)freeSpacePtr, record->recordLength, nullptr, (u32)FlashUserTypes::DEFAULT);
                     return;
                 }
@@ -503,6 +518,9 @@ void RecordStorage::ClearPageAndSaveImmortals(RecordStoragePage& page, bool forc
             SIMEXCEPTION(IllegalStateException);
         }
 
+        //Once the header is written, the records exist twice until the old page is erased, so the index must be rebuilt afterwards
+        InvalidateRecordIndex();
+
         //Next, write Active to this page with a version that is newer than all other pages
         RecordStoragePage pageHeader;
         CheckedMemset(&pageHeader, 0, sizeof(pageHeader));
@@ -516,7 +534,7 @@ void RecordStorage::ClearPageAndSaveImmortals(RecordStoragePage& page, bool forc
     else if (defragmentationStage == DefragmentationStage::ERASE_OLD_PAGE)
     {
         //Finally, erase the page that we just swapped
-        GS->flashStorage.ErasePage(((u32)defragmentPage - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize(), this, (u32)FlashUserTypes::DEFAULT);
+        GS->flashStorage.ErasePage(TO_PAGE(defragmentPage), this, (u32)FlashUserTypes::DEFAULT);
 
         defragmentationStage = DefragmentationStage::FINALIZE;
     }
@@ -620,6 +638,7 @@ void RecordStorage::RepairPages()
 {
     if (repairStage == RepairStage::NO_REPAIR) {
         repairStage = RepairStage::ERASE_CORRUPT_PAGES;
+        InvalidateRecordIndex();
     }
 
     //If there are items in the flashStorage queue, we wait until we get called after the queue is empty
@@ -636,7 +655,7 @@ void RecordStorage::RepairPages()
             RecordStoragePageState pageState = GetPageState(page);
 
             if (pageState == RecordStoragePageState::CORRUPT) {
-                GS->flashStorage.ErasePage(((u32)&page - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize(), nullptr, (u32)FlashUserTypes::DEFAULT);
+                GS->flashStorage.ErasePage(TO_PAGE(&page), nullptr, (u32)FlashUserTypes::DEFAULT);
                 return;
             }
         }
@@ -663,7 +682,7 @@ void RecordStorage::RepairPages()
             }
 
             //Clear the swap page
-            GS->flashStorage.ErasePage(((u32)swapPage - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize(), nullptr, (u32)FlashUserTypes::DEFAULT);
+            GS->flashStorage.ErasePage(TO_PAGE(swapPage), nullptr, (u32)FlashUserTypes::DEFAULT);
             return;
         }
 
@@ -720,7 +739,7 @@ void RecordStorage::RepairPages()
 
                 //Now, we must check that the rest of the page is clean
                 u32* pageData = (u32*)&page;
-                u32 freeSpaceOffset = ((u32)record) - ((u32)pageData);
+                u32 freeSpaceOffset = (u32)((u8*)record - (u8*)pageData);
                 for(u32 j=freeSpaceOffset; j<FruityHal::GetCodePageSize(); j+=sizeof(u32)){
                     if(pageData[j/4] != 0xFFFFFFFF){
                         repairStage = RepairStage::FINALIZE;
@@ -738,6 +757,7 @@ void RecordStorage::RepairPages()
     if (repairStage == RepairStage::FINALIZE)
     {
         repairStage = RepairStage::NO_REPAIR;
+        if (IsRecordIndexUsable()) RebuildRecordIndex();
 
         //If this repair process was initiated from a lock down.
         if (recordStorageLockDown)
@@ -786,7 +806,7 @@ void RecordStorage::DefragmentPage(RecordStoragePage& pageToDefragment, bool for
             return;
         }
 
-        logt("RS", "Defragmenting Page %u (free %u, after %u)", ((u32)defragmentPage - (u32)FLASH_REGION_START_ADDRESS) / (u32)FruityHal::GetCodePageSize(), GetFreeSpaceOnPage(*defragmentPage), GetFreeSpaceWhenDefragmented(*defragmentPage));
+        logt("RS", "Defragmenting Page %u (free %u, after %u)", TO_PAGE(defragmentPage), GetFreeSpaceOnPage(*defragmentPage), GetFreeSpaceWhenDefragmented(*defragmentPage));
     }
 
     //If there are items in the flashStorage queue, we wait until we get called after the queue is empty
@@ -820,7 +840,7 @@ void RecordStorage::DefragmentPage(RecordStoragePage& pageToDefragment, bool for
                 }
                 //If the record was not found on the swap page, we must move it
                 if (!found) {
-                    logt("RS", "Moving record %u", (u32)record);
+                    logt("RS", "Moving record %u", POINTER_TO_FLASH_ADDRESS(record));
                     GS->flashStorage.CacheAndWriteData((u32*)record, (u32*)freeSpacePtr, record->recordLength, nullptr, (u32)FlashUserTypes::DEFAULT);
                     return;
                 }
@@ -856,6 +876,9 @@ void RecordStorage::DefragmentPage(RecordStoragePage& pageToDefragment, bool for
             SIMEXCEPTION(IllegalStateException);
         }
 
+        //Once the header is written, the records exist twice until the old page is erased, so the index must be rebuilt afterwards
+        InvalidateRecordIndex();
+
         //Next, write Active to this page with a version that is newer than all other pages
         RecordStoragePage pageHeader;
         CheckedMemset(&pageHeader, 0, sizeof(pageHeader));
@@ -869,7 +892,7 @@ void RecordStorage::DefragmentPage(RecordStoragePage& pageToDefragment, bool for
     else if (defragmentationStage == DefragmentationStage::ERASE_OLD_PAGE)
     {
         //Finally, erase the page that we just swapped
-        GS->flashStorage.ErasePage(((u32)defragmentPage - FLASH_REGION_START_ADDRESS) / FruityHal::GetCodePageSize(), this, (u32)FlashUserTypes::DEFAULT);
+        GS->flashStorage.ErasePage(TO_PAGE(defragmentPage), this, (u32)FlashUserTypes::DEFAULT);
 
         defragmentationStage = DefragmentationStage::FINALIZE;
     }
@@ -994,6 +1017,30 @@ SizedData RecordStorage::GetRecordData(u16 recordId) const
 //Will return the latest version of a record if its structure is valid
 //Will also return a record if it has been deactivated
 RecordStorageRecord* RecordStorage::GetRecord(u16 recordId) const
+{
+    if (!IsRecordIndexUsable()) return FindRecordOnPages(recordId);
+    if (!recordIndexValid) RebuildRecordIndex();
+
+    const u16 position = GetRecordIndexPosition(recordId);
+    if (position >= recordIndexCount || recordIndex[position].recordId != recordId)
+    {
+        //If all records fit into the index, a record that is not indexed does not exist
+        return recordIndexOverflowed ? FindRecordOnPages(recordId) : nullptr;
+    }
+
+    const u32 offset = recordIndex[position].offset * sizeof(u32);
+    RecordStorageRecord* record = (RecordStorageRecord*)(startPage + offset);
+    const RecordStoragePage& page = getPage(offset / FruityHal::GetCodePageSize());
+    if (record->recordId != recordId || GetPageState(page) != RecordStoragePageState::ACTIVE || !IsRecordValid(page, record))
+    {
+        //The flash was changed without the index knowing about it, e.g. because the pages were erased
+        InvalidateRecordIndex();
+        return FindRecordOnPages(recordId);
+    }
+    return record;
+}
+
+RecordStorageRecord* RecordStorage::FindRecordOnPages(u16 recordId) const
 {
     RecordStorageRecord* result = nullptr;
 
@@ -1029,6 +1076,97 @@ RecordStorageRecord* RecordStorage::GetRecord(u16 recordId) const
     return result;
 }
 
+bool RecordStorage::IsRecordIndexUsable() const
+{
+    //While the old page of a defragmentation is not yet erased, records might exist twice on active pages
+    const bool defragmentationAllowsIndex =
+           defragmentationStage == DefragmentationStage::NO_DEFRAGMENTATION
+        || defragmentationStage == DefragmentationStage::MOVE_TO_SWAP_PAGE
+        || defragmentationStage == DefragmentationStage::WRITE_PAGE_HEADER;
+
+    //A record that is being saved is already in the flash but only indexed once its write succeeded
+    return startPage != nullptr
+        && recordBeingSaved == nullptr
+        && repairStage == RepairStage::NO_REPAIR
+        && defragmentationAllowsIndex
+        && RECORD_STORAGE_NUM_PAGES * FruityHal::GetCodePageSize() / sizeof(u32) <= (u32)UINT16_MAX + 1;
+}
+
+//Walks through all records once, using the same rules as FindRecordOnPages to pick the latest version
+void RecordStorage::RebuildRecordIndex() const
+{
+    recordIndexCount = 0;
+    recordIndexOverflowed = false;
+
+    for (u32 i = 0; i < RECORD_STORAGE_NUM_PAGES; i++)
+    {
+        RecordStoragePage& page = getPage(i);
+        if (GetPageState(page) != RecordStoragePageState::ACTIVE) continue;
+
+        const RecordStorageRecord* record = (const RecordStorageRecord*)page.data;
+        while (IsRecordValid(page, record))
+        {
+            const u16 position = GetRecordIndexPosition(record->recordId);
+            if (position < recordIndexCount && recordIndex[position].recordId == record->recordId)
+            {
+                const RecordStorageRecord* indexedRecord = (const RecordStorageRecord*)(startPage + recordIndex[position].offset * sizeof(u32));
+                if (record->versionCounter > indexedRecord->versionCounter) UpdateRecordIndex(record);
+            }
+            else
+            {
+                UpdateRecordIndex(record);
+            }
+
+            record = (const RecordStorageRecord*)((const u8*)record + record->recordLength);
+        }
+    }
+
+    recordIndexValid = true;
+}
+
+void RecordStorage::InvalidateRecordIndex() const
+{
+    recordIndexValid = false;
+}
+
+//Stores the location of the given record as the latest version of its recordId
+void RecordStorage::UpdateRecordIndex(const RecordStorageRecord* record) const
+{
+    const u16 offset = (u16)(((const u8*)record - startPage) / sizeof(u32));
+    const u16 position = GetRecordIndexPosition(record->recordId);
+    if (position < recordIndexCount && recordIndex[position].recordId == record->recordId)
+    {
+        recordIndex[position].offset = offset;
+        return;
+    }
+    if (recordIndexCount >= RECORD_STORAGE_INDEX_SIZE)
+    {
+        recordIndexOverflowed = true;
+        return;
+    }
+    for (u16 i = recordIndexCount; i > position; i--)
+    {
+        recordIndex[i] = recordIndex[i - 1];
+    }
+    recordIndex[position].recordId = record->recordId;
+    recordIndex[position].offset = offset;
+    recordIndexCount++;
+}
+
+//Returns the position of the recordId in the index or the position where it would have to be inserted
+u16 RecordStorage::GetRecordIndexPosition(u16 recordId) const
+{
+    u16 low = 0;
+    u16 high = recordIndexCount;
+    while (low < high)
+    {
+        const u16 mid = low + (high - low) / 2;
+        if (recordIndex[mid].recordId < recordId) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
 bool RecordStorage::HasMortalRecords()
 {
     //Go through all pages
@@ -1078,7 +1216,7 @@ u8* RecordStorage::GetFreeRecordSpace(u16 dataLength) const
         }
 
         //Check if we have enough space left till the end of the page
-        if(((u32)record - (u32)&page + dataLength) <= FruityHal::GetCodePageSize()){
+        if(((u32)((u8*)record - (u8*)&page) + dataLength) <= FruityHal::GetCodePageSize()){
             return (u8*)record;
         }
     }
@@ -1097,7 +1235,7 @@ u16 RecordStorage::GetFreeSpaceOnPage(const RecordStoragePage& page) const
         record = (const RecordStorageRecord*)((const u8*)record + record->recordLength);
     }
 
-    return (FruityHal::GetCodePageSize() - ((u32)record - (u32)&page));
+    return (FruityHal::GetCodePageSize() - (u32)((const u8*)record - (const u8*)&page));
 }
 
 //Calculates the free storage that would be available when defragmenting the page
@@ -1143,7 +1281,7 @@ RecordStoragePage* RecordStorage::GetSwapPage() const
 bool RecordStorage::IsRecordValid(const RecordStoragePage& page, RecordStorageRecord const * record) const
 {
     //Check if length is within page boundaries
-    if(record == nullptr || ((u32)record - (u32)&page) + record->recordLength > FruityHal::GetCodePageSize()){
+    if(record == nullptr || (u32)((const u8*)record - (const u8*)&page) + record->recordLength > FruityHal::GetCodePageSize()){
         return false;
     }
 
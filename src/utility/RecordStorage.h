@@ -189,7 +189,7 @@ typedef struct
 } RecordStoragePage;
 STATIC_ASSERT_SIZE(RecordStoragePage, 5);
 
-constexpr int SIZEOF_RECORD_STORAGE_OPERATION = 14;
+constexpr int SIZEOF_RECORD_STORAGE_OPERATION = 10 + sizeof(void*); //Only lives in RAM, so it follows the size of a pointer
 typedef struct
 {
     RecordStorageEventListener* callback;
@@ -260,6 +260,10 @@ class RecordStorageEventListener;
 
 constexpr int RECORD_STORAGE_QUEUE_SIZE = 256;
 
+//Number of records whose location is kept in RAM (4 byte each) so that looking them up does not
+//have to go through all pages. If more records are stored, the remaining ones are searched on the pages.
+constexpr int RECORD_STORAGE_INDEX_SIZE = 64;
+
 /**
  * The RecordStorage is able to manage multiple records in the flash. It is possible to create new
  * records, update records and delete records. It uses the FlashStorage class for storage operations.
@@ -294,6 +298,21 @@ class RecordStorage : public FlashStorageEventListener
 
         bool processQueueInProgress = false;
 
+        //A RAM index of the newest version of each record, sorted by recordId. It only caches
+        //what is stored in the flash and is rebuilt once the pages were repaired or defragmented.
+        struct RecordIndexEntry
+        {
+            u16 recordId;
+            u16 offset; //Offset of the record from the startPage in multiples of 4 byte
+        };
+        mutable RecordIndexEntry recordIndex[RECORD_STORAGE_INDEX_SIZE] = {};
+        mutable u16 recordIndexCount = 0;
+        mutable bool recordIndexValid = false;
+        //Set if not all records fit in the index, records that are not indexed must then be searched on the pages
+        mutable bool recordIndexOverflowed = false;
+        //Location of the record that is currently being saved, it is indexed once the write succeeded
+        RecordStorageRecord* recordBeingSaved = nullptr;
+
         //Stores a record
         void SaveRecordInternal(SaveRecordOperation& op);
         //Removes a record
@@ -329,6 +348,15 @@ class RecordStorage : public FlashStorageEventListener
         RecordStoragePage * FindPageToDefragment() const;
         RecordStoragePage& getPage(u32 index) const;
 
+        //Looks through all pages for the latest version of a record without using the index
+        RecordStorageRecord* FindRecordOnPages(u16 recordId) const;
+        //The index can not be used while pages are repaired or while a defragmented page has two active copies
+        bool IsRecordIndexUsable() const;
+        void RebuildRecordIndex() const;
+        void InvalidateRecordIndex() const;
+        void UpdateRecordIndex(const RecordStorageRecord* record) const;
+        u16 GetRecordIndexPosition(u16 recordId) const;
+
         bool isInit = false;
 
         bool recordStorageLockDown = false;
@@ -894,6 +894,12 @@ bool Terminal::GetNextTerminalQueueEntry(TerminalCommandQueueEntry & out)
     }
 }
 
+bool Terminal::HasPendingTerminalCommands()
+{
+    std::unique_lock<std::mutex> guard(terminalMutex);
+    return !terminalCommandQueue.empty();
+}
+
 std::vector<std::string> tokenize(const std::string& message)
 {
     std::vector<std::string> retVal;
@@ -93,6 +93,7 @@ public:
 class Terminal
 {
         friend class DebugModule;
+        friend class CherrySim;
 
 private:
     const char* commandArgsPtr[MAX_NUM_TERM_ARGS];
@@ -216,6 +217,7 @@ private:
 public:
     void PutIntoTerminalCommandQueue(std::string &message, bool skipCrc);
     bool GetNextTerminalQueueEntry(TerminalCommandQueueEntry &out);
+    bool HasPendingTerminalCommands();
     void StdioPutString(const char* message);
 
 #endif